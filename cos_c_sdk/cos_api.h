@@ -300,6 +300,57 @@ cos_status_t *cos_do_list_object(const cos_request_options_t *options,
                               cos_list_object_params_t *params, 
                               cos_table_t **resp_headers);
 
+/*
+ * @brief  list cos objects with mulit-thread, the keys are split into partitions by the split
+ *         markers, or by the common prefixes of the delimiter, which are listed in parallel
+ * @param[in]   options       the cos request options
+ * @param[in]   bucket        the cos bucket name
+ * @param[in]   params        input params for parallel list object request,
+                              including prefix, marker, delimiter, split markers, max_ret, sorted
+ * @param[in]   clt_params    the control params of listing, thread_num and priority are used
+ * @param[in]   callback      called on the thread of the caller for every object, in the order of
+                              keys if params->sorted, the object is valid during the call only
+ * @param[in]   user_data     the data passed to callback
+ * @return  cos_status_t, code is 2xx success, other failure
+ */
+cos_status_t *cos_parallel_list_object(cos_request_options_t *options,
+                                       const cos_string_t *bucket,
+                                       cos_parallel_list_object_params_t *params,
+                                       cos_resumable_clt_params_t *clt_params,
+                                       cos_list_object_callback callback,
+                                       void *user_data);
+
+/*
+ * @brief  create an iterator of cos objects, the next page is listed in the background
+ *         while the objects of the page before are iterated
+ * @param[in]   options       the cos request options, which must outlive the iterator
+ * @param[in]   bucket        the cos bucket name
+ * @param[in]   params        input params for list object request,
+                              including prefix, marker, delimiter, max_ret
+ * @param[out]  iter          the iterator, destroyed by cos_list_iter_destroy
+ * @return  cos_status_t, code is 2xx success, other failure
+ */
+cos_status_t *cos_list_iter_create(cos_request_options_t *options,
+                                   const cos_string_t *bucket,
+                                   cos_list_object_params_t *params,
+                                   cos_list_iter_t **iter);
+
+/*
+ * @brief  get the next cos object of the iterator
+ * @param[in]   iter          the iterator
+ * @param[out]  content       the next object, NULL at the end of the listing or on failure,
+                              it is valid until the page after it is reached by next
+ * @return  cos_status_t, code is 2xx success, other failure
+ */
+cos_status_t *cos_list_iter_next(cos_list_iter_t *iter, 
+                                 cos_list_object_content_t **content);
+
+/*
+ * @brief  destroy the iterator, the page in flight is aborted
+ * @param[in]   iter          the iterator
+ */
+void cos_list_iter_destroy(cos_list_iter_t *iter);
+
 /*
  * @brief  put cos object from buffer
  * @param[in]   options             the cos request options
@@ -381,7 +432,10 @@ cos_status_t *cos_do_put_object_from_file(const cos_request_options_t *options,
                                           cos_list_t *resp_body);
 
 /*
- * @brief  get cos object to buffer
+ * @brief  get cos object to buffer, a read of the whole object or a Range is served by
+ *         the block cache once it is enabled by cos_set_block_cache, see cos_block_cache.h,
+ *         the identical reads running at once share one request once cos_set_single_flight
+ *         is called, see cos_single_flight.h
  * @param[in]   options             the cos request options
  * @param[in]   bucket              the cos bucket name
  * @param[in]   object              the cos object name
@@ -461,7 +515,9 @@ cos_status_t *cos_do_get_object_to_file(const cos_request_options_t *options,
                                         cos_table_t **resp_headers);
 
 /*
- * @brief  head cos object
+ * @brief  head cos object, without headers it is served by the metadata cache
+ *         once it is enabled by cos_set_meta_cache, see cos_meta_cache.h, the identical
+ *         heads running at once share one request once cos_set_single_flight is called
  * @param[in]   options          the cos request options
  * @param[in]   bucket           the cos bucket name
  * @param[in]   object           the cos object name
@@ -540,16 +596,48 @@ cos_status_t *cos_do_delete_objects(const cos_request_options_t *options,
                                  cos_list_t *deleted_object_list);
 
 /*
- * @brief  delete cos objects by prefix
+ * @brief  delete cos objects in quiet mode
  * @param[in]   options             the cos request options
  * @param[in]   bucket              the cos bucket name
- * @param[in]   prefix              prefix of delete objects
+ * @param[in]   object_list         the cos object list name
+ * @param[in]   headers             the headers for request
+ * @param[out]  resp_headers        cos server response headers
+ * @param[out]  failed_object_list  the objects failed to be deleted, empty if all are deleted
  * @return  cos_status_t, code is 2xx success, other failure
  */
+cos_status_t *cos_do_delete_objects_quiet(const cos_request_options_t *options,
+                                       const cos_string_t *bucket, 
+                                       cos_list_t *object_list, 
+                                       cos_table_t *headers,
+                                       cos_table_t **resp_headers, 
+                                       cos_list_t *failed_object_list);
+
+/*
+ * @brief  delete cos objects by prefix, the batches of keys are deleted in parallel by up to
+ *         cos_get_thread_pool_size threads, limited to the fair share of the shared thread pool
+ * @param[in]   options             the cos request options
+ * @param[in]   bucket              the cos bucket name
+ * @param[in]   prefix              prefix of delete objects
+ * @return  cos_status_t, the status of the last batch deleted, code is 2xx success, other failure
+ */
 cos_status_t *cos_delete_objects_by_prefix(cos_request_options_t *options,
                                            const cos_string_t *bucket, 
                                            const cos_string_t *prefix);
 
+/*
+ * @brief  delete cos objects by prefix with mulit-thread, the keys are listed ahead 
+ *         while the batches of them are deleted in parallel, the keys failed in a batch are retried
+ * @param[in]   options             the cos request options
+ * @param[in]   bucket              the cos bucket name
+ * @param[in]   prefix              prefix of delete objects
+ * @param[in]   clt_params          the control params of deleting, thread_num and priority are used
+ * @return  cos_status_t, code is 2xx success, other failure
+ */
+cos_status_t *cos_parallel_delete_objects_by_prefix(cos_request_options_t *options,
+                                                    const cos_string_t *bucket, 
+                                                    const cos_string_t *prefix,
+                                                    cos_resumable_clt_params_t *clt_params);
+
 
 /*
  * @brief  append cos object from buffer
@@ -976,11 +1064,11 @@ cos_status_t *cos_list_multipart_upload(const cos_request_options_t *options,
                                         cos_list_multipart_upload_params_t *params, 
                                         cos_table_t **resp_headers);
 
-#if 0
 /*
  * @brief  cos copy large object using upload part copy
  * @param[in]   options             the cos request options
- * @param[in]   paramsthe           upload part copy parameters
+ * @param[in]   params              the upload part copy parameters, the etag of the part is
+ *                                  returned in params->rsp_content
  * @param[in]   headers             the headers for request
  * @param[out]  resp_headers        cos server response headers
  * @return  cos_status_t, code is 2xx success, other failure
@@ -989,7 +1077,6 @@ cos_status_t *cos_upload_part_copy(const cos_request_options_t *options,
                                    cos_upload_part_copy_params_t *params, 
                                    cos_table_t *headers, 
                                    cos_table_t **resp_headers);
-#endif
 
 /*
  * @brief  cos upload file using multipart upload
@@ -1046,6 +1133,31 @@ cos_status_t *cos_do_download_part_to_file(const cos_request_options_t *options,
                                            cos_table_t *params,
                                            cos_table_t **resp_headers);
 
+/*
+ * @brief  cos download part to buffer
+ * @param[in]   options             the cos request options
+ * @param[in]   bucket              the cos bucket name
+ * @param[in]   object              the cos object name
+ * @param[in]   start               the first byte of the part
+ * @param[in]   end                 the byte after the last byte of the part
+ * @param[out]  buffer              the buffer list to save the download content
+ * @param[in]   progress_callback   the progress callback function
+ * @param[in]   headers             the headers for request
+ * @param[in]   params              the params for request
+ * @param[out]  resp_headers        cos server response headers
+ * @return  cos_status_t, code is 2xx success, other failure
+ */
+cos_status_t *cos_do_download_part_to_buffer(const cos_request_options_t *options,
+                                             const cos_string_t *bucket, 
+                                             const cos_string_t *object,
+                                             int64_t start,
+                                             int64_t end,
+                                             cos_list_t *buffer,
+                                             cos_progress_callback progress_callback,
+                                             cos_table_t *headers, 
+                                             cos_table_t *params,
+                                             cos_table_t **resp_headers);
+
 /*
  * @brief  cos upload file with mulit-thread and resumable
  * @param[in]   options             the cos request options
@@ -1069,6 +1181,136 @@ cos_status_t *cos_resumable_upload_file(cos_request_options_t *options,
                                         cos_table_t **resp_headers,
                                         cos_list_t *resp_body);
 
+/*
+ * @brief  cos upload object from a stream with mulit-thread, such as a pipe or a socket
+ *         the stream is read into thread_num part buffers of part_size while the full
+ *         parts are uploading, so the memory is part_size * thread_num, the upload is
+ *         completed at the end of the stream and aborted on failure, it can not be resumed
+ * @param[in]   options             the cos request options
+ * @param[in]   bucket              the cos bucket name
+ * @param[in]   object              the cos object name
+ * @param[in]   headers             the headers for request    
+ * @param[in]   clt_params          the control params of upload, checkpoint is not supported
+ * @param[in]   read_callback       read at most size bytes of the stream into buffer,
+ *                                  return the number of bytes read, 0 at the end, negative on failure
+ * @param[in]   user_data           the data passed to read_callback
+ * @param[in]   progress_callback   the progress callback function, total_bytes is -1
+ * @param[out]  resp_headers        cos server response headers
+ * @param[out]  resp_body           cos server response body
+ * @return  cos_status_t, code is 2xx success, other failure
+ */
+cos_status_t *cos_resumable_upload_stream(cos_request_options_t *options,
+                                          cos_string_t *bucket, 
+                                          cos_string_t *object, 
+                                          cos_table_t *headers,
+                                          cos_resumable_clt_params_t *clt_params, 
+                                          cos_read_stream_callback read_callback,
+                                          void *user_data,
+                                          cos_progress_callback progress_callback,
+                                          cos_table_t **resp_headers,
+                                          cos_list_t *resp_body);
+
+/*
+ * @brief  cos upload object from memory with mulit-thread, the parts are sent from views of
+ *         the buffer without copying it, the buffer must not be modified until it returns,
+ *         with crc enabled the object is verified by the crc64 combined from the parts,
+ *         the upload is aborted on failure, it can not be resumed
+ * @param[in]   options             the cos request options
+ * @param[in]   bucket              the cos bucket name
+ * @param[in]   object              the cos object name
+ * @param[in]   buffer              the content of the object, a list of cos_buf_t
+ * @param[in]   headers             the headers for request
+ * @param[in]   clt_params          the control params of upload, checkpoint is not supported
+ * @param[in]   progress_callback   the progress callback function
+ * @param[out]  resp_headers        cos server response headers
+ * @param[out]  resp_body           cos server response body
+ * @return  cos_status_t, code is 2xx success, other failure
+ */
+cos_status_t *cos_resumable_upload_buffer(cos_request_options_t *options,
+                                          cos_string_t *bucket,
+                                          cos_string_t *object,
+                                          cos_list_t *buffer,
+                                          cos_table_t *headers,
+                                          cos_resumable_clt_params_t *clt_params,
+                                          cos_progress_callback progress_callback,
+                                          cos_table_t **resp_headers,
+                                          cos_list_t *resp_body);
+
+/*
+ * @brief  cos download file with mulit-thread and resumable
+ * @param[in]   options             the cos request options
+ * @param[in]   bucket              the cos bucket name
+ * @param[in]   object              the cos object name
+ * @param[in]   filepath            the local file to save the object content
+ * @param[in]   headers             the headers for request    
+ * @param[in]   params              the params for request
+ * @param[in]   clt_params          the control params of download, with checkpoint enabled
+ *                                  the completed parts are saved to ./filepath.dcp by default
+ *                                  and an interrupted download only fetches the missing parts
+ * @param[in]   progress_callback   the progress callback function
+ * @return  cos_status_t, code is 2xx success, other failure
+ */
+cos_status_t *cos_resumable_download_file(cos_request_options_t *options,
+                                          cos_string_t *bucket, 
+                                          cos_string_t *object, 
+                                          cos_string_t *filepath,                           
+                                          cos_table_t *headers,
+                                          cos_table_t *params,
+                                          cos_resumable_clt_params_t *clt_params, 
+                                          cos_progress_callback progress_callback);
+
+/*
+ * @brief  cos copy object with mulit-thread upload part copy and resumable
+ * @param[in]   options             the cos request options
+ * @param[in]   copy_source         the cos copy source, bucket-appid.cos.region.myqcloud.com/object
+ * @param[in]   dest_bucket         the cos dest bucket name
+ * @param[in]   dest_object         the cos dest object name
+ * @param[in]   headers             the headers for request    
+ * @param[in]   params              the params for request
+ * @param[in]   clt_params          the control params of copy, the parts are 16MB to 5GB,
+ *                                  with checkpoint enabled the completed parts are saved to
+ *                                  checkpoint_path, by default a file named by the md5 of the
+ *                                  source and the destination in the temp dir, an interrupted
+ *                                  copy only copies the missing parts if the source is not
+ *                                  modified, without checkpoint the upload is aborted when it fails
+ * @param[in]   progress_callback   the progress callback function
+ * @param[out]  resp_headers        cos server response headers
+ * @param[out]  resp_body           cos server response body
+ * @return  cos_status_t, code is 2xx success, other failure
+ */
+cos_status_t *cos_resumable_copy_object(cos_request_options_t *options,
+                                        cos_string_t *copy_source,
+                                        cos_string_t *dest_bucket, 
+                                        cos_string_t *dest_object, 
+                                        cos_table_t *headers,
+                                        cos_table_t *params,
+                                        cos_resumable_clt_params_t *clt_params, 
+                                        cos_progress_callback progress_callback,
+                                        cos_table_t **resp_headers,
+                                        cos_list_t *resp_body);
+
+/*
+ * @brief  cos download object to a stream with mulit-thread, such as a decompressor or a socket
+ *         the parts are downloaded in parallel into a reorder buffer of clt_params->buffer_size
+ *         bytes and handed to write_callback strictly in order, nothing is saved to disk
+ * @param[in]   options             the cos request options
+ * @param[in]   bucket              the cos bucket name
+ * @param[in]   object              the cos object name
+ * @param[in]   clt_params          the control params of download, checkpoint is not supported
+ * @param[in]   write_callback      write size bytes of the object, return size to continue,
+ *                                  other values abort the download
+ * @param[in]   user_data           the data passed to write_callback
+ * @param[in]   progress_callback   the progress callback function
+ * @return  cos_status_t, code is 2xx success, other failure
+ */
+cos_status_t *cos_resumable_download_stream(cos_request_options_t *options,
+                                            cos_string_t *bucket, 
+                                            cos_string_t *object, 
+                                            cos_resumable_clt_params_t *clt_params, 
+                                            cos_write_stream_callback write_callback,
+                                            void *user_data,
+                                            cos_progress_callback progress_callback);
+
 #if 0
 /*
  * @brief  cos create live channel
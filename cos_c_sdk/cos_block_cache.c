@@ -0,0 +1,1126 @@
+#include "cos_log.h"
+#include "cos_sys_define.h"
+#include "cos_sys_util.h"
+#include "cos_define.h"
+#include "cos_utility.h"
+#include "cos_crc64.h"
+#include "cos_block_cache.h"
+#include "apr_hash.h"
+#include "apr_atomic.h"
+#include "apr_thread_mutex.h"
+
+#define COS_BLOCK_CACHE_GENERATION_NUM 64
+
+typedef struct cos_block_cache_object_s cos_block_cache_object_t;
+typedef struct cos_block_cache_block_s cos_block_cache_block_t;
+
+/**
+  * @brief the data of a block, it is referenced by the cache and the responses served from it,
+  *        the data follows the header
+**/
+typedef struct {
+    apr_uint32_t refs;      // use atomic
+    int len;
+} cos_block_data_t;
+
+struct cos_block_cache_object_s {
+    cos_list_t node;
+    char *key;
+    char *access_key_id;    // the credentials the blocks are read with, they are not served to others
+    apr_uint64_t id;        // identifies the object while its files are read without locking
+    char *etag;
+    char **headers;         // the headers describing the object, key and value pairs ended by NULL, NULL if none
+    int64_t size;
+    apr_time_t validated;   // the time the blocks are known to be the data of the object
+    cos_list_t blocks;
+};
+
+typedef struct {
+    cos_block_cache_object_t *object;
+    int64_t index;
+} cos_block_id_t;
+
+/**
+  * @brief the write of a block to the disk tier, it is done once the mutex is unlocked
+**/
+typedef struct {
+    cos_list_t node;
+    cos_block_cache_block_t *block; // NULL once the block is removed during the write
+    cos_block_data_t *data;         // referenced by the write
+    apr_uint64_t file_id;
+    char *path;
+    int failed;
+} cos_block_spill_t;
+
+/**
+  * @brief a file of the disk tier to remove once the mutex is unlocked
+**/
+typedef struct {
+    cos_list_t node;
+    char *path;
+} cos_block_file_t;
+
+struct cos_block_cache_block_s {
+    cos_block_id_t id;      // the key in cos_block_cache_blocks
+    cos_list_t node;        // in the lru of its tier, the most recently used first, not in a list while spilled
+    cos_list_t object_node;
+    cos_block_data_t *data; // NULL if the block is in the disk tier
+    cos_block_spill_t *spill;   // the write to the disk tier in progress, NULL if none
+    apr_uint64_t file_id;   // the file of the block in the disk tier, 0 if none
+    int len;
+};
+
+/**
+  * @brief a block referenced by a read, the blocks in the disk tier are read without locking
+**/
+typedef struct {
+    cos_block_data_t *data;
+    apr_uint64_t file_id;   // the file the data is read from, 0 if the block is in memory
+    char *path;
+} cos_block_ref_t;
+
+static cos_pool_t *cos_block_cache_pool = NULL;
+static apr_thread_mutex_t *cos_block_cache_mutex = NULL;
+static apr_hash_t *cos_block_cache_objects = NULL;
+static apr_hash_t *cos_block_cache_blocks = NULL;
+static cos_list_t cos_block_cache_object_list;
+static cos_list_t cos_block_cache_memory_lru;
+static cos_list_t cos_block_cache_disk_lru;
+static cos_list_t cos_block_cache_spills;
+static cos_list_t cos_block_cache_removals;
+static int64_t cos_block_cache_memory_size = 0;
+static int64_t cos_block_cache_memory_used = 0;     // the blocks being spilled are not counted
+static int64_t cos_block_cache_disk_size = 0;
+static int64_t cos_block_cache_disk_used = 0;
+static char *cos_block_cache_dir = NULL;
+static int cos_block_cache_block_size = COS_BLOCK_CACHE_DEFAULT_BLOCK_SIZE;
+static apr_time_t cos_block_cache_ttl = 0;
+static apr_uint64_t cos_block_cache_next_id = 0;
+static apr_uint64_t cos_block_cache_next_file_id = 1;
+static apr_uint32_t cos_block_cache_generations[COS_BLOCK_CACHE_GENERATION_NUM];
+
+static void cos_block_data_release(cos_block_data_t *data)
+{
+    if (0 == apr_atomic_dec32(&data->refs)) {
+        free(data);
+    }
+}
+
+static apr_status_t cos_block_cache_release(void *data)
+{
+    cos_block_data_release((cos_block_data_t *)data);
+    return APR_SUCCESS;
+}
+
+// the generation of key changes on each invalidation, called with cos_block_cache_mutex locked
+static apr_uint32_t *cos_block_cache_generation(const char *key)
+{
+    apr_ssize_t key_len = APR_HASH_KEY_STRING;
+    return cos_block_cache_generations + apr_hashfunc_default(key, &key_len) % COS_BLOCK_CACHE_GENERATION_NUM;
+}
+
+// the path is used after the mutex is unlocked, so it is allocated by malloc
+static char *cos_block_cache_path(apr_uint64_t file_id)
+{
+    char *path;
+    apr_size_t size = strlen(cos_block_cache_dir) + 64;
+
+    path = (char *)malloc(size);
+    if (path != NULL) {
+        apr_snprintf(path, size, "%s/cos_block_%" APR_UINT64_T_FMT, cos_block_cache_dir, file_id);
+    }
+    return path;
+}
+
+static void cos_block_cache_remove_file(char *path)
+{
+    cos_block_file_t *file;
+
+    file = (cos_block_file_t *)malloc(sizeof(cos_block_file_t));
+    if (NULL == file) {
+        free(path);
+        return;
+    }
+    file->path = path;
+    cos_list_add_tail(&file->node, &cos_block_cache_removals);
+}
+
+static cos_block_cache_block_t *cos_block_cache_find(cos_block_cache_object_t *object, int64_t index)
+{
+    cos_block_id_t id;
+
+    memset(&id, 0, sizeof(id));
+    id.object = object;
+    id.index = index;
+    return (cos_block_cache_block_t *)apr_hash_get(cos_block_cache_blocks, &id, sizeof(id));
+}
+
+// the headers of a response that do not describe the object, they are not served with the cached blocks
+static const char *cos_block_cache_response_headers[] = {
+    COS_CONTENT_LENGTH, COS_CONTENT_RANGE, COS_DATE, COS_TRANSFER_ENCODING,
+    "Connection", "Keep-Alive", "Server", "x-cos-request-id", "x-cos-trace-id", NULL
+};
+
+// copy the headers describing the object, e.g. Content-Type and x-cos-meta-*, they outlive the response
+static char **cos_block_cache_copy_headers(cos_table_t *headers)
+{
+    int i;
+    int j;
+    int n = 0;
+    char **copy;
+    const apr_array_header_t *arr = apr_table_elts(headers);
+    const apr_table_entry_t *elts = (const apr_table_entry_t *)arr->elts;
+
+    copy = (char **)calloc(arr->nelts * 2 + 1, sizeof(char *));
+    if (NULL == copy) {
+        return NULL;
+    }
+    for (i = 0; i < arr->nelts; i++) {
+        if (NULL == elts[i].key || NULL == elts[i].val) {
+            continue;
+        }
+        for (j = 0; cos_block_cache_response_headers[j] != NULL; j++) {
+            if (0 == strcasecmp(elts[i].key, cos_block_cache_response_headers[j])) {
+                break;
+            }
+        }
+        if (cos_block_cache_response_headers[j] != NULL) {
+            continue;
+        }
+        copy[n] = strdup(elts[i].key);
+        copy[n + 1] = strdup(elts[i].val);
+        if (NULL == copy[n] || NULL == copy[n + 1]) {
+            free(copy[n]);
+            free(copy[n + 1]);
+            copy[n] = NULL;
+            copy[n + 1] = NULL;
+            break;
+        }
+        n += 2;
+    }
+    return copy;
+}
+
+static void cos_block_cache_free_headers(char **headers)
+{
+    char **h;
+
+    if (NULL == headers) {
+        return;
+    }
+    for (h = headers; *h != NULL; h++) {
+        free(*h);
+    }
+    free(headers);
+}
+
+static void cos_block_cache_free_object(cos_block_cache_object_t *object)
+{
+    apr_hash_set(cos_block_cache_objects, object->key, APR_HASH_KEY_STRING, NULL);
+    cos_list_del(&object->node);
+    free(object->key);
+    free(object->access_key_id);
+    free(object->etag);
+    cos_block_cache_free_headers(object->headers);
+    free(object);
+}
+
+// take the block out of its tier, the block keeps its place in the object
+static void cos_block_cache_unload(cos_block_cache_block_t *block)
+{
+    if (block->spill != NULL) {
+        // the file is removed by the thread writing it
+        block->spill->block = NULL;
+        block->spill = NULL;
+        cos_block_data_release(block->data);
+        block->data = NULL;
+    } else if (block->data != NULL) {
+        cos_list_del(&block->node);
+        cos_block_cache_memory_used -= block->len;
+        cos_block_data_release(block->data);
+        block->data = NULL;
+    } else {
+        cos_list_del(&block->node);
+        cos_block_cache_disk_used -= block->len;
+        cos_block_cache_remove_file(cos_block_cache_path(block->file_id));
+        block->file_id = 0;
+    }
+}
+
+// the object is freed with its last block
+static void cos_block_cache_remove(cos_block_cache_block_t *block)
+{
+    cos_block_cache_object_t *object = block->id.object;
+
+    cos_block_cache_unload(block);
+    apr_hash_set(cos_block_cache_blocks, &block->id, sizeof(block->id), NULL);
+    cos_list_del(&block->object_node);
+    free(block);
+
+    if (cos_list_empty(&object->blocks)) {
+        cos_block_cache_free_object(object);
+    }
+}
+
+static void cos_block_cache_drop(cos_block_cache_object_t *object)
+{
+    int last;
+    cos_block_cache_block_t *block;
+
+    // an object has a block at least, it is freed with the last one
+    do {
+        block = cos_list_entry(object->blocks.next, cos_block_cache_block_t, object_node);
+        last = (block->object_node.next == &object->blocks);
+        cos_block_cache_remove(block);
+    } while (!last);
+}
+
+static void cos_block_cache_drop_all()
+{
+    cos_block_cache_object_t *object;
+    cos_block_cache_object_t *n;
+
+    cos_list_for_each_entry_safe(cos_block_cache_object_t, object, n, &cos_block_cache_object_list, node) {
+        cos_block_cache_drop(object);
+    }
+}
+
+// queue the write of a block to the disk tier, it is still served from memory meanwhile
+static int cos_block_cache_spill(cos_block_cache_block_t *block)
+{
+    cos_block_spill_t *spill;
+
+    spill = (cos_block_spill_t *)calloc(1, sizeof(cos_block_spill_t));
+    if (NULL == spill) {
+        return COSE_OUT_MEMORY;
+    }
+    spill->file_id = cos_block_cache_next_file_id++;
+    spill->path = cos_block_cache_path(spill->file_id);
+    if (NULL == spill->path) {
+        free(spill);
+        return COSE_OUT_MEMORY;
+    }
+    spill->block = block;
+    spill->data = block->data;
+    apr_atomic_inc32(&spill->data->refs);
+
+    cos_list_del(&block->node);
+    cos_block_cache_memory_used -= block->len;
+    block->spill = spill;
+    cos_list_add_tail(&spill->node, &cos_block_cache_spills);
+
+    return COSE_OK;
+}
+
+static void cos_block_cache_evict()
+{
+    cos_block_cache_block_t *block;
+
+    while (cos_block_cache_memory_used > cos_block_cache_memory_size) {
+        block = cos_list_entry(cos_block_cache_memory_lru.prev, cos_block_cache_block_t, node);
+        if (0 == cos_block_cache_disk_size || cos_block_cache_spill(block) != COSE_OK) {
+            cos_block_cache_remove(block);
+        }
+    }
+    while (cos_block_cache_disk_used > cos_block_cache_disk_size) {
+        block = cos_list_entry(cos_block_cache_disk_lru.prev, cos_block_cache_block_t, node);
+        cos_block_cache_remove(block);
+    }
+}
+
+static int cos_block_cache_write(cos_pool_t *p, cos_block_spill_t *spill)
+{
+    int s;
+    apr_size_t bytes;
+    apr_file_t *file;
+
+    s = apr_file_open(&file, spill->path, APR_CREATE | APR_WRITE | APR_TRUNCATE | APR_BINARY,
+                      APR_UREAD | APR_UWRITE, p);
+    if (APR_SUCCESS == s) {
+        s = apr_file_write_full(file, spill->data + 1, spill->data->len, &bytes);
+        apr_file_close(file);
+        if (s != APR_SUCCESS) {
+            apr_file_remove(spill->path, p);
+        }
+    }
+    return (APR_SUCCESS == s) ? COSE_OK : COSE_FILE_WRITE_ERROR;
+}
+
+// called with cos_block_cache_mutex locked after the write
+static void cos_block_cache_finish_spill(cos_block_spill_t *spill)
+{
+    cos_block_cache_block_t *block = spill->block;
+
+    if (NULL == block) {
+        if (spill->failed) {
+            free(spill->path);
+        } else {
+            cos_block_cache_remove_file(spill->path);
+        }
+    } else if (spill->failed) {
+        // back to memory to be removed from it
+        block->spill = NULL;
+        __cos_list_add(&block->node, &cos_block_cache_memory_lru, cos_block_cache_memory_lru.next);
+        cos_block_cache_memory_used += block->len;
+        cos_block_cache_remove(block);
+        free(spill->path);
+    } else {
+        block->spill = NULL;
+        cos_block_data_release(block->data);
+        block->data = NULL;
+        block->file_id = spill->file_id;
+        __cos_list_add(&block->node, &cos_block_cache_disk_lru, cos_block_cache_disk_lru.next);
+        cos_block_cache_disk_used += block->len;
+        free(spill->path);
+    }
+    cos_block_data_release(spill->data);
+    free(spill);
+}
+
+// unlock cos_block_cache_mutex, then do the file io queued while it is locked,
+// so the reads of the cache don't wait for the disk tier
+static void cos_block_cache_unlock()
+{
+    cos_pool_t *p = NULL;
+    cos_list_t spills;
+    cos_list_t removals;
+    cos_block_spill_t *spill;
+    cos_block_spill_t *next_spill;
+    cos_block_file_t *file;
+    cos_block_file_t *next_file;
+
+    for (;;) {
+        cos_list_movelist(&cos_block_cache_spills, &spills);
+        cos_list_movelist(&cos_block_cache_removals, &removals);
+        apr_thread_mutex_unlock(cos_block_cache_mutex);
+        if (cos_list_empty(&spills) && cos_list_empty(&removals)) {
+            break;
+        }
+        if (NULL == p && cos_pool_create(&p, NULL) != APR_SUCCESS) {
+            p = NULL;
+        }
+
+        cos_list_for_each_entry_safe(cos_block_file_t, file, next_file, &removals, node) {
+            if (p != NULL) {
+                apr_file_remove(file->path, p);
+            }
+            free(file->path);
+            free(file);
+        }
+        if (cos_list_empty(&spills)) {
+            break;
+        }
+        cos_list_for_each_entry(cos_block_spill_t, spill, &spills, node) {
+            spill->failed = (NULL == p || cos_block_cache_write(p, spill) != COSE_OK);
+        }
+        if (p != NULL) {
+            apr_pool_clear(p);
+        }
+
+        // the finished spills may evict the disk tier, whose files are removed by the next round
+        apr_thread_mutex_lock(cos_block_cache_mutex);
+        cos_list_for_each_entry_safe(cos_block_spill_t, spill, next_spill, &spills, node) {
+            cos_block_cache_finish_spill(spill);
+        }
+        cos_block_cache_evict();
+    }
+
+    if (p != NULL) {
+        cos_pool_destroy(p);
+    }
+}
+
+static cos_block_data_t *cos_block_data_create(int len)
+{
+    cos_block_data_t *data;
+
+    data = (cos_block_data_t *)malloc(sizeof(cos_block_data_t) + len);
+    if (data != NULL) {
+        data->refs = 1;
+        data->len = len;
+    }
+    return data;
+}
+
+static void cos_block_cache_release_refs(cos_block_ref_t *refs, int64_t count)
+{
+    int64_t i;
+
+    for (i = 0; i < count; i++) {
+        cos_block_data_release(refs[i].data);
+    }
+}
+
+// reference the data of count blocks from first, stop at the first block not cached,
+// the data of a block in the disk tier is read by cos_block_cache_read once the mutex is unlocked,
+// return the number of blocks referenced
+static int64_t cos_block_cache_collect(cos_pool_t *p, cos_block_cache_object_t *object, int64_t first,
+                                       int64_t count, cos_block_ref_t *refs)
+{
+    int64_t i;
+    char *path;
+    cos_block_cache_block_t *block;
+
+    for (i = 0; i < count; i++) {
+        block = cos_block_cache_find(object, first + i);
+        if (NULL == block) {
+            break;
+        }
+        refs[i].file_id = 0;
+        refs[i].path = NULL;
+        if (block->data != NULL) {
+            if (NULL == block->spill) {
+                cos_list_del(&block->node);
+                __cos_list_add(&block->node, &cos_block_cache_memory_lru, cos_block_cache_memory_lru.next);
+            }
+            apr_atomic_inc32(&block->data->refs);
+            refs[i].data = block->data;
+            continue;
+        }
+
+        refs[i].data = cos_block_data_create(block->len);
+        path = cos_block_cache_path(block->file_id);
+        if (NULL == refs[i].data || NULL == path) {
+            free(refs[i].data);
+            free(path);
+            break;
+        }
+        refs[i].file_id = block->file_id;
+        refs[i].path = apr_pstrdup(p, path);
+        free(path);
+    }
+    return i;
+}
+
+// read the blocks of the disk tier without locking, read is the number of blocks read from the first,
+// return COS_TRUE if any block is in the disk tier
+static int cos_block_cache_read(cos_pool_t *p, cos_block_ref_t *refs, int64_t count, int64_t *read)
+{
+    int64_t i;
+    int s;
+    int disk = COS_FALSE;
+    apr_size_t bytes;
+    apr_file_t *file;
+
+    for (i = 0; i < count; i++) {
+        if (NULL == refs[i].path) {
+            continue;
+        }
+        disk = COS_TRUE;
+        s = apr_file_open(&file, refs[i].path, APR_READ | APR_BINARY, APR_UREAD, p);
+        if (APR_SUCCESS == s) {
+            s = apr_file_read_full(file, refs[i].data + 1, refs[i].data->len, &bytes);
+            apr_file_close(file);
+        }
+        if (s != APR_SUCCESS) {
+            break;
+        }
+    }
+    *read = i;
+    return disk;
+}
+
+// move the blocks read from the disk tier to memory, the block failed to read is removed,
+// so it is fetched again, called with cos_block_cache_mutex locked
+static void cos_block_cache_promote(cos_block_cache_object_t *object, int64_t first,
+                                    cos_block_ref_t *refs, int64_t count, int64_t read)
+{
+    int64_t i;
+    cos_block_cache_block_t *block;
+
+    for (i = 0; i < count && i <= read; i++) {
+        block = cos_block_cache_find(object, first + i);
+        if (NULL == refs[i].path || NULL == block || block->data != NULL || block->file_id != refs[i].file_id) {
+            continue;
+        }
+        if (i == read) {
+            cos_block_cache_remove(block);
+            break;
+        }
+        cos_block_cache_unload(block);
+        block->data = refs[i].data;
+        apr_atomic_inc32(&block->data->refs);
+        __cos_list_add(&block->node, &cos_block_cache_memory_lru, cos_block_cache_memory_lru.next);
+        cos_block_cache_memory_used += block->len;
+    }
+    cos_block_cache_evict();
+}
+
+static char *cos_block_cache_strdup(const char *str)
+{
+    return (NULL == str) ? NULL : strdup(str);
+}
+
+// the cached object of key read with access_key_id, called with cos_block_cache_mutex locked
+static cos_block_cache_object_t *cos_block_cache_lookup(const char *key, const cos_string_t *access_key_id)
+{
+    cos_block_cache_object_t *object;
+
+    object = (cos_block_cache_object_t *)apr_hash_get(cos_block_cache_objects, key, APR_HASH_KEY_STRING);
+    if (object != NULL && (strlen(object->access_key_id) != (size_t)access_key_id->len ||
+        memcmp(object->access_key_id, access_key_id->data, access_key_id->len) != 0))
+    {
+        // another client may not be allowed to read the object
+        return NULL;
+    }
+    return object;
+}
+
+// store the complete blocks of a response at offset of an object of size bytes
+static void cos_block_cache_store(const char *key, const cos_string_t *access_key_id, apr_uint32_t generation,
+                                  int64_t offset, int64_t size, cos_http_response_t *resp)
+{
+    int i;
+    int n;
+    int len;
+    int64_t body_len;
+    int64_t copied;
+    int block_size = cos_block_cache_block_size;
+    const char *etag;
+    char **headers;
+    cos_buf_t *b;
+    cos_block_data_t **datas;
+    cos_block_cache_object_t *object;
+    cos_block_cache_block_t *block;
+
+    etag = apr_table_get(resp->headers, COS_ETAG);
+    body_len = cos_buf_list_len(&resp->body);
+    if (NULL == etag || 0 != offset % block_size || body_len > cos_block_cache_memory_size) {
+        return;
+    }
+
+    // the last block of the object may be short
+    n = (int)(body_len / block_size);
+    if (offset + body_len == size && 0 != body_len % block_size) {
+        n++;
+    }
+    if (0 == n) {
+        return;
+    }
+
+    // copy the body without locking
+    datas = (cos_block_data_t **)cos_pcalloc(resp->pool, sizeof(cos_block_data_t *) * n);
+    for (i = 0; i < n; i++) {
+        len = (int)cos_min(block_size, body_len - (int64_t)i * block_size);
+        datas[i] = cos_block_data_create(len);
+        if (NULL == datas[i]) {
+            while (i-- > 0) {
+                cos_block_data_release(datas[i]);
+            }
+            return;
+        }
+    }
+    i = 0;
+    copied = 0;
+    cos_list_for_each_entry(cos_buf_t, b, &resp->body, node) {
+        for (len = cos_buf_size(b); len > 0 && i < n; ) {
+            int m = (int)cos_min(len, datas[i]->len - copied);
+            memcpy((char *)(datas[i] + 1) + copied, b->last - len, m);
+            len -= m;
+            copied += m;
+            if (copied == datas[i]->len) {
+                i++;
+                copied = 0;
+            }
+        }
+    }
+    headers = cos_block_cache_copy_headers(resp->headers);
+
+    apr_thread_mutex_lock(cos_block_cache_mutex);
+    if (*cos_block_cache_generation(key) != generation || 0 == cos_block_cache_memory_size ||
+        block_size != cos_block_cache_block_size)
+    {
+        // the object may be changed while the request is sent
+        cos_block_cache_unlock();
+        for (i = 0; i < n; i++) {
+            cos_block_data_release(datas[i]);
+        }
+        cos_block_cache_free_headers(headers);
+        return;
+    }
+
+    object = (cos_block_cache_object_t *)apr_hash_get(cos_block_cache_objects, key, APR_HASH_KEY_STRING);
+    if (object != NULL && (NULL == cos_block_cache_lookup(key, access_key_id) || strcmp(object->etag, etag) != 0)) {
+        // the blocks of another version or another client are replaced
+        cos_block_cache_drop(object);
+        object = NULL;
+    }
+    if (NULL == object) {
+        object = (cos_block_cache_object_t *)calloc(1, sizeof(cos_block_cache_object_t));
+        object->key = strdup(key);
+        object->access_key_id = (char *)malloc(access_key_id->len + 1);
+        memcpy(object->access_key_id, access_key_id->data, access_key_id->len);
+        object->access_key_id[access_key_id->len] = '\0';
+        object->id = cos_block_cache_next_id++;
+        cos_list_init(&object->blocks);
+        cos_list_add_tail(&object->node, &cos_block_cache_object_list);
+        apr_hash_set(cos_block_cache_objects, object->key, APR_HASH_KEY_STRING, object);
+    }
+    free(object->etag);
+    cos_block_cache_free_headers(object->headers);
+    object->etag = strdup(etag);
+    object->headers = headers;
+    object->size = size;
+    object->validated = apr_time_now();
+
+    for (i = 0; i < n; i++) {
+        block = cos_block_cache_find(object, offset / block_size + i);
+        if (NULL == block) {
+            block = (cos_block_cache_block_t *)calloc(1, sizeof(cos_block_cache_block_t));
+            block->id.object = object;
+            block->id.index = offset / block_size + i;
+            apr_hash_set(cos_block_cache_blocks, &block->id, sizeof(block->id), block);
+            cos_list_add_tail(&block->object_node, &object->blocks);
+        } else {
+            cos_block_cache_unload(block);
+        }
+        block->data = datas[i];
+        block->len = datas[i]->len;
+        __cos_list_add(&block->node, &cos_block_cache_memory_lru, cos_block_cache_memory_lru.next);
+        cos_block_cache_memory_used += block->len;
+    }
+    cos_block_cache_evict();
+    cos_block_cache_unlock();
+}
+
+// COS_TRUE if the read may be served by the cache, end is -1 for the end of the object
+static int cos_block_cache_parse_read(cos_table_t *headers, cos_table_t *params,
+                                      int *has_range, int64_t *start, int64_t *end)
+{
+    const char *range;
+    const char *dash;
+
+    *has_range = COS_FALSE;
+    *start = 0;
+    *end = -1;
+    if (params != NULL && !apr_is_empty_table(params)) {
+        return COS_FALSE;
+    }
+    if (NULL == headers || apr_is_empty_table(headers)) {
+        return COS_TRUE;
+    }
+
+    range = apr_table_get(headers, COS_RANGE);
+    if (NULL == range || apr_table_elts(headers)->nelts != 1 ||
+        strncmp(range, "bytes=", 6) != 0 || NULL == (dash = strchr(range + 6, '-')))
+    {
+        return COS_FALSE;
+    }
+    *start = cos_atoi64_n(range + 6, (int)(dash - range - 6));
+    if (dash[1] != '\0') {
+        *end = cos_atoi64_n(dash + 1, strlen(dash + 1));
+        if (*end < *start) {
+            return COS_FALSE;
+        }
+    }
+    *has_range = COS_TRUE;
+    return *start >= 0;
+}
+
+// parse Content-Range of bytes first-last/size
+static int cos_block_cache_parse_content_range(const char *range, int64_t *offset, int64_t *size)
+{
+    const char *dash;
+    const char *slash;
+
+    if (NULL == range || strncmp(range, "bytes ", 6) != 0 ||
+        NULL == (dash = strchr(range + 6, '-')) || NULL == (slash = strchr(dash, '/')))
+    {
+        return COS_FALSE;
+    }
+    *offset = cos_atoi64_n(range + 6, (int)(dash - range - 6));
+    *size = cos_atoi64_n(slash + 1, strlen(slash + 1));
+    return *offset >= 0 && *size >= 0;
+}
+
+static void cos_block_cache_fill_headers(cos_table_t *headers, int has_range,
+                                         int64_t start, int64_t end, int64_t size)
+{
+    char buf[96];
+
+    apr_snprintf(buf, sizeof(buf), "%" APR_INT64_T_FMT, end - start + 1);
+    apr_table_set(headers, COS_CONTENT_LENGTH, buf);
+    if (has_range) {
+        apr_snprintf(buf, sizeof(buf), "bytes %" APR_INT64_T_FMT "-%" APR_INT64_T_FMT "/%" APR_INT64_T_FMT,
+                     start, end, size);
+        apr_table_set(headers, COS_CONTENT_RANGE, buf);
+    } else {
+        apr_table_unset(headers, COS_CONTENT_RANGE);
+    }
+}
+
+// check the crc64 of a whole object read
+static void cos_block_cache_check_crc(cos_list_t *buffer, cos_table_t *headers, cos_status_t *s)
+{
+    uint64_t crc64 = 0;
+    cos_buf_t *b;
+
+    if (NULL == apr_table_get(headers, COS_HASH_CRC64_ECMA)) {
+        return;
+    }
+    cos_list_for_each_entry(cos_buf_t, b, buffer, node) {
+        crc64 = cos_crc64(crc64, b->pos, cos_buf_size(b));
+    }
+    cos_check_crc_consistent(crc64, headers, s);
+}
+
+// refer to len bytes at offset of the chain of bufs, without copying them
+static void cos_block_cache_slice(cos_pool_t *p, cos_list_t *bc, int64_t offset,
+                                  int64_t len, cos_list_t *buffer)
+{
+    int64_t size;
+    cos_buf_t *b;
+    cos_buf_t *slice;
+
+    cos_list_for_each_entry(cos_buf_t, b, bc, node) {
+        size = cos_buf_size(b);
+        if (offset >= size) {
+            offset -= size;
+            continue;
+        }
+        if (len <= 0) {
+            break;
+        }
+        size = cos_min(size - offset, len);
+        slice = cos_buf_pack(p, b->pos + offset, (int)size);
+        cos_list_add_tail(&slice->node, buffer);
+        len -= size;
+        offset = 0;
+    }
+}
+
+int cos_block_cache_initialize()
+{
+    int s;
+    char buf[256];
+
+    if ((s = cos_pool_create(&cos_block_cache_pool, NULL)) != APR_SUCCESS) {
+        cos_error_log("cos_pool_create failure, code:%d %s.\n", s, apr_strerror(s, buf, sizeof(buf)));
+        return COSE_INTERNAL_ERROR;
+    }
+    if ((s = apr_thread_mutex_create(&cos_block_cache_mutex, APR_THREAD_MUTEX_DEFAULT, cos_block_cache_pool)) != APR_SUCCESS) {
+        cos_error_log("apr_thread_mutex_create failure, code:%d %s.\n", s, apr_strerror(s, buf, sizeof(buf)));
+        cos_block_cache_mutex = NULL;
+        return COSE_INTERNAL_ERROR;
+    }
+
+    cos_block_cache_objects = apr_hash_make(cos_block_cache_pool);
+    cos_block_cache_blocks = apr_hash_make(cos_block_cache_pool);
+    cos_list_init(&cos_block_cache_object_list);
+    cos_list_init(&cos_block_cache_memory_lru);
+    cos_list_init(&cos_block_cache_disk_lru);
+    cos_list_init(&cos_block_cache_spills);
+    cos_list_init(&cos_block_cache_removals);
+
+    return COSE_OK;
+}
+
+void cos_block_cache_deinitialize()
+{
+    // the data referenced by the responses is freed with their pools
+    if (cos_block_cache_mutex != NULL) {
+        apr_thread_mutex_lock(cos_block_cache_mutex);
+        cos_block_cache_drop_all();
+        cos_block_cache_unlock();
+        apr_thread_mutex_destroy(cos_block_cache_mutex);
+        cos_block_cache_mutex = NULL;
+    }
+
+    if (cos_block_cache_pool != NULL) {
+        cos_pool_destroy(cos_block_cache_pool);
+        cos_block_cache_pool = NULL;
+    }
+
+    free(cos_block_cache_dir);
+    cos_block_cache_dir = NULL;
+    cos_block_cache_memory_size = 0;
+    cos_block_cache_disk_size = 0;
+}
+
+int cos_set_block_cache(int64_t memory_size, int block_size, int ttl,
+                        const char *disk_dir, int64_t disk_size)
+{
+    if (memory_size < 0 || block_size <= 0 || ttl < 0 || disk_size < 0 ||
+        (disk_size > 0 && NULL == disk_dir))
+    {
+        return COSE_INVALID_ARGUMENT;
+    }
+    if (NULL == cos_block_cache_mutex) {
+        return COSE_INTERNAL_ERROR;
+    }
+
+    apr_thread_mutex_lock(cos_block_cache_mutex);
+    cos_block_cache_drop_all();
+    free(cos_block_cache_dir);
+    cos_block_cache_dir = cos_block_cache_strdup(disk_size > 0 ? disk_dir : NULL);
+    cos_block_cache_disk_size = disk_size;
+    cos_block_cache_block_size = block_size;
+    cos_block_cache_ttl = apr_time_from_sec(ttl);
+    cos_block_cache_memory_size = memory_size;
+    cos_block_cache_unlock();
+
+    return COSE_OK;
+}
+
+char *cos_block_cache_key(cos_pool_t *p, const cos_request_options_t *options,
+                          const cos_string_t *bucket, const cos_string_t *object)
+{
+    if (0 == cos_block_cache_memory_size || NULL == cos_block_cache_mutex) {
+        return NULL;
+    }
+
+    // an object name may contain any character, so it is the last part
+    return apr_psprintf(p, "%.*s\n%.*s\n%.*s",
+                        options->config->endpoint.len, options->config->endpoint.data,
+                        bucket->len, bucket->data, object->len, object->data);
+}
+
+void cos_block_cache_invalidate(const cos_request_options_t *options,
+                                const cos_string_t *bucket,
+                                const cos_string_t *object)
+{
+    char *key;
+
+    key = cos_block_cache_key(options->pool, options, bucket, object);
+    if (key != NULL) {
+        cos_block_cache_invalidate_key(key);
+    }
+}
+
+void cos_block_cache_invalidate_key(const char *key)
+{
+    cos_block_cache_object_t *object;
+
+    apr_thread_mutex_lock(cos_block_cache_mutex);
+    (*cos_block_cache_generation(key))++;
+    object = (cos_block_cache_object_t *)apr_hash_get(cos_block_cache_objects, key, APR_HASH_KEY_STRING);
+    if (object != NULL) {
+        cos_block_cache_drop(object);
+    }
+    cos_block_cache_unlock();
+}
+
+int cos_block_cache_get_object(const cos_request_options_t *options,
+                               const cos_string_t *bucket,
+                               const cos_string_t *object,
+                               cos_table_t *headers,
+                               cos_table_t *params,
+                               cos_list_t *buffer,
+                               cos_table_t **resp_headers,
+                               cos_status_t **s)
+{
+    int64_t i;
+    int attempt;
+    int has_range;
+    int conditional;
+    int revalidated = COS_FALSE;
+    int partial;
+    int block_size;
+    int64_t start;
+    int64_t end;
+    int64_t read_end = -1;
+    int64_t first = 0;
+    int64_t count = 0;
+    int64_t got;
+    int64_t read;
+    int64_t fetch_first;
+    int64_t fetch_last;
+    int64_t size;
+    int64_t offset;
+    int64_t block_start;
+    int64_t from;
+    int64_t to;
+    apr_uint32_t generation;
+    apr_uint64_t object_id = 0;
+    char *key;
+    char *etag = NULL;
+    char range_buf[64];
+    cos_block_cache_object_t *cached;
+    cos_block_ref_t *refs = NULL;
+    cos_http_request_t *req = NULL;
+    cos_http_response_t *resp = NULL;
+    cos_table_t *req_headers;
+    cos_table_t *query_params;
+    cos_table_t *hit_headers;
+    cos_buf_t *b;
+    char **h;
+
+    if (!cos_block_cache_parse_read(headers, params, &has_range, &start, &end)) {
+        return COS_FALSE;
+    }
+    key = cos_block_cache_key(options->pool, options, bucket, object);
+    if (NULL == key) {
+        return COS_FALSE;
+    }
+
+    // a fetch of the missing blocks or a revalidation is followed by a read of the cache,
+    // the last attempt is served by the response in case the blocks are evicted meanwhile
+    for (attempt = 0; attempt < 3; attempt++) {
+        conditional = COS_FALSE;
+        partial = COS_FALSE;
+        size = -1;
+        hit_headers = NULL;
+
+        apr_thread_mutex_lock(cos_block_cache_mutex);
+        block_size = cos_block_cache_block_size;
+        fetch_first = start / block_size;
+        fetch_last = -1;
+        cached = cos_block_cache_lookup(key, &options->config->access_key_id);
+        if (cached != NULL) {
+            size = cached->size;
+            read_end = (end < 0 || end >= size) ? size - 1 : end;
+            if (start > read_end) {
+                // out of the object, it is answered by the server
+                cos_block_cache_unlock();
+                return COS_FALSE;
+            }
+            first = start / block_size;
+            count = read_end / block_size - first + 1;
+            fetch_last = first + count - 1;
+        }
+        if (cached != NULL && attempt < 2) {
+            refs = (cos_block_ref_t *)cos_pcalloc(options->pool, sizeof(cos_block_ref_t) * count);
+            got = cos_block_cache_collect(options->pool, cached, first, count, refs);
+            // the blocks revalidated by the last attempt are served even if ttl is 0
+            if (got == count && (apr_time_now() - cached->validated < cos_block_cache_ttl ||
+                (revalidated && 0 == strcmp(cached->etag, etag))))
+            {
+                // the headers of the response the blocks are stored from, e.g. Content-Type and x-cos-meta-*
+                hit_headers = cos_table_make(options->pool, 8);
+                for (h = cached->headers; h != NULL && *h != NULL; h += 2) {
+                    apr_table_set(hit_headers, h[0], h[1]);
+                }
+                apr_table_set(hit_headers, COS_ETAG, cached->etag);
+                object_id = cached->id;
+            } else {
+                cos_block_cache_release_refs(refs, got);
+                if (got == count) {
+                    conditional = COS_TRUE;
+                    etag = apr_pstrdup(options->pool, cached->etag);
+                } else {
+                    // fetch the blocks from the first missing one to the last missing one
+                    fetch_first = first + got;
+                    while (fetch_last > fetch_first && cos_block_cache_find(cached, fetch_last) != NULL) {
+                        fetch_last--;
+                    }
+                    partial = (fetch_first != first || fetch_last != first + count - 1);
+                }
+            }
+        }
+        generation = *cos_block_cache_generation(key);
+        cos_block_cache_unlock();
+
+        if (hit_headers != NULL) {
+            if (cos_block_cache_read(options->pool, refs, count, &read)) {
+                // the blocks read from the disk tier are moved to memory if they are not changed meanwhile
+                apr_thread_mutex_lock(cos_block_cache_mutex);
+                cached = cos_block_cache_lookup(key, &options->config->access_key_id);
+                if (cached != NULL && cached->id == object_id) {
+                    cos_block_cache_promote(cached, first, refs, count, read);
+                }
+                cos_block_cache_unlock();
+            }
+            if (read < count) {
+                // a block lost from the disk tier is fetched by the next attempt
+                cos_block_cache_release_refs(refs, count);
+                continue;
+            }
+
+            // refer to the cached data, it is released with the pool of the request
+            for (i = 0; i < count; i++) {
+                block_start = (first + i) * block_size;
+                from = cos_max(start, block_start) - block_start;
+                to = cos_min(read_end, block_start + refs[i].data->len - 1) - block_start;
+                b = cos_buf_pack(options->pool, (char *)(refs[i].data + 1) + from, (int)(to - from + 1));
+                cos_list_add_tail(&b->node, buffer);
+                apr_pool_cleanup_register(options->pool, refs[i].data, cos_block_cache_release, apr_pool_cleanup_null);
+            }
+            cos_block_cache_fill_headers(hit_headers, has_range, start, read_end, size);
+            if (resp_headers != NULL) {
+                *resp_headers = hit_headers;
+            }
+            *s = cos_status_create(options->pool);
+            (*s)->code = has_range ? 206 : 200;
+            if (!has_range && is_enable_crc(options)) {
+                cos_block_cache_check_crc(buffer, hit_headers, *s);
+            }
+            return COS_TRUE;
+        }
+
+        // the size is unknown before the first read, then the range is aligned to blocks
+        req_headers = cos_table_make(options->pool, 2);
+        query_params = cos_table_make(options->pool, 0);
+        if (fetch_last < 0 && end >= 0) {
+            fetch_last = end / block_size;
+        }
+        if (fetch_last >= 0) {
+            to = (fetch_last + 1) * block_size - 1;
+            apr_snprintf(range_buf, sizeof(range_buf), "bytes=%" APR_INT64_T_FMT "-%" APR_INT64_T_FMT,
+                         fetch_first * block_size, (size > 0) ? cos_min(to, size - 1) : to);
+            apr_table_set(req_headers, COS_RANGE, range_buf);
+        } else if (has_range) {
+            apr_snprintf(range_buf, sizeof(range_buf), "bytes=%" APR_INT64_T_FMT "-", fetch_first * block_size);
+            apr_table_set(req_headers, COS_RANGE, range_buf);
+        }
+        if (conditional) {
+            apr_table_set(req_headers, COS_IF_NONE_MATCH, etag);
+        }
+
+        cos_init_object_request(options, bucket, object, HTTP_GET,
+                                &req, query_params, req_headers, NULL, 0, &resp);
+        *s = cos_process_request(options, req, resp);
+
+        if (conditional && 304 == (*s)->code) {
+            apr_thread_mutex_lock(cos_block_cache_mutex);
+            cached = cos_block_cache_lookup(key, &options->config->access_key_id);
+            if (cached != NULL && generation == *cos_block_cache_generation(key) &&
+                0 == strcmp(cached->etag, etag))
+            {
+                cached->validated = apr_time_now();
+                revalidated = COS_TRUE;
+            }
+            cos_block_cache_unlock();
+            continue;
+        }
+        if (!cos_status_is_ok(*s)) {
+            cos_fill_read_response_body(resp, buffer);
+            cos_fill_read_response_header(resp, resp_headers);
+            return COS_TRUE;
+        }
+
+        offset = 0;
+        size = cos_buf_list_len(&resp->body);
+        if (206 == resp->status && !cos_block_cache_parse_content_range(
+                apr_table_get(resp->headers, COS_CONTENT_RANGE), &offset, &size))
+        {
+            cos_fill_read_response_body(resp, buffer);
+            cos_fill_read_response_header(resp, resp_headers);
+            return COS_TRUE;
+        }
+        cos_block_cache_store(key, &options->config->access_key_id, generation, offset, size, resp);
+        if (partial) {
+            continue;
+        }
+
+        read_end = (end < 0 || end >= size) ? size - 1 : end;
+        if (start > read_end && has_range) {
+            // the blocks before start are fetched, the range of the caller is answered as the server does
+            apr_snprintf(range_buf, sizeof(range_buf), "bytes */%" APR_INT64_T_FMT, size);
+            apr_table_set(resp->headers, COS_CONTENT_RANGE, range_buf);
+            apr_table_set(resp->headers, COS_CONTENT_LENGTH, "0");
+            cos_fill_read_response_header(resp, resp_headers);
+            cos_status_set(*s, 416, "InvalidRange", "The requested range is not satisfiable");
+            return COS_TRUE;
+        }
+        cos_block_cache_slice(options->pool, &resp->body, start - offset, read_end - start + 1, buffer);
+        if (!has_range && is_enable_crc(options)) {
+            cos_block_cache_check_crc(buffer, resp->headers, *s);
+        }
+        cos_block_cache_fill_headers(resp->headers, has_range, start, read_end, size);
+        cos_fill_read_response_header(resp, resp_headers);
+        (*s)->code = has_range ? 206 : 200;
+        return COS_TRUE;
+    }
+
+    return COS_FALSE;
+}
@@ -0,0 +1,75 @@
+#ifndef LIBCOS_BLOCK_CACHE_H
+#define LIBCOS_BLOCK_CACHE_H
+
+#include "cos_sys_define.h"
+#include "cos_define.h"
+#include "cos_status.h"
+
+
+COS_CPP_START
+
+#define COS_BLOCK_CACHE_DEFAULT_BLOCK_SIZE (1024 * 1024)
+
+/**
+  * @brief the block cache is owned by the sdk, it is a read-through cache of the data read by
+  *        cos_get_object_to_buffer, it is disabled until cos_set_block_cache is called,
+  *        an object is cached in blocks of block_size, a read fetches the blocks covering its
+  *        range, so the nearby reads are served by the cache, a hit refers to the cached data
+  *        instead of copying it, the data is kept until the pool of the request is destroyed,
+  *        the blocks evicted from memory are written to the disk tier if it is enabled,
+  *        the blocks are served to the reads with the access key they were fetched with only,
+  *        the blocks of an object are fresh for ttl seconds, then they are revalidated by a
+  *        request with If-None-Match, which costs a 304 if the object is not changed,
+  *        the blocks of an object are dropped by the PUT, POST and DELETE requests of this client,
+  *        of a multipart upload only by the complete and abort requests
+**/
+int cos_block_cache_initialize();
+void cos_block_cache_deinitialize();
+
+/**
+  * @brief enable the block cache, the cached blocks are dropped
+  * @param[in]   memory_size   the max bytes of the blocks in memory, 0 to disable the cache
+  * @param[in]   block_size    the size of a block, e.g. COS_BLOCK_CACHE_DEFAULT_BLOCK_SIZE
+  * @param[in]   ttl           the seconds the blocks are served without revalidation, 0 to revalidate each read
+  * @param[in]   disk_dir      the directory of the disk tier used by this process only, NULL for none
+  * @param[in]   disk_size     the max bytes of the blocks on disk, 0 for no disk tier
+  * @return  COSE_OK, COSE_INVALID_ARGUMENT, or COSE_INTERNAL_ERROR before cos_http_io_initialize
+**/
+int cos_set_block_cache(int64_t memory_size, int block_size, int ttl,
+                        const char *disk_dir, int64_t disk_size);
+
+/**
+  * @brief drop the blocks of an object changed by others, e.g. by another client
+**/
+void cos_block_cache_invalidate(const cos_request_options_t *options,
+                                const cos_string_t *bucket,
+                                const cos_string_t *object);
+
+/**
+  * @brief the key of an object in the cache, NULL if the cache is disabled
+**/
+char *cos_block_cache_key(cos_pool_t *p, const cos_request_options_t *options,
+                          const cos_string_t *bucket, const cos_string_t *object);
+
+void cos_block_cache_invalidate_key(const char *key);
+
+/**
+  * @brief read an object through the cache, only reads without params and headers except
+  *        a Range of bytes=start-end or bytes=start- are served, the other ones are left to
+  *        the caller, a hit has the headers describing the object of the response the blocks
+  *        were stored from, e.g. ETag, Content-Type and x-cos-meta-*, with the Content-Length and
+  *        Content-Range of the read, but no x-cos-request-id, a range beyond the object is 416
+  * @return  COS_TRUE if the read is served, with its status in s, COS_FALSE otherwise
+**/
+int cos_block_cache_get_object(const cos_request_options_t *options,
+                               const cos_string_t *bucket,
+                               const cos_string_t *object,
+                               cos_table_t *headers,
+                               cos_table_t *params,
+                               cos_list_t *buffer,
+                               cos_table_t **resp_headers,
+                               cos_status_t **s);
+
+COS_CPP_END
+
+#endif
@@ -7,6 +7,8 @@
 #include "cos_utility.h"
 #include "cos_xml.h"
 #include "cos_api.h"
+#include "cos_meta_cache.h"
+#include "cos_block_cache.h"
 
 cos_status_t *cos_create_bucket(const cos_request_options_t *options, 
                                 const cos_string_t *bucket, 
@@ -120,9 +122,9 @@ cos_status_t *cos_do_list_object(const cos_request_options_t *options,
         return s;
     }
 
-    res = cos_list_objects_parse_from_body(options->pool, &resp->body, 
+    res = cos_do_list_objects_parse_from_body(options->pool, &resp->body, 
             &params->object_list, &params->common_prefix_list, 
-            &params->next_marker, &params->truncated);
+            &params->next_marker, &params->truncated, params->zero_copy);
     if (res != COSE_OK) {
         cos_xml_error_status_set(s, res);
     }
@@ -141,20 +143,19 @@ cos_status_t *cos_delete_objects(const cos_request_options_t *options,
     return cos_do_delete_objects(options, bucket, object_list, is_quiet, NULL, resp_headers, deleted_object_list);
 }
 
-cos_status_t *cos_do_delete_objects(const cos_request_options_t *options,
-                                 const cos_string_t *bucket, 
-                                 cos_list_t *object_list, 
-                                 int is_quiet,
-                                 cos_table_t *headers,
-                                 cos_table_t **resp_headers, 
-                                 cos_list_t *deleted_object_list)
+static cos_status_t *cos_send_delete_objects_request(const cos_request_options_t *options,
+                                                     const cos_string_t *bucket, 
+                                                     cos_list_t *object_list, 
+                                                     int is_quiet,
+                                                     cos_table_t *headers,
+                                                     cos_table_t **resp_headers, 
+                                                     cos_http_response_t **resp)
 {
-    int res;
     cos_status_t *s = NULL;
     cos_http_request_t *req = NULL;
-    cos_http_response_t *resp = NULL;
     cos_table_t *pHeaders = NULL;
     cos_table_t *query_params = NULL;
+    cos_object_key_t *content = NULL;
     cos_list_t body;
     unsigned char *md5 = NULL;
     char *buf = NULL;
@@ -172,7 +173,7 @@ cos_status_t *cos_do_delete_objects(const cos_request_options_t *options,
     apr_table_set(pHeaders, COS_CONTENT_TYPE, COS_MULTIPART_CONTENT_TYPE);
 
     cos_init_bucket_request(options, bucket, HTTP_POST, &req, 
-                            query_params, pHeaders, &resp);
+                            query_params, pHeaders, resp);
 
     build_delete_objects_body(options->pool, object_list, is_quiet, &body);
 
@@ -187,8 +188,31 @@ cos_status_t *cos_do_delete_objects(const cos_request_options_t *options,
 
     cos_write_request_body_from_buffer(&body, req);
 
-    s = cos_process_request(options, req, resp);
-    cos_fill_read_response_header(resp, resp_headers);
+    s = cos_process_request(options, req, *resp);
+    cos_fill_read_response_header(*resp, resp_headers);
+
+    cos_list_for_each_entry(cos_object_key_t, content, object_list, node) {
+        cos_meta_cache_invalidate(options, bucket, &content->key);
+        cos_block_cache_invalidate(options, bucket, &content->key);
+    }
+
+    return s;
+}
+
+cos_status_t *cos_do_delete_objects(const cos_request_options_t *options,
+                                 const cos_string_t *bucket, 
+                                 cos_list_t *object_list, 
+                                 int is_quiet,
+                                 cos_table_t *headers,
+                                 cos_table_t **resp_headers, 
+                                 cos_list_t *deleted_object_list)
+{
+    int res;
+    cos_status_t *s = NULL;
+    cos_http_response_t *resp = NULL;
+
+    s = cos_send_delete_objects_request(options, bucket, object_list, is_quiet, 
+                                        headers, resp_headers, &resp);
 
     if (is_quiet) {
         return s;
@@ -207,87 +231,47 @@ cos_status_t *cos_do_delete_objects(const cos_request_options_t *options,
     return s;
 }
 
+cos_status_t *cos_do_delete_objects_quiet(const cos_request_options_t *options,
+                                       const cos_string_t *bucket, 
+                                       cos_list_t *object_list, 
+                                       cos_table_t *headers,
+                                       cos_table_t **resp_headers, 
+                                       cos_list_t *failed_object_list)
+{
+    int res;
+    cos_status_t *s = NULL;
+    cos_http_response_t *resp = NULL;
+
+    s = cos_send_delete_objects_request(options, bucket, object_list, COS_TRUE, 
+                                        headers, resp_headers, &resp);
+    if (!cos_status_is_ok(s)) {
+        return s;
+    }
+
+    // only the keys failed to be deleted are in the body of a quiet request, it is empty if all are deleted
+    if (cos_list_empty(&resp->body)) {
+        return s;
+    }
+    res = cos_delete_objects_failed_parse_from_body(options->pool, &resp->body, 
+                                                    failed_object_list);
+    if (res != COSE_OK) {
+        cos_xml_error_status_set(s, res);
+    }
+
+    return s;
+}
+
 
 cos_status_t *cos_delete_objects_by_prefix(cos_request_options_t *options,
                                            const cos_string_t *bucket, 
                                            const cos_string_t *prefix)
 {
-    cos_pool_t *subpool = NULL;
-    cos_pool_t *parent_pool = NULL;
-    int is_quiet = 1;
-    cos_status_t *s = NULL;
-    cos_status_t *ret = NULL;
-    cos_list_object_params_t *params = NULL;
-    int list_object_count = 0;
-    
-    parent_pool = options->pool;
-    params = cos_create_list_object_params(parent_pool);
-    if (prefix->data == NULL) {
-        cos_str_set(&params->prefix, "");
-    } else {
-        cos_str_set(&params->prefix, prefix->data);
-    }
-    while (params->truncated) {
-        cos_table_t *list_object_resp_headers = NULL;
-        cos_list_t object_list;
-        cos_list_t deleted_object_list;
-        cos_list_object_content_t *list_content = NULL;
-        cos_table_t *delete_objects_resp_headers = NULL;
-        char *key = NULL;
-
-        cos_pool_create(&subpool, parent_pool);
-        options->pool = subpool;
-        list_object_count = 0;
-        cos_list_init(&object_list);
-        s = cos_list_object(options, bucket, params, &list_object_resp_headers);
-        if (!cos_status_is_ok(s)) {
-            ret = cos_status_dup(parent_pool, s);
-            cos_pool_destroy(subpool);
-            options->pool = parent_pool;
-            return ret;
-        }
-
-        cos_list_for_each_entry(cos_list_object_content_t, list_content, &params->object_list, node) {
-            cos_object_key_t *object_key = cos_create_cos_object_key(parent_pool);
-            key = apr_psprintf(parent_pool, "%.*s", list_content->key.len, 
-                               list_content->key.data);
-            cos_str_set(&object_key->key, key);
-            cos_list_add_tail(&object_key->node, &object_list);
-            list_object_count += 1;
-        }
-        if (list_object_count == 0)
-        {
-            ret = cos_status_dup(parent_pool, s);
-            cos_pool_destroy(subpool);
-            options->pool = parent_pool;
-            return ret;
-        }
-        cos_pool_destroy(subpool);
-
-        cos_list_init(&deleted_object_list);
-        cos_pool_create(&subpool, parent_pool);
-        options->pool = subpool;
-        s = cos_delete_objects(options, bucket, &object_list, is_quiet,
-                               &delete_objects_resp_headers, &deleted_object_list);
-        if (!cos_status_is_ok(s)) {
-            ret = cos_status_dup(parent_pool, s);
-            cos_pool_destroy(subpool);
-            options->pool = parent_pool;
-            return ret;
-        }
-        if (!params->truncated) {
-            ret = cos_status_dup(parent_pool, s);
-        }
-
-        cos_pool_destroy(subpool);
-
-        cos_list_init(&params->object_list);
-        if (params->next_marker.data) {
-            cos_str_set(&params->marker, params->next_marker.data);
-        }
-    }
-    options->pool = parent_pool;
-    return ret;
+    cos_resumable_clt_params_t *clt_params = NULL;
+
+    // the listing runs ahead of the batches in flight, see cos_parallel_delete_objects_by_prefix,
+    // a batch per thread of the shared pool, the batches are limited to the fair share of the transfer
+    clt_params = cos_create_resumable_clt_params_content(options->pool, 0, cos_get_thread_pool_size(), COS_FALSE, NULL);
+    return cos_parallel_delete_objects_by_prefix(options, bucket, prefix, clt_params);
 }
 
 cos_status_t *cos_put_bucket_acl(const cos_request_options_t *options, 
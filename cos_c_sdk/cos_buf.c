@@ -1,6 +1,19 @@
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE     // O_DIRECT
+#endif
+
 #include "cos_buf.h"
 #include "cos_log.h"
 #include <apr_file_io.h>
+#include <apr_portable.h>
+#include <apr_atomic.h>
+#include <apr_thread_mutex.h>
+
+#ifndef WIN32
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#endif
 
 cos_buf_t *cos_create_buf(cos_pool_t *p, int size)
 {
@@ -69,6 +82,27 @@ char *cos_buf_list_content(cos_pool_t *p, cos_list_t *list)
     return buf;
 }
 
+cos_buf_t *cos_create_aligned_buf(cos_pool_t *p, int size, int align)
+{
+    cos_buf_t* b;
+    uint8_t *data;
+
+    b = cos_palloc(p, sizeof(cos_buf_t) + size + align);
+    if (b == NULL) {
+        return NULL;
+    }
+
+    data = (uint8_t *)b + sizeof(cos_buf_t);
+    data = (uint8_t *)(((uintptr_t)data + align - 1) & ~((uintptr_t)align - 1));
+    b->pos = data;
+    b->last = data;
+    b->start = data;
+    b->end = data + size;
+    cos_list_init(&b->node);
+
+    return b;
+}
+
 cos_file_buf_t *cos_create_file_buf(cos_pool_t *p)
 {
     return (cos_file_buf_t*)cos_pcalloc(p, sizeof(cos_file_buf_t));
@@ -163,6 +197,95 @@ int cos_open_file_for_range_write(cos_pool_t *p, const char *path, int64_t file_
 }
 
 
+void cos_share_file_for_range(apr_file_t *file, int64_t file_pos, int64_t file_last, cos_file_buf_t *fb)
+{
+    fb->file = file;
+    fb->file_pos = file_pos;
+    fb->file_last = file_last;
+    fb->owner = 0;
+}
+
+int cos_file_read_at(apr_file_t *file, int64_t offset, void *buffer, apr_size_t *nbytes)
+{
+    apr_os_file_t fd;
+#ifdef WIN32
+    OVERLAPPED ov;
+    DWORD bytes = 0;
+#else
+    ssize_t bytes;
+#endif
+
+    apr_os_file_get(&fd, file);
+#ifdef WIN32
+    memset(&ov, 0, sizeof(ov));
+    ov.Offset = (DWORD)offset;
+    ov.OffsetHigh = (DWORD)(offset >> 32);
+    if (!ReadFile(fd, buffer, (DWORD)*nbytes, &bytes, &ov)) {
+        return apr_get_os_error();
+    }
+#else
+    do {
+        bytes = pread(fd, buffer, *nbytes, (off_t)offset);
+    } while (bytes < 0 && errno == EINTR);
+    if (bytes < 0) {
+        return errno;
+    }
+#endif
+    if (bytes == 0 && *nbytes > 0) {
+        return APR_EOF;
+    }
+    *nbytes = (apr_size_t)bytes;
+    return APR_SUCCESS;
+}
+
+int cos_file_write_at(apr_file_t *file, int64_t offset, const void *buffer, apr_size_t *nbytes)
+{
+    apr_os_file_t fd;
+    apr_size_t written = 0;
+#ifdef WIN32
+    OVERLAPPED ov;
+    DWORD bytes = 0;
+#else
+    ssize_t bytes;
+#endif
+
+    apr_os_file_get(&fd, file);
+    while (written < *nbytes) {
+#ifdef WIN32
+        memset(&ov, 0, sizeof(ov));
+        ov.Offset = (DWORD)(offset + written);
+        ov.OffsetHigh = (DWORD)((offset + written) >> 32);
+        if (!WriteFile(fd, (const char *)buffer + written, (DWORD)(*nbytes - written), &bytes, &ov)) {
+            *nbytes = written;
+            return apr_get_os_error();
+        }
+#else
+        bytes = pwrite(fd, (const char *)buffer + written, *nbytes - written, (off_t)(offset + written));
+        if (bytes < 0 && errno == EINTR) {
+            continue;
+        }
+        if (bytes < 0) {
+            *nbytes = written;
+            return errno;
+        }
+#endif
+        written += (apr_size_t)bytes;
+    }
+    return APR_SUCCESS;
+}
+
+int cos_file_preallocate(apr_file_t *file, int64_t size)
+{
+#if defined(__linux__)
+    apr_os_file_t fd;
+
+    apr_os_file_get(&fd, file);
+    return posix_fallocate(fd, 0, (off_t)size);
+#else
+    return APR_ENOTIMPL;
+#endif
+}
+
 void cos_buf_append_string(cos_pool_t *p, cos_buf_t *b, const char *str, int len)
 {
     int size;
@@ -189,3 +312,320 @@ void cos_buf_append_string(cos_pool_t *p, cos_buf_t *b, const char *str, int len
         b->last = (uint8_t *)buf + size + len;
     }
 }
+
+int cos_file_advise(apr_file_t *file, int64_t offset, int64_t len, cos_file_advice_e advice)
+{
+#ifdef POSIX_FADV_SEQUENTIAL
+    apr_os_file_t fd;
+    int flag;
+
+    switch (advice) {
+        case COS_FILE_ADVICE_SEQUENTIAL:
+            flag = POSIX_FADV_SEQUENTIAL;
+            break;
+        case COS_FILE_ADVICE_WILLNEED:
+            flag = POSIX_FADV_WILLNEED;
+            break;
+        case COS_FILE_ADVICE_DONTNEED:
+            flag = POSIX_FADV_DONTNEED;
+            break;
+        default:
+            return APR_EINVAL;
+    }
+
+    apr_os_file_get(&fd, file);
+    return posix_fadvise(fd, (off_t)offset, (off_t)len, flag);
+#else
+    return APR_ENOTIMPL;
+#endif
+}
+
+int cos_open_file_for_direct_read(cos_pool_t *p, const char *path, apr_file_t **file)
+{
+#ifdef O_DIRECT
+    apr_os_file_t fd;
+
+    do {
+        fd = open(path, O_RDONLY | O_DIRECT);
+    } while (fd < 0 && errno == EINTR);
+    if (fd < 0) {
+        return errno;
+    }
+    // the descriptor is closed by apr_file_close
+    *file = NULL;
+    return apr_os_file_put(file, &fd, APR_READ, p);
+#else
+    return APR_ENOTIMPL;
+#endif
+}
+
+int cos_file_read_direct(cos_file_buf_t *fb, void *buffer, apr_size_t *nbytes)
+{
+    int s;
+    cos_buf_t *b = fb->align_buf;
+    int64_t offset;
+    apr_size_t bytes;
+
+    if (cos_buf_size(b) == 0) {
+        // refill the buffer from the aligned offset at or before file_pos
+        offset = fb->file_pos & ~((int64_t)COS_DIRECT_IO_ALIGN - 1);
+        bytes = b->end - b->start;
+        if ((s = cos_file_read_at(fb->file, offset, b->start, &bytes)) != APR_SUCCESS) {
+            return s;
+        }
+        if (offset + (int64_t)bytes <= fb->file_pos) {
+            return APR_EOF;
+        }
+        b->pos = b->start + (fb->file_pos - offset);
+        b->last = b->start + bytes;
+    }
+
+    bytes = cos_min(*nbytes, (apr_size_t)cos_buf_size(b));
+    memcpy(buffer, b->pos, bytes);
+    b->pos += bytes;
+    fb->file_pos += bytes;
+    *nbytes = bytes;
+
+    return APR_SUCCESS;
+}
+
+static cos_pool_t *cos_write_behind_pool = NULL;
+static apr_thread_mutex_t *cos_write_behind_mutex = NULL;
+static apr_thread_t *cos_write_behind_thread = NULL;    // started by the first download written behind
+static apr_queue_t *cos_write_behind_filled = NULL;     // the buffers of all downloads to be written, NULL stops the writer
+static cos_list_t cos_write_behind_free;                // the buffers no download uses, guarded by cos_write_behind_mutex
+
+static void cos_write_behind_push(apr_queue_t *queue, void *data)
+{
+    while (apr_queue_push(queue, data) == APR_EINTR);
+}
+
+static void *cos_write_behind_pop(apr_queue_t *queue)
+{
+    void *item = NULL;
+
+    while (apr_queue_pop(queue, &item) == APR_EINTR);
+    return item;
+}
+
+static void * APR_THREAD_FUNC cos_write_behind_run(apr_thread_t *thd, void *data)
+{
+    int s;
+    char buf[256];
+    void *item = NULL;
+    apr_size_t nbytes;
+    cos_write_behind_t *wb;
+    cos_write_behind_buf_t *wbuf;
+
+    for (;;) {
+        s = apr_queue_pop(cos_write_behind_filled, &item);
+        if (s == APR_EINTR) {
+            continue;
+        }
+        if (s != APR_SUCCESS || item == NULL) {
+            break;
+        }
+
+        wbuf = (cos_write_behind_buf_t *)item;
+        wb = wbuf->wb;
+        if (apr_atomic_read32(&wb->error) == APR_SUCCESS) {
+            nbytes = cos_buf_size(wbuf->buf);
+            if ((s = cos_file_write_at(wb->file, wbuf->file_pos, wbuf->buf->pos, &nbytes)) != APR_SUCCESS) {
+                cos_error_log("cos_file_write_at failure, code:%d %s.", s, apr_strerror(s, buf, sizeof(buf)));
+                apr_atomic_set32(&wb->error, s);
+            }
+        }
+        // the data is dropped after a failure, the buffer is still returned to unblock the network
+        wbuf->buf->pos = wbuf->buf->start;
+        wbuf->buf->last = wbuf->buf->start;
+        cos_write_behind_push(wb->idle, wbuf);
+    }
+
+    apr_thread_exit(thd, APR_SUCCESS);
+    return NULL;
+}
+
+int cos_write_behind_initialize()
+{
+    int s;
+    char buf[256];
+
+    if ((s = cos_pool_create(&cos_write_behind_pool, NULL)) != APR_SUCCESS) {
+        cos_error_log("cos_pool_create failure, code:%d %s.\n", s, apr_strerror(s, buf, sizeof(buf)));
+        return COSE_INTERNAL_ERROR;
+    }
+
+    if ((s = apr_thread_mutex_create(&cos_write_behind_mutex, APR_THREAD_MUTEX_DEFAULT, cos_write_behind_pool)) != APR_SUCCESS) {
+        cos_error_log("apr_thread_mutex_create failure, code:%d %s.\n", s, apr_strerror(s, buf, sizeof(buf)));
+        cos_write_behind_mutex = NULL;
+        return COSE_INTERNAL_ERROR;
+    }
+    cos_list_init(&cos_write_behind_free);
+
+    return COSE_OK;
+}
+
+void cos_write_behind_deinitialize()
+{
+    apr_status_t rv;
+
+    // the downloads written behind have finished
+    if (cos_write_behind_thread != NULL) {
+        cos_write_behind_push(cos_write_behind_filled, NULL);
+        apr_thread_join(&rv, cos_write_behind_thread);
+        cos_write_behind_thread = NULL;
+    }
+    cos_write_behind_filled = NULL;
+
+    if (cos_write_behind_mutex != NULL) {
+        apr_thread_mutex_destroy(cos_write_behind_mutex);
+        cos_write_behind_mutex = NULL;
+    }
+
+    if (cos_write_behind_pool != NULL) {
+        cos_pool_destroy(cos_write_behind_pool);
+        cos_write_behind_pool = NULL;
+    }
+}
+
+// take a buffer of the free list or allocate one, called with cos_write_behind_mutex held
+static cos_write_behind_buf_t *cos_write_behind_take()
+{
+    cos_write_behind_buf_t *wbuf;
+
+    if (!cos_list_empty(&cos_write_behind_free)) {
+        wbuf = cos_list_entry(cos_write_behind_free.next, cos_write_behind_buf_t, node);
+        cos_list_del(&wbuf->node);
+        return wbuf;
+    }
+
+    // the free list grows to the buffers of the downloads written behind at the same time
+    wbuf = (cos_write_behind_buf_t *)cos_palloc(cos_write_behind_pool, sizeof(cos_write_behind_buf_t));
+    if (wbuf == NULL) {
+        return NULL;
+    }
+    wbuf->buf = cos_create_aligned_buf(cos_write_behind_pool, COS_WRITE_BEHIND_BUF_SIZE, COS_DIRECT_IO_ALIGN);
+    if (wbuf->buf == NULL) {
+        return NULL;
+    }
+    cos_list_init(&wbuf->node);
+    return wbuf;
+}
+
+// start the writer thread once, called with cos_write_behind_mutex held
+static int cos_write_behind_start()
+{
+    int s;
+
+    if (cos_write_behind_thread != NULL) {
+        return APR_SUCCESS;
+    }
+    if (cos_write_behind_filled == NULL && 
+        (s = apr_queue_create(&cos_write_behind_filled, COS_WRITE_BEHIND_QUEUE_SIZE, cos_write_behind_pool)) != APR_SUCCESS) 
+    {
+        return s;
+    }
+    return apr_thread_create(&cos_write_behind_thread, NULL, cos_write_behind_run, NULL, cos_write_behind_pool);
+}
+
+int cos_write_behind_create(cos_pool_t *p, apr_file_t *file, int64_t file_pos, int64_t size, cos_write_behind_t **wb)
+{
+    int s;
+    int i;
+    int buf_num;
+    cos_write_behind_t *w;
+    cos_write_behind_buf_t *wbuf;
+
+    if (cos_write_behind_mutex == NULL) {
+        return APR_EINIT;
+    }
+
+    buf_num = (int)cos_max(size / COS_WRITE_BEHIND_BUF_SIZE, COS_WRITE_BEHIND_MIN_BUFS);
+    w = (cos_write_behind_t *)cos_pcalloc(p, sizeof(cos_write_behind_t));
+    w->file = file;
+    w->file_pos = file_pos;
+
+    if ((s = apr_queue_create(&w->idle, buf_num, p)) != APR_SUCCESS) {
+        return s;
+    }
+
+    apr_thread_mutex_lock(cos_write_behind_mutex);
+    if ((s = cos_write_behind_start()) != APR_SUCCESS) {
+        apr_thread_mutex_unlock(cos_write_behind_mutex);
+        return s;
+    }
+    for (i = 0; i < buf_num; i++) {
+        if ((wbuf = cos_write_behind_take()) == NULL) {
+            apr_thread_mutex_unlock(cos_write_behind_mutex);
+            cos_write_behind_finish(w);
+            return APR_ENOMEM;
+        }
+        wbuf->wb = w;
+        wbuf->file_pos = 0;
+        w->buf_num++;
+        cos_write_behind_push(w->idle, wbuf);
+    }
+    apr_thread_mutex_unlock(cos_write_behind_mutex);
+
+    *wb = w;
+    return APR_SUCCESS;
+}
+
+int cos_write_behind_write(cos_write_behind_t *wb, const char *buffer, int len)
+{
+    int bytes;
+    int left = len;
+    cos_buf_t *b;
+
+    if (apr_atomic_read32(&wb->error) != APR_SUCCESS) {
+        return COSE_FILE_WRITE_ERROR;
+    }
+
+    while (left > 0) {
+        if (wb->cur == NULL) {
+            // all buffers are filled, wait for the writer to catch up
+            wb->cur = (cos_write_behind_buf_t *)cos_write_behind_pop(wb->idle);
+            wb->cur->file_pos = wb->file_pos;
+        }
+
+        b = wb->cur->buf;
+        bytes = cos_min(left, (int)(b->end - b->last));
+        memcpy(b->last, buffer, bytes);
+        b->last += bytes;
+        buffer += bytes;
+        left -= bytes;
+        wb->file_pos += bytes;
+
+        if (b->last == b->end) {
+            cos_write_behind_push(cos_write_behind_filled, wb->cur);
+            wb->cur = NULL;
+        }
+    }
+
+    return len;
+}
+
+int cos_write_behind_finish(cos_write_behind_t *wb)
+{
+    cos_write_behind_buf_t *wbuf;
+
+    if (wb->cur != NULL) {
+        if (cos_buf_size(wb->cur->buf) > 0) {
+            cos_write_behind_push(cos_write_behind_filled, wb->cur);
+        } else {
+            cos_write_behind_push(wb->idle, wb->cur);
+        }
+        wb->cur = NULL;
+    }
+
+    // the data is written once the writer has returned all buffers
+    for (; wb->buf_num > 0; wb->buf_num--) {
+        wbuf = (cos_write_behind_buf_t *)cos_write_behind_pop(wb->idle);
+        wbuf->wb = NULL;
+        apr_thread_mutex_lock(cos_write_behind_mutex);
+        cos_list_add_tail(&wbuf->node, &cos_write_behind_free);
+        apr_thread_mutex_unlock(cos_write_behind_mutex);
+    }
+
+    return apr_atomic_read32(&wb->error);
+}
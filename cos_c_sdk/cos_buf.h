@@ -3,6 +3,8 @@
 
 #include "cos_sys_define.h"
 #include "cos_list.h"
+#include <apr_thread_proc.h>
+#include <apr_queue.h>
 
 COS_CPP_START
 
@@ -19,12 +21,43 @@ typedef struct {
     int64_t file_pos;
     int64_t file_last;
     apr_file_t *file;
+    cos_buf_t *align_buf;
     uint32_t owner:1;
 } cos_file_buf_t;
 
+typedef struct cos_write_behind_s cos_write_behind_t;
+
+typedef struct {
+    cos_list_t node;                // in the free list while no download uses it
+    cos_buf_t *buf;
+    int64_t file_pos;               // the file offset of the data of buf
+    cos_write_behind_t *wb;         // the download the data belongs to
+} cos_write_behind_buf_t;
+
+struct cos_write_behind_s {
+    apr_file_t *file;
+    apr_queue_t *idle;              // the buffers written, the network waits on it when the disk falls behind
+    int buf_num;                    // the buffers taken from the free list, all are idle once written
+    cos_write_behind_buf_t *cur;    // the buffer being filled
+    int64_t file_pos;               // the file offset of the next byte received
+    volatile apr_uint32_t error;    // the status of the first failed write, use atomic
+};
+
+typedef enum {
+    COS_FILE_ADVICE_SEQUENTIAL,
+    COS_FILE_ADVICE_WILLNEED,
+    COS_FILE_ADVICE_DONTNEED
+} cos_file_advice_e;
+
 cos_buf_t *cos_create_buf(cos_pool_t *p, int size);
 #define cos_buf_size(b) (b->last - b->pos)
 
+/**
+ * the data of the buffer starts at an address aligned to align, for the file opened with O_DIRECT.
+ * @param align power of 2.
+ */
+cos_buf_t *cos_create_aligned_buf(cos_pool_t *p, int size, int align);
+
 cos_file_buf_t *cos_create_file_buf(cos_pool_t *p);
 
 cos_buf_t *cos_buf_pack(cos_pool_t *p, const void *data, int size);
@@ -56,6 +89,71 @@ int cos_open_file_for_write(cos_pool_t *p, const char *path, cos_file_buf_t *fb)
 
 int cos_open_file_for_range_write(cos_pool_t *p, const char *path, int64_t file_pos, int64_t file_last, cos_file_buf_t *fb);
 
+/**
+ * share the file opened by the caller among the requests, it is not closed with the request.
+ * @param fb file_pos is the position of the next positional read or write.
+ */
+void cos_share_file_for_range(apr_file_t *file, int64_t file_pos, int64_t file_last, cos_file_buf_t *fb);
+
+/**
+ * positional read and write, the offset of the file is not used so that the file can be shared by threads.
+ * @return APR_SUCCESS success, other failure.
+ */
+int cos_file_read_at(apr_file_t *file, int64_t offset, void *buffer, apr_size_t *nbytes);
+
+int cos_file_write_at(apr_file_t *file, int64_t offset, const void *buffer, apr_size_t *nbytes);
+
+/**
+ * allocate the blocks of the file up to size, it is not supported on all platforms.
+ * @return APR_SUCCESS success, other failure.
+ */
+int cos_file_preallocate(apr_file_t *file, int64_t size);
+
+/**
+ * hint the kernel how the range of the file is accessed, len 0 means to the end of the file.
+ * @return APR_SUCCESS success, APR_ENOTIMPL not supported on the platform, other failure.
+ */
+int cos_file_advise(apr_file_t *file, int64_t offset, int64_t len, cos_file_advice_e advice);
+
+/**
+ * open the file for read with O_DIRECT, the offset, length and buffer of the read must be aligned.
+ * @return APR_SUCCESS success, APR_ENOTIMPL not supported on the platform, other failure.
+ */
+int cos_open_file_for_direct_read(cos_pool_t *p, const char *path, apr_file_t **file);
+
+/**
+ * positional read of the file opened with O_DIRECT through the aligned buffer of fb,
+ * the data left in the buffer is served first.
+ * @param fb file_pos is advanced by the bytes read.
+ * @return APR_SUCCESS success, APR_EOF end of file, other failure.
+ */
+int cos_file_read_direct(cos_file_buf_t *fb, void *buffer, apr_size_t *nbytes);
+
+/**
+ * the writer thread is started by the first download written behind and lives until deinitialize,
+ * the buffers are kept in a free list and reused by the later downloads.
+ */
+int cos_write_behind_initialize();
+void cos_write_behind_deinitialize();
+
+/**
+ * write the file behind the download, the received data is copied to the buffers of size bytes in total
+ * and written by the writer thread at the offset from file_pos, so that a slow disk does not stall the network.
+ * @return APR_SUCCESS success, other failure.
+ */
+int cos_write_behind_create(cos_pool_t *p, apr_file_t *file, int64_t file_pos, int64_t size, cos_write_behind_t **wb);
+
+/**
+ * copy the data to the buffers, wait for a written buffer when all are filled.
+ * @return the bytes copied, COSE_FILE_WRITE_ERROR a previous write failure.
+ */
+int cos_write_behind_write(cos_write_behind_t *wb, const char *buffer, int len);
+
+/**
+ * write the data left and return the buffers to the free list.
+ * @return APR_SUCCESS success, the status of the first failed write.
+ */
+int cos_write_behind_finish(cos_write_behind_t *wb);
 
 COS_CPP_END
 
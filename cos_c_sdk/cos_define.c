@@ -10,6 +10,8 @@ const char COS_GRANT_FULL_CONTROL[] = "x-cos-grant-full-control";
 const char COS_CONTENT_MD5[] = "Content-MD5";
 const char COS_CONTENT_TYPE[] = "Content-Type";
 const char COS_CONTENT_LENGTH[] = "Content-Length";
+const char COS_ETAG[] = "ETag";
+const char COS_LAST_MODIFIED[] = "Last-Modified";
 const char COS_DATE[] = "Date";
 const char COS_AUTHORIZATION[] = "Authorization";
 const char COS_ACCESSKEYID[] = "COSAccessKeyId";
@@ -17,6 +19,11 @@ const char COS_EXPECT[] = "Expect";
 const char COS_TRANSFER_ENCODING[] = "Transfer-Encoding";
 const char COS_HOST[] = "Host";
 const char COS_RANGE[] = "Range";
+const char COS_CONTENT_RANGE[] = "Content-Range";
+const char COS_IF_NONE_MATCH[] = "If-None-Match";
+const char COS_IF_MATCH[] = "If-Match";
+const char COS_IF_MODIFIED_SINCE[] = "If-Modified-Since";
+const char COS_IF_UNMODIFIED_SINCE[] = "If-Unmodified-Since";
 const char COS_EXPIRES[] = "Expires";
 const char COS_SIGNATURE[] = "Signature";
 const char COS_ACL[] = "acl";
@@ -39,6 +46,7 @@ const char COS_POSITION[] = "position";
 const char COS_MULTIPART_CONTENT_TYPE[] = "application/x-www-form-urlencoded";
 const char COS_COPY_SOURCE[] = "x-cos-copy-source";
 const char COS_COPY_SOURCE_RANGE[] = "x-cos-copy-source-range";
+const char COS_COPY_SOURCE_IF_MATCH[] = "x-cos-copy-source-If-Match";
 const char COS_SECURITY_TOKEN[] = "security-token";
 const char COS_STS_SECURITY_TOKEN[] = "x-cos-security-token";
 const char COS_REPLACE_OBJECT_META[] = "x-cos-replace-object-meta";
@@ -36,6 +36,8 @@ extern const char COS_GRANT_FULL_CONTROL[];
 extern const char COS_CONTENT_MD5[];
 extern const char COS_CONTENT_TYPE[];
 extern const char COS_CONTENT_LENGTH[];
+extern const char COS_ETAG[];
+extern const char COS_LAST_MODIFIED[];
 extern const char COS_DATE[];
 extern const char COS_AUTHORIZATION[];
 extern const char COS_ACCESSKEYID[];
@@ -64,6 +66,7 @@ extern const char COS_POSITION[];
 extern const char COS_MULTIPART_CONTENT_TYPE[];
 extern const char COS_COPY_SOURCE[];
 extern const char COS_COPY_SOURCE_RANGE[];
+extern const char COS_COPY_SOURCE_IF_MATCH[];
 extern const char COS_SECURITY_TOKEN[];
 extern const char COS_STS_SECURITY_TOKEN[];
 extern const char COS_REPLACE_OBJECT_META[];
@@ -103,6 +106,11 @@ extern const int COS_PER_RET_NUM;
 extern const int MAX_SUFFIX_LEN;
 extern const char COS_CONTENT_SHA1[];
 extern const char COS_RANGE[];
+extern const char COS_CONTENT_RANGE[];
+extern const char COS_IF_NONE_MATCH[];
+extern const char COS_IF_MATCH[];
+extern const char COS_IF_MODIFIED_SINCE[];
+extern const char COS_IF_UNMODIFIED_SINCE[];
 
 
 typedef struct cos_lib_curl_initializer_s cos_lib_curl_initializer_t;
@@ -124,6 +132,17 @@ typedef enum {
     COS_ACL_PUBLIC_READ_WRITE        = 2    /*< public read write */
 } cos_acl_e;
 
+/**
+ * cos_task_priority is the priority of the part tasks of a multi-thread transfer
+ * in the shared transfer thread pool. A transfer with higher priority gets a
+ * larger share of the threads, and its tasks are taken before the queued ones.
+ **/
+typedef enum {
+    COS_TASK_PRIORITY_NORMAL         = 0,   /*< normal, default */
+    COS_TASK_PRIORITY_LOW            = 1,   /*< low */
+    COS_TASK_PRIORITY_HIGH           = 2    /*< high */
+} cos_task_priority_e;
+
 typedef struct {
     cos_string_t endpoint;
     cos_string_t access_key_id;
@@ -141,6 +160,7 @@ typedef struct {
     cos_config_t *config;
     cos_http_controller_t *ctl; /*< cos http controller, more see cos_transport.h */
     cos_pool_t *pool;
+    cos_cancel_token_t *cancel_token; /*< the in-flight requests are aborted once it is cancelled, NULL never */
 } cos_request_options_t;
 
 typedef struct {
@@ -171,6 +191,8 @@ typedef struct {
     cos_string_t owner_id;
     cos_string_t owner_display_name;
     cos_string_t storage_class;
+    int64_t object_size;           // size parsed, -1 if absent
+    int64_t last_modified_epoch;   // last_modified in seconds since the epoch, -1 if absent or not parsed
 } cos_list_object_content_t;
 
 typedef struct {
@@ -214,8 +236,27 @@ typedef struct {
     cos_string_t next_marker;
     cos_list_t object_list;
     cos_list_t common_prefix_list;
+    int zero_copy;                 // COS_TRUE to point the strings of object_list into the response body in
+                                   // the pool of options instead of copying them, they are not NUL terminated
 } cos_list_object_params_t;
 
+/*
+ * the callback of parallel listing, called on the thread of the caller,
+ * return 0 to continue, others to stop the listing
+ */
+typedef int (*cos_list_object_callback)(void *user_data, cos_list_object_content_t *content);
+
+typedef struct {
+    cos_string_t prefix;
+    cos_string_t marker;
+    cos_string_t delimiter;        // the keys are partitioned by the common prefixes of delimiter, "/" by default
+    cos_list_t split_marker_list;  // cos_object_key_t of sorted keys, the ranges between them are partitions instead
+    int max_ret;
+    int sorted;                    // COS_TRUE to emit the keys in order, the pages listed ahead are buffered
+} cos_parallel_list_object_params_t;
+
+typedef struct cos_list_iter_s cos_list_iter_t;
+
 typedef struct {
     cos_string_t encoding_type;
     cos_string_t part_number_marker;
@@ -239,6 +280,7 @@ typedef struct {
 } cos_list_multipart_upload_params_t;
 
 typedef struct {
+    cos_string_t copy_source;    // bucket-appid.cos.region.myqcloud.com/object as cos_copy_object, empty the source_bucket of the endpoint
     cos_string_t source_bucket;
     cos_string_t source_object;
     cos_string_t dest_bucket;
@@ -247,12 +289,15 @@ typedef struct {
     int part_num;
     int64_t range_start;
     int64_t range_end;
+    cos_copy_object_params_t rsp_content; // the etag and last modified time of the copied part
 } cos_upload_part_copy_params_t;
 
 typedef struct {
     cos_string_t filename;  /**< file range read filename */
     int64_t file_pos;   /**< file range read start position */
     int64_t file_last;  /**< file range read last position */
+    apr_file_t *file;   /**< the file shared by parts with positional io, NULL the filename is opened */
+    int direct_io;      /**< the shared file is opened with O_DIRECT, read through an aligned buffer */
 } cos_upload_file_t;
 
 typedef struct {
@@ -323,7 +368,14 @@ typedef struct {
     int64_t  part_size;  // bytes, default 1MB
     int32_t  thread_num;  // default 1
     int      enable_checkpoint; // default disable, false
-    cos_string_t checkpoint_path;  // dafault ./filepath.ucp or ./filepath.dcp
+    cos_string_t checkpoint_path;  // dafault ./filepath.cp for upload, ./filepath.dcp for download, tmpdir/cos_copy_md5.ccp for copy
+    int      priority;    // cos_task_priority_e, default COS_TASK_PRIORITY_NORMAL
+    int      auto_tune;   // default disable, false, adjust the concurrency and choose part_size by the observed throughput
+    int64_t  buffer_size; // the max memory of the parts downloaded ahead, for stream download, default 2 * thread_num * part_size
+    int      enable_fallocate; // default disable, false, allocate the blocks of the downloaded file before the parts are written
+    int      enable_fadvise;   // default disable, false, read the parts of the uploaded file sequentially and drop them from the page cache after upload
+    int      enable_readahead; // default disable, false, read the next range of the uploaded file into the page cache while the part is sent
+    int      enable_direct_io; // default disable, false, read the uploaded file with O_DIRECT bypassing the page cache, linux only
 } cos_resumable_clt_params_t;
 
 typedef struct {
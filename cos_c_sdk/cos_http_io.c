@@ -1,7 +1,12 @@
 #include "cos_log.h"
 #include "cos_http_io.h"
 #include "cos_sys_define.h"
+#include "cos_thread_pool.h"
+#include "cos_meta_cache.h"
+#include "cos_block_cache.h"
+#include "cos_single_flight.h"
 #include <apr_thread_mutex.h>
+#include <apr_atomic.h>
 #include <apr_file_io.h>
 
 cos_pool_t *cos_global_pool = NULL;
@@ -85,6 +90,7 @@ cos_http_request_options_t *cos_http_request_options_create(cos_pool_t *p)
     options->enable_crc = COS_TRUE;
     options->proxy_auth = NULL;
     options->proxy_host = NULL;
+    options->write_behind_size = 0;
 
     return options;
 }
@@ -114,6 +120,31 @@ cos_http_controller_t *cos_http_controller_create(cos_pool_t *p, int owner)
     return ctl;
 }
 
+cos_cancel_token_t *cos_cancel_token_create(cos_pool_t *p, cos_cancel_token_t *parent)
+{
+    cos_cancel_token_t *token;
+
+    token = (cos_cancel_token_t *)cos_pcalloc(p, sizeof(cos_cancel_token_t));
+    token->parent = parent;
+
+    return token;
+}
+
+void cos_cancel(cos_cancel_token_t *token)
+{
+    apr_atomic_set32(&token->cancelled, 1);
+}
+
+int cos_is_cancelled(cos_cancel_token_t *token)
+{
+    for (; token != NULL; token = token->parent) {
+        if (apr_atomic_read32(&token->cancelled)) {
+            return COS_TRUE;
+        }
+    }
+    return COS_FALSE;
+}
+
 cos_http_request_t *cos_http_request_create(cos_pool_t *p)
 {
     cos_http_request_t *req;
@@ -275,6 +306,67 @@ int cos_write_http_body_file_part(cos_http_response_t *resp, const char *buffer,
     return nbytes;
 }
 
+int cos_read_http_body_file_at(cos_http_request_t *req, char *buffer, int len)
+{
+    int s;
+    char buf[256];
+    apr_size_t nbytes = len;
+    apr_size_t bytes_left;
+    
+    if (req->file_buf == NULL || req->file_buf->file == NULL) {
+        cos_error_log("request body arg invalid file_buf NULL.");
+        return COSE_INVALID_ARGUMENT;
+    }
+
+    if (req->file_buf->file_pos >= req->file_buf->file_last) {
+        cos_debug_log("file read finish.");
+        return 0;
+    }
+
+    bytes_left = (apr_size_t)(req->file_buf->file_last - req->file_buf->file_pos);
+    if (nbytes > bytes_left) {
+        nbytes = bytes_left;
+    }
+
+    if (req->file_buf->align_buf != NULL) {
+        // the file is opened with O_DIRECT, file_pos is advanced by the read
+        if ((s = cos_file_read_direct(req->file_buf, buffer, &nbytes)) != APR_SUCCESS) {
+            cos_error_log("cos_file_read_direct filure, code:%d %s.", s, apr_strerror(s, buf, sizeof(buf)));
+            return COSE_FILE_READ_ERROR;
+        }
+        return nbytes;
+    }
+
+    if ((s = cos_file_read_at(req->file_buf->file, req->file_buf->file_pos, buffer, &nbytes)) != APR_SUCCESS) {
+        cos_error_log("cos_file_read_at filure, code:%d %s.", s, apr_strerror(s, buf, sizeof(buf)));
+        return COSE_FILE_READ_ERROR;
+    }
+    req->file_buf->file_pos += nbytes;
+    return nbytes;
+}
+
+int cos_write_http_body_file_at(cos_http_response_t *resp, const char *buffer, int len)
+{
+    int s;
+    char buf[256];
+    apr_size_t nbytes = len;
+    
+    if (resp->file_buf == NULL || resp->file_buf->file == NULL) {
+        cos_error_log("file_buf is NULL.");
+        return COSE_INVALID_ARGUMENT;
+    }
+    
+    if ((s = cos_file_write_at(resp->file_buf->file, resp->file_buf->file_pos, buffer, &nbytes)) != APR_SUCCESS) {
+        cos_error_log("cos_file_write_at fialure, code:%d %s.", s, apr_strerror(s, buf, sizeof(buf)));
+        return COSE_FILE_WRITE_ERROR;
+    }
+    
+    resp->file_buf->file_pos += nbytes;
+    resp->body_len += nbytes;
+
+    return nbytes;
+}
+
 
 int cos_http_io_initialize(const char *user_agent_info, int flags)
 {
@@ -316,6 +408,26 @@ int cos_http_io_initialize(const char *user_agent_info, int flags)
         return COSE_INTERNAL_ERROR;
     }
 
+    if ((s = cos_thread_pool_initialize()) != COSE_OK) {
+        return s;
+    }
+
+    if ((s = cos_meta_cache_initialize()) != COSE_OK) {
+        return s;
+    }
+
+    if ((s = cos_block_cache_initialize()) != COSE_OK) {
+        return s;
+    }
+
+    if ((s = cos_single_flight_initialize()) != COSE_OK) {
+        return s;
+    }
+
+    if ((s = cos_write_behind_initialize()) != COSE_OK) {
+        return s;
+    }
+
     apr_snprintf(cos_user_agent, sizeof(cos_user_agent)-1, "%s(Compatible %s)", 
                  COS_VER, user_agent_info);
 
@@ -331,6 +443,11 @@ int cos_http_io_initialize(const char *user_agent_info, int flags)
 
 void cos_http_io_deinitialize()
 {
+    cos_thread_pool_deinitialize();
+    cos_meta_cache_deinitialize();
+    cos_block_cache_deinitialize();
+    cos_single_flight_deinitialize();
+    cos_write_behind_deinitialize();
     apr_thread_mutex_destroy(requestStackMutexG);
     apr_thread_mutex_destroy(downloadMutex);
 
@@ -9,6 +9,10 @@ COS_CPP_START
 
 cos_http_controller_t *cos_http_controller_create(cos_pool_t *p, int owner);
 
+cos_cancel_token_t *cos_cancel_token_create(cos_pool_t *p, cos_cancel_token_t *parent);
+void cos_cancel(cos_cancel_token_t *token);
+int cos_is_cancelled(cos_cancel_token_t *token);
+
 /* http io error message*/
 static APR_INLINE const char *cos_http_controller_get_reason(cos_http_controller_t *ctl)
 {
@@ -39,6 +43,9 @@ int cos_read_http_body_file(cos_http_request_t *req, char *buffer, int len);
 int cos_write_http_body_file(cos_http_response_t *resp, const char *buffer, int len);
 int cos_write_http_body_file_part(cos_http_response_t *resp, const char *buffer, int len);
 
+int cos_read_http_body_file_at(cos_http_request_t *req, char *buffer, int len);
+int cos_write_http_body_file_at(cos_http_response_t *resp, const char *buffer, int len);
+
 
 typedef cos_http_transport_t *(*cos_http_transport_create_pt)(cos_pool_t *p);
 typedef int (*cos_http_transport_perform_pt)(cos_http_transport_t *t);
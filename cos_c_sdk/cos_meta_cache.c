@@ -0,0 +1,325 @@
+#include "cos_log.h"
+#include "cos_sys_define.h"
+#include "cos_define.h"
+#include "cos_meta_cache.h"
+#include "apr_hash.h"
+#include "apr_thread_mutex.h"
+
+#define COS_META_CACHE_HEADER_NUM 4
+
+typedef struct cos_meta_cache_entry_s cos_meta_cache_entry_t;
+
+struct cos_meta_cache_entry_s {
+    cos_list_t node;
+    const char *key;
+    apr_ssize_t key_len;
+    const char *access_key_id;  // the credentials of the head, the entry is not served to others
+    int status;
+    apr_time_t expires;
+    const char *values[COS_META_CACHE_HEADER_NUM];  // NULL if the header is absent
+};
+
+typedef struct {
+    apr_thread_mutex_t *mutex;
+    apr_hash_t *entries;
+    cos_list_t lru;             // the most recently used entry first
+    int count;
+    apr_uint32_t generation;
+} cos_meta_cache_shard_t;
+
+static const char *cos_meta_cache_headers[COS_META_CACHE_HEADER_NUM] = {
+    COS_ETAG, COS_CONTENT_LENGTH, COS_LAST_MODIFIED, COS_HASH_CRC64_ECMA
+};
+
+static cos_pool_t *cos_meta_cache_pool = NULL;
+static cos_meta_cache_shard_t *cos_meta_cache_shards = NULL;
+static int cos_meta_cache_capacity = 0;       // the max number of entries of a shard
+static apr_time_t cos_meta_cache_ttl = 0;
+static apr_time_t cos_meta_cache_negative_ttl = 0;
+
+static cos_meta_cache_shard_t *cos_meta_cache_shard(const char *key, apr_ssize_t *key_len)
+{
+    *key_len = APR_HASH_KEY_STRING;
+    return cos_meta_cache_shards + apr_hashfunc_default(key, key_len) % COS_META_CACHE_SHARD_NUM;
+}
+
+// called with shard->mutex locked
+static void cos_meta_cache_remove(cos_meta_cache_shard_t *shard, cos_meta_cache_entry_t *entry)
+{
+    apr_hash_set(shard->entries, entry->key, entry->key_len, NULL);
+    cos_list_del(&entry->node);
+    shard->count--;
+    free(entry);
+}
+
+// called with shard->mutex locked
+static void cos_meta_cache_evict(cos_meta_cache_shard_t *shard, int capacity)
+{
+    while (shard->count > capacity) {
+        cos_meta_cache_remove(shard, cos_list_entry(shard->lru.prev, cos_meta_cache_entry_t, node));
+    }
+}
+
+static int cos_meta_cache_owned(cos_meta_cache_entry_t *entry, const cos_string_t *access_key_id)
+{
+    return strlen(entry->access_key_id) == (size_t)access_key_id->len &&
+        0 == memcmp(entry->access_key_id, access_key_id->data, access_key_id->len);
+}
+
+int cos_meta_cache_initialize()
+{
+    int i;
+    int s;
+    char buf[256];
+    cos_meta_cache_shard_t *shard;
+
+    if ((s = cos_pool_create(&cos_meta_cache_pool, NULL)) != APR_SUCCESS) {
+        cos_error_log("cos_pool_create failure, code:%d %s.\n", s, apr_strerror(s, buf, sizeof(buf)));
+        return COSE_INTERNAL_ERROR;
+    }
+
+    cos_meta_cache_shards = (cos_meta_cache_shard_t *)cos_pcalloc(cos_meta_cache_pool,
+            sizeof(cos_meta_cache_shard_t) * COS_META_CACHE_SHARD_NUM);
+    for (i = 0; i < COS_META_CACHE_SHARD_NUM; i++) {
+        shard = cos_meta_cache_shards + i;
+        if ((s = apr_thread_mutex_create(&shard->mutex, APR_THREAD_MUTEX_DEFAULT, cos_meta_cache_pool)) != APR_SUCCESS) {
+            cos_error_log("apr_thread_mutex_create failure, code:%d %s.\n", s, apr_strerror(s, buf, sizeof(buf)));
+            cos_meta_cache_shards = NULL;
+            return COSE_INTERNAL_ERROR;
+        }
+        shard->entries = apr_hash_make(cos_meta_cache_pool);
+        cos_list_init(&shard->lru);
+    }
+
+    return COSE_OK;
+}
+
+void cos_meta_cache_deinitialize()
+{
+    int i;
+
+    if (cos_meta_cache_shards != NULL) {
+        for (i = 0; i < COS_META_CACHE_SHARD_NUM; i++) {
+            cos_meta_cache_evict(cos_meta_cache_shards + i, 0);
+            apr_thread_mutex_destroy(cos_meta_cache_shards[i].mutex);
+        }
+        cos_meta_cache_shards = NULL;
+    }
+
+    if (cos_meta_cache_pool != NULL) {
+        cos_pool_destroy(cos_meta_cache_pool);
+        cos_meta_cache_pool = NULL;
+    }
+}
+
+int cos_set_meta_cache(int capacity, int ttl, int negative_ttl)
+{
+    int i;
+    cos_meta_cache_shard_t *shard;
+
+    if (capacity < 0 || ttl < 0 || negative_ttl < 0) {
+        return COSE_INVALID_ARGUMENT;
+    }
+
+    capacity = (capacity + COS_META_CACHE_SHARD_NUM - 1) / COS_META_CACHE_SHARD_NUM;
+    cos_meta_cache_ttl = apr_time_from_sec(ttl);
+    cos_meta_cache_negative_ttl = apr_time_from_sec(negative_ttl);
+    cos_meta_cache_capacity = capacity;
+
+    if (cos_meta_cache_shards != NULL) {
+        for (i = 0; i < COS_META_CACHE_SHARD_NUM; i++) {
+            shard = cos_meta_cache_shards + i;
+            apr_thread_mutex_lock(shard->mutex);
+            cos_meta_cache_evict(shard, capacity);
+            apr_thread_mutex_unlock(shard->mutex);
+        }
+    }
+
+    return COSE_OK;
+}
+
+char *cos_meta_cache_key(cos_pool_t *p, const cos_request_options_t *options,
+                         const cos_string_t *bucket, const cos_string_t *object)
+{
+    if (0 == cos_meta_cache_capacity || NULL == cos_meta_cache_shards) {
+        return NULL;
+    }
+
+    // an object name may contain any character, so it is the last part
+    return apr_psprintf(p, "%.*s\n%.*s\n%.*s",
+                        options->config->endpoint.len, options->config->endpoint.data,
+                        bucket->len, bucket->data, object->len, object->data);
+}
+
+void cos_meta_cache_invalidate(const cos_request_options_t *options,
+                               const cos_string_t *bucket,
+                               const cos_string_t *object)
+{
+    char *key;
+
+    key = cos_meta_cache_key(options->pool, options, bucket, object);
+    if (key != NULL) {
+        cos_meta_cache_invalidate_key(key);
+    }
+}
+
+cos_status_t *cos_meta_cache_get(const char *key, const cos_string_t *access_key_id,
+                                 cos_pool_t *p, cos_table_t **resp_headers)
+{
+    int i;
+    int status = 0;
+    apr_ssize_t key_len;
+    cos_meta_cache_shard_t *shard;
+    cos_meta_cache_entry_t *entry;
+    cos_table_t *headers = NULL;
+    cos_status_t *s;
+
+    shard = cos_meta_cache_shard(key, &key_len);
+    apr_thread_mutex_lock(shard->mutex);
+    entry = (cos_meta_cache_entry_t *)apr_hash_get(shard->entries, key, key_len);
+    if (entry != NULL && entry->expires <= apr_time_now()) {
+        cos_meta_cache_remove(shard, entry);
+        entry = NULL;
+    }
+    if (entry != NULL && !cos_meta_cache_owned(entry, access_key_id)) {
+        // another client may not be allowed to read the object
+        entry = NULL;
+    }
+    if (entry != NULL) {
+        cos_list_del(&entry->node);
+        __cos_list_add(&entry->node, &shard->lru, shard->lru.next);
+        status = entry->status;
+        headers = cos_table_make(p, COS_META_CACHE_HEADER_NUM);
+        for (i = 0; i < COS_META_CACHE_HEADER_NUM; i++) {
+            if (entry->values[i] != NULL) {
+                apr_table_set(headers, cos_meta_cache_headers[i], entry->values[i]);
+            }
+        }
+    }
+    apr_thread_mutex_unlock(shard->mutex);
+
+    if (NULL == entry) {
+        return NULL;
+    }
+
+    // the same status as the one of the request, a head response has no body
+    s = cos_status_create(p);
+    s->code = status;
+    if (!cos_http_is_ok(status)) {
+        s->error_code = (char *)COS_UNKNOWN_ERROR_CODE;
+    }
+    if (resp_headers != NULL) {
+        *resp_headers = headers;
+    }
+    return s;
+}
+
+apr_uint32_t cos_meta_cache_generation(const char *key)
+{
+    apr_ssize_t key_len;
+    apr_uint32_t generation;
+    cos_meta_cache_shard_t *shard;
+
+    shard = cos_meta_cache_shard(key, &key_len);
+    apr_thread_mutex_lock(shard->mutex);
+    generation = shard->generation;
+    apr_thread_mutex_unlock(shard->mutex);
+
+    return generation;
+}
+
+void cos_meta_cache_put(const char *key, const cos_string_t *access_key_id,
+                        apr_uint32_t generation, int status, cos_table_t *headers)
+{
+    int i;
+    apr_size_t size;
+    apr_size_t len;
+    apr_ssize_t key_len;
+    apr_time_t ttl;
+    char *data;
+    const char *values[COS_META_CACHE_HEADER_NUM];
+    cos_meta_cache_shard_t *shard;
+    cos_meta_cache_entry_t *entry;
+    cos_meta_cache_entry_t *old;
+
+    if (200 == status) {
+        ttl = cos_meta_cache_ttl;
+    } else if (404 == status) {
+        ttl = cos_meta_cache_negative_ttl;
+    } else {
+        return;
+    }
+    if (0 == ttl || 0 == cos_meta_cache_capacity) {
+        return;
+    }
+
+    // the entry and its strings are in one block, so it is freed at once on eviction
+    shard = cos_meta_cache_shard(key, &key_len);
+    size = sizeof(cos_meta_cache_entry_t) + key_len + 1 + access_key_id->len + 1;
+    for (i = 0; i < COS_META_CACHE_HEADER_NUM; i++) {
+        values[i] = NULL;
+        if (200 == status && headers != NULL) {
+            values[i] = apr_table_get(headers, cos_meta_cache_headers[i]);
+        }
+        if (values[i] != NULL) {
+            size += strlen(values[i]) + 1;
+        }
+    }
+    entry = (cos_meta_cache_entry_t *)malloc(size);
+    if (NULL == entry) {
+        return;
+    }
+    data = (char *)(entry + 1);
+    memcpy(data, key, key_len + 1);
+    entry->key = data;
+    entry->key_len = key_len;
+    data += key_len + 1;
+    memcpy(data, access_key_id->data, access_key_id->len);
+    data[access_key_id->len] = '\0';
+    entry->access_key_id = data;
+    data += access_key_id->len + 1;
+    for (i = 0; i < COS_META_CACHE_HEADER_NUM; i++) {
+        entry->values[i] = NULL;
+        if (values[i] != NULL) {
+            len = strlen(values[i]) + 1;
+            memcpy(data, values[i], len);
+            entry->values[i] = data;
+            data += len;
+        }
+    }
+    entry->status = status;
+    entry->expires = apr_time_now() + ttl;
+
+    apr_thread_mutex_lock(shard->mutex);
+    if (shard->generation != generation) {
+        // the object may be changed while the request is sent
+        apr_thread_mutex_unlock(shard->mutex);
+        free(entry);
+        return;
+    }
+    old = (cos_meta_cache_entry_t *)apr_hash_get(shard->entries, key, key_len);
+    if (old != NULL) {
+        cos_meta_cache_remove(shard, old);
+    }
+    apr_hash_set(shard->entries, entry->key, entry->key_len, entry);
+    __cos_list_add(&entry->node, &shard->lru, shard->lru.next);
+    shard->count++;
+    cos_meta_cache_evict(shard, cos_meta_cache_capacity);
+    apr_thread_mutex_unlock(shard->mutex);
+}
+
+void cos_meta_cache_invalidate_key(const char *key)
+{
+    apr_ssize_t key_len;
+    cos_meta_cache_shard_t *shard;
+    cos_meta_cache_entry_t *entry;
+
+    shard = cos_meta_cache_shard(key, &key_len);
+    apr_thread_mutex_lock(shard->mutex);
+    shard->generation++;
+    entry = (cos_meta_cache_entry_t *)apr_hash_get(shard->entries, key, key_len);
+    if (entry != NULL) {
+        cos_meta_cache_remove(shard, entry);
+    }
+    apr_thread_mutex_unlock(shard->mutex);
+}
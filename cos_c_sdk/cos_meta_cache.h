@@ -0,0 +1,69 @@
+#ifndef LIBCOS_META_CACHE_H
+#define LIBCOS_META_CACHE_H
+
+#include "cos_sys_define.h"
+#include "cos_define.h"
+#include "cos_status.h"
+
+
+COS_CPP_START
+
+#define COS_META_CACHE_SHARD_NUM 16
+
+/**
+  * @brief the metadata cache is owned by the sdk, it keeps the result of cos_head_object
+  *        by endpoint, bucket and object, it is disabled until cos_set_meta_cache is called,
+  *        the cached headers are ETag, Content-Length, Last-Modified and x-cos-hash-crc64ecma,
+  *        an entry is served to the heads with the access key it was cached with only,
+  *        a missing object is cached as a 404 without headers, the entries of an object are
+  *        invalidated by the PUT, POST and DELETE requests of this client on it, of a multipart
+  *        upload only the complete and abort requests invalidate them
+**/
+int cos_meta_cache_initialize();
+void cos_meta_cache_deinitialize();
+
+/**
+  * @brief enable the metadata cache with at most capacity entries, 0 to disable it and drop
+  *        the entries, ttl and negative_ttl are the seconds an entry of an existing object
+  *        and a missing one is kept, negative_ttl 0 not to cache missing objects
+**/
+int cos_set_meta_cache(int capacity, int ttl, int negative_ttl);
+
+/**
+  * @brief drop the entry of an object changed by others, e.g. by another client
+**/
+void cos_meta_cache_invalidate(const cos_request_options_t *options,
+                               const cos_string_t *bucket,
+                               const cos_string_t *object);
+
+/**
+  * @brief the key of an object in the cache, NULL if the cache is disabled
+**/
+char *cos_meta_cache_key(cos_pool_t *p, const cos_request_options_t *options,
+                         const cos_string_t *bucket, const cos_string_t *object);
+
+/**
+  * @brief get the status and the headers of a cached head_object, NULL if key is not cached
+  *        with access_key_id, resp_headers is created in p
+**/
+cos_status_t *cos_meta_cache_get(const char *key, const cos_string_t *access_key_id,
+                                 cos_pool_t *p, cos_table_t **resp_headers);
+
+/**
+  * @brief the generation of the shard of key, it changes on each invalidation in the shard,
+  *        get it before sending a head request and put the result with it, so the result of
+  *        a request racing with a change of the object is not cached
+**/
+apr_uint32_t cos_meta_cache_generation(const char *key);
+
+/**
+  * @brief cache the result of a head request, only 200 and 404 are cached
+**/
+void cos_meta_cache_put(const char *key, const cos_string_t *access_key_id,
+                        apr_uint32_t generation, int status, cos_table_t *headers);
+
+void cos_meta_cache_invalidate_key(const char *key);
+
+COS_CPP_END
+
+#endif
@@ -67,6 +67,7 @@ cos_status_t *cos_abort_multipart_upload(const cos_request_options_t *options,
 
     cos_init_object_request(options, bucket, object, HTTP_DELETE, 
                             &req, query_params, headers, NULL, 0, &resp);
+    cos_init_object_cache_keys(options, bucket, object, req);
 
     s = cos_process_request(options, req, resp);
     cos_fill_read_response_header(resp, resp_headers);
@@ -200,6 +201,7 @@ cos_status_t *cos_do_complete_multipart_upload(const cos_request_options_t *opti
 
     cos_init_object_request(options, bucket, object, HTTP_POST, 
                             &req, query_params, headers, NULL, 0, &resp);
+    cos_init_object_cache_keys(options, bucket, object, req);
 
     build_complete_multipart_upload_body(options->pool, part_list, &body);
     cos_write_request_body_from_buffer(&body, req);
@@ -324,7 +326,6 @@ cos_status_t *cos_do_upload_part_from_file(const cos_request_options_t *options,
     return s;
 }
 
-#if 0
 cos_status_t *cos_upload_part_copy(const cos_request_options_t *options,
                                    cos_upload_part_copy_params_t *params, 
                                    cos_table_t *headers, 
@@ -336,6 +337,7 @@ cos_status_t *cos_upload_part_copy(const cos_request_options_t *options,
     cos_table_t *query_params = NULL;
     char *copy_source = NULL;
     char *copy_source_range = NULL;
+    int res;
 
     s = cos_status_create(options->pool);
 
@@ -346,9 +348,13 @@ cos_status_t *cos_upload_part_copy(const cos_request_options_t *options,
 
     //init headers
     headers = cos_table_create_if_null(options, headers, 2);
-    copy_source = apr_psprintf(options->pool, "/%.*s/%.*s", 
-        params->source_bucket.len, params->source_bucket.data, 
-        params->source_object.len, params->source_object.data);
+    if (!cos_is_null_string(&params->copy_source)) {
+        copy_source = apr_psprintf(options->pool, "%.*s", 
+            params->copy_source.len, params->copy_source.data);
+    } else {
+        // the source bucket of the same appid and endpoint
+        copy_source = cos_gen_copy_source(options, &params->source_bucket, &params->source_object);
+    }
     apr_table_add(headers, COS_COPY_SOURCE, copy_source);
     copy_source_range = apr_psprintf(options->pool, 
             "bytes=%" APR_INT64_T_FMT "-%" APR_INT64_T_FMT,
@@ -360,10 +366,17 @@ cos_status_t *cos_upload_part_copy(const cos_request_options_t *options,
 
     s = cos_process_request(options, req, resp);
     cos_fill_read_response_header(resp, resp_headers);
+    if (!cos_status_is_ok(s)) {
+        return s;
+    }
+
+    res = cos_copy_object_parse_from_body(options->pool, &resp->body, &params->rsp_content);
+    if (res != COSE_OK) {
+        cos_xml_error_status_set(s, res);
+    }
 
     return s;
 }
-#endif
 
 cos_status_t *cos_get_sorted_uploaded_part(cos_request_options_t *options,
                                            const cos_string_t *bucket, 
@@ -582,12 +595,10 @@ cos_status_t *cos_do_download_part_to_file(const cos_request_options_t *options,
     cos_http_request_t *req = NULL;
     cos_http_response_t *resp = NULL;
     int res = COSE_OK;
-    char range_buf[64];
     
     headers = cos_table_create_if_null(options, headers, 1);
     params = cos_table_create_if_null(options, params, 0);
-    apr_snprintf(range_buf, sizeof(range_buf), "bytes=%"APR_INT64_T_FMT"-%"APR_INT64_T_FMT, download_file->file_pos, download_file->file_last-1);
-    apr_table_add(headers, COS_RANGE, range_buf);
+    cos_set_range_header(headers, download_file->file_pos, download_file->file_last);
 
     cos_init_object_request(options, bucket, object, HTTP_GET, 
                             &req, params, headers, progress_callback, 0, &resp);
@@ -610,3 +621,32 @@ cos_status_t *cos_do_download_part_to_file(const cos_request_options_t *options,
     return s;
 }
 
+cos_status_t *cos_do_download_part_to_buffer(const cos_request_options_t *options,
+                                             const cos_string_t *bucket, 
+                                             const cos_string_t *object,
+                                             int64_t start,
+                                             int64_t end,
+                                             cos_list_t *buffer,
+                                             cos_progress_callback progress_callback,
+                                             cos_table_t *headers, 
+                                             cos_table_t *params,
+                                             cos_table_t **resp_headers)
+{
+    cos_status_t *s = NULL;
+    cos_http_request_t *req = NULL;
+    cos_http_response_t *resp = NULL;
+    
+    headers = cos_table_create_if_null(options, headers, 1);
+    params = cos_table_create_if_null(options, params, 0);
+    cos_set_range_header(headers, start, end);
+
+    cos_init_object_request(options, bucket, object, HTTP_GET, 
+                            &req, params, headers, progress_callback, 0, &resp);
+
+    s = cos_process_request(options, req, resp);
+    cos_fill_read_response_body(resp, buffer);
+    cos_fill_read_response_header(resp, resp_headers);
+
+    return s;
+}
+
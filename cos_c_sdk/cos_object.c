@@ -6,6 +6,18 @@
 #include "cos_utility.h"
 #include "cos_xml.h"
 #include "cos_api.h"
+#include "cos_meta_cache.h"
+#include "cos_block_cache.h"
+#include "cos_single_flight.h"
+
+typedef struct {
+    const cos_string_t *bucket;
+    const cos_string_t *object;
+    cos_table_t *headers;
+    cos_table_t *params;
+    char *cache_key;
+    apr_uint32_t generation;
+} cos_object_read_t;
 
 cos_status_t *cos_put_object_from_buffer(const cos_request_options_t *options,
                                          const cos_string_t *bucket, 
@@ -121,19 +133,24 @@ cos_status_t *cos_get_object_to_buffer(const cos_request_options_t *options,
                                        params, buffer, NULL, resp_headers);
 }
 
-cos_status_t *cos_do_get_object_to_buffer(const cos_request_options_t *options, 
-                                          const cos_string_t *bucket, 
-                                          const cos_string_t *object,
-                                          cos_table_t *headers, 
-                                          cos_table_t *params,
-                                          cos_list_t *buffer,
-                                          cos_progress_callback progress_callback, 
-                                          cos_table_t **resp_headers)
+static cos_status_t *cos_send_get_object_to_buffer(const cos_request_options_t *options, 
+                                                   const cos_string_t *bucket, 
+                                                   const cos_string_t *object,
+                                                   cos_table_t *headers, 
+                                                   cos_table_t *params,
+                                                   cos_list_t *buffer,
+                                                   cos_progress_callback progress_callback, 
+                                                   cos_table_t **resp_headers)
 {
     cos_status_t *s = NULL;
     cos_http_request_t *req = NULL;
     cos_http_response_t *resp = NULL;
 
+    if (NULL == progress_callback && 
+        cos_block_cache_get_object(options, bucket, object, headers, params, buffer, resp_headers, &s)) {
+        return s;
+    }
+
     headers = cos_table_create_if_null(options, headers, 0);
     params = cos_table_create_if_null(options, params, 0);
 
@@ -152,6 +169,45 @@ cos_status_t *cos_do_get_object_to_buffer(const cos_request_options_t *options,
     return s;
 }
 
+static cos_status_t *cos_get_object_to_buffer_flight(const cos_request_options_t *options, void *arg,
+                                                     cos_list_t *buffer, cos_table_t **resp_headers)
+{
+    cos_object_read_t *read = (cos_object_read_t *)arg;
+
+    return cos_send_get_object_to_buffer(options, read->bucket, read->object, read->headers,
+                                         read->params, buffer, NULL, resp_headers);
+}
+
+cos_status_t *cos_do_get_object_to_buffer(const cos_request_options_t *options, 
+                                          const cos_string_t *bucket, 
+                                          const cos_string_t *object,
+                                          cos_table_t *headers, 
+                                          cos_table_t *params,
+                                          cos_list_t *buffer,
+                                          cos_progress_callback progress_callback, 
+                                          cos_table_t **resp_headers)
+{
+    char *flight_key = NULL;
+    cos_object_read_t read;
+
+    // the progress of a shared read can't be reported to each caller
+    if (NULL == progress_callback) {
+        flight_key = cos_single_flight_key(options, "GET", bucket, object, headers, params);
+    }
+    if (flight_key != NULL) {
+        memset(&read, 0, sizeof(read));
+        read.bucket = bucket;
+        read.object = object;
+        read.headers = headers;
+        read.params = params;
+        return cos_single_flight_do(options, flight_key, cos_get_object_to_buffer_flight,
+                                    &read, buffer, resp_headers);
+    }
+
+    return cos_send_get_object_to_buffer(options, bucket, object, headers, 
+                                         params, buffer, progress_callback, resp_headers);
+}
+
 cos_status_t *cos_get_object_to_file(const cos_request_options_t *options,
                                      const cos_string_t *bucket, 
                                      const cos_string_t *object,
@@ -207,11 +263,13 @@ cos_status_t *cos_do_get_object_to_file(const cos_request_options_t *options,
     return s;
 }
 
-cos_status_t *cos_head_object(const cos_request_options_t *options, 
-                              const cos_string_t *bucket, 
-                              const cos_string_t *object,
-                              cos_table_t *headers, 
-                              cos_table_t **resp_headers)
+static cos_status_t *cos_send_head_object(const cos_request_options_t *options, 
+                                          const cos_string_t *bucket, 
+                                          const cos_string_t *object,
+                                          cos_table_t *headers, 
+                                          const char *cache_key,
+                                          apr_uint32_t generation,
+                                          cos_table_t **resp_headers)
 {
     cos_status_t *s = NULL;
     cos_http_request_t *req = NULL;
@@ -228,9 +286,62 @@ cos_status_t *cos_head_object(const cos_request_options_t *options,
     s = cos_process_request(options, req, resp);
     cos_fill_read_response_header(resp, resp_headers);
 
+    if (cache_key != NULL) {
+        cos_meta_cache_put(cache_key, &options->config->access_key_id, generation, s->code, resp->headers);
+    }
+
     return s;
 }
 
+static cos_status_t *cos_head_object_flight(const cos_request_options_t *options, void *arg,
+                                            cos_list_t *buffer, cos_table_t **resp_headers)
+{
+    cos_object_read_t *read = (cos_object_read_t *)arg;
+
+    return cos_send_head_object(options, read->bucket, read->object, read->headers,
+                                read->cache_key, read->generation, resp_headers);
+}
+
+cos_status_t *cos_head_object(const cos_request_options_t *options, 
+                              const cos_string_t *bucket, 
+                              const cos_string_t *object,
+                              cos_table_t *headers, 
+                              cos_table_t **resp_headers)
+{
+    cos_status_t *s = NULL;
+    char *cache_key = NULL;
+    char *flight_key = NULL;
+    apr_uint32_t generation = 0;
+    cos_object_read_t read;
+
+    // the request headers may change the result, e.g. If-Match, so it is cached without them only
+    if (NULL == headers || apr_is_empty_table(headers)) {
+        cache_key = cos_meta_cache_key(options->pool, options, bucket, object);
+    }
+    if (cache_key != NULL) {
+        s = cos_meta_cache_get(cache_key, &options->config->access_key_id, options->pool, resp_headers);
+        if (s != NULL) {
+            return s;
+        }
+        generation = cos_meta_cache_generation(cache_key);
+    }
+
+    flight_key = cos_single_flight_key(options, "HEAD", bucket, object, headers, NULL);
+    if (flight_key != NULL) {
+        memset(&read, 0, sizeof(read));
+        read.bucket = bucket;
+        read.object = object;
+        read.headers = headers;
+        read.cache_key = cache_key;
+        read.generation = generation;
+        return cos_single_flight_do(options, flight_key, cos_head_object_flight,
+                                    &read, NULL, resp_headers);
+    }
+
+    return cos_send_head_object(options, bucket, object, headers, 
+                                cache_key, generation, resp_headers);
+}
+
 cos_status_t *cos_delete_object(const cos_request_options_t *options,
                                 const cos_string_t *bucket, 
                                 const cos_string_t *object, 
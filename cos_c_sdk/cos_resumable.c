@@ -7,6 +7,7 @@
 #include "cos_utility.h"
 #include "cos_xml.h"
 #include "cos_api.h"
+#include "cos_crc64.h"
 #include "cos_resumable.h"
 
 int32_t cos_get_thread_num(cos_resumable_clt_params_t *clt_params)
@@ -17,6 +18,54 @@ int32_t cos_get_thread_num(cos_resumable_clt_params_t *clt_params)
     return clt_params->thread_num;
 }
 
+int64_t cos_get_resumable_part_size(cos_resumable_clt_params_t *clt_params)
+{
+    if (NULL == clt_params) {
+        return COS_DEFAULT_PART_SIZE;
+    }
+    return clt_params->part_size;
+}
+
+int cos_is_auto_tune(cos_resumable_clt_params_t *clt_params)
+{
+    return NULL != clt_params && clt_params->auto_tune;
+}
+
+int64_t cos_get_auto_tune_part_size(int64_t file_size, int32_t thread_num)
+{
+    int64_t part_size = COS_DEFAULT_PART_SIZE;
+    int64_t stream_rate = 0;
+    cos_thread_pool_t *thrp;
+
+    // a part lasts COS_AUTO_TUNE_PART_SECONDS at the observed throughput of one part task,
+    // so the time to set up each request is small against the time to transfer it
+    thrp = cos_get_thread_pool();
+    if (NULL != thrp) {
+        stream_rate = cos_thread_pool_stream_rate(thrp);
+    }
+    if (stream_rate > 0) {
+        part_size = stream_rate * COS_AUTO_TUNE_PART_SECONDS;
+    }
+
+    // small files are still split to keep all threads busy
+    if (thread_num > 1) {
+        part_size = cos_min(part_size, file_size / thread_num);
+    }
+    part_size = cos_max(part_size, COS_AUTO_TUNE_MIN_PART_SIZE);
+    part_size = cos_min(part_size, COS_AUTO_TUNE_MAX_PART_SIZE);
+    cos_get_part_size(file_size, &part_size);
+
+    return part_size;
+}
+
+int cos_get_task_priority(cos_resumable_clt_params_t *clt_params)
+{
+    if (NULL == clt_params) {
+        return COS_TASK_PRIORITY_NORMAL;
+    }
+    return clt_params->priority;
+}
+
 void cos_get_checkpoint_path(cos_resumable_clt_params_t *clt_params, const cos_string_t *filepath, 
                              cos_pool_t *pool, cos_string_t *checkpoint_path)
 {
@@ -36,6 +85,59 @@ void cos_get_checkpoint_path(cos_resumable_clt_params_t *clt_params, const cos_s
     checkpoint_path->len = clt_params->checkpoint_path.len;
 }
 
+void cos_get_copy_checkpoint_path(cos_resumable_clt_params_t *clt_params, const cos_string_t *copy_source, 
+                                  const cos_string_t *bucket, const cos_string_t *object, 
+                                  cos_pool_t *pool, cos_string_t *checkpoint_path)
+{
+    int i = 0;
+    char *key = NULL;
+    unsigned char *md5 = NULL;
+    char hex[APR_MD5_DIGESTSIZE * 2 + 1];
+    const char *temp_dir = NULL;
+
+    if ((NULL == checkpoint_path) || (NULL == clt_params) || (!clt_params->enable_checkpoint)) {
+        return;
+    }
+
+    if (cos_is_null_string(&clt_params->checkpoint_path)) {
+        // there is no local file to put it beside, the name is the md5 of the source and the destination,
+        // so the keys of any characters are fine and the copies to one destination do not share it
+        key = apr_psprintf(pool, "%.*s\n%.*s/%.*s", copy_source->len, copy_source->data, 
+            bucket->len, bucket->data, object->len, object->data);
+        md5 = cos_md5(pool, key, strlen(key));
+        for (i = 0; i < APR_MD5_DIGESTSIZE; i++) {
+            apr_snprintf(hex + 2 * i, 3, "%02x", md5[i]);
+        }
+        if (apr_temp_dir_get(&temp_dir, pool) != APR_SUCCESS) {
+            temp_dir = ".";
+        }
+        cos_str_set(checkpoint_path, apr_psprintf(pool, "%s/cos_copy_%s.ccp", temp_dir, hex));
+        return;
+    }
+
+    checkpoint_path->data = clt_params->checkpoint_path.data;
+    checkpoint_path->len = clt_params->checkpoint_path.len;
+}
+
+void cos_get_download_checkpoint_path(cos_resumable_clt_params_t *clt_params, const cos_string_t *filepath, 
+                                      cos_pool_t *pool, cos_string_t *checkpoint_path)
+{
+    if ((NULL == checkpoint_path) || (NULL == clt_params) || (!clt_params->enable_checkpoint)) {
+        return;
+    }
+
+    if (cos_is_null_string(&clt_params->checkpoint_path)) {
+        int len = filepath->len + strlen(".dcp") + 1;
+        char *buffer = (char *)cos_pcalloc(pool, len);
+        apr_snprintf(buffer, len, "%.*s.dcp", filepath->len, filepath->data);
+        cos_str_set(checkpoint_path , buffer);
+        return;
+    }
+
+    checkpoint_path->data = clt_params->checkpoint_path.data;
+    checkpoint_path->len = clt_params->checkpoint_path.len;
+}
+
 int cos_get_file_info(const cos_string_t *filepath, cos_pool_t *pool, apr_finfo_t *finfo) 
 {
     apr_status_t s;
@@ -113,37 +215,219 @@ void cos_build_thread_params(cos_transport_thread_params_t *thr_params, int part
                              cos_part_task_result_t *result) 
 {
     int i = 0;
-    cos_pool_t *subpool = NULL;
-    cos_config_t *config = NULL;
-    cos_http_controller_t *ctl;
+    cos_pool_t *result_pool = NULL;
+    apr_thread_mutex_t *result_mutex = NULL;
+    cos_cancel_token_t *cancel_token = NULL;
+
+    // the request context of a part is created on the worker when it runs, 
+    // only the config, which is read only during the transfer, is shared
+    if (part_num > 0) {
+        // apr pools are not thread safe, the workers allocate the results from a pool of their own
+        // and the coordinator keeps allocating from parent_pool, both are freed with parent_pool
+        cos_pool_create(&result_pool, parent_pool);
+        apr_thread_mutex_create(&result_mutex, APR_THREAD_MUTEX_DEFAULT, parent_pool);
+        // cancelled by the caller or by the first failed part, the parts in flight are aborted
+        cancel_token = cos_cancel_token_create(parent_pool, options->cancel_token);
+    }
     for (; i < part_num; i++) {
-        cos_pool_create(&subpool, parent_pool); 
-        config = cos_config_create(subpool);
-        cos_str_set(&config->endpoint, options->config->endpoint.data);
-        cos_str_set(&config->access_key_id, options->config->access_key_id.data);
-        cos_str_set(&config->access_key_secret, options->config->access_key_secret.data);
-        cos_str_set(&config->appid, options->config->appid.data);
-        config->is_cname = options->config->is_cname;
-        ctl = cos_http_controller_create(subpool, 0);
-        thr_params[i].options.config = config;
-        thr_params[i].options.ctl = ctl;
-        thr_params[i].options.pool = subpool;
+        thr_params[i].options.config = options->config;
+        thr_params[i].options.ctl = NULL;
+        thr_params[i].options.pool = NULL;
+        thr_params[i].options.cancel_token = cancel_token;
+        thr_params[i].result_pool = result_pool;
+        thr_params[i].result_mutex = result_mutex;
         thr_params[i].bucket = bucket;
         thr_params[i].object = object;
         thr_params[i].filepath = filepath;
+        thr_params[i].file = NULL;
+        thr_params[i].fadvise = COS_FALSE;
+        thr_params[i].readahead = COS_FALSE;
+        thr_params[i].direct_io = COS_FALSE;
+        thr_params[i].copy_source = NULL;
+        thr_params[i].copy_source_etag = NULL;
+        thr_params[i].object_etag = NULL;
+        thr_params[i].buffer_list = NULL;
+        thr_params[i].list_pool = NULL;
+        thr_params[i].list_params = NULL;
+        cos_list_init(&thr_params[i].key_list);
+        cos_list_init(&thr_params[i].retry_node);
+        thr_params[i].retry_func = NULL;
         thr_params[i].upload_id = upload_id;
         thr_params[i].part = parts + i;
         thr_params[i].result = result + i;
         thr_params[i].result->part = thr_params[i].part;
+        thr_params[i].result->s = NULL;
+        cos_str_set(&thr_params[i].result->etag, "");
+        thr_params[i].result->elapsed = 0;
+        thr_params[i].result->retries = 0;
+        thr_params[i].result->retrying = COS_FALSE;
+        thr_params[i].result->throttled = COS_FALSE;
+        thr_params[i].result->has_crc64 = COS_FALSE;
+        thr_params[i].result->crc64 = 0;
     }
 }
 
 void cos_destroy_thread_pool(cos_transport_thread_params_t *thr_params, int part_num) 
+{
+    if (part_num > 0 && NULL != thr_params[0].result_mutex) {
+        apr_thread_mutex_destroy(thr_params[0].result_mutex);
+        thr_params[0].result_mutex = NULL;
+    }
+}
+
+void cos_set_part_file(cos_transport_thread_params_t *thr_params, int part_num, apr_file_t *file)
 {
     int i = 0;
+    // the file is opened once for all parts instead of once per part
     for (; i < part_num; i++) {
-        cos_pool_destroy(thr_params[i].options.pool);
+        thr_params[i].file = file;
+    }
+}
+
+int cos_open_part_file_for_read(cos_pool_t *p, cos_string_t *filepath, cos_resumable_clt_params_t *clt_params,
+                                cos_transport_thread_params_t *thr_params, int part_num, apr_file_t **file)
+{
+    int i;
+    int rv = APR_ENOTIMPL;
+    int direct_io = COS_FALSE;
+    char buf[256];
+
+    if (NULL != clt_params && clt_params->enable_direct_io) {
+        rv = cos_open_file_for_direct_read(p, filepath->data, file);
+        if (rv == APR_SUCCESS) {
+            direct_io = COS_TRUE;
+        } else {
+            // O_DIRECT is not supported by the platform or the file system
+            cos_warn_log("cos_open_file_for_direct_read failure, code:%d %s, use buffered read.",
+                rv, apr_strerror(rv, buf, sizeof(buf)));
+        }
+    }
+    if (!direct_io) {
+        rv = apr_file_open(file, filepath->data, APR_READ, APR_UREAD | APR_GREAD, p);
+        if (rv != APR_SUCCESS) {
+            return rv;
+        }
+    }
+
+    cos_set_part_file(thr_params, part_num, *file);
+    for (i = 0; i < part_num; i++) {
+        thr_params[i].direct_io = direct_io;
+        // the page cache is not used by the file opened with O_DIRECT
+        if (NULL != clt_params && !direct_io) {
+            thr_params[i].fadvise = clt_params->enable_fadvise;
+            thr_params[i].readahead = clt_params->enable_readahead;
+        }
+    }
+    return APR_SUCCESS;
+}
+
+void cos_advise_part_file(cos_transport_thread_params_t *params, int64_t offset, int64_t len, cos_file_advice_e advice)
+{
+    int rv;
+    char buf[256];
+
+    if (NULL == params->file || len <= 0) {
+        return;
+    }
+    rv = cos_file_advise(params->file, offset, len, advice);
+    if (rv != APR_SUCCESS) {
+        cos_debug_log("cos_file_advise failure, advice:%d, code:%d %s.", advice, rv, apr_strerror(rv, buf, sizeof(buf)));
+    }
+}
+
+void cos_preallocate_part_file(cos_resumable_clt_params_t *clt_params, apr_file_t *file, int64_t file_size)
+{
+    int rv;
+    char buf[256];
+
+    if (NULL == clt_params || !clt_params->enable_fallocate || file_size <= 0) {
+        return;
+    }
+    // avoid the fragments of the file written by the parts out of order
+    rv = cos_file_preallocate(file, file_size);
+    if (rv != APR_SUCCESS) {
+        cos_warn_log("cos_file_preallocate failure, code:%d %s.", rv, apr_strerror(rv, buf, sizeof(buf)));
+    }
+}
+
+void cos_init_part_task_options(cos_transport_thread_params_t *params, cos_pool_t *pool)
+{
+    params->options.pool = pool;
+    params->options.ctl = cos_http_controller_create(pool, 0);
+}
+
+void cos_set_part_task_result(cos_transport_thread_params_t *params, cos_status_t *s, const char *etag)
+{
+    // the request pool is cleared when the task returns, keep the result in the pool of the transfer
+    apr_thread_mutex_lock(params->result_mutex);
+    params->result->s = cos_status_dup(params->result_pool, s);
+    if (NULL != etag) {
+        cos_str_set(&params->result->etag, apr_pstrdup(params->result_pool, etag));
+    }
+    apr_thread_mutex_unlock(params->result_mutex);
+}
+
+int cos_skip_part_task(cos_transport_thread_params_t *params)
+{
+    cos_status_t s;
+
+    if (apr_atomic_read32(params->failed) > 0) {
+        apr_atomic_inc32(params->launched);
+        params->result->s = NULL;
+        apr_queue_push(params->completed_parts, params->result);
+        return COS_TRUE;
+    }
+
+    if (cos_is_cancelled(params->options.cancel_token)) {
+        // cancelled by the caller before the part starts
+        memset(&s, 0, sizeof(s));
+        cos_status_set(&s, COSE_CANCELLED, COS_CANCELLED_ERROR_CODE, NULL);
+        cos_fail_part_task(params, &s);
+        return COS_TRUE;
+    }
+
+    return COS_FALSE;
+}
+
+void cos_fail_part_task(cos_transport_thread_params_t *params, cos_status_t *s)
+{
+    apr_atomic_inc32(params->failed);
+    cos_set_part_task_result(params, s, NULL);
+    apr_queue_push(params->failed_parts, params->result);
+    apr_queue_push(params->completed_parts, params->result);
+
+    // the first failure is reported, abort the other parts in flight
+    cos_cancel(params->options.cancel_token);
+}
+
+int cos_should_abort_upload(cos_request_options_t *options)
+{
+    // a failed upload is kept to be resumed, unless the caller cancels it and asks for the abort
+    return NULL != options->cancel_token && options->cancel_token->abort_upload && 
+        cos_is_cancelled(options->cancel_token);
+}
+
+void cos_abort_resumable_upload(cos_request_options_t *options, cos_string_t *bucket, 
+                                cos_string_t *object, cos_string_t *upload_id)
+{
+    cos_pool_t *subpool = NULL;
+    cos_pool_t *parent_pool = NULL;
+    cos_cancel_token_t *cancel_token = NULL;
+    cos_status_t *s = NULL;
+
+    // the abort request is not cancelled with the transfer
+    parent_pool = options->pool;
+    cancel_token = options->cancel_token;
+    cos_pool_create(&subpool, parent_pool);
+    options->pool = subpool;
+    options->cancel_token = NULL;
+    s = cos_abort_multipart_upload(options, bucket, object, upload_id, NULL);
+    if (!cos_status_is_ok(s)) {
+        cos_warn_log("abort multipart upload failure, upload_id:%s, code:%d.", upload_id->data, s->code);
     }
+    options->cancel_token = cancel_token;
+    options->pool = parent_pool;
+    cos_pool_destroy(subpool);
 }
 
 void cos_set_task_tracker(cos_transport_thread_params_t *thr_params, int part_num, 
@@ -160,6 +444,196 @@ void cos_set_task_tracker(cos_transport_thread_params_t *thr_params, int part_nu
     }
 }
 
+int cos_launch_part_task(cos_thread_pool_t *thrp, cos_task_group_t *group, apr_thread_start_t func, 
+                         cos_transport_thread_params_t *params)
+{
+    int rv;
+
+    params->group = group;
+    rv = cos_thread_pool_push(thrp, func, params, group->priority);
+    if (rv != COSE_OK) {
+        // the task never runs, report it as a failed one so that the waiter does not block
+        apr_atomic_inc32(params->failed);
+        apr_thread_mutex_lock(params->result_mutex);
+        params->result->s = cos_status_create(params->result_pool);
+        cos_status_set(params->result->s, rv, COS_CREATE_THREAD_POOL_ERROR_CODE, NULL);
+        apr_thread_mutex_unlock(params->result_mutex);
+        apr_queue_push(params->failed_parts, params->result);
+        apr_queue_push(params->completed_parts, params->result);
+    }
+    return rv;
+}
+
+int cos_retry_part_task(cos_transport_thread_params_t *params, cos_status_t *s)
+{
+    int throttled;
+    int max_retries;
+
+    // a transient failure is reported to the coordinator to relaunch the part instead of failing 
+    // the transfer, with auto_tune a throttled part also halves the window
+    throttled = params->group->auto_tune && cos_status_is_throttled(s);
+    max_retries = throttled ? COS_AUTO_TUNE_MAX_THROTTLE_RETRY : COS_PART_MAX_RETRY;
+    if ((!throttled && !cos_should_retry(s)) || params->result->retries >= max_retries || 
+        cos_is_cancelled(params->options.cancel_token)) {
+        return COS_FALSE;
+    }
+    params->result->retries++;
+    params->result->retrying = COS_TRUE;
+    params->result->retry_at = apr_time_now() + 
+        cos_min(COS_PART_RETRY_BACKOFF << (params->result->retries - 1), COS_PART_MAX_RETRY_BACKOFF);
+    params->result->throttled = throttled;
+    cos_set_part_task_result(params, s, NULL);
+    apr_queue_push(params->completed_parts, params->result);
+    return COS_TRUE;
+}
+
+int cos_relaunch_part_task(cos_thread_pool_t *thrp, cos_task_group_t *group, apr_thread_start_t func, 
+                           cos_transport_thread_params_t *params)
+{
+    // the part backs off in the group instead of on a worker or the coordinator, it is launched again
+    // by cos_wait_part_task_result when its retry_at comes, the other parts are handled meanwhile
+    params->retry_func = func;
+    cos_list_add_tail(&params->retry_node, &group->delayed);
+    return COSE_OK;
+}
+
+// launch the parts whose backoff is over, return the time until the next one is due, -1 if none is delayed
+static apr_time_t cos_launch_due_part_tasks(cos_thread_pool_t *thrp, cos_task_group_t *group)
+{
+    apr_time_t now;
+    apr_time_t wait = -1;
+    cos_transport_thread_params_t *params;
+    cos_transport_thread_params_t *tmp;
+
+    now = apr_time_now();
+    cos_list_for_each_entry_safe(cos_transport_thread_params_t, params, tmp, &group->delayed, retry_node) {
+        // after a failure or cancel the part is launched at once to report itself skipped
+        if (params->result->retry_at > now && 0 == apr_atomic_read32(params->failed) && 
+            !cos_is_cancelled(params->options.cancel_token)) {
+            wait = (wait < 0) ? params->result->retry_at - now : cos_min(wait, params->result->retry_at - now);
+            continue;
+        }
+        cos_list_del(&params->retry_node);
+        params->result->retrying = COS_FALSE;
+        cos_launch_part_task(thrp, group, params->retry_func, params);
+    }
+    return wait;
+}
+
+cos_status_t *cos_get_part_task_failure(cos_pool_t *pool, apr_queue_t *failed_parts)
+{
+    void *task_result = NULL;
+    cos_part_task_result_t *task_res = NULL;
+    cos_status_t *s = NULL;
+    char *part_list = NULL;
+
+    // the first failure is reported with the parts failed after their retries, 
+    // the parts aborted by it are not listed
+    while (APR_SUCCESS == apr_queue_trypop(failed_parts, &task_result)) {
+        task_res = (cos_part_task_result_t *)task_result;
+        if (NULL == s) {
+            s = cos_status_dup(pool, task_res->s);
+        } else if (COSE_CANCELLED == task_res->s->code) {
+            continue;
+        }
+        part_list = (NULL == part_list) ? apr_psprintf(pool, "%d", task_res->part->index + 1) : 
+            apr_psprintf(pool, "%s,%d", part_list, task_res->part->index + 1);
+    }
+
+    if (NULL == s) {
+        s = cos_status_create(pool);
+        cos_status_set(s, COSE_INTERNAL_ERROR, COS_UNKNOWN_ERROR_CODE, NULL);
+    } else if (COSE_CANCELLED != s->code) {
+        s->error_msg = apr_psprintf(pool, "%s%sfailed parts:%s", NULL == s->error_msg ? "" : s->error_msg, 
+            NULL == s->error_msg ? "" : ", ", part_list);
+    }
+    return s;
+}
+
+int cos_launch_part_tasks(cos_thread_pool_t *thrp, cos_task_group_t *group, apr_thread_start_t func, 
+                          cos_transport_thread_params_t *thr_params, int part_num, int pushed, int finished)
+{
+    // the share of the group shrinks when other transfers start, and grows when they finish
+    while (pushed < part_num && pushed - finished < cos_task_group_limit(thrp, group)) {
+        cos_launch_part_task(thrp, group, func, thr_params + pushed);
+        pushed++;
+    }
+    return pushed;
+}
+
+void cos_build_part_buffer(cos_pool_t *pool, cos_list_t *buffer_list, int64_t offset, int64_t size, 
+                           cos_list_t *content)
+{
+    cos_buf_t *b;
+    cos_buf_t *view;
+    int64_t len;
+
+    // the part is a list of views of the content of the caller, the data is not copied
+    cos_list_init(content);
+    cos_list_for_each_entry(cos_buf_t, b, buffer_list, node) {
+        if (size <= 0) {
+            break;
+        }
+        len = cos_buf_size(b);
+        if (offset >= len) {
+            offset -= len;
+            continue;
+        }
+        len = cos_min(len - offset, size);
+        view = cos_buf_pack(pool, b->pos + offset, (int)len);
+        cos_list_add_tail(&view->node, content);
+        size -= len;
+        offset = 0;
+    }
+}
+
+uint64_t cos_combine_part_crc64(cos_part_task_result_t *results, int part_num, int *has_crc64)
+{
+    uint64_t crc64 = 0;
+    int i = 0;
+
+    // the crc64 of the object is combined from the parts in order, the same as the server does
+    *has_crc64 = COS_TRUE;
+    for (; i < part_num; i++) {
+        if (!results[i].has_crc64) {
+            *has_crc64 = COS_FALSE;
+            return 0;
+        }
+        crc64 = cos_crc64_combine(crc64, results[i].crc64, (uintmax_t)results[i].part->size);
+    }
+    return crc64;
+}
+
+int cos_wait_part_task_result(cos_thread_pool_t *thrp, cos_task_group_t *group, 
+                              apr_queue_t *completed_parts, cos_part_task_result_t **task_res)
+{
+    apr_status_t rv;
+    void *task_result = NULL;
+    apr_time_t wait;
+
+    for (;;) {
+        wait = cos_launch_due_part_tasks(thrp, group);
+        if (wait < 0) {
+            // block until a part task finishes, every task pushes exactly one result
+            do {
+                rv = apr_queue_pop(completed_parts, &task_result);
+            } while (rv == APR_EINTR);
+            break;
+        }
+        // a part is backing off, poll the results until it is due, a cancel is noticed meanwhile
+        rv = apr_queue_trypop(completed_parts, &task_result);
+        if (rv != APR_EAGAIN && rv != APR_EINTR) {
+            break;
+        }
+        apr_sleep(cos_min(wait, COS_PART_RETRY_POLL_INTERVAL));
+    }
+
+    if (rv == APR_SUCCESS) {
+        *task_res = (cos_part_task_result_t *)task_result;
+    }
+    return rv;
+}
+
 int cos_verify_checkpoint_md5(cos_pool_t *pool, const cos_checkpoint_t *checkpoint)
 {
     return COS_TRUE;
@@ -187,12 +661,87 @@ void cos_build_upload_checkpoint(cos_pool_t *pool, cos_checkpoint_t *checkpoint,
     checkpoint->part_num = i;
 }
 
+void cos_build_download_checkpoint(cos_pool_t *pool, cos_checkpoint_t *checkpoint, cos_string_t *file_path, 
+                                   const char *object_name, int64_t object_size, const char *object_last_modified,
+                                   const char *object_etag, int64_t part_size)
+{
+    int i = 0;
+
+    checkpoint->cp_type = COS_CP_DOWNLOAD;
+    cos_str_set(&checkpoint->file_path, cos_pstrdup(pool, file_path));
+    cos_str_set(&checkpoint->object_name, apr_pstrdup(pool, object_name));
+    checkpoint->object_size = object_size;
+    cos_str_set(&checkpoint->object_last_modified, apr_pstrdup(pool, object_last_modified));
+    cos_str_set(&checkpoint->object_etag, apr_pstrdup(pool, object_etag));
+
+    checkpoint->part_size = part_size;
+    for (; i * part_size < object_size; i++) {
+        checkpoint->parts[i].index = i;
+        checkpoint->parts[i].offset = i * part_size;
+        checkpoint->parts[i].size = cos_min(part_size, (object_size - i * part_size));
+        checkpoint->parts[i].completed = COS_FALSE;
+        cos_str_set(&checkpoint->parts[i].etag , "");
+    }
+    checkpoint->part_num = i;
+}
+
+void cos_build_copy_checkpoint(cos_pool_t *pool, cos_checkpoint_t *checkpoint, cos_string_t *dest_path, 
+                               const char *copy_source, int64_t object_size, const char *object_last_modified,
+                               const char *object_etag, cos_string_t *upload_id, int64_t part_size)
+{
+    // the parts are the ranges of the source object, the local file is the destination
+    cos_build_download_checkpoint(pool, checkpoint, dest_path, copy_source, object_size, 
+        object_last_modified, object_etag, part_size);
+    checkpoint->cp_type = COS_CP_COPY;
+    cos_str_set(&checkpoint->upload_id, cos_pstrdup(pool, upload_id));
+}
+
+static void cos_encode_le(unsigned char *buf, uint64_t value, int bytes)
+{
+    int i;
+    for (i = 0; i < bytes; i++) {
+        buf[i] = (unsigned char)(value >> (8 * i));
+    }
+}
+
+static uint64_t cos_decode_le(const unsigned char *buf, int bytes)
+{
+    int i;
+    uint64_t value = 0;
+    for (i = 0; i < bytes; i++) {
+        value |= (uint64_t)buf[i] << (8 * i);
+    }
+    return value;
+}
+
+static void cos_encode_checkpoint_record(cos_checkpoint_record_t *record, unsigned char *buf)
+{
+    memset(buf, 0, COS_CP_JOURNAL_RECORD_LEN);
+    cos_encode_le(buf, (uint32_t)record->index, 4);
+    cos_encode_le(buf + 4, (uint32_t)record->etag_len, 4);
+    memcpy(buf + 8, record->etag, (size_t)record->etag_len);
+    record->crc64 = cos_crc64(0, buf, COS_CP_JOURNAL_RECORD_LEN - 8);
+    cos_encode_le(buf + COS_CP_JOURNAL_RECORD_LEN - 8, record->crc64, 8);
+}
+
+// COS_FALSE if the crc64 of the record does not match
+static int cos_decode_checkpoint_record(const unsigned char *buf, cos_checkpoint_record_t *record)
+{
+    record->index = (int32_t)(uint32_t)cos_decode_le(buf, 4);
+    record->etag_len = (int32_t)(uint32_t)cos_decode_le(buf + 4, 4);
+    memcpy(record->etag, buf + 8, COS_CP_JOURNAL_ETAG_LEN);
+    record->crc64 = cos_decode_le(buf + COS_CP_JOURNAL_RECORD_LEN - 8, 8);
+    return record->crc64 == cos_crc64(0, (void *)buf, COS_CP_JOURNAL_RECORD_LEN - 8);
+}
+
 int cos_dump_checkpoint(cos_pool_t *pool, const cos_checkpoint_t *checkpoint) 
 {
     char *xml_body = NULL;
     apr_status_t s;
     char buf[256];
     apr_size_t len;
+    apr_size_t xml_len;
+    unsigned char *body = NULL;
     
     // to xml
     xml_body = cos_build_checkpoint_xml(pool, checkpoint);
@@ -200,16 +749,22 @@ int cos_dump_checkpoint(cos_pool_t *pool, const cos_checkpoint_t *checkpoint)
         return COSE_OUT_MEMORY;
     }
 
-    // truncate to empty
+    // truncate to empty, the records appended before are folded into the xml
     s = apr_file_trunc(checkpoint->thefile, 0);
     if (s != APR_SUCCESS) {
         cos_error_log("apr_file_write fialure, code:%d %s.", s, apr_strerror(s, buf, sizeof(buf)));
         return COSE_FILE_TRUNC_ERROR;
     }
    
-    // write to file
-    len = strlen(xml_body);
-    s = apr_file_write(checkpoint->thefile, xml_body, &len);
+    // write the journal header to file
+    xml_len = strlen(xml_body);
+    len = COS_CP_JOURNAL_HEADER_LEN + xml_len;
+    body = (unsigned char *)cos_palloc(pool, len);
+    memcpy(body, COS_CP_JOURNAL_MAGIC, COS_CP_JOURNAL_MAGIC_LEN);
+    cos_encode_le(body + COS_CP_JOURNAL_MAGIC_LEN, xml_len, 8);
+    cos_encode_le(body + COS_CP_JOURNAL_MAGIC_LEN + 8, cos_crc64(0, xml_body, xml_len), 8);
+    memcpy(body + COS_CP_JOURNAL_HEADER_LEN, xml_body, xml_len);
+    s = apr_file_write_full(checkpoint->thefile, body, len, &len);
     if (s != APR_SUCCESS) {
         cos_error_log("apr_file_write fialure, code:%d %s.", s, apr_strerror(s, buf, sizeof(buf)));
         return COSE_FILE_WRITE_ERROR;
@@ -217,6 +772,9 @@ int cos_dump_checkpoint(cos_pool_t *pool, const cos_checkpoint_t *checkpoint)
 
     // flush file
     s = apr_file_flush(checkpoint->thefile);
+    if (s == APR_SUCCESS) {
+        s = apr_file_sync(checkpoint->thefile);
+    }
     if (s != APR_SUCCESS) {
         cos_error_log("apr_file_flush fialure, code:%d %s.", s, apr_strerror(s, buf, sizeof(buf)));
         return COSE_FILE_FLUSH_ERROR;
@@ -225,6 +783,48 @@ int cos_dump_checkpoint(cos_pool_t *pool, const cos_checkpoint_t *checkpoint)
     return COSE_OK;
 }
 
+int cos_load_checkpoint_journal(cos_pool_t *pool, const char *body, apr_size_t len, cos_checkpoint_t *checkpoint)
+{
+    const unsigned char *data = (const unsigned char *)body;
+    uint64_t xml_len;
+    char *xml_body = NULL;
+    apr_size_t pos = COS_CP_JOURNAL_HEADER_LEN;
+    cos_checkpoint_record_t record;
+    cos_string_t etag;
+    int res;
+
+    if (len < pos) {
+        return COSE_XML_PARSE_ERROR;
+    }
+    xml_len = cos_decode_le(data + COS_CP_JOURNAL_MAGIC_LEN, 8);
+    if (xml_len > len - pos || 
+        cos_decode_le(data + COS_CP_JOURNAL_MAGIC_LEN + 8, 8) != cos_crc64(0, (void *)(body + pos), (size_t)xml_len)) {
+        cos_error_log("checkpoint journal header is broken.");
+        return COSE_XML_PARSE_ERROR;
+    }
+
+    xml_body = apr_pstrmemdup(pool, body + pos, (apr_size_t)xml_len);
+    res = cos_checkpoint_parse_from_body(pool, xml_body, checkpoint);
+    if (res != COSE_OK) {
+        return res;
+    }
+
+    // replay the records, stop at the torn record of an interrupted append
+    for (pos += (apr_size_t)xml_len; pos + COS_CP_JOURNAL_RECORD_LEN <= len; pos += COS_CP_JOURNAL_RECORD_LEN) {
+        if (!cos_decode_checkpoint_record(data + pos, &record) || 
+            record.index < 0 || record.index >= checkpoint->part_num ||
+            record.etag_len < 0 || record.etag_len >= COS_CP_JOURNAL_ETAG_LEN) {
+            cos_warn_log("checkpoint journal record is broken, drop the tail.");
+            break;
+        }
+        record.etag[record.etag_len] = '\0';
+        cos_str_set(&etag, record.etag);
+        cos_update_checkpoint(pool, checkpoint, record.index, &etag);
+    }
+
+    return COSE_OK;
+}
+
 int cos_load_checkpoint(cos_pool_t *pool, const cos_string_t *filepath, cos_checkpoint_t *checkpoint) 
 {
     apr_status_t s;
@@ -261,10 +861,19 @@ int cos_load_checkpoint(cos_pool_t *pool, const cos_string_t *filepath, cos_chec
     apr_file_close(thefile);
     xml_body[len] = '\0';
 
-    // parse
+    // parse, the checkpoint of old version is xml without the journal header
+    if (len >= COS_CP_JOURNAL_MAGIC_LEN && 0 == memcmp(xml_body, COS_CP_JOURNAL_MAGIC, COS_CP_JOURNAL_MAGIC_LEN)) {
+        return cos_load_checkpoint_journal(pool, xml_body, len, checkpoint);
+    }
     return cos_checkpoint_parse_from_body(pool, xml_body, checkpoint);
 }
 
+// an empty element of the checkpoint is loaded as NULL, e.g. the etag of the object without one
+static const char *cos_checkpoint_str(const cos_string_t *value)
+{
+    return NULL == value->data ? "" : value->data;
+}
+
 int cos_is_upload_checkpoint_valid(cos_pool_t *pool, cos_checkpoint_t *checkpoint, apr_finfo_t *finfo)
 {
     if (cos_verify_checkpoint_md5(pool, checkpoint) && 
@@ -275,12 +884,96 @@ int cos_is_upload_checkpoint_valid(cos_pool_t *pool, cos_checkpoint_t *checkpoin
     return COS_FALSE;
 }
 
-void cos_update_checkpoint(cos_pool_t *pool, cos_checkpoint_t *checkpoint, int32_t part_index, cos_string_t *etag) 
+int cos_is_download_checkpoint_valid(cos_pool_t *pool, cos_checkpoint_t *checkpoint, const char *object_name,
+                                     int64_t object_size, const char *object_last_modified, const char *object_etag)
 {
-    char *p = NULL;
-    checkpoint->parts[part_index].completed = COS_TRUE;
-    p = apr_pstrdup(pool, etag->data);
-    cos_str_set(&checkpoint->parts[part_index].etag, p);
+    if (cos_verify_checkpoint_md5(pool, checkpoint) && 
+        (checkpoint->cp_type == COS_CP_DOWNLOAD) &&
+        (checkpoint->object_size == object_size) &&
+        (checkpoint->part_num <= COS_MAX_PART_NUM) &&
+        !strcmp(checkpoint->object_name.data, object_name) &&
+        !strcmp(cos_checkpoint_str(&checkpoint->object_last_modified), object_last_modified) &&
+        !strcmp(cos_checkpoint_str(&checkpoint->object_etag), object_etag)) {
+        return COS_TRUE;
+    }
+    return COS_FALSE;
+}
+
+int cos_is_copy_checkpoint_valid(cos_pool_t *pool, cos_checkpoint_t *checkpoint, cos_string_t *dest_path,
+                                 const char *copy_source, int64_t object_size, const char *object_last_modified,
+                                 const char *object_etag)
+{
+    if (cos_verify_checkpoint_md5(pool, checkpoint) && 
+        (checkpoint->cp_type == COS_CP_COPY) &&
+        (checkpoint->object_size == object_size) &&
+        (checkpoint->part_num <= COS_MAX_PART_NUM) &&
+        !strcmp(checkpoint->file_path.data, dest_path->data) &&
+        !strcmp(checkpoint->object_name.data, copy_source) &&
+        !strcmp(cos_checkpoint_str(&checkpoint->object_last_modified), object_last_modified) &&
+        !strcmp(cos_checkpoint_str(&checkpoint->object_etag), object_etag)) {
+        return COS_TRUE;
+    }
+    return COS_FALSE;
+}
+
+void cos_update_checkpoint(cos_pool_t *pool, cos_checkpoint_t *checkpoint, int32_t part_index, cos_string_t *etag) 
+{
+    char *p = NULL;
+    checkpoint->parts[part_index].completed = COS_TRUE;
+    p = apr_pstrdup(pool, etag->data);
+    cos_str_set(&checkpoint->parts[part_index].etag, p);
+}
+
+int cos_append_checkpoint(cos_pool_t *pool, cos_checkpoint_t *checkpoint, int32_t part_index, cos_string_t *etag)
+{
+    cos_checkpoint_record_t record;
+    unsigned char body[COS_CP_JOURNAL_RECORD_LEN];
+    apr_status_t s;
+    char buf[256];
+    apr_size_t len;
+
+    cos_update_checkpoint(pool, checkpoint, part_index, etag);
+    if (etag->len >= COS_CP_JOURNAL_ETAG_LEN) {
+        // not fit in a record, compact the journal instead
+        checkpoint->unsynced = 0;
+        return cos_dump_checkpoint(pool, checkpoint);
+    }
+
+    memset(&record, 0, sizeof(record));
+    record.index = part_index;
+    record.etag_len = etag->len;
+    memcpy(record.etag, etag->data, etag->len);
+    cos_encode_checkpoint_record(&record, body);
+
+    s = apr_file_write_full(checkpoint->thefile, body, sizeof(body), &len);
+    if (s != APR_SUCCESS) {
+        cos_error_log("apr_file_write fialure, code:%d %s.", s, apr_strerror(s, buf, sizeof(buf)));
+        return COSE_FILE_WRITE_ERROR;
+    }
+
+    // a record lost in a crash only makes the part transferred again
+    if (++checkpoint->unsynced >= COS_CP_JOURNAL_SYNC_PARTS) {
+        checkpoint->unsynced = 0;
+        s = apr_file_sync(checkpoint->thefile);
+        if (s != APR_SUCCESS) {
+            cos_error_log("apr_file_sync fialure, code:%d %s.", s, apr_strerror(s, buf, sizeof(buf)));
+            return COSE_FILE_FLUSH_ERROR;
+        }
+    }
+
+    return COSE_OK;
+}
+
+int cos_close_checkpoint_file(cos_checkpoint_t *checkpoint)
+{
+    apr_status_t s = APR_SUCCESS;
+
+    if (checkpoint->unsynced > 0) {
+        checkpoint->unsynced = 0;
+        s = apr_file_sync(checkpoint->thefile);
+    }
+    apr_file_close(checkpoint->thefile);
+    return s;
 }
 
 void cos_get_checkpoint_undo_parts(cos_checkpoint_t *checkpoint, int *part_num, cos_checkpoint_part_t *parts)
@@ -305,49 +998,65 @@ void * APR_THREAD_FUNC upload_part(apr_thread_t *thd, void *data)
     cos_upload_thread_params_t *params = NULL;
     cos_upload_file_t *upload_file = NULL;
     cos_table_t *resp_headers = NULL;
+    apr_time_t start;
     int part_num;
-    char *etag;
     
     params = (cos_upload_thread_params_t *)data;
-    if (apr_atomic_read32(params->failed) > 0) {
-        apr_atomic_inc32(params->launched);
+    if (cos_skip_part_task(params)) {
         return NULL;
     }
 
+    cos_init_part_task_options(params, cos_get_worker_pool(thd));
+
     part_num = params->part->index + 1;
     upload_file = cos_create_upload_file(params->options.pool);
     cos_str_set(&upload_file->filename, params->filepath->data);
     upload_file->file_pos = params->part->offset;
     upload_file->file_last = params->part->offset + params->part->size;
+    upload_file->file = params->file;
+    upload_file->direct_io = params->direct_io;
+    if (params->fadvise) {
+        cos_advise_part_file(params, params->part->offset, params->part->size, COS_FILE_ADVICE_SEQUENTIAL);
+    }
+    if (params->readahead) {
+        // the next range is read into the page cache by the kernel while this part is sent
+        cos_advise_part_file(params, upload_file->file_last, params->part->size, COS_FILE_ADVICE_WILLNEED);
+    }
 
+    params->result->throttled = COS_FALSE;
+    start = apr_time_now();
     s = cos_upload_part_from_file(&params->options, params->bucket, params->object, params->upload_id,
         part_num, upload_file, &resp_headers);
+    params->result->elapsed = apr_time_now() - start;
     if (!cos_status_is_ok(s)) {
-        apr_atomic_inc32(params->failed);
-        params->result->s = s;
-        apr_queue_push(params->failed_parts, params->result);
+        if (cos_retry_part_task(params, s)) {
+            return s;
+        }
+        cos_fail_part_task(params, s);
         return s;
     }
+    if (params->fadvise) {
+        // the part is read once, drop it from the page cache of the host
+        cos_advise_part_file(params, params->part->offset, params->part->size, COS_FILE_ADVICE_DONTNEED);
+    }
 
-    etag = apr_pstrdup(params->options.pool, (char*)apr_table_get(resp_headers, "ETag"));
-    cos_str_set(&params->result->etag, etag);
+    cos_set_part_task_result(params, s, apr_table_get(resp_headers, "ETag"));
     apr_atomic_inc32(params->completed);
     apr_queue_push(params->completed_parts, params->result);
     return NULL;
 }
 
-cos_status_t *cos_resumable_upload_file_without_cp(cos_request_options_t *options,
-                                                   cos_string_t *bucket, 
-                                                   cos_string_t *object, 
-                                                   cos_string_t *filepath,                           
-                                                   cos_table_t *headers,
-                                                   cos_table_t *params,
-                                                   int32_t thread_num,
-                                                   int64_t part_size,
-                                                   apr_finfo_t *finfo,
-                                                   cos_progress_callback progress_callback,
-                                                   cos_table_t **resp_headers,
-                                                   cos_list_t *resp_body) 
+cos_status_t *cos_resumable_upload_file_without_cp_ex(cos_request_options_t *options,
+                                                      cos_string_t *bucket, 
+                                                      cos_string_t *object, 
+                                                      cos_string_t *filepath,                           
+                                                      cos_table_t *headers,
+                                                      cos_table_t *params,
+                                                      cos_resumable_clt_params_t *clt_params,
+                                                      apr_finfo_t *finfo,
+                                                      cos_progress_callback progress_callback,
+                                                      cos_table_t **resp_headers,
+                                                      cos_list_t *resp_body) 
 {
     cos_pool_t *subpool = NULL;
     cos_pool_t *parent_pool = NULL;
@@ -361,24 +1070,35 @@ cos_status_t *cos_resumable_upload_file_without_cp(cos_request_options_t *option
     cos_part_task_result_t *task_res;
     cos_upload_thread_params_t *thr_params;
     cos_table_t *cb_headers = NULL;
-    apr_thread_pool_t *thrp;
+    cos_thread_pool_t *thrp;
+    cos_task_group_t group;
+    apr_file_t *file = NULL;
     apr_uint32_t launched = 0;
     apr_uint32_t failed = 0;
     apr_uint32_t completed = 0;
-    apr_uint32_t total_num = 0;
     apr_queue_t *failed_parts;
     apr_queue_t *completed_parts;
     int64_t consume_bytes = 0;
-    void *task_result;
     char *part_num_str;
     char *etag;
+    int32_t thread_num = 0;
+    int64_t part_size = 0;
     int part_num = 0;
+    int finished = 0;
+    int pushed = 0;
     int i = 0;
     int rv;
 
     // prepare
     parent_pool = options->pool;
     ret = cos_status_create(parent_pool);
+    thread_num = cos_get_thread_num(clt_params);
+    if (cos_is_auto_tune(clt_params)) {
+        part_size = cos_get_auto_tune_part_size(finfo->size, thread_num);
+    } else {
+        part_size = cos_get_resumable_part_size(clt_params);
+        cos_get_part_size(finfo->size, &part_size);
+    }
     part_num = cos_get_part_num(finfo->size, part_size);
     parts = (cos_checkpoint_part_t *)cos_palloc(parent_pool, sizeof(cos_checkpoint_part_t) * part_num);
     cos_build_parts(finfo->size, part_size, parts);
@@ -401,9 +1121,9 @@ cos_status_t *cos_resumable_upload_file_without_cp(cos_request_options_t *option
     cos_pool_destroy(subpool);
 
     // upload parts    
-    rv = apr_thread_pool_create(&thrp, 0, thread_num, parent_pool);
-    if (APR_SUCCESS != rv) {
-        cos_status_set(ret, rv, COS_CREATE_THREAD_POOL_ERROR_CODE, NULL); 
+    thrp = cos_get_thread_pool();
+    if (NULL == thrp) {
+        cos_status_set(ret, COSE_INTERNAL_ERROR, COS_CREATE_THREAD_POOL_ERROR_CODE, NULL); 
         return ret;
     }
 
@@ -419,45 +1139,56 @@ cos_status_t *cos_resumable_upload_file_without_cp(cos_request_options_t *option
         return ret;
     }
 
-    // launch
-    cos_set_task_tracker(thr_params, part_num, &launched, &failed, &completed, failed_parts, completed_parts);
-    for (i = 0; i < part_num; i++) {
-        apr_thread_pool_push(thrp, upload_part, thr_params + i, 0, NULL);
+    rv = cos_open_part_file_for_read(parent_pool, filepath, clt_params, thr_params, part_num, &file);
+    if (rv != APR_SUCCESS) {
+        cos_status_set(ret, rv, COS_OPEN_FILE_ERROR_CODE, NULL);
+        return ret;
     }
 
+    // launch, the running tasks of this transfer are limited to its share of the shared thread pool
+    cos_set_task_tracker(thr_params, part_num, &launched, &failed, &completed, failed_parts, completed_parts);
+    cos_task_group_init(thrp, &group, cos_get_task_priority(clt_params), thread_num, cos_is_auto_tune(clt_params));
+    pushed = cos_launch_part_tasks(thrp, &group, upload_part, thr_params, part_num, 0, 0);
+
     // wait until all tasks exit
-    total_num = apr_atomic_read32(&launched) + apr_atomic_read32(&failed) + apr_atomic_read32(&completed);
-    for ( ; total_num < (apr_uint32_t)part_num; ) {
-        rv = apr_queue_trypop(completed_parts, &task_result);
-        if (rv == APR_EINTR || rv == APR_EAGAIN) {
-            apr_sleep(1000);
-        } else if(rv == APR_EOF) {
+    while (finished < pushed) {
+        rv = cos_wait_part_task_result(thrp, &group, completed_parts, &task_res);
+        if (rv != APR_SUCCESS) {
             break;
-        } else if(rv == APR_SUCCESS) {
-            task_res = (cos_part_task_result_t*)task_result;
-            if (NULL != progress_callback) {
-                consume_bytes += task_res->part->size;
-                progress_callback(consume_bytes, finfo->size);
+        }
+        if (task_res->retrying && 0 == apr_atomic_read32(&failed)) {
+            // the part stays in flight, relaunch it after a backoff, the window is halved if it is throttled
+            if (task_res->throttled) {
+                cos_task_group_feedback(thrp, &group, task_res->part->size, task_res->elapsed, COS_TRUE);
             }
+            cos_relaunch_part_task(thrp, &group, upload_part, thr_params + (task_res - results));
+            continue;
+        }
+        finished++;
+        if (NULL != task_res->s && cos_status_is_ok(task_res->s)) {
+            cos_task_group_feedback(thrp, &group, task_res->part->size, task_res->elapsed, COS_FALSE);
+        }
+        if (0 == apr_atomic_read32(&failed)) {
+            pushed = cos_launch_part_tasks(thrp, &group, upload_part, thr_params, part_num, pushed, finished);
+        }
+        if (NULL == task_res->s || !cos_status_is_ok(task_res->s)) {
+            continue;
         }
-        total_num = apr_atomic_read32(&launched) + apr_atomic_read32(&failed) + apr_atomic_read32(&completed);
-    }
-
-    // deal with left successful parts
-    while(APR_SUCCESS == apr_queue_trypop(completed_parts, &task_result)) {
-        task_res = (cos_part_task_result_t*)task_result;
         if (NULL != progress_callback) {
             consume_bytes += task_res->part->size;
             progress_callback(consume_bytes, finfo->size);
         }
     }
+    cos_task_group_destroy(thrp, &group);
+    apr_file_close(file);
 
     // failed
     if (apr_atomic_read32(&failed) > 0) {
-        apr_queue_pop(failed_parts, &task_result);
-        task_res = (cos_part_task_result_t*)task_result;
-        s = cos_status_dup(parent_pool, task_res->s);
+        s = cos_get_part_task_failure(parent_pool, failed_parts);
         cos_destroy_thread_pool(thr_params, part_num);
+        if (cos_should_abort_upload(options)) {
+            cos_abort_resumable_upload(options, bucket, object, &upload_id);
+        }
         return s;
     }
 
@@ -492,19 +1223,37 @@ cos_status_t *cos_resumable_upload_file_without_cp(cos_request_options_t *option
     return s;
 }
 
-cos_status_t *cos_resumable_upload_file_with_cp(cos_request_options_t *options,
-                                                cos_string_t *bucket, 
-                                                cos_string_t *object, 
-                                                cos_string_t *filepath,                           
-                                                cos_table_t *headers,
-                                                cos_table_t *params,
-                                                int32_t thread_num,
-                                                int64_t part_size,
-                                                cos_string_t *checkpoint_path,
-                                                apr_finfo_t *finfo,
-                                                cos_progress_callback progress_callback,
-                                                cos_table_t **resp_headers,
-                                                cos_list_t *resp_body) 
+cos_status_t *cos_resumable_upload_file_without_cp(cos_request_options_t *options,
+                                                   cos_string_t *bucket, 
+                                                   cos_string_t *object, 
+                                                   cos_string_t *filepath,                           
+                                                   cos_table_t *headers,
+                                                   cos_table_t *params,
+                                                   int32_t thread_num,
+                                                   int64_t part_size,
+                                                   apr_finfo_t *finfo,
+                                                   cos_progress_callback progress_callback,
+                                                   cos_table_t **resp_headers,
+                                                   cos_list_t *resp_body) 
+{
+    cos_resumable_clt_params_t *clt_params;
+    clt_params = cos_create_resumable_clt_params_content(options->pool, part_size, thread_num, COS_FALSE, NULL);
+    return cos_resumable_upload_file_without_cp_ex(options, bucket, object, filepath, headers, params, clt_params, 
+        finfo, progress_callback, resp_headers, resp_body);
+}
+
+cos_status_t *cos_resumable_upload_file_with_cp_ex(cos_request_options_t *options,
+                                                   cos_string_t *bucket, 
+                                                   cos_string_t *object, 
+                                                   cos_string_t *filepath,                           
+                                                   cos_table_t *headers,
+                                                   cos_table_t *params,
+                                                   cos_resumable_clt_params_t *clt_params,
+                                                   cos_string_t *checkpoint_path,
+                                                   apr_finfo_t *finfo,
+                                                   cos_progress_callback progress_callback,
+                                                   cos_table_t **resp_headers,
+                                                   cos_list_t *resp_body) 
 {
     cos_pool_t *subpool = NULL;
     cos_pool_t *parent_pool = NULL;
@@ -518,26 +1267,36 @@ cos_status_t *cos_resumable_upload_file_with_cp(cos_request_options_t *options,
     cos_part_task_result_t *task_res;
     cos_upload_thread_params_t *thr_params;
     cos_table_t *cb_headers = NULL;
-    apr_thread_pool_t *thrp;
+    cos_thread_pool_t *thrp;
+    cos_task_group_t group;
+    apr_file_t *file = NULL;
     apr_uint32_t launched = 0;
     apr_uint32_t failed = 0;
     apr_uint32_t completed = 0;
-    apr_uint32_t total_num = 0;
     apr_queue_t *failed_parts;
     apr_queue_t *completed_parts;
     cos_checkpoint_t *checkpoint = NULL;
     int need_init_upload = COS_TRUE;
-    int has_left_result = COS_FALSE;
     int64_t consume_bytes = 0;
-    void *task_result;
     char *part_num_str;
+    int32_t thread_num = 0;
+    int64_t part_size = 0;
     int part_num = 0;
+    int finished = 0;
+    int pushed = 0;
     int i = 0;
     int rv;
 
     // checkpoint
     parent_pool = options->pool;
     ret = cos_status_create(parent_pool);
+    thread_num = cos_get_thread_num(clt_params);
+    if (cos_is_auto_tune(clt_params)) {
+        part_size = cos_get_auto_tune_part_size(finfo->size, thread_num);
+    } else {
+        part_size = cos_get_resumable_part_size(clt_params);
+        cos_get_part_size(finfo->size, &part_size);
+    }
     checkpoint = cos_create_checkpoint_content(parent_pool);
     if(cos_does_file_exist(checkpoint_path, parent_pool)) {
         if (COSE_OK == cos_load_checkpoint(parent_pool, checkpoint_path, checkpoint) && 
@@ -574,6 +1333,14 @@ cos_status_t *cos_resumable_upload_file_with_cp(cos_request_options_t *options,
         return ret;
     }
 
+    // compact the journal, then the completed parts are appended to it
+    rv = cos_dump_checkpoint(parent_pool, checkpoint);
+    if (rv != COSE_OK) {
+        apr_file_close(checkpoint->thefile);
+        cos_status_set(ret, rv, COS_WRITE_FILE_ERROR_CODE, NULL);
+        return ret;
+    }
+
     // prepare
     ret = cos_status_create(parent_pool);
     parts = (cos_checkpoint_part_t *)cos_palloc(parent_pool, sizeof(cos_checkpoint_part_t) * (checkpoint->part_num));
@@ -583,82 +1350,87 @@ cos_status_t *cos_resumable_upload_file_with_cp(cos_request_options_t *options,
     cos_build_thread_params(thr_params, part_num, parent_pool, options, bucket, object, filepath, &upload_id, parts, results);
 
     // upload parts    
-    rv = apr_thread_pool_create(&thrp, 0, thread_num, parent_pool);
-    if (APR_SUCCESS != rv) {
-        cos_status_set(ret, rv, COS_CREATE_THREAD_POOL_ERROR_CODE, NULL); 
+    thrp = cos_get_thread_pool();
+    if (NULL == thrp) {
+        apr_file_close(checkpoint->thefile);
+        cos_status_set(ret, COSE_INTERNAL_ERROR, COS_CREATE_THREAD_POOL_ERROR_CODE, NULL); 
         return ret;
     }
 
     rv = apr_queue_create(&failed_parts, part_num, parent_pool);
     if (APR_SUCCESS != rv) {
+        apr_file_close(checkpoint->thefile);
         cos_status_set(ret, rv, COS_CREATE_QUEUE_ERROR_CODE, NULL); 
         return ret;
     }
 
     rv = apr_queue_create(&completed_parts, part_num, parent_pool);
     if (APR_SUCCESS != rv) {
+        apr_file_close(checkpoint->thefile);
         cos_status_set(ret, rv, COS_CREATE_QUEUE_ERROR_CODE, NULL); 
         return ret;
     }
 
-    // launch
-    cos_set_task_tracker(thr_params, part_num, &launched, &failed, &completed, failed_parts, completed_parts);
-    for (i = 0; i < part_num; i++) {
-        apr_thread_pool_push(thrp, upload_part, thr_params + i, 0, NULL);
+    rv = cos_open_part_file_for_read(parent_pool, filepath, clt_params, thr_params, part_num, &file);
+    if (rv != APR_SUCCESS) {
+        apr_file_close(checkpoint->thefile);
+        cos_status_set(ret, rv, COS_OPEN_FILE_ERROR_CODE, NULL);
+        return ret;
     }
 
+    // launch, the running tasks of this transfer are limited to its share of the shared thread pool
+    cos_set_task_tracker(thr_params, part_num, &launched, &failed, &completed, failed_parts, completed_parts);
+    cos_task_group_init(thrp, &group, cos_get_task_priority(clt_params), thread_num, cos_is_auto_tune(clt_params));
+    pushed = cos_launch_part_tasks(thrp, &group, upload_part, thr_params, part_num, 0, 0);
+
     // wait until all tasks exit
-    total_num = apr_atomic_read32(&launched) + apr_atomic_read32(&failed) + apr_atomic_read32(&completed);
-    for ( ; total_num < (apr_uint32_t)part_num; ) {
-        rv = apr_queue_trypop(completed_parts, &task_result);
-        if (rv == APR_EINTR || rv == APR_EAGAIN) {
-            apr_sleep(1000);
-        } else if(rv == APR_EOF) {
+    while (finished < pushed) {
+        rv = cos_wait_part_task_result(thrp, &group, completed_parts, &task_res);
+        if (rv != APR_SUCCESS) {
             break;
-        } else if(rv == APR_SUCCESS) {
-            task_res = (cos_part_task_result_t*)task_result;
-            cos_update_checkpoint(parent_pool, checkpoint, task_res->part->index, &task_res->etag);
-            rv = cos_dump_checkpoint(parent_pool, checkpoint);
-            if (rv != COSE_OK) {
-                int idx = task_res->part->index;
-                cos_status_set(ret, rv, COS_WRITE_FILE_ERROR_CODE, NULL);
-                apr_atomic_inc32(&failed);
-                thr_params[idx].result->s = ret;
-                apr_queue_push(failed_parts, thr_params[idx].result);
-            }
-            if (NULL != progress_callback) {
-                consume_bytes += task_res->part->size;
-                progress_callback(consume_bytes, finfo->size);
+        }
+        if (task_res->retrying && 0 == apr_atomic_read32(&failed)) {
+            // the part stays in flight, relaunch it after a backoff, the window is halved if it is throttled
+            if (task_res->throttled) {
+                cos_task_group_feedback(thrp, &group, task_res->part->size, task_res->elapsed, COS_TRUE);
             }
+            cos_relaunch_part_task(thrp, &group, upload_part, thr_params + (task_res - results));
+            continue;
         }
-        total_num = apr_atomic_read32(&launched) + apr_atomic_read32(&failed) + apr_atomic_read32(&completed);
-    }
-
-    // deal with left successful parts
-    while(APR_SUCCESS == apr_queue_trypop(completed_parts, &task_result)) {
-        task_res = (cos_part_task_result_t*)task_result;
-        cos_update_checkpoint(parent_pool, checkpoint, task_res->part->index, &task_res->etag);
-        consume_bytes += task_res->part->size;
-        has_left_result = COS_TRUE;
-    }
-    if (has_left_result) {
-        rv = cos_dump_checkpoint(parent_pool, checkpoint);
+        finished++;
+        if (NULL != task_res->s && cos_status_is_ok(task_res->s)) {
+            cos_task_group_feedback(thrp, &group, task_res->part->size, task_res->elapsed, COS_FALSE);
+        }
+        if (0 == apr_atomic_read32(&failed)) {
+            pushed = cos_launch_part_tasks(thrp, &group, upload_part, thr_params, part_num, pushed, finished);
+        }
+        if (NULL == task_res->s || !cos_status_is_ok(task_res->s)) {
+            continue;
+        }
+        rv = cos_append_checkpoint(parent_pool, checkpoint, task_res->part->index, &task_res->etag);
         if (rv != COSE_OK) {
             cos_status_set(ret, rv, COS_WRITE_FILE_ERROR_CODE, NULL);
-            return ret;
+            apr_atomic_inc32(&failed);
+            task_res->s = ret;
+            apr_queue_push(failed_parts, task_res);
         }
         if (NULL != progress_callback) {
+            consume_bytes += task_res->part->size;
             progress_callback(consume_bytes, finfo->size);
         }
     }
-    apr_file_close(checkpoint->thefile);
+    cos_task_group_destroy(thrp, &group);
+    apr_file_close(file);
+    cos_close_checkpoint_file(checkpoint);
 
     // failed
     if (apr_atomic_read32(&failed) > 0) {
-        apr_queue_pop(failed_parts, &task_result);
-        task_res = (cos_part_task_result_t*)task_result;
-        s = cos_status_dup(parent_pool, task_res->s);
+        s = cos_get_part_task_failure(parent_pool, failed_parts);
         cos_destroy_thread_pool(thr_params, part_num);
+        if (cos_should_abort_upload(options)) {
+            cos_abort_resumable_upload(options, bucket, object, &upload_id);
+            apr_file_remove(checkpoint_path->data, parent_pool);
+        }
         return s;
     }
     
@@ -695,6 +1467,26 @@ cos_status_t *cos_resumable_upload_file_with_cp(cos_request_options_t *options,
     return s;
 }
 
+cos_status_t *cos_resumable_upload_file_with_cp(cos_request_options_t *options,
+                                                cos_string_t *bucket, 
+                                                cos_string_t *object, 
+                                                cos_string_t *filepath,                           
+                                                cos_table_t *headers,
+                                                cos_table_t *params,
+                                                int32_t thread_num,
+                                                int64_t part_size,
+                                                cos_string_t *checkpoint_path,
+                                                apr_finfo_t *finfo,
+                                                cos_progress_callback progress_callback,
+                                                cos_table_t **resp_headers,
+                                                cos_list_t *resp_body) 
+{
+    cos_resumable_clt_params_t *clt_params;
+    clt_params = cos_create_resumable_clt_params_content(options->pool, part_size, thread_num, COS_TRUE, NULL);
+    return cos_resumable_upload_file_with_cp_ex(options, bucket, object, filepath, headers, params, clt_params, 
+        checkpoint_path, finfo, progress_callback, resp_headers, resp_body);
+}
+
 cos_status_t *cos_resumable_upload_file(cos_request_options_t *options,
                                         cos_string_t *bucket, 
                                         cos_string_t *object, 
@@ -706,16 +1498,12 @@ cos_status_t *cos_resumable_upload_file(cos_request_options_t *options,
                                         cos_table_t **resp_headers,
                                         cos_list_t *resp_body) 
 {
-    int32_t thread_num = 0;
-    int64_t part_size = 0;
     cos_string_t checkpoint_path;
     cos_pool_t *sub_pool;
     apr_finfo_t finfo;
     cos_status_t *s;
     int res;
 
-    thread_num = cos_get_thread_num(clt_params);
-
     cos_pool_create(&sub_pool, options->pool);
     res = cos_get_file_info(filepath, sub_pool, &finfo);
     if (res != COSE_OK) {
@@ -725,138 +1513,441 @@ cos_status_t *cos_resumable_upload_file(cos_request_options_t *options,
         cos_pool_destroy(sub_pool);
         return s;
     }
-    part_size = clt_params->part_size;
-    cos_get_part_size(finfo.size, &part_size);
 
     if (NULL != clt_params && clt_params->enable_checkpoint) {
         cos_get_checkpoint_path(clt_params, filepath, sub_pool, &checkpoint_path);
-        s = cos_resumable_upload_file_with_cp(options, bucket, object, filepath, headers, params, thread_num, 
-            part_size, &checkpoint_path, &finfo, progress_callback, resp_headers, resp_body);
+        s = cos_resumable_upload_file_with_cp_ex(options, bucket, object, filepath, headers, params, clt_params, 
+            &checkpoint_path, &finfo, progress_callback, resp_headers, resp_body);
     } else {
-        s = cos_resumable_upload_file_without_cp(options, bucket, object, filepath, headers, params, thread_num, 
-            part_size, &finfo, progress_callback, resp_headers, resp_body);
+        s = cos_resumable_upload_file_without_cp_ex(options, bucket, object, filepath, headers, params, clt_params, 
+            &finfo, progress_callback, resp_headers, resp_body);
     }
 
     cos_pool_destroy(sub_pool);
     return s;
 }
 
-void * APR_THREAD_FUNC download_part(apr_thread_t *thd, void *data) 
+void * APR_THREAD_FUNC upload_part_from_buffer(apr_thread_t *thd, void *data) 
 {
     cos_status_t *s = NULL;
     cos_upload_thread_params_t *params = NULL;
-    cos_upload_file_t *download_file = NULL;
     cos_table_t *resp_headers = NULL;
+    cos_list_t buffer;
+    cos_buf_t *content;
+    apr_time_t start;
     int part_num;
-    char *etag;
     
     params = (cos_upload_thread_params_t *)data;
-    if (apr_atomic_read32(params->failed) > 0) {
-        apr_atomic_inc32(params->launched);
+    if (cos_skip_part_task(params)) {
         return NULL;
     }
 
-    part_num = params->part->index + 1;
-    download_file = cos_create_upload_file(params->options.pool);
-    cos_str_set(&download_file->filename, params->filepath->data);
-    download_file->file_pos = params->part->offset;
-    download_file->file_last = params->part->offset + params->part->size;
+    cos_init_part_task_options(params, cos_get_worker_pool(thd));
 
-    s = cos_download_part_to_file(&params->options, params->bucket, params->object, download_file, &resp_headers);
+    // the list is built on every launch, the request consumes it
+    part_num = params->part->index + 1;
+    cos_list_init(&buffer);
+    content = cos_buf_pack(params->options.pool, params->buffer, (int)params->part->size);
+    cos_list_add_tail(&content->node, &buffer);
+
+    params->result->throttled = COS_FALSE;
+    start = apr_time_now();
+    s = cos_upload_part_from_buffer(&params->options, params->bucket, params->object, params->upload_id,
+        part_num, &buffer, &resp_headers);
+    params->result->elapsed = apr_time_now() - start;
     if (!cos_status_is_ok(s)) {
-        apr_atomic_inc32(params->failed);
-        params->result->s = s;
-        apr_queue_push(params->failed_parts, params->result);
+        if (cos_retry_part_task(params, s)) {
+            return s;
+        }
+        cos_fail_part_task(params, s);
         return s;
     }
 
-    cos_warn_log("download part = %d, start byte = %"APR_INT64_T_FMT", end byte = %"APR_INT64_T_FMT, part_num, download_file->file_pos, download_file->file_last-1);
-
-    etag = apr_pstrdup(params->options.pool, (char*)apr_table_get(resp_headers, "ETag"));
-    cos_str_set(&params->result->etag, etag);
+    cos_set_part_task_result(params, s, apr_table_get(resp_headers, "ETag"));
     apr_atomic_inc32(params->completed);
     apr_queue_push(params->completed_parts, params->result);
     return NULL;
 }
 
-int64_t cos_get_safe_size_for_download(int64_t part_size)
+int64_t cos_read_stream_part(cos_read_stream_callback read_callback, void *user_data, char *buffer, int64_t size)
 {
-    if (part_size < 4*1024*1024) return 4*1024*1024;
-    else if (part_size > 20*1024*1024) return 20*1024*1024;
-    else return part_size;
+    int64_t filled = 0;
+    int64_t bytes = 0;
+
+    // the source may return less than asked, fill the whole part unless it ends
+    while (filled < size) {
+        bytes = read_callback(user_data, buffer + filled, size - filled);
+        if (bytes < 0) {
+            return bytes;
+        }
+        if (0 == bytes) {
+            break;
+        }
+        filled += bytes;
+    }
+    return filled;
 }
 
-cos_status_t *cos_resumable_download_file_without_cp(cos_request_options_t *options,
-                                                   cos_string_t *bucket, 
-                                                   cos_string_t *object, 
-                                                   cos_string_t *filepath,                           
-                                                   cos_table_t *headers,
-                                                   cos_table_t *params,
-                                                   int32_t thread_num,
-                                                   int64_t part_size,
-                                                   cos_progress_callback progress_callback) 
+cos_status_t *cos_resumable_upload_stream(cos_request_options_t *options,
+                                          cos_string_t *bucket, 
+                                          cos_string_t *object, 
+                                          cos_table_t *headers,
+                                          cos_resumable_clt_params_t *clt_params, 
+                                          cos_read_stream_callback read_callback,
+                                          void *user_data,
+                                          cos_progress_callback progress_callback,
+                                          cos_table_t **resp_headers,
+                                          cos_list_t *resp_body) 
 {
     cos_pool_t *subpool = NULL;
     cos_pool_t *parent_pool = NULL;
+    cos_pool_t *buffer_pool = NULL;
     cos_status_t *s = NULL;
     cos_status_t *ret = NULL;
+    cos_status_t *error = NULL;
+    cos_list_t completed_part_list;
+    cos_complete_part_content_t *complete_content = NULL;
     cos_string_t upload_id;
     cos_checkpoint_part_t *parts;
     cos_part_task_result_t *results;
     cos_part_task_result_t *task_res;
-    cos_transport_thread_params_t *thr_params;
-    apr_thread_pool_t *thrp;
+    cos_upload_thread_params_t *thr_params;
+    cos_table_t *cb_headers = NULL;
+    cos_thread_pool_t *thrp;
+    cos_task_group_t group;
     apr_uint32_t launched = 0;
     apr_uint32_t failed = 0;
     apr_uint32_t completed = 0;
-    apr_uint32_t total_num = 0;
     apr_queue_t *failed_parts;
     apr_queue_t *completed_parts;
     int64_t consume_bytes = 0;
-    void *task_result;
+    int64_t part_size = 0;
+    int64_t filled = 0;
+    char **buffers;
+    char **etags;
+    char *part_num_str;
+    int *free_slots;
+    int32_t thread_num = 0;
+    int free_num = 0;
+    int running = 0;
     int part_num = 0;
+    int eof = COS_FALSE;
+    int slot;
     int i = 0;
     int rv;
-    const char *value = NULL;
-    int64_t file_size = 0;
-    cos_table_t *resp_headers = NULL;
 
-    // prepare
+    // prepare, the memory is part_size * thread_num whatever the length of the stream
     parent_pool = options->pool;
     ret = cos_status_create(parent_pool);
-    // get object file size
+    thread_num = cos_get_thread_num(clt_params);
+    part_size = cos_get_resumable_part_size(clt_params);
+    part_size = cos_max(part_size, COS_DEFAULT_PART_SIZE);
+    part_size = cos_min(part_size, COS_MAX_PART_SIZE);
+
+    thrp = cos_get_thread_pool();
+    if (NULL == thrp) {
+        cos_status_set(ret, COSE_INTERNAL_ERROR, COS_CREATE_THREAD_POOL_ERROR_CODE, NULL); 
+        return ret;
+    }
+
+    rv = apr_queue_create(&failed_parts, thread_num, parent_pool);
+    if (APR_SUCCESS != rv) {
+        cos_status_set(ret, rv, COS_CREATE_QUEUE_ERROR_CODE, NULL); 
+        return ret;
+    }
+
+    rv = apr_queue_create(&completed_parts, thread_num, parent_pool);
+    if (APR_SUCCESS != rv) {
+        cos_status_set(ret, rv, COS_CREATE_QUEUE_ERROR_CODE, NULL); 
+        return ret;
+    }
+
+    // init upload
     cos_pool_create(&subpool, parent_pool);
     options->pool = subpool;
-    s = cos_head_object(options, bucket, object, NULL, &resp_headers);
+    s = cos_init_multipart_upload(options, bucket, object, &upload_id, headers, resp_headers);
     if (!cos_status_is_ok(s)) {
         s = cos_status_dup(parent_pool, s);
         cos_pool_destroy(subpool);
         options->pool = parent_pool;
         return s;
     }
-    value = apr_table_get(resp_headers, COS_CONTENT_LENGTH);
-    if (NULL == value) {
-        cos_status_set(ret, COSE_INVALID_ARGUMENT, COS_LACK_OF_CONTENT_LEN_ERROR_CODE, NULL);
-        cos_pool_destroy(subpool);
-        options->pool = parent_pool;
-        return ret;
-    }
-    file_size = cos_atoi64(value);
+    cos_str_set(&upload_id, apr_pstrdup(parent_pool, upload_id.data));
+    options->pool = parent_pool;
+    cos_pool_destroy(subpool);
+
+    // one slot per thread, a slot is reused once its part is uploaded
+    cos_pool_create(&buffer_pool, parent_pool);
+    parts = (cos_checkpoint_part_t *)cos_pcalloc(parent_pool, sizeof(cos_checkpoint_part_t) * thread_num);
+    results = (cos_part_task_result_t *)cos_palloc(parent_pool, sizeof(cos_part_task_result_t) * thread_num);
+    thr_params = (cos_upload_thread_params_t *)cos_palloc(parent_pool, sizeof(cos_upload_thread_params_t) * thread_num);
+    buffers = (char **)cos_palloc(parent_pool, sizeof(char *) * thread_num);
+    free_slots = (int *)cos_palloc(parent_pool, sizeof(int) * thread_num);
+    etags = (char **)cos_pcalloc(parent_pool, sizeof(char *) * COS_MAX_PART_NUM);
+    cos_build_thread_params(thr_params, thread_num, parent_pool, options, bucket, object, NULL, &upload_id, parts, results);
+    cos_set_task_tracker(thr_params, thread_num, &launched, &failed, &completed, failed_parts, completed_parts);
+    for (i = 0; i < thread_num; i++) {
+        buffers[i] = NULL;
+        free_slots[free_num++] = thread_num - 1 - i;
+    }
+
+    // upload parts while the next one is read from the stream
+    cos_task_group_init(thrp, &group, cos_get_task_priority(clt_params), thread_num, cos_is_auto_tune(clt_params));
+    for (;;) {
+        if (NULL == error && cos_is_cancelled(options->cancel_token)) {
+            cos_status_set(ret, COSE_CANCELLED, COS_CANCELLED_ERROR_CODE, NULL);
+            error = ret;
+        }
+        if (!eof && NULL == error && 0 == apr_atomic_read32(&failed) && 
+            free_num > 0 && running < cos_task_group_limit(thrp, &group)) 
+        {
+            slot = free_slots[--free_num];
+            if (NULL == buffers[slot]) {
+                buffers[slot] = (char *)cos_palloc(buffer_pool, (apr_size_t)part_size);
+            }
+            filled = cos_read_stream_part(read_callback, user_data, buffers[slot], part_size);
+            if (filled < 0) {
+                cos_error_log("Read stream fail, part number:%d, code:%" APR_INT64_T_FMT "\n", part_num + 1, filled);
+                cos_status_set(ret, COSE_READ_BODY_ERROR, COS_CLIENT_ERROR_CODE, "Read stream fail");
+                error = ret;
+                cos_cancel(thr_params[0].options.cancel_token);
+                free_slots[free_num++] = slot;
+                continue;
+            }
+            eof = (filled < part_size);
+            // an empty stream is uploaded as one empty part
+            if (0 == filled && part_num > 0) {
+                free_slots[free_num++] = slot;
+                continue;
+            }
+            if (part_num >= COS_MAX_PART_NUM) {
+                cos_error_log("Stream is larger than part_size * %d, part size:%" APR_INT64_T_FMT "\n", COS_MAX_PART_NUM, part_size);
+                cos_status_set(ret, COSE_INVALID_ARGUMENT, COS_CLIENT_ERROR_CODE, "Part number larger than max limit");
+                error = ret;
+                free_slots[free_num++] = slot;
+                continue;
+            }
+
+            results[slot].s = NULL;
+            results[slot].retries = 0;
+            results[slot].retrying = COS_FALSE;
+            parts[slot].index = part_num;
+            parts[slot].offset = part_num * part_size;
+            parts[slot].size = filled;
+            thr_params[slot].buffer = buffers[slot];
+            part_num++;
+            cos_launch_part_task(thrp, &group, upload_part_from_buffer, thr_params + slot);
+            running++;
+            continue;
+        }
+
+        if (0 == running) {
+            break;
+        }
+
+        // wait for a part to free its slot
+        rv = cos_wait_part_task_result(thrp, &group, completed_parts, &task_res);
+        if (rv != APR_SUCCESS) {
+            break;
+        }
+        slot = (int)(task_res - results);
+        if (task_res->retrying && 0 == apr_atomic_read32(&failed)) {
+            // the part stays in flight, relaunch it after a backoff, the window is halved if it is throttled
+            if (task_res->throttled) {
+                cos_task_group_feedback(thrp, &group, task_res->part->size, task_res->elapsed, COS_TRUE);
+            }
+            cos_relaunch_part_task(thrp, &group, upload_part_from_buffer, thr_params + slot);
+            continue;
+        }
+        running--;
+        free_slots[free_num++] = slot;
+        if (NULL == task_res->s || !cos_status_is_ok(task_res->s)) {
+            continue;
+        }
+        cos_task_group_feedback(thrp, &group, task_res->part->size, task_res->elapsed, COS_FALSE);
+        etags[task_res->part->index] = apr_pstrdup(parent_pool, task_res->etag.data);
+        if (NULL != progress_callback) {
+            consume_bytes += task_res->part->size;
+            progress_callback(consume_bytes, -1);
+        }
+    }
+    cos_task_group_destroy(thrp, &group);
+    cos_pool_destroy(buffer_pool);
+
+    // failed, the stream can not be resumed, abort the upload, a read failure is reported 
+    // instead of the parts it cancelled
+    if (NULL == error && apr_atomic_read32(&failed) > 0) {
+        error = cos_get_part_task_failure(parent_pool, failed_parts);
+    }
+    cos_destroy_thread_pool(thr_params, thread_num);
+    if (NULL != error) {
+        cos_abort_resumable_upload(options, bucket, object, &upload_id);
+        return error;
+    }
+
+    // successful
+    cos_pool_create(&subpool, parent_pool);
+    cos_list_init(&completed_part_list);
+    for (i = 0; i < part_num; i++) {
+        complete_content = cos_create_complete_part_content(subpool);
+        part_num_str = apr_psprintf(subpool, "%d", i + 1);
+        cos_str_set(&complete_content->part_number, part_num_str);
+        cos_str_set(&complete_content->etag, etags[i]);
+        cos_list_add_tail(&complete_content->node, &completed_part_list);
+    }
+
+    // complete upload
+    options->pool = subpool;
+    if (NULL != headers && NULL != apr_table_get(headers, COS_CALLBACK)) {
+        cb_headers = cos_table_make(subpool, 2);
+        apr_table_set(cb_headers, COS_CALLBACK, apr_table_get(headers, COS_CALLBACK));
+        if (NULL != apr_table_get(headers, COS_CALLBACK_VAR)) {
+            apr_table_set(cb_headers, COS_CALLBACK_VAR, apr_table_get(headers, COS_CALLBACK_VAR));
+        }
+    }
+    s = cos_do_complete_multipart_upload(options, bucket, object, &upload_id, 
+        &completed_part_list, cb_headers, NULL, resp_headers, resp_body);
+    s = cos_status_dup(parent_pool, s);
     cos_pool_destroy(subpool);
     options->pool = parent_pool;
-    // init download params
-    part_size = cos_get_safe_size_for_download(part_size);
-    part_num = cos_get_part_num(file_size, part_size);
-    parts = (cos_checkpoint_part_t *)cos_palloc(parent_pool, sizeof(cos_checkpoint_part_t) * part_num);
-    cos_build_parts(file_size, part_size, parts);
-    results = (cos_part_task_result_t *)cos_palloc(parent_pool, sizeof(cos_part_task_result_t) * part_num);
-    thr_params = (cos_transport_thread_params_t *)cos_palloc(parent_pool, sizeof(cos_transport_thread_params_t) * part_num);
-    cos_build_thread_params(thr_params, part_num, parent_pool, options, bucket, object, filepath, &upload_id, parts, results);
+
+    return s;
+}
+
+void * APR_THREAD_FUNC upload_part_from_buffer_list(apr_thread_t *thd, void *data) 
+{
+    cos_status_t *s = NULL;
+    cos_upload_thread_params_t *params = NULL;
+    cos_table_t *resp_headers = NULL;
+    cos_list_t buffer;
+    const char *crc64;
+    apr_time_t start;
+    int part_num;
     
-    // download parts    
-    rv = apr_thread_pool_create(&thrp, 0, thread_num, parent_pool);
-    if (APR_SUCCESS != rv) {
-        cos_status_set(ret, rv, COS_CREATE_THREAD_POOL_ERROR_CODE, NULL); 
+    params = (cos_upload_thread_params_t *)data;
+    if (cos_skip_part_task(params)) {
+        return NULL;
+    }
+
+    cos_init_part_task_options(params, cos_get_worker_pool(thd));
+
+    // the views are built on every launch, the request consumes them but not the content
+    part_num = params->part->index + 1;
+    cos_build_part_buffer(params->options.pool, params->buffer_list, params->part->offset, 
+        params->part->size, &buffer);
+
+    params->result->throttled = COS_FALSE;
+    start = apr_time_now();
+    s = cos_do_upload_part_from_buffer(&params->options, params->bucket, params->object, params->upload_id,
+        part_num, &buffer, NULL, NULL, NULL, &resp_headers, NULL);
+    params->result->elapsed = apr_time_now() - start;
+    if (!cos_status_is_ok(s)) {
+        if (cos_retry_part_task(params, s)) {
+            return s;
+        }
+        cos_fail_part_task(params, s);
+        return s;
+    }
+
+    // the crc64 of the part is checked against the request, it is kept to verify the object
+    crc64 = apr_table_get(resp_headers, COS_HASH_CRC64_ECMA);
+    if (NULL != crc64) {
+        params->result->crc64 = cos_atoui64(crc64);
+        params->result->has_crc64 = COS_TRUE;
+    }
+
+    cos_set_part_task_result(params, s, apr_table_get(resp_headers, "ETag"));
+    apr_atomic_inc32(params->completed);
+    apr_queue_push(params->completed_parts, params->result);
+    return NULL;
+}
+
+cos_status_t *cos_resumable_upload_buffer(cos_request_options_t *options,
+                                          cos_string_t *bucket, 
+                                          cos_string_t *object, 
+                                          cos_list_t *buffer,
+                                          cos_table_t *headers,
+                                          cos_resumable_clt_params_t *clt_params, 
+                                          cos_progress_callback progress_callback,
+                                          cos_table_t **resp_headers,
+                                          cos_list_t *resp_body) 
+{
+    cos_pool_t *subpool = NULL;
+    cos_pool_t *parent_pool = NULL;
+    cos_status_t *s = NULL;
+    cos_status_t *ret = NULL;
+    cos_list_t completed_part_list;
+    cos_complete_part_content_t *complete_content = NULL;
+    cos_string_t upload_id;
+    cos_checkpoint_part_t *parts;
+    cos_part_task_result_t *results;
+    cos_part_task_result_t *task_res;
+    cos_upload_thread_params_t *thr_params;
+    cos_table_t *cb_headers = NULL;
+    cos_table_t *complete_headers = NULL;
+    cos_thread_pool_t *thrp;
+    cos_task_group_t group;
+    apr_uint32_t launched = 0;
+    apr_uint32_t failed = 0;
+    apr_uint32_t completed = 0;
+    apr_queue_t *failed_parts;
+    apr_queue_t *completed_parts;
+    int64_t consume_bytes = 0;
+    int64_t content_length = 0;
+    int64_t part_size = 0;
+    uint64_t crc64 = 0;
+    char *part_num_str;
+    char *etag;
+    int32_t thread_num = 0;
+    int has_crc64 = COS_FALSE;
+    int part_num = 0;
+    int finished = 0;
+    int pushed = 0;
+    int i = 0;
+    int rv;
+
+    // prepare, a part is sent from views of the buffer, the size of a view is an int
+    parent_pool = options->pool;
+    ret = cos_status_create(parent_pool);
+    content_length = cos_buf_list_len(buffer);
+    thread_num = cos_get_thread_num(clt_params);
+    if (cos_is_auto_tune(clt_params)) {
+        part_size = cos_get_auto_tune_part_size(content_length, thread_num);
+    } else {
+        part_size = cos_get_resumable_part_size(clt_params);
+        part_size = cos_min(part_size, COS_MAX_PART_SIZE);
+        cos_get_part_size(content_length, &part_size);
+    }
+    part_num = cos_get_part_num(content_length, part_size);
+    // an empty buffer is uploaded as one empty part
+    part_num = cos_max(part_num, 1);
+    parts = (cos_checkpoint_part_t *)cos_pcalloc(parent_pool, sizeof(cos_checkpoint_part_t) * part_num);
+    cos_build_parts(content_length, part_size, parts);
+    results = (cos_part_task_result_t *)cos_palloc(parent_pool, sizeof(cos_part_task_result_t) * part_num);
+    thr_params = (cos_upload_thread_params_t *)cos_palloc(parent_pool, sizeof(cos_upload_thread_params_t) * part_num);
+    cos_build_thread_params(thr_params, part_num, parent_pool, options, bucket, object, NULL, &upload_id, parts, results);
+    for (i = 0; i < part_num; i++) {
+        thr_params[i].buffer_list = buffer;
+    }
+
+    // init upload
+    cos_pool_create(&subpool, parent_pool);
+    options->pool = subpool;
+    s = cos_init_multipart_upload(options, bucket, object, &upload_id, headers, resp_headers);
+    if (!cos_status_is_ok(s)) {
+        s = cos_status_dup(parent_pool, s);
+        cos_pool_destroy(subpool);
+        options->pool = parent_pool;
+        return s;
+    }
+    cos_str_set(&upload_id, apr_pstrdup(parent_pool, upload_id.data));
+    options->pool = parent_pool;
+    cos_pool_destroy(subpool);
+
+    // upload parts    
+    thrp = cos_get_thread_pool();
+    if (NULL == thrp) {
+        cos_status_set(ret, COSE_INTERNAL_ERROR, COS_CREATE_THREAD_POOL_ERROR_CODE, NULL); 
         return ret;
     }
 
@@ -872,53 +1963,2122 @@ cos_status_t *cos_resumable_download_file_without_cp(cos_request_options_t *opti
         return ret;
     }
 
-    // launch
+    // launch, the running tasks of this transfer are limited to its share of the shared thread pool
     cos_set_task_tracker(thr_params, part_num, &launched, &failed, &completed, failed_parts, completed_parts);
-    for (i = 0; i < part_num; i++) {
-        apr_thread_pool_push(thrp, download_part, thr_params + i, 0, NULL);
-    }
+    cos_task_group_init(thrp, &group, cos_get_task_priority(clt_params), thread_num, cos_is_auto_tune(clt_params));
+    pushed = cos_launch_part_tasks(thrp, &group, upload_part_from_buffer_list, thr_params, part_num, 0, 0);
 
     // wait until all tasks exit
-    total_num = apr_atomic_read32(&launched) + apr_atomic_read32(&failed) + apr_atomic_read32(&completed);
-    for ( ; total_num < (apr_uint32_t)part_num; ) {
-        rv = apr_queue_trypop(completed_parts, &task_result);
-        if (rv == APR_EINTR || rv == APR_EAGAIN) {
-            apr_sleep(1000);
-        } else if(rv == APR_EOF) {
+    while (finished < pushed) {
+        rv = cos_wait_part_task_result(thrp, &group, completed_parts, &task_res);
+        if (rv != APR_SUCCESS) {
             break;
-        } else if(rv == APR_SUCCESS) {
-            task_res = (cos_part_task_result_t*)task_result;
-            if (NULL != progress_callback) {
-                consume_bytes += task_res->part->size;
-                progress_callback(consume_bytes, file_size);
+        }
+        if (task_res->retrying && 0 == apr_atomic_read32(&failed)) {
+            // the part stays in flight, relaunch it after a backoff, the window is halved if it is throttled
+            if (task_res->throttled) {
+                cos_task_group_feedback(thrp, &group, task_res->part->size, task_res->elapsed, COS_TRUE);
             }
+            cos_relaunch_part_task(thrp, &group, upload_part_from_buffer_list, thr_params + (task_res - results));
+            continue;
+        }
+        finished++;
+        if (NULL != task_res->s && cos_status_is_ok(task_res->s)) {
+            cos_task_group_feedback(thrp, &group, task_res->part->size, task_res->elapsed, COS_FALSE);
+        }
+        if (0 == apr_atomic_read32(&failed)) {
+            pushed = cos_launch_part_tasks(thrp, &group, upload_part_from_buffer_list, thr_params, part_num, pushed, finished);
+        }
+        if (NULL == task_res->s || !cos_status_is_ok(task_res->s)) {
+            continue;
         }
-        total_num = apr_atomic_read32(&launched) + apr_atomic_read32(&failed) + apr_atomic_read32(&completed);
-    }
-
-    // deal with left successful parts
-    while(APR_SUCCESS == apr_queue_trypop(completed_parts, &task_result)) {
-        task_res = (cos_part_task_result_t*)task_result;
         if (NULL != progress_callback) {
             consume_bytes += task_res->part->size;
-            progress_callback(consume_bytes, file_size);
+            progress_callback(consume_bytes, content_length);
         }
     }
+    cos_task_group_destroy(thrp, &group);
 
-    // failed
+    // failed, the buffer is gone with the caller, abort the upload
     if (apr_atomic_read32(&failed) > 0) {
-        apr_queue_pop(failed_parts, &task_result);
-        task_res = (cos_part_task_result_t*)task_result;
-        s = cos_status_dup(parent_pool, task_res->s);
+        s = cos_get_part_task_failure(parent_pool, failed_parts);
         cos_destroy_thread_pool(thr_params, part_num);
+        cos_abort_resumable_upload(options, bucket, object, &upload_id);
         return s;
     }
 
     // successful
+    cos_pool_create(&subpool, parent_pool);
+    cos_list_init(&completed_part_list);
+    for (i = 0; i < part_num; i++) {
+        complete_content = cos_create_complete_part_content(subpool);
+        part_num_str = apr_psprintf(subpool, "%d", thr_params[i].part->index + 1);
+        cos_str_set(&complete_content->part_number, part_num_str);
+        etag = apr_pstrdup(subpool, thr_params[i].result->etag.data);
+        cos_str_set(&complete_content->etag, etag);
+        cos_list_add_tail(&complete_content->node, &completed_part_list);
+    }
+    crc64 = cos_combine_part_crc64(results, part_num, &has_crc64);
     cos_destroy_thread_pool(thr_params, part_num);
 
-    s = cos_status_create(options->pool);
+    // complete upload
+    options->pool = subpool;
+    if (NULL != headers && NULL != apr_table_get(headers, COS_CALLBACK)) {
+        cb_headers = cos_table_make(subpool, 2);
+        apr_table_set(cb_headers, COS_CALLBACK, apr_table_get(headers, COS_CALLBACK));
+        if (NULL != apr_table_get(headers, COS_CALLBACK_VAR)) {
+            apr_table_set(cb_headers, COS_CALLBACK_VAR, apr_table_get(headers, COS_CALLBACK_VAR));
+        }
+    }
+    s = cos_do_complete_multipart_upload(options, bucket, object, &upload_id, 
+        &completed_part_list, cb_headers, NULL, &complete_headers, resp_body);
+    // the object is verified with the crc64 combined from the parts before it is reported as uploaded
+    if (cos_status_is_ok(s) && is_enable_crc(options) && has_crc64 && NULL != complete_headers) {
+        cos_check_crc_consistent(crc64, complete_headers, s);
+    }
+    if (NULL != resp_headers && NULL != complete_headers) {
+        *resp_headers = apr_table_clone(parent_pool, complete_headers);
+    }
+    s = cos_status_dup(parent_pool, s);
+    cos_pool_destroy(subpool);
+    options->pool = parent_pool;
+
     return s;
 }
 
+void * APR_THREAD_FUNC download_part(apr_thread_t *thd, void *data) 
+{
+    cos_status_t *s = NULL;
+    cos_upload_thread_params_t *params = NULL;
+    cos_upload_file_t *download_file = NULL;
+    cos_table_t *headers = NULL;
+    cos_table_t *resp_headers = NULL;
+    apr_time_t start;
+    int part_num;
+    
+    params = (cos_upload_thread_params_t *)data;
+    if (cos_skip_part_task(params)) {
+        return NULL;
+    }
+
+    cos_init_part_task_options(params, cos_get_worker_pool(thd));
+
+    part_num = params->part->index + 1;
+    download_file = cos_create_upload_file(params->options.pool);
+    cos_str_set(&download_file->filename, params->filepath->data);
+    download_file->file_pos = params->part->offset;
+    download_file->file_last = params->part->offset + params->part->size;
+    download_file->file = params->file;
+    headers = cos_table_make(params->options.pool, 2);
+    if (NULL != params->object_etag && '\0' != params->object_etag[0]) {
+        // the parts of two versions of the object are never mixed
+        apr_table_set(headers, COS_IF_MATCH, params->object_etag);
+    }
+
+    params->result->throttled = COS_FALSE;
+    start = apr_time_now();
+    s = cos_do_download_part_to_file(&params->options, params->bucket, params->object, download_file, 
+        NULL, headers, NULL, &resp_headers);
+    params->result->elapsed = apr_time_now() - start;
+    if (!cos_status_is_ok(s)) {
+        if (cos_retry_part_task(params, s)) {
+            return s;
+        }
+        cos_fail_part_task(params, s);
+        return s;
+    }
+
+    cos_warn_log("download part = %d, start byte = %"APR_INT64_T_FMT", end byte = %"APR_INT64_T_FMT, part_num, download_file->file_pos, download_file->file_last-1);
+
+    cos_set_part_task_result(params, s, apr_table_get(resp_headers, "ETag"));
+    apr_atomic_inc32(params->completed);
+    apr_queue_push(params->completed_parts, params->result);
+    return NULL;
+}
+
+int64_t cos_get_safe_size_for_download(int64_t part_size)
+{
+    if (part_size < 4*1024*1024) return 4*1024*1024;
+    else if (part_size > 20*1024*1024) return 20*1024*1024;
+    else return part_size;
+}
+
+cos_status_t *cos_resumable_download_file_without_cp_ex(cos_request_options_t *options,
+                                                   cos_string_t *bucket, 
+                                                   cos_string_t *object, 
+                                                   cos_string_t *filepath,                           
+                                                   cos_table_t *headers,
+                                                   cos_table_t *params,
+                                                   cos_resumable_clt_params_t *clt_params,
+                                                   cos_progress_callback progress_callback) 
+{
+    cos_pool_t *subpool = NULL;
+    cos_pool_t *parent_pool = NULL;
+    cos_status_t *s = NULL;
+    cos_status_t *ret = NULL;
+    cos_string_t upload_id;
+    cos_checkpoint_part_t *parts;
+    cos_part_task_result_t *results;
+    cos_part_task_result_t *task_res;
+    cos_transport_thread_params_t *thr_params;
+    cos_thread_pool_t *thrp;
+    cos_task_group_t group;
+    apr_file_t *file = NULL;
+    apr_uint32_t launched = 0;
+    apr_uint32_t failed = 0;
+    apr_uint32_t completed = 0;
+    apr_queue_t *failed_parts;
+    apr_queue_t *completed_parts;
+    int64_t consume_bytes = 0;
+    int32_t thread_num = 0;
+    int64_t part_size = 0;
+    int part_num = 0;
+    int finished = 0;
+    int pushed = 0;
+    int rv;
+    int i;
+    const char *value = NULL;
+    char *object_etag = NULL;
+    int64_t file_size = 0;
+    cos_table_t *resp_headers = NULL;
 
+    // prepare
+    parent_pool = options->pool;
+    ret = cos_status_create(parent_pool);
+    // get object file size
+    cos_pool_create(&subpool, parent_pool);
+    options->pool = subpool;
+    s = cos_head_object(options, bucket, object, NULL, &resp_headers);
+    if (!cos_status_is_ok(s)) {
+        s = cos_status_dup(parent_pool, s);
+        cos_pool_destroy(subpool);
+        options->pool = parent_pool;
+        return s;
+    }
+    value = apr_table_get(resp_headers, COS_CONTENT_LENGTH);
+    if (NULL == value) {
+        cos_status_set(ret, COSE_INVALID_ARGUMENT, COS_LACK_OF_CONTENT_LEN_ERROR_CODE, NULL);
+        cos_pool_destroy(subpool);
+        options->pool = parent_pool;
+        return ret;
+    }
+    file_size = cos_atoi64(value);
+    value = apr_table_get(resp_headers, COS_ETAG);
+    object_etag = apr_pstrdup(parent_pool, NULL == value ? "" : value);
+    cos_pool_destroy(subpool);
+    options->pool = parent_pool;
+    // init download params
+    thread_num = cos_get_thread_num(clt_params);
+    if (cos_is_auto_tune(clt_params)) {
+        part_size = cos_get_auto_tune_part_size(file_size, thread_num);
+    } else {
+        part_size = cos_get_safe_size_for_download(cos_get_resumable_part_size(clt_params));
+    }
+    part_num = cos_get_part_num(file_size, part_size);
+    parts = (cos_checkpoint_part_t *)cos_palloc(parent_pool, sizeof(cos_checkpoint_part_t) * part_num);
+    cos_build_parts(file_size, part_size, parts);
+    results = (cos_part_task_result_t *)cos_palloc(parent_pool, sizeof(cos_part_task_result_t) * part_num);
+    thr_params = (cos_transport_thread_params_t *)cos_palloc(parent_pool, sizeof(cos_transport_thread_params_t) * part_num);
+    cos_build_thread_params(thr_params, part_num, parent_pool, options, bucket, object, filepath, &upload_id, parts, results);
+    for (i = 0; i < part_num; i++) {
+        thr_params[i].object_etag = object_etag;
+    }
+    
+    // download parts    
+    thrp = cos_get_thread_pool();
+    if (NULL == thrp) {
+        cos_status_set(ret, COSE_INTERNAL_ERROR, COS_CREATE_THREAD_POOL_ERROR_CODE, NULL); 
+        return ret;
+    }
+
+    rv = apr_queue_create(&failed_parts, part_num, parent_pool);
+    if (APR_SUCCESS != rv) {
+        cos_status_set(ret, rv, COS_CREATE_QUEUE_ERROR_CODE, NULL); 
+        return ret;
+    }
+
+    rv = apr_queue_create(&completed_parts, part_num, parent_pool);
+    if (APR_SUCCESS != rv) {
+        cos_status_set(ret, rv, COS_CREATE_QUEUE_ERROR_CODE, NULL); 
+        return ret;
+    }
+
+    rv = apr_file_open(&file, filepath->data, APR_CREATE | APR_WRITE, APR_UREAD | APR_UWRITE | APR_GREAD, parent_pool);
+    if (rv != APR_SUCCESS) {
+        cos_status_set(ret, rv, COS_OPEN_FILE_ERROR_CODE, NULL);
+        return ret;
+    }
+    cos_preallocate_part_file(clt_params, file, file_size);
+    cos_set_part_file(thr_params, part_num, file);
+
+    // launch, the running tasks of this transfer are limited to its share of the shared thread pool
+    cos_set_task_tracker(thr_params, part_num, &launched, &failed, &completed, failed_parts, completed_parts);
+    cos_task_group_init(thrp, &group, cos_get_task_priority(clt_params), thread_num, cos_is_auto_tune(clt_params));
+    pushed = cos_launch_part_tasks(thrp, &group, download_part, thr_params, part_num, 0, 0);
+
+    // wait until all tasks exit
+    while (finished < pushed) {
+        rv = cos_wait_part_task_result(thrp, &group, completed_parts, &task_res);
+        if (rv != APR_SUCCESS) {
+            break;
+        }
+        if (task_res->retrying && 0 == apr_atomic_read32(&failed)) {
+            // the part stays in flight, relaunch it after a backoff, the window is halved if it is throttled
+            if (task_res->throttled) {
+                cos_task_group_feedback(thrp, &group, task_res->part->size, task_res->elapsed, COS_TRUE);
+            }
+            cos_relaunch_part_task(thrp, &group, download_part, thr_params + (task_res - results));
+            continue;
+        }
+        finished++;
+        if (NULL != task_res->s && cos_status_is_ok(task_res->s)) {
+            cos_task_group_feedback(thrp, &group, task_res->part->size, task_res->elapsed, COS_FALSE);
+        }
+        if (0 == apr_atomic_read32(&failed)) {
+            pushed = cos_launch_part_tasks(thrp, &group, download_part, thr_params, part_num, pushed, finished);
+        }
+        if (NULL == task_res->s || !cos_status_is_ok(task_res->s)) {
+            continue;
+        }
+        if (NULL != progress_callback) {
+            consume_bytes += task_res->part->size;
+            progress_callback(consume_bytes, file_size);
+        }
+    }
+    cos_task_group_destroy(thrp, &group);
+    apr_file_close(file);
+
+    // failed
+    if (apr_atomic_read32(&failed) > 0) {
+        s = cos_get_part_task_failure(parent_pool, failed_parts);
+        cos_destroy_thread_pool(thr_params, part_num);
+        return s;
+    }
+
+    // successful
+    cos_destroy_thread_pool(thr_params, part_num);
+
+    s = cos_status_create(options->pool);
+    s->code = 200;
+    return s;
+}
+
+cos_status_t *cos_resumable_download_file_without_cp(cos_request_options_t *options,
+                                                   cos_string_t *bucket, 
+                                                   cos_string_t *object, 
+                                                   cos_string_t *filepath,                           
+                                                   cos_table_t *headers,
+                                                   cos_table_t *params,
+                                                   int32_t thread_num,
+                                                   int64_t part_size,
+                                                   cos_progress_callback progress_callback) 
+{
+    cos_resumable_clt_params_t *clt_params;
+    clt_params = cos_create_resumable_clt_params_content(options->pool, part_size, thread_num, COS_FALSE, NULL);
+    return cos_resumable_download_file_without_cp_ex(options, bucket, object, filepath, headers, params, clt_params, 
+        progress_callback);
+}
+
+
+
+cos_status_t *cos_resumable_download_file_with_cp(cos_request_options_t *options,
+                                                  cos_string_t *bucket, 
+                                                  cos_string_t *object, 
+                                                  cos_string_t *filepath,                           
+                                                  cos_table_t *headers,
+                                                  cos_table_t *params,
+                                                  cos_resumable_clt_params_t *clt_params,
+                                                  cos_string_t *checkpoint_path,
+                                                  cos_progress_callback progress_callback) 
+{
+    cos_pool_t *subpool = NULL;
+    cos_pool_t *parent_pool = NULL;
+    cos_status_t *s = NULL;
+    cos_status_t *ret = NULL;
+    cos_string_t upload_id;
+    cos_string_t tmp_filepath;
+    cos_checkpoint_part_t *parts;
+    cos_part_task_result_t *results;
+    cos_part_task_result_t *task_res;
+    cos_transport_thread_params_t *thr_params;
+    cos_checkpoint_t *checkpoint = NULL;
+    cos_thread_pool_t *thrp;
+    cos_task_group_t group;
+    apr_file_t *tmp_file;
+    apr_uint32_t launched = 0;
+    apr_uint32_t failed = 0;
+    apr_uint32_t completed = 0;
+    apr_queue_t *failed_parts;
+    apr_queue_t *completed_parts;
+    int need_new_checkpoint = COS_TRUE;
+    int64_t consume_bytes = 0;
+    int32_t thread_num = 0;
+    int64_t part_size = 0;
+    int part_num = 0;
+    int finished = 0;
+    int pushed = 0;
+    int i = 0;
+    int rv;
+    const char *value = NULL;
+    char *object_key = NULL;
+    char *object_etag = NULL;
+    char *object_last_modified = NULL;
+    int64_t file_size = 0;
+    cos_table_t *resp_headers = NULL;
+
+    // get object size, etag and last modified time
+    parent_pool = options->pool;
+    ret = cos_status_create(parent_pool);
+    cos_pool_create(&subpool, parent_pool);
+    options->pool = subpool;
+    s = cos_head_object(options, bucket, object, NULL, &resp_headers);
+    if (!cos_status_is_ok(s)) {
+        s = cos_status_dup(parent_pool, s);
+        cos_pool_destroy(subpool);
+        options->pool = parent_pool;
+        return s;
+    }
+    value = apr_table_get(resp_headers, COS_CONTENT_LENGTH);
+    if (NULL == value) {
+        cos_status_set(ret, COSE_INVALID_ARGUMENT, COS_LACK_OF_CONTENT_LEN_ERROR_CODE, NULL);
+        cos_pool_destroy(subpool);
+        options->pool = parent_pool;
+        return ret;
+    }
+    file_size = cos_atoi64(value);
+    value = apr_table_get(resp_headers, COS_ETAG);
+    object_etag = apr_pstrdup(parent_pool, NULL == value ? "" : value);
+    value = apr_table_get(resp_headers, COS_LAST_MODIFIED);
+    object_last_modified = apr_pstrdup(parent_pool, NULL == value ? "" : value);
+    cos_pool_destroy(subpool);
+    options->pool = parent_pool;
+
+    // checkpoint
+    thread_num = cos_get_thread_num(clt_params);
+    if (cos_is_auto_tune(clt_params)) {
+        part_size = cos_get_auto_tune_part_size(file_size, thread_num);
+    } else {
+        part_size = cos_get_safe_size_for_download(cos_get_resumable_part_size(clt_params));
+        cos_get_part_size(file_size, &part_size);
+    }
+    cos_get_temporary_file_name(parent_pool, filepath, &tmp_filepath);
+    // the checkpoint of the object of another bucket is not resumed, as the copy source it has the bucket
+    object_key = apr_psprintf(parent_pool, "%.*s/%.*s", bucket->len, bucket->data, object->len, object->data);
+    checkpoint = cos_create_checkpoint_content(parent_pool);
+    if (cos_does_file_exist(checkpoint_path, parent_pool)) {
+        if (COSE_OK == cos_load_checkpoint(parent_pool, checkpoint_path, checkpoint) && 
+            cos_is_download_checkpoint_valid(parent_pool, checkpoint, object_key, file_size, 
+                object_last_modified, object_etag) &&
+            cos_does_file_exist(&tmp_filepath, parent_pool)) {
+                need_new_checkpoint = COS_FALSE;
+        } else {
+            apr_file_remove(checkpoint_path->data, parent_pool);
+        }
+    }
+
+    if (need_new_checkpoint) {
+        apr_file_remove(tmp_filepath.data, parent_pool);
+        cos_build_download_checkpoint(parent_pool, checkpoint, filepath, object_key, file_size, 
+            object_last_modified, object_etag, part_size);
+    }
+
+    // the temporary file exists even for an empty object, it is shared by the parts
+    rv = apr_file_open(&tmp_file, tmp_filepath.data, APR_CREATE | APR_WRITE, 
+        APR_UREAD | APR_UWRITE | APR_GREAD, parent_pool);
+    if (rv != APR_SUCCESS) {
+        cos_status_set(ret, rv, COS_OPEN_FILE_ERROR_CODE, NULL);
+        return ret;
+    }
+    if (need_new_checkpoint) {
+        cos_preallocate_part_file(clt_params, tmp_file, file_size);
+    }
+
+    rv = cos_open_checkpoint_file(parent_pool, checkpoint_path, checkpoint);
+    if (rv != APR_SUCCESS) {
+        apr_file_close(tmp_file);
+        cos_status_set(ret, rv, COS_OPEN_FILE_ERROR_CODE, NULL);
+        return ret;
+    }
+
+    // compact the journal, then the completed parts are appended to it
+    rv = cos_dump_checkpoint(parent_pool, checkpoint);
+    if (rv != COSE_OK) {
+        apr_file_close(checkpoint->thefile);
+        apr_file_close(tmp_file);
+        cos_status_set(ret, rv, COS_WRITE_FILE_ERROR_CODE, NULL);
+        return ret;
+    }
+
+    // prepare
+    parts = (cos_checkpoint_part_t *)cos_palloc(parent_pool, sizeof(cos_checkpoint_part_t) * (checkpoint->part_num + 1));
+    cos_get_checkpoint_undo_parts(checkpoint, &part_num, parts);
+    for (i = 0; i < checkpoint->part_num; i++) {
+        if (checkpoint->parts[i].completed) {
+            consume_bytes += checkpoint->parts[i].size;
+        }
+    }
+    results = (cos_part_task_result_t *)cos_palloc(parent_pool, sizeof(cos_part_task_result_t) * (part_num + 1));
+    thr_params = (cos_transport_thread_params_t *)cos_palloc(parent_pool, sizeof(cos_transport_thread_params_t) * (part_num + 1));
+    cos_build_thread_params(thr_params, part_num, parent_pool, options, bucket, object, &tmp_filepath, &upload_id, parts, results);
+    cos_set_part_file(thr_params, part_num, tmp_file);
+    for (i = 0; i < part_num; i++) {
+        thr_params[i].object_etag = object_etag;
+    }
+
+    // download parts    
+    thrp = cos_get_thread_pool();
+    if (NULL == thrp) {
+        apr_file_close(checkpoint->thefile);
+        apr_file_close(tmp_file);
+        cos_status_set(ret, COSE_INTERNAL_ERROR, COS_CREATE_THREAD_POOL_ERROR_CODE, NULL); 
+        return ret;
+    }
+
+    rv = apr_queue_create(&failed_parts, part_num + 1, parent_pool);
+    if (APR_SUCCESS != rv) {
+        apr_file_close(checkpoint->thefile);
+        apr_file_close(tmp_file);
+        cos_status_set(ret, rv, COS_CREATE_QUEUE_ERROR_CODE, NULL); 
+        return ret;
+    }
+
+    rv = apr_queue_create(&completed_parts, part_num + 1, parent_pool);
+    if (APR_SUCCESS != rv) {
+        apr_file_close(checkpoint->thefile);
+        apr_file_close(tmp_file);
+        cos_status_set(ret, rv, COS_CREATE_QUEUE_ERROR_CODE, NULL); 
+        return ret;
+    }
+
+    // launch, the running tasks of this transfer are limited to its share of the shared thread pool
+    cos_set_task_tracker(thr_params, part_num, &launched, &failed, &completed, failed_parts, completed_parts);
+    cos_task_group_init(thrp, &group, cos_get_task_priority(clt_params), thread_num, cos_is_auto_tune(clt_params));
+    pushed = cos_launch_part_tasks(thrp, &group, download_part, thr_params, part_num, 0, 0);
+
+    // wait until all tasks exit
+    while (finished < pushed) {
+        rv = cos_wait_part_task_result(thrp, &group, completed_parts, &task_res);
+        if (rv != APR_SUCCESS) {
+            break;
+        }
+        if (task_res->retrying && 0 == apr_atomic_read32(&failed)) {
+            // the part stays in flight, relaunch it after a backoff, the window is halved if it is throttled
+            if (task_res->throttled) {
+                cos_task_group_feedback(thrp, &group, task_res->part->size, task_res->elapsed, COS_TRUE);
+            }
+            cos_relaunch_part_task(thrp, &group, download_part, thr_params + (task_res - results));
+            continue;
+        }
+        finished++;
+        if (NULL != task_res->s && cos_status_is_ok(task_res->s)) {
+            cos_task_group_feedback(thrp, &group, task_res->part->size, task_res->elapsed, COS_FALSE);
+        }
+        if (0 == apr_atomic_read32(&failed)) {
+            pushed = cos_launch_part_tasks(thrp, &group, download_part, thr_params, part_num, pushed, finished);
+        }
+        if (NULL == task_res->s || !cos_status_is_ok(task_res->s)) {
+            continue;
+        }
+        rv = cos_append_checkpoint(parent_pool, checkpoint, task_res->part->index, &task_res->etag);
+        if (rv != COSE_OK) {
+            cos_status_set(ret, rv, COS_WRITE_FILE_ERROR_CODE, NULL);
+            apr_atomic_inc32(&failed);
+            task_res->s = ret;
+            apr_queue_push(failed_parts, task_res);
+        }
+        if (NULL != progress_callback) {
+            consume_bytes += task_res->part->size;
+            progress_callback(consume_bytes, file_size);
+        }
+    }
+    cos_task_group_destroy(thrp, &group);
+    cos_close_checkpoint_file(checkpoint);
+    apr_file_close(tmp_file);
+
+    // failed, keep the checkpoint and the temporary file for the next retry, unless the object is changed
+    if (apr_atomic_read32(&failed) > 0) {
+        s = cos_get_part_task_failure(parent_pool, failed_parts);
+        cos_destroy_thread_pool(thr_params, part_num);
+        if (412 == s->code) {
+            apr_file_remove(checkpoint_path->data, parent_pool);
+            apr_file_remove(tmp_filepath.data, parent_pool);
+        }
+        return s;
+    }
+    cos_destroy_thread_pool(thr_params, part_num);
+
+    // successful, move the temporary file to the target file
+    rv = apr_file_rename(tmp_filepath.data, filepath->data, parent_pool);
+    if (rv != APR_SUCCESS) {
+        cos_status_set(ret, rv, COS_WRITE_FILE_ERROR_CODE, NULL);
+        return ret;
+    }
+
+    // remove chepoint file
+    apr_file_remove(checkpoint_path->data, parent_pool);
+
+    s = cos_status_create(parent_pool);
+    s->code = 200;
+    return s;
+}
+
+void * APR_THREAD_FUNC download_part_to_buffer(apr_thread_t *thd, void *data) 
+{
+    cos_status_t *s = NULL;
+    cos_upload_thread_params_t *params = NULL;
+    cos_table_t *resp_headers = NULL;
+    apr_time_t start;
+    
+    params = (cos_upload_thread_params_t *)data;
+    if (cos_skip_part_task(params)) {
+        return NULL;
+    }
+
+    cos_init_part_task_options(params, params->result_pool);
+
+    // the content of a throttled try is dropped with the status
+    cos_list_init(&params->content);
+    params->result->throttled = COS_FALSE;
+    start = apr_time_now();
+    s = cos_do_download_part_to_buffer(&params->options, params->bucket, params->object, params->part->offset, 
+        params->part->offset + params->part->size, &params->content, NULL, NULL, NULL, &resp_headers);
+    params->result->elapsed = apr_time_now() - start;
+    if (!cos_status_is_ok(s)) {
+        if (cos_retry_part_task(params, s)) {
+            return s;
+        }
+        cos_fail_part_task(params, s);
+        return s;
+    }
+
+    cos_set_part_task_result(params, s, NULL);
+    apr_atomic_inc32(params->completed);
+    apr_queue_push(params->completed_parts, params->result);
+    return NULL;
+}
+
+int cos_write_stream_part(cos_write_stream_callback write_callback, void *user_data, cos_list_t *content)
+{
+    cos_buf_t *b;
+    int64_t size;
+
+    cos_list_for_each_entry(cos_buf_t, b, content, node) {
+        size = cos_buf_size(b);
+        if (size > 0 && write_callback(user_data, (const char *)b->pos, size) != size) {
+            return COSE_WRITE_BODY_ERROR;
+        }
+    }
+    return COSE_OK;
+}
+
+cos_status_t *cos_resumable_download_stream(cos_request_options_t *options,
+                                            cos_string_t *bucket, 
+                                            cos_string_t *object, 
+                                            cos_resumable_clt_params_t *clt_params, 
+                                            cos_write_stream_callback write_callback,
+                                            void *user_data,
+                                            cos_progress_callback progress_callback) 
+{
+    cos_pool_t *subpool = NULL;
+    cos_pool_t *parent_pool = NULL;
+    cos_status_t *s = NULL;
+    cos_status_t *ret = NULL;
+    cos_status_t *error = NULL;
+    cos_checkpoint_part_t *parts;
+    cos_part_task_result_t *results;
+    cos_part_task_result_t *task_res;
+    cos_transport_thread_params_t *thr_params;
+    cos_thread_pool_t *thrp;
+    cos_task_group_t group;
+    apr_uint32_t launched = 0;
+    apr_uint32_t failed = 0;
+    apr_uint32_t completed = 0;
+    apr_queue_t *failed_parts;
+    apr_queue_t *completed_parts;
+    int64_t consume_bytes = 0;
+    int64_t buffer_size = 0;
+    int64_t part_size = 0;
+    int64_t file_size = 0;
+    int *ready;
+    int32_t thread_num = 0;
+    int slot_num = 0;
+    int part_num = 0;
+    int next_launch = 0;
+    int next_write = 0;
+    int running = 0;
+    int slot;
+    int rv;
+    const char *value = NULL;
+    cos_table_t *resp_headers = NULL;
+
+    // get object size
+    parent_pool = options->pool;
+    ret = cos_status_create(parent_pool);
+    cos_pool_create(&subpool, parent_pool);
+    options->pool = subpool;
+    s = cos_head_object(options, bucket, object, NULL, &resp_headers);
+    if (!cos_status_is_ok(s)) {
+        s = cos_status_dup(parent_pool, s);
+        cos_pool_destroy(subpool);
+        options->pool = parent_pool;
+        return s;
+    }
+    value = apr_table_get(resp_headers, COS_CONTENT_LENGTH);
+    if (NULL == value) {
+        cos_status_set(ret, COSE_INVALID_ARGUMENT, COS_LACK_OF_CONTENT_LEN_ERROR_CODE, NULL);
+        cos_pool_destroy(subpool);
+        options->pool = parent_pool;
+        return ret;
+    }
+    file_size = cos_atoi64(value);
+    cos_pool_destroy(subpool);
+    options->pool = parent_pool;
+
+    // the parts are downloaded ahead of the writer into a reorder buffer of slot_num parts,
+    // the memory is part_size * slot_num
+    thread_num = cos_get_thread_num(clt_params);
+    if (cos_is_auto_tune(clt_params)) {
+        part_size = cos_get_auto_tune_part_size(file_size, thread_num);
+    } else {
+        part_size = cos_get_safe_size_for_download(cos_get_resumable_part_size(clt_params));
+        cos_get_part_size(file_size, &part_size);
+    }
+    buffer_size = (NULL == clt_params) ? 0 : clt_params->buffer_size;
+    if (buffer_size <= 0) {
+        buffer_size = part_size * thread_num * 2;
+    }
+    part_num = cos_get_part_num(file_size, part_size);
+    slot_num = (int)cos_min(buffer_size / part_size, COS_MAX_PART_NUM);
+    slot_num = cos_max(cos_min(slot_num, part_num), 1);
+    parts = (cos_checkpoint_part_t *)cos_palloc(parent_pool, sizeof(cos_checkpoint_part_t) * cos_max(part_num, 1));
+    cos_build_parts(file_size, part_size, parts);
+    results = (cos_part_task_result_t *)cos_palloc(parent_pool, sizeof(cos_part_task_result_t) * slot_num);
+    thr_params = (cos_transport_thread_params_t *)cos_palloc(parent_pool, sizeof(cos_transport_thread_params_t) * slot_num);
+    ready = (int *)cos_pcalloc(parent_pool, sizeof(int) * slot_num);
+
+    // download parts    
+    thrp = cos_get_thread_pool();
+    if (NULL == thrp) {
+        cos_status_set(ret, COSE_INTERNAL_ERROR, COS_CREATE_THREAD_POOL_ERROR_CODE, NULL); 
+        return ret;
+    }
+
+    rv = apr_queue_create(&failed_parts, slot_num, parent_pool);
+    if (APR_SUCCESS != rv) {
+        cos_status_set(ret, rv, COS_CREATE_QUEUE_ERROR_CODE, NULL); 
+        return ret;
+    }
+
+    rv = apr_queue_create(&completed_parts, slot_num, parent_pool);
+    if (APR_SUCCESS != rv) {
+        cos_status_set(ret, rv, COS_CREATE_QUEUE_ERROR_CODE, NULL); 
+        return ret;
+    }
+
+    // the content of a part stays in the pool of its slot until it is written out
+    cos_build_thread_params(thr_params, slot_num, parent_pool, options, bucket, object, NULL, NULL, parts, results);
+    cos_set_task_tracker(thr_params, slot_num, &launched, &failed, &completed, failed_parts, completed_parts);
+    for (slot = 0; slot < slot_num; slot++) {
+        cos_pool_create(&thr_params[slot].result_pool, parent_pool);
+    }
+
+    cos_task_group_init(thrp, &group, cos_get_task_priority(clt_params), thread_num, cos_is_auto_tune(clt_params));
+    for (;;) {
+        if (NULL == error && cos_is_cancelled(options->cancel_token)) {
+            cos_status_set(ret, COSE_CANCELLED, COS_CANCELLED_ERROR_CODE, NULL);
+            error = ret;
+        }
+
+        // launch the next part if its slot is written out
+        if (NULL == error && 0 == apr_atomic_read32(&failed) && next_launch < part_num && 
+            next_launch < next_write + slot_num && running < cos_task_group_limit(thrp, &group))
+        {
+            slot = next_launch % slot_num;
+            // release the content of the part written out of the slot
+            apr_pool_clear(thr_params[slot].result_pool);
+            thr_params[slot].part = parts + next_launch;
+            results[slot].part = parts + next_launch;
+            results[slot].s = NULL;
+            results[slot].retries = 0;
+            results[slot].retrying = COS_FALSE;
+            ready[slot] = COS_FALSE;
+            next_launch++;
+            cos_launch_part_task(thrp, &group, download_part_to_buffer, thr_params + slot);
+            running++;
+            continue;
+        }
+
+        // hand the parts to the writer strictly in order
+        if (NULL == error && next_write < next_launch && ready[next_write % slot_num]) {
+            slot = next_write % slot_num;
+            rv = cos_write_stream_part(write_callback, user_data, &thr_params[slot].content);
+            if (rv != COSE_OK) {
+                cos_error_log("Write stream fail, part number:%d\n", next_write + 1);
+                cos_status_set(ret, rv, COS_CLIENT_ERROR_CODE, "Write stream fail");
+                error = ret;
+                cos_cancel(thr_params[0].options.cancel_token);
+                continue;
+            }
+            next_write++;
+            if (NULL != progress_callback) {
+                consume_bytes += thr_params[slot].part->size;
+                progress_callback(consume_bytes, file_size);
+            }
+            continue;
+        }
+
+        if (0 == running) {
+            break;
+        }
+
+        // wait for a part
+        rv = cos_wait_part_task_result(thrp, &group, completed_parts, &task_res);
+        if (rv != APR_SUCCESS) {
+            break;
+        }
+        slot = (int)(task_res - results);
+        if (task_res->retrying && 0 == apr_atomic_read32(&failed)) {
+            // the part stays in flight, relaunch it after a backoff, the window is halved if it is throttled
+            if (task_res->throttled) {
+                cos_task_group_feedback(thrp, &group, task_res->part->size, task_res->elapsed, COS_TRUE);
+            }
+            cos_relaunch_part_task(thrp, &group, download_part_to_buffer, thr_params + slot);
+            continue;
+        }
+        running--;
+        if (NULL == task_res->s || !cos_status_is_ok(task_res->s)) {
+            continue;
+        }
+        cos_task_group_feedback(thrp, &group, task_res->part->size, task_res->elapsed, COS_FALSE);
+        ready[slot] = COS_TRUE;
+    }
+    cos_task_group_destroy(thrp, &group);
+
+    // failed, a write failure is reported instead of the parts it cancelled
+    if (NULL == error && apr_atomic_read32(&failed) > 0) {
+        error = cos_get_part_task_failure(parent_pool, failed_parts);
+    }
+    for (slot = 0; slot < slot_num; slot++) {
+        cos_pool_destroy(thr_params[slot].result_pool);
+    }
+    cos_destroy_thread_pool(thr_params, slot_num);
+    if (NULL != error) {
+        return error;
+    }
+
+    s = cos_status_create(parent_pool);
+    s->code = 200;
+    return s;
+}
+
+cos_status_t *cos_resumable_download_file(cos_request_options_t *options,
+                                          cos_string_t *bucket, 
+                                          cos_string_t *object, 
+                                          cos_string_t *filepath,                           
+                                          cos_table_t *headers,
+                                          cos_table_t *params,
+                                          cos_resumable_clt_params_t *clt_params, 
+                                          cos_progress_callback progress_callback) 
+{
+    cos_string_t checkpoint_path;
+    cos_pool_t *sub_pool;
+    cos_status_t *s;
+
+    cos_pool_create(&sub_pool, options->pool);
+    if (NULL != clt_params && clt_params->enable_checkpoint) {
+        cos_get_download_checkpoint_path(clt_params, filepath, sub_pool, &checkpoint_path);
+        s = cos_resumable_download_file_with_cp(options, bucket, object, filepath, headers, params, clt_params, 
+            &checkpoint_path, progress_callback);
+    } else {
+        s = cos_resumable_download_file_without_cp_ex(options, bucket, object, filepath, headers, params, clt_params, 
+            progress_callback);
+    }
+
+    cos_pool_destroy(sub_pool);
+    return s;
+}
+
+void cos_set_part_copy_source(cos_transport_thread_params_t *thr_params, int part_num, 
+                              cos_string_t *copy_source, const char *copy_source_etag)
+{
+    int i = 0;
+    for (; i < part_num; i++) {
+        thr_params[i].copy_source = copy_source;
+        thr_params[i].copy_source_etag = copy_source_etag;
+    }
+}
+
+cos_status_t *cos_head_copy_source(cos_request_options_t *options, 
+                                   cos_string_t *copy_source,
+                                   int64_t *object_size,
+                                   char **object_etag,
+                                   char **object_last_modified)
+{
+    cos_pool_t *subpool = NULL;
+    cos_pool_t *parent_pool = NULL;
+    cos_status_t *s = NULL;
+    cos_request_options_t source_options;
+    cos_config_t source_config;
+    cos_string_t source_bucket;
+    cos_string_t source_object;
+    cos_table_t *resp_headers = NULL;
+    const char *value = NULL;
+
+    parent_pool = options->pool;
+    s = cos_status_create(parent_pool);
+    cos_pool_create(&subpool, parent_pool);
+    options->pool = subpool;
+
+    // the source may be in another bucket or region, it is addressed by its host
+    source_options = *options;
+    source_config = *options->config;
+    source_options.config = &source_config;
+    if (COSE_OK != cos_parse_copy_source(&source_options, copy_source, &source_config.endpoint, &source_object)) {
+        cos_status_set(s, COSE_INVALID_ARGUMENT, COS_CLIENT_ERROR_CODE, "invalid copy source");
+        cos_pool_destroy(subpool);
+        options->pool = parent_pool;
+        return s;
+    }
+    source_config.is_cname = COS_TRUE;
+    cos_str_set(&source_bucket, "");
+
+    s = cos_head_object(&source_options, &source_bucket, &source_object, NULL, &resp_headers);
+    if (!cos_status_is_ok(s)) {
+        s = cos_status_dup(parent_pool, s);
+        cos_pool_destroy(subpool);
+        options->pool = parent_pool;
+        return s;
+    }
+    value = apr_table_get(resp_headers, COS_CONTENT_LENGTH);
+    if (NULL == value) {
+        s = cos_status_create(parent_pool);
+        cos_status_set(s, COSE_INVALID_ARGUMENT, COS_LACK_OF_CONTENT_LEN_ERROR_CODE, NULL);
+        cos_pool_destroy(subpool);
+        options->pool = parent_pool;
+        return s;
+    }
+    *object_size = cos_atoi64(value);
+    value = apr_table_get(resp_headers, COS_ETAG);
+    *object_etag = apr_pstrdup(parent_pool, NULL == value ? "" : value);
+    value = apr_table_get(resp_headers, COS_LAST_MODIFIED);
+    *object_last_modified = apr_pstrdup(parent_pool, NULL == value ? "" : value);
+
+    s = cos_status_dup(parent_pool, s);
+    cos_pool_destroy(subpool);
+    options->pool = parent_pool;
+    return s;
+}
+
+int64_t cos_get_copy_part_size(cos_resumable_clt_params_t *clt_params, int64_t object_size)
+{
+    int64_t part_size = 0;
+
+    if (cos_is_auto_tune(clt_params)) {
+        part_size = cos_get_auto_tune_part_size(object_size, cos_get_thread_num(clt_params));
+    } else {
+        part_size = cos_get_resumable_part_size(clt_params);
+    }
+    // the data is not transferred by the client, larger parts save requests
+    part_size = cos_max(part_size, COS_MIN_COPY_PART_SIZE);
+    part_size = cos_min(part_size, COS_MAX_COPY_PART_SIZE);
+    cos_get_part_size(object_size, &part_size);
+    return part_size;
+}
+
+void * APR_THREAD_FUNC copy_part(apr_thread_t *thd, void *data) 
+{
+    cos_status_t *s = NULL;
+    cos_upload_thread_params_t *params = NULL;
+    cos_upload_part_copy_params_t *copy_params = NULL;
+    cos_table_t *headers = NULL;
+    cos_table_t *resp_headers = NULL;
+    apr_time_t start;
+
+    params = (cos_upload_thread_params_t *)data;
+    if (cos_skip_part_task(params)) {
+        return NULL;
+    }
+
+    cos_init_part_task_options(params, cos_get_worker_pool(thd));
+
+    copy_params = cos_create_upload_part_copy_params(params->options.pool);
+    cos_str_set(&copy_params->copy_source, params->copy_source->data);
+    cos_str_set(&copy_params->dest_bucket, params->bucket->data);
+    cos_str_set(&copy_params->dest_object, params->object->data);
+    cos_str_set(&copy_params->upload_id, params->upload_id->data);
+    copy_params->part_num = params->part->index + 1;
+    copy_params->range_start = params->part->offset;
+    copy_params->range_end = params->part->offset + params->part->size - 1;
+    headers = cos_table_make(params->options.pool, 1);
+    if (NULL != params->copy_source_etag && '\0' != params->copy_source_etag[0]) {
+        // the parts of two versions of the source are never mixed
+        apr_table_set(headers, COS_COPY_SOURCE_IF_MATCH, params->copy_source_etag);
+    }
+
+    params->result->throttled = COS_FALSE;
+    start = apr_time_now();
+    s = cos_upload_part_copy(&params->options, copy_params, headers, &resp_headers);
+    params->result->elapsed = apr_time_now() - start;
+    if (!cos_status_is_ok(s)) {
+        if (cos_retry_part_task(params, s)) {
+            return s;
+        }
+        cos_fail_part_task(params, s);
+        return s;
+    }
+
+    cos_set_part_task_result(params, s, copy_params->rsp_content.etag.data);
+    apr_atomic_inc32(params->completed);
+    apr_queue_push(params->completed_parts, params->result);
+    return NULL;
+}
+
+cos_status_t *cos_resumable_copy_object_parts(cos_request_options_t *options,
+                                              cos_string_t *copy_source,
+                                              cos_string_t *dest_bucket, 
+                                              cos_string_t *dest_object, 
+                                              cos_table_t *headers,
+                                              cos_resumable_clt_params_t *clt_params,
+                                              cos_string_t *checkpoint_path,
+                                              int64_t object_size,
+                                              const char *object_etag,
+                                              const char *object_last_modified,
+                                              cos_progress_callback progress_callback,
+                                              cos_table_t **resp_headers,
+                                              cos_list_t *resp_body) 
+{
+    cos_pool_t *subpool = NULL;
+    cos_pool_t *parent_pool = NULL;
+    cos_status_t *s = NULL;
+    cos_status_t *ret = NULL;
+    cos_list_t completed_part_list;
+    cos_complete_part_content_t *complete_content = NULL;
+    cos_string_t upload_id;
+    cos_string_t dest_path;
+    cos_checkpoint_part_t *parts;
+    cos_part_task_result_t *results;
+    cos_part_task_result_t *task_res;
+    cos_upload_thread_params_t *thr_params;
+    cos_thread_pool_t *thrp;
+    cos_task_group_t group;
+    apr_uint32_t launched = 0;
+    apr_uint32_t failed = 0;
+    apr_uint32_t completed = 0;
+    apr_queue_t *failed_parts;
+    apr_queue_t *completed_parts;
+    cos_checkpoint_t *checkpoint = NULL;
+    int need_init_upload = COS_TRUE;
+    int64_t consume_bytes = 0;
+    char *part_num_str;
+    int32_t thread_num = 0;
+    int64_t part_size = 0;
+    int part_num = 0;
+    int finished = 0;
+    int pushed = 0;
+    int i = 0;
+    int rv;
+
+    // checkpoint, the upload is resumed if the source is not modified
+    parent_pool = options->pool;
+    ret = cos_status_create(parent_pool);
+    thread_num = cos_get_thread_num(clt_params);
+    part_size = cos_get_copy_part_size(clt_params, object_size);
+    cos_str_set(&dest_path, apr_psprintf(parent_pool, "%.*s/%.*s", 
+        dest_bucket->len, dest_bucket->data, dest_object->len, dest_object->data));
+    checkpoint = cos_create_checkpoint_content(parent_pool);
+    if (NULL != checkpoint_path && cos_does_file_exist(checkpoint_path, parent_pool)) {
+        if (COSE_OK == cos_load_checkpoint(parent_pool, checkpoint_path, checkpoint) && 
+            cos_is_copy_checkpoint_valid(parent_pool, checkpoint, &dest_path, copy_source->data, 
+                object_size, object_last_modified, object_etag)) {
+                cos_str_set(&upload_id, checkpoint->upload_id.data);
+                need_init_upload = COS_FALSE;
+        } else {
+            apr_file_remove(checkpoint_path->data, parent_pool);
+        }
+    }
+
+    if (need_init_upload) {
+        // init upload 
+        cos_pool_create(&subpool, parent_pool);
+        options->pool = subpool;
+        s = cos_init_multipart_upload(options, dest_bucket, dest_object, &upload_id, headers, resp_headers);
+        if (!cos_status_is_ok(s)) {
+            s = cos_status_dup(parent_pool, s);
+            cos_pool_destroy(subpool);
+            options->pool = parent_pool;
+            return s;
+        }
+        cos_str_set(&upload_id, apr_pstrdup(parent_pool, upload_id.data));
+        options->pool = parent_pool;
+        cos_pool_destroy(subpool);
+
+        // build checkpoint, it is kept in memory without checkpoint_path
+        checkpoint = cos_create_checkpoint_content(parent_pool);
+        cos_build_copy_checkpoint(parent_pool, checkpoint, &dest_path, copy_source->data, object_size, 
+            object_last_modified, object_etag, &upload_id, part_size);
+    }
+
+    if (NULL != checkpoint_path) {
+        rv = cos_open_checkpoint_file(parent_pool, checkpoint_path, checkpoint);
+        if (rv != APR_SUCCESS) {
+            cos_status_set(ret, rv, COS_OPEN_FILE_ERROR_CODE, NULL);
+            return ret;
+        }
+
+        // compact the journal, then the completed parts are appended to it
+        rv = cos_dump_checkpoint(parent_pool, checkpoint);
+        if (rv != COSE_OK) {
+            apr_file_close(checkpoint->thefile);
+            cos_status_set(ret, rv, COS_WRITE_FILE_ERROR_CODE, NULL);
+            return ret;
+        }
+    }
+
+    // prepare
+    parts = (cos_checkpoint_part_t *)cos_palloc(parent_pool, sizeof(cos_checkpoint_part_t) * (checkpoint->part_num));
+    cos_get_checkpoint_undo_parts(checkpoint, &part_num, parts);
+    results = (cos_part_task_result_t *)cos_palloc(parent_pool, sizeof(cos_part_task_result_t) * part_num);
+    thr_params = (cos_upload_thread_params_t *)cos_palloc(parent_pool, sizeof(cos_upload_thread_params_t) * part_num);
+    cos_build_thread_params(thr_params, part_num, parent_pool, options, dest_bucket, dest_object, NULL, &upload_id, parts, results);
+    cos_set_part_copy_source(thr_params, part_num, copy_source, object_etag);
+    for (i = 0; i < checkpoint->part_num; i++) {
+        if (checkpoint->parts[i].completed) {
+            consume_bytes += checkpoint->parts[i].size;
+        }
+    }
+
+    // copy parts    
+    thrp = cos_get_thread_pool();
+    if (NULL == thrp) {
+        if (NULL != checkpoint_path) {
+            apr_file_close(checkpoint->thefile);
+        }
+        cos_status_set(ret, COSE_INTERNAL_ERROR, COS_CREATE_THREAD_POOL_ERROR_CODE, NULL); 
+        return ret;
+    }
+
+    rv = apr_queue_create(&failed_parts, part_num + 1, parent_pool);
+    if (APR_SUCCESS != rv) {
+        if (NULL != checkpoint_path) {
+            apr_file_close(checkpoint->thefile);
+        }
+        cos_status_set(ret, rv, COS_CREATE_QUEUE_ERROR_CODE, NULL); 
+        return ret;
+    }
+
+    rv = apr_queue_create(&completed_parts, part_num + 1, parent_pool);
+    if (APR_SUCCESS != rv) {
+        if (NULL != checkpoint_path) {
+            apr_file_close(checkpoint->thefile);
+        }
+        cos_status_set(ret, rv, COS_CREATE_QUEUE_ERROR_CODE, NULL); 
+        return ret;
+    }
+
+    // launch, the running tasks of this transfer are limited to its share of the shared thread pool
+    cos_set_task_tracker(thr_params, part_num, &launched, &failed, &completed, failed_parts, completed_parts);
+    cos_task_group_init(thrp, &group, cos_get_task_priority(clt_params), thread_num, cos_is_auto_tune(clt_params));
+    pushed = cos_launch_part_tasks(thrp, &group, copy_part, thr_params, part_num, 0, 0);
+
+    // wait until all tasks exit
+    while (finished < pushed) {
+        rv = cos_wait_part_task_result(thrp, &group, completed_parts, &task_res);
+        if (rv != APR_SUCCESS) {
+            break;
+        }
+        if (task_res->retrying && 0 == apr_atomic_read32(&failed)) {
+            // the part stays in flight, relaunch it after a backoff, the window is halved if it is throttled
+            if (task_res->throttled) {
+                cos_task_group_feedback(thrp, &group, task_res->part->size, task_res->elapsed, COS_TRUE);
+            }
+            cos_relaunch_part_task(thrp, &group, copy_part, thr_params + (task_res - results));
+            continue;
+        }
+        finished++;
+        if (NULL != task_res->s && cos_status_is_ok(task_res->s)) {
+            cos_task_group_feedback(thrp, &group, task_res->part->size, task_res->elapsed, COS_FALSE);
+        }
+        if (0 == apr_atomic_read32(&failed)) {
+            pushed = cos_launch_part_tasks(thrp, &group, copy_part, thr_params, part_num, pushed, finished);
+        }
+        if (NULL == task_res->s || !cos_status_is_ok(task_res->s)) {
+            continue;
+        }
+        if (NULL != checkpoint_path) {
+            rv = cos_append_checkpoint(parent_pool, checkpoint, task_res->part->index, &task_res->etag);
+            if (rv != COSE_OK) {
+                cos_status_set(ret, rv, COS_WRITE_FILE_ERROR_CODE, NULL);
+                apr_atomic_inc32(&failed);
+                task_res->s = ret;
+                apr_queue_push(failed_parts, task_res);
+            }
+        } else {
+            cos_update_checkpoint(parent_pool, checkpoint, task_res->part->index, &task_res->etag);
+        }
+        if (NULL != progress_callback) {
+            consume_bytes += task_res->part->size;
+            progress_callback(consume_bytes, object_size);
+        }
+    }
+    cos_task_group_destroy(thrp, &group);
+    if (NULL != checkpoint_path) {
+        cos_close_checkpoint_file(checkpoint);
+    }
+
+    // failed, the upload can not be resumed without checkpoint
+    if (apr_atomic_read32(&failed) > 0) {
+        s = cos_get_part_task_failure(parent_pool, failed_parts);
+        cos_destroy_thread_pool(thr_params, part_num);
+        if (NULL == checkpoint_path || cos_should_abort_upload(options)) {
+            cos_abort_resumable_upload(options, dest_bucket, dest_object, &upload_id);
+            if (NULL != checkpoint_path) {
+                apr_file_remove(checkpoint_path->data, parent_pool);
+            }
+        }
+        return s;
+    }
+    
+    // successful
+    cos_pool_create(&subpool, parent_pool);
+    cos_list_init(&completed_part_list);
+    for (i = 0; i < checkpoint->part_num; i++) {
+        complete_content = cos_create_complete_part_content(subpool);
+        part_num_str = apr_psprintf(subpool, "%d", checkpoint->parts[i].index + 1);
+        cos_str_set(&complete_content->part_number, part_num_str);
+        cos_str_set(&complete_content->etag, checkpoint->parts[i].etag.data);
+        cos_list_add_tail(&complete_content->node, &completed_part_list);
+    }
+    cos_destroy_thread_pool(thr_params, part_num);
+
+    // complete upload
+    options->pool = subpool;
+    s = cos_do_complete_multipart_upload(options, dest_bucket, dest_object, &upload_id, 
+        &completed_part_list, NULL, NULL, resp_headers, resp_body);
+    s = cos_status_dup(parent_pool, s);
+    cos_pool_destroy(subpool);
+    options->pool = parent_pool;
+
+    // remove chepoint file
+    if (NULL != checkpoint_path) {
+        apr_file_remove(checkpoint_path->data, parent_pool);
+    }
+    
+    return s;
+}
+
+cos_status_t *cos_resumable_copy_object(cos_request_options_t *options,
+                                        cos_string_t *copy_source,
+                                        cos_string_t *dest_bucket, 
+                                        cos_string_t *dest_object, 
+                                        cos_table_t *headers,
+                                        cos_table_t *params,
+                                        cos_resumable_clt_params_t *clt_params, 
+                                        cos_progress_callback progress_callback,
+                                        cos_table_t **resp_headers,
+                                        cos_list_t *resp_body) 
+{
+    cos_string_t checkpoint_path;
+    cos_pool_t *sub_pool;
+    cos_status_t *s;
+    cos_copy_object_params_t *copy_object_params;
+    int64_t object_size = 0;
+    char *object_etag = NULL;
+    char *object_last_modified = NULL;
+
+    s = cos_head_copy_source(options, copy_source, &object_size, &object_etag, &object_last_modified);
+    if (!cos_status_is_ok(s)) {
+        return s;
+    }
+
+    // a single copy is enough for the object of one part, the larger object is copied by parts
+    if (object_size <= cos_get_copy_part_size(clt_params, object_size) && object_size <= COS_MAX_COPY_PART_SIZE) {
+        copy_object_params = cos_create_copy_object_params(options->pool);
+        s = cos_copy_object(options, copy_source, dest_bucket, dest_object, headers, 
+            copy_object_params, resp_headers);
+        if (cos_status_is_ok(s) && NULL != progress_callback) {
+            progress_callback(object_size, object_size);
+        }
+        return s;
+    }
+
+    cos_pool_create(&sub_pool, options->pool);
+    if (NULL != clt_params && clt_params->enable_checkpoint) {
+        cos_get_copy_checkpoint_path(clt_params, copy_source, dest_bucket, dest_object, sub_pool, &checkpoint_path);
+        s = cos_resumable_copy_object_parts(options, copy_source, dest_bucket, dest_object, headers, clt_params, 
+            &checkpoint_path, object_size, object_etag, object_last_modified, progress_callback, resp_headers, resp_body);
+    } else {
+        s = cos_resumable_copy_object_parts(options, copy_source, dest_bucket, dest_object, headers, clt_params, 
+            NULL, object_size, object_etag, object_last_modified, progress_callback, resp_headers, resp_body);
+    }
+
+    cos_pool_destroy(sub_pool);
+    return s;
+}
+
+cos_list_partition_t *cos_create_list_partition(cos_pool_t *p, const char *prefix, const char *marker, 
+                                                const char *end_marker)
+{
+    cos_list_partition_t *partition;
+
+    partition = (cos_list_partition_t *)cos_pcalloc(p, sizeof(cos_list_partition_t));
+    cos_list_init(&partition->node);
+    cos_str_set(&partition->prefix, apr_pstrdup(p, NULL == prefix ? "" : prefix));
+    cos_str_set(&partition->marker, apr_pstrdup(p, NULL == marker ? "" : marker));
+    cos_str_set(&partition->end_marker, apr_pstrdup(p, NULL == end_marker ? "" : end_marker));
+    cos_list_init(&partition->object_list);
+    cos_list_init(&partition->page_list);
+    partition->pending = 0;
+    partition->parked = COS_FALSE;
+    partition->done = COS_FALSE;
+    return partition;
+}
+
+cos_status_t *cos_discover_list_partitions(cos_request_options_t *options, const cos_string_t *bucket,
+                                           cos_parallel_list_object_params_t *params, 
+                                           cos_list_object_callback callback, void *user_data,
+                                           cos_pool_t *pool, cos_list_t *partition_list)
+{
+    cos_pool_t *subpool = NULL;
+    cos_pool_t *parent_pool = NULL;
+    cos_status_t *s = NULL;
+    cos_list_object_params_t *list_params = NULL;
+    cos_list_partition_t *partition = NULL;
+    cos_list_partition_t *ready = NULL;
+    cos_list_object_content_t *content = NULL;
+    cos_list_object_content_t *copy = NULL;
+    cos_list_object_common_prefix_t *common_prefix = NULL;
+    cos_object_key_t *split_marker = NULL;
+    cos_list_t *object_node;
+    cos_list_t *prefix_node;
+    const char *start_marker;
+    char *prefix;
+    char *marker;
+    int truncated = COS_TRUE;
+
+    parent_pool = options->pool;
+    prefix = apr_pstrdup(pool, NULL == params->prefix.data ? "" : params->prefix.data);
+    start_marker = NULL == params->marker.data ? "" : params->marker.data;
+    marker = apr_pstrdup(pool, start_marker);
+
+    // the ranges between the sorted split markers, the markers before the start are skipped
+    if (!cos_list_empty(&params->split_marker_list)) {
+        cos_list_for_each_entry(cos_object_key_t, split_marker, &params->split_marker_list, node) {
+            if (NULL == split_marker->key.data || strcmp(split_marker->key.data, marker) <= 0) {
+                continue;
+            }
+            partition = cos_create_list_partition(pool, prefix, marker, split_marker->key.data);
+            cos_list_add_tail(&partition->node, partition_list);
+            marker = partition->end_marker.data;
+        }
+        partition = cos_create_list_partition(pool, prefix, marker, NULL);
+        cos_list_add_tail(&partition->node, partition_list);
+        return NULL;
+    }
+
+    if (cos_is_null_string(&params->delimiter)) {
+        partition = cos_create_list_partition(pool, prefix, marker, NULL);
+        cos_list_add_tail(&partition->node, partition_list);
+        return NULL;
+    }
+
+    // every common prefix of the delimiter is a partition, the objects beside them are listed here
+    while (truncated) {
+        cos_pool_create(&subpool, parent_pool);
+        options->pool = subpool;
+        list_params = cos_create_list_object_params(subpool);
+        cos_str_set(&list_params->prefix, prefix);
+        cos_str_set(&list_params->marker, marker);
+        cos_str_set(&list_params->delimiter, params->delimiter.data);
+        list_params->max_ret = params->max_ret;
+        s = cos_list_object(options, bucket, list_params, NULL);
+        if (!cos_status_is_ok(s)) {
+            s = cos_status_dup(parent_pool, s);
+            cos_pool_destroy(subpool);
+            options->pool = parent_pool;
+            return s;
+        }
+
+        // the objects and the common prefixes of a page are merged in the order of keys
+        object_node = list_params->object_list.next;
+        prefix_node = list_params->common_prefix_list.next;
+        while (object_node != &list_params->object_list || prefix_node != &list_params->common_prefix_list) {
+            content = (object_node == &list_params->object_list) ? NULL :
+                cos_list_entry(object_node, cos_list_object_content_t, node);
+            common_prefix = (prefix_node == &list_params->common_prefix_list) ? NULL :
+                cos_list_entry(prefix_node, cos_list_object_common_prefix_t, node);
+            if (NULL != common_prefix && (NULL == content || strcmp(common_prefix->prefix.data, content->key.data) < 0)) {
+                // a marker inside the common prefix is where its partition starts
+                partition = cos_create_list_partition(pool, common_prefix->prefix.data, 
+                    0 == strncmp(start_marker, common_prefix->prefix.data, common_prefix->prefix.len) ? start_marker : NULL, 
+                    NULL);
+                cos_list_add_tail(&partition->node, partition_list);
+                ready = NULL;
+                prefix_node = prefix_node->next;
+                continue;
+            }
+            object_node = object_node->next;
+            if (!params->sorted) {
+                if (0 != callback(user_data, content)) {
+                    s = cos_status_create(parent_pool);
+                    cos_status_set(s, COSE_CANCELLED, COS_CANCELLED_ERROR_CODE, "Stopped by list object callback");
+                    cos_pool_destroy(subpool);
+                    options->pool = parent_pool;
+                    return s;
+                }
+                continue;
+            }
+            // the objects between two common prefixes are kept to be emitted in their place
+            if (NULL == ready) {
+                ready = cos_create_list_partition(pool, prefix, NULL, NULL);
+                ready->done = COS_TRUE;
+                cos_list_add_tail(&ready->node, partition_list);
+            }
+            copy = cos_dup_list_object_content(pool, content);
+            cos_list_add_tail(&copy->node, &ready->object_list);
+        }
+
+        truncated = list_params->truncated && !cos_is_null_string(&list_params->next_marker);
+        if (truncated) {
+            marker = cos_pstrdup(pool, &list_params->next_marker);
+        }
+        cos_pool_destroy(subpool);
+        options->pool = parent_pool;
+    }
+
+    return NULL;
+}
+
+void cos_prepare_list_page(cos_transport_thread_params_t *params, cos_list_partition_t *partition, 
+                           const char *marker, int max_ret, cos_pool_t *pool)
+{
+    // the page is listed on a worker and emitted by the caller, so its pool is not a child of theirs,
+    // a cleared pool of an emitted page may be reused
+    params->list_pool = pool;
+    if (NULL == params->list_pool) {
+        cos_pool_create(&params->list_pool, NULL);
+    }
+    params->list_params = cos_create_list_object_params(params->list_pool);
+    cos_str_set(&params->list_params->prefix, partition->prefix.data);
+    cos_str_set(&params->list_params->marker, apr_pstrdup(params->list_pool, marker));
+    params->list_params->max_ret = max_ret;
+    params->result->s = NULL;
+    params->result->retries = 0;
+    params->result->retrying = COS_FALSE;
+}
+
+void * APR_THREAD_FUNC list_object_page(apr_thread_t *thd, void *data) 
+{
+    cos_status_t *s = NULL;
+    cos_transport_thread_params_t *params = NULL;
+    apr_time_t start;
+
+    params = (cos_transport_thread_params_t *)data;
+    if (cos_skip_part_task(params)) {
+        return NULL;
+    }
+
+    cos_init_part_task_options(params, params->list_pool);
+
+    params->result->throttled = COS_FALSE;
+    start = apr_time_now();
+    s = cos_list_object(&params->options, params->bucket, params->list_params, NULL);
+    params->result->elapsed = apr_time_now() - start;
+    if (!cos_status_is_ok(s)) {
+        if (cos_retry_part_task(params, s)) {
+            return s;
+        }
+        cos_fail_part_task(params, s);
+        return s;
+    }
+
+    // the status stays in the pool of the page, the pool of the listing does not grow with the pages
+    params->result->s = s;
+    apr_atomic_inc32(params->completed);
+    apr_queue_push(params->completed_parts, params->result);
+    return NULL;
+}
+
+char *cos_clip_list_page(cos_list_partition_t *partition, cos_list_object_params_t *page)
+{
+    cos_list_object_content_t *content = NULL;
+    cos_list_object_content_t *next = NULL;
+    char *last_key = NULL;
+    int clipped = COS_FALSE;
+
+    // the listing has no end, the keys after the end of the partition belong to the next one
+    cos_list_for_each_entry_safe(cos_list_object_content_t, content, next, &page->object_list, node) {
+        if (!cos_is_null_string(&partition->end_marker) && strcmp(content->key.data, partition->end_marker.data) > 0) {
+            cos_list_del(&content->node);
+            clipped = COS_TRUE;
+            continue;
+        }
+        last_key = content->key.data;
+    }
+
+    if (clipped || !page->truncated) {
+        return NULL;
+    }
+    if (NULL != last_key && !cos_is_null_string(&partition->end_marker) && 
+        0 == strcmp(last_key, partition->end_marker.data)) 
+    {
+        return NULL;
+    }
+    return cos_is_null_string(&page->next_marker) ? last_key : page->next_marker.data;
+}
+
+int cos_emit_list_objects(cos_list_t *object_list, cos_list_object_callback callback, void *user_data)
+{
+    cos_list_object_content_t *content = NULL;
+    int rv = 0;
+
+    cos_list_for_each_entry(cos_list_object_content_t, content, object_list, node) {
+        rv = callback(user_data, content);
+        if (0 != rv) {
+            break;
+        }
+    }
+    return rv;
+}
+
+int cos_emit_list_partition(cos_list_partition_t *partition, cos_list_object_callback callback, void *user_data)
+{
+    cos_list_object_page_t *page = NULL;
+    int rv = 0;
+
+    // the objects of the discovery come first, then the pages in the order they are listed
+    rv = cos_emit_list_objects(&partition->object_list, callback, user_data);
+    cos_list_init(&partition->object_list);
+    while (0 == rv && !cos_list_empty(&partition->page_list)) {
+        page = cos_list_entry(partition->page_list.next, cos_list_object_page_t, node);
+        cos_list_del(&page->node);
+        partition->pending--;
+        rv = cos_emit_list_objects(&page->params->object_list, callback, user_data);
+        cos_pool_destroy(page->pool);
+    }
+    return rv;
+}
+
+cos_status_t *cos_parallel_list_object(cos_request_options_t *options,
+                                       const cos_string_t *bucket,
+                                       cos_parallel_list_object_params_t *params,
+                                       cos_resumable_clt_params_t *clt_params,
+                                       cos_list_object_callback callback,
+                                       void *user_data)
+{
+    cos_pool_t *parent_pool = NULL;
+    cos_pool_t *partition_pool = NULL;
+    cos_pool_t *page_pool = NULL;
+    cos_status_t *s = NULL;
+    cos_status_t *ret = NULL;
+    cos_status_t *error = NULL;
+    cos_list_t partition_list;
+    cos_list_t *head_node;
+    cos_list_t *next_node;
+    cos_list_partition_t *partition = NULL;
+    cos_list_partition_t *head = NULL;
+    cos_list_partition_t **slot_partitions;
+    cos_list_object_params_t *page = NULL;
+    cos_list_object_page_t *pending_page = NULL;
+    cos_checkpoint_part_t *parts;
+    cos_part_task_result_t *results;
+    cos_part_task_result_t *task_res;
+    cos_transport_thread_params_t *thr_params;
+    cos_thread_pool_t *thrp;
+    cos_task_group_t group;
+    apr_uint32_t launched = 0;
+    apr_uint32_t failed = 0;
+    apr_uint32_t completed = 0;
+    apr_queue_t *failed_parts;
+    apr_queue_t *completed_parts;
+    char *next_marker;
+    int *free_slots;
+    int32_t thread_num = 0;
+    int free_num = 0;
+    int running = 0;
+    int slot;
+    int i = 0;
+    int rv;
+
+    // prepare
+    parent_pool = options->pool;
+    ret = cos_status_create(parent_pool);
+    thread_num = cos_get_thread_num(clt_params);
+
+    thrp = cos_get_thread_pool();
+    if (NULL == thrp) {
+        cos_status_set(ret, COSE_INTERNAL_ERROR, COS_CREATE_THREAD_POOL_ERROR_CODE, NULL); 
+        return ret;
+    }
+
+    rv = apr_queue_create(&failed_parts, thread_num, parent_pool);
+    if (APR_SUCCESS != rv) {
+        cos_status_set(ret, rv, COS_CREATE_QUEUE_ERROR_CODE, NULL); 
+        return ret;
+    }
+
+    rv = apr_queue_create(&completed_parts, thread_num, parent_pool);
+    if (APR_SUCCESS != rv) {
+        cos_status_set(ret, rv, COS_CREATE_QUEUE_ERROR_CODE, NULL); 
+        return ret;
+    }
+
+    // discover the partitions
+    cos_pool_create(&partition_pool, parent_pool);
+    cos_list_init(&partition_list);
+    s = cos_discover_list_partitions(options, bucket, params, callback, user_data, partition_pool, &partition_list);
+    if (NULL != s) {
+        cos_pool_destroy(partition_pool);
+        return s;
+    }
+
+    // one slot per thread, a slot lists the pages of a partition one after another
+    parts = (cos_checkpoint_part_t *)cos_pcalloc(parent_pool, sizeof(cos_checkpoint_part_t) * thread_num);
+    results = (cos_part_task_result_t *)cos_palloc(parent_pool, sizeof(cos_part_task_result_t) * thread_num);
+    thr_params = (cos_transport_thread_params_t *)cos_palloc(parent_pool, sizeof(cos_transport_thread_params_t) * thread_num);
+    slot_partitions = (cos_list_partition_t **)cos_pcalloc(parent_pool, sizeof(cos_list_partition_t *) * thread_num);
+    free_slots = (int *)cos_palloc(parent_pool, sizeof(int) * thread_num);
+    cos_build_thread_params(thr_params, thread_num, parent_pool, options, (cos_string_t *)bucket, NULL, NULL, NULL, parts, results);
+    cos_set_task_tracker(thr_params, thread_num, &launched, &failed, &completed, failed_parts, completed_parts);
+    for (i = 0; i < thread_num; i++) {
+        parts[i].index = i;
+        free_slots[free_num++] = thread_num - 1 - i;
+    }
+
+    // list the partitions, they are started in order so that the head of a sorted listing always progresses
+    head_node = partition_list.next;
+    next_node = partition_list.next;
+    cos_task_group_init(thrp, &group, cos_get_task_priority(clt_params), thread_num, COS_FALSE);
+    for (;;) {
+        if (NULL == error && cos_is_cancelled(options->cancel_token)) {
+            cos_status_set(ret, COSE_CANCELLED, COS_CANCELLED_ERROR_CODE, NULL);
+            error = ret;
+        }
+        while (NULL == error && 0 == apr_atomic_read32(&failed) && next_node != &partition_list && 
+               free_num > 0 && running < cos_task_group_limit(thrp, &group)) 
+        {
+            partition = cos_list_entry(next_node, cos_list_partition_t, node);
+            next_node = next_node->next;
+            if (partition->done) {
+                continue;
+            }
+            slot = free_slots[--free_num];
+            slot_partitions[slot] = partition;
+            cos_prepare_list_page(thr_params + slot, partition, partition->marker.data, params->max_ret, NULL);
+            cos_launch_part_task(thrp, &group, list_object_page, thr_params + slot);
+            running++;
+        }
+
+        // emit the partitions at the head, a partition parked ahead resumes once it is the head
+        head = NULL;
+        while (NULL == error && params->sorted && head_node != &partition_list) {
+            head = cos_list_entry(head_node, cos_list_partition_t, node);
+            if (0 != cos_emit_list_partition(head, callback, user_data)) {
+                cos_status_set(ret, COSE_CANCELLED, COS_CANCELLED_ERROR_CODE, "Stopped by list object callback");
+                error = ret;
+                cos_cancel(thr_params[0].options.cancel_token);
+                break;
+            }
+            if (head->parked) {
+                head->parked = COS_FALSE;
+                for (slot = 0; slot < thread_num && slot_partitions[slot] != head; slot++);
+                cos_launch_part_task(thrp, &group, list_object_page, thr_params + slot);
+                running++;
+            }
+            if (!head->done) {
+                break;
+            }
+            head_node = head_node->next;
+            head = NULL;
+        }
+
+        if (0 == running) {
+            break;
+        }
+
+        rv = cos_wait_part_task_result(thrp, &group, completed_parts, &task_res);
+        if (rv != APR_SUCCESS) {
+            break;
+        }
+        slot = (int)(task_res - results);
+        if (task_res->retrying && 0 == apr_atomic_read32(&failed)) {
+            // the page stays in flight, relaunch it after a backoff
+            cos_relaunch_part_task(thrp, &group, list_object_page, thr_params + slot);
+            continue;
+        }
+        running--;
+        partition = slot_partitions[slot];
+        page_pool = thr_params[slot].list_pool;
+        page = thr_params[slot].list_params;
+        thr_params[slot].list_pool = NULL;
+        if (NULL != error || NULL == task_res->s || !cos_status_is_ok(task_res->s)) {
+            cos_pool_destroy(page_pool);
+            free_slots[free_num++] = slot;
+            continue;
+        }
+
+        // emit the page, or keep it until the partitions before it are emitted
+        next_marker = cos_clip_list_page(partition, page);
+        if (!params->sorted || partition == head) {
+            if (0 != cos_emit_list_objects(&page->object_list, callback, user_data)) {
+                cos_status_set(ret, COSE_CANCELLED, COS_CANCELLED_ERROR_CODE, "Stopped by list object callback");
+                error = ret;
+                cos_cancel(thr_params[0].options.cancel_token);
+            }
+        } else {
+            pending_page = (cos_list_object_page_t *)cos_palloc(page_pool, sizeof(cos_list_object_page_t));
+            pending_page->pool = page_pool;
+            pending_page->params = page;
+            cos_list_add_tail(&pending_page->node, &partition->page_list);
+            partition->pending++;
+            page_pool = NULL;
+        }
+
+        // list the next page of the partition, a partition too far ahead of the head is parked
+        if (NULL == error && NULL != next_marker) {
+            cos_prepare_list_page(thr_params + slot, partition, next_marker, params->max_ret, NULL);
+            if (params->sorted && partition != head && partition->pending >= COS_LIST_MAX_PENDING_PAGES) {
+                partition->parked = COS_TRUE;
+            } else {
+                cos_launch_part_task(thrp, &group, list_object_page, thr_params + slot);
+                running++;
+            }
+        } else {
+            partition->done = COS_TRUE;
+            free_slots[free_num++] = slot;
+        }
+        if (NULL != page_pool) {
+            cos_pool_destroy(page_pool);
+        }
+    }
+    cos_task_group_destroy(thrp, &group);
+
+    // the pages left by a failed or stopped listing
+    for (i = 0; i < thread_num; i++) {
+        if (NULL != thr_params[i].list_pool) {
+            cos_pool_destroy(thr_params[i].list_pool);
+            thr_params[i].list_pool = NULL;
+        }
+    }
+    cos_list_for_each_entry(cos_list_partition_t, partition, &partition_list, node) {
+        while (!cos_list_empty(&partition->page_list)) {
+            pending_page = cos_list_entry(partition->page_list.next, cos_list_object_page_t, node);
+            cos_list_del(&pending_page->node);
+            cos_pool_destroy(pending_page->pool);
+        }
+    }
+    cos_pool_destroy(partition_pool);
+
+    if (NULL == error && apr_atomic_read32(&failed) > 0) {
+        error = cos_get_part_task_failure(parent_pool, failed_parts);
+    }
+    cos_destroy_thread_pool(thr_params, thread_num);
+    if (NULL != error) {
+        return error;
+    }
+
+    ret->code = 200;
+    return ret;
+}
+
+void cos_prefetch_list_iter_page(cos_list_iter_t *iter, const char *marker)
+{
+    // the page before is done with, its pool is reused so that two pages are kept whatever the length
+    cos_prepare_list_page(&iter->thr_params, iter->partition, marker, iter->max_ret, iter->spare_pool);
+    iter->spare_pool = NULL;
+    if (!cos_is_null_string(&iter->delimiter)) {
+        cos_str_set(&iter->thr_params.list_params->delimiter, iter->delimiter.data);
+    }
+    if (!cos_is_null_string(&iter->encoding_type)) {
+        cos_str_set(&iter->thr_params.list_params->encoding_type, iter->encoding_type.data);
+    }
+    iter->prefetching = COS_TRUE;
+    cos_launch_part_task(iter->thrp, &iter->group, list_object_page, &iter->thr_params);
+}
+
+cos_status_t *cos_list_iter_create(cos_request_options_t *options,
+                                   const cos_string_t *bucket,
+                                   cos_list_object_params_t *params,
+                                   cos_list_iter_t **iter)
+{
+    cos_pool_t *pool = NULL;
+    cos_status_t *s = NULL;
+    cos_list_iter_t *it = NULL;
+    cos_thread_pool_t *thrp;
+    int rv;
+
+    s = cos_status_create(options->pool);
+    *iter = NULL;
+    thrp = cos_get_thread_pool();
+    if (NULL == thrp) {
+        cos_status_set(s, COSE_INTERNAL_ERROR, COS_CREATE_THREAD_POOL_ERROR_CODE, NULL); 
+        return s;
+    }
+
+    cos_pool_create(&pool, options->pool);
+    it = (cos_list_iter_t *)cos_pcalloc(pool, sizeof(cos_list_iter_t));
+    it->pool = pool;
+    it->options = options;
+    it->thrp = thrp;
+    cos_str_set(&it->bucket, cos_pstrdup(pool, bucket));
+    cos_str_set(&it->delimiter, apr_pstrdup(pool, NULL == params->delimiter.data ? "" : params->delimiter.data));
+    cos_str_set(&it->encoding_type, apr_pstrdup(pool, NULL == params->encoding_type.data ? "" : params->encoding_type.data));
+    it->max_ret = params->max_ret;
+    it->partition = cos_create_list_partition(pool, params->prefix.data, params->marker.data, NULL);
+    it->status = cos_status_create(pool);
+    it->status->code = 200;
+
+    rv = apr_queue_create(&it->failed_parts, 1, pool);
+    if (APR_SUCCESS == rv) {
+        rv = apr_queue_create(&it->completed_parts, 1, pool);
+    }
+    if (APR_SUCCESS != rv) {
+        cos_status_set(s, rv, COS_CREATE_QUEUE_ERROR_CODE, NULL); 
+        cos_pool_destroy(pool);
+        return s;
+    }
+
+    // the first page is listed in the background as well, the caller may prepare meanwhile
+    cos_build_thread_params(&it->thr_params, 1, pool, options, &it->bucket, NULL, NULL, NULL, &it->part, &it->result);
+    cos_set_task_tracker(&it->thr_params, 1, &it->launched, &it->failed, &it->completed, 
+        it->failed_parts, it->completed_parts);
+    cos_task_group_init(thrp, &it->group, cos_get_task_priority(NULL), 1, COS_FALSE);
+    cos_prefetch_list_iter_page(it, it->partition->marker.data);
+
+    *iter = it;
+    s->code = 200;
+    return s;
+}
+
+cos_status_t *cos_list_iter_next(cos_list_iter_t *iter, cos_list_object_content_t **content)
+{
+    cos_part_task_result_t *task_res = NULL;
+    char *next_marker = NULL;
+    int rv;
+
+    *content = NULL;
+    for (;;) {
+        if (NULL != iter->page && iter->cur != &iter->page->object_list) {
+            *content = cos_list_entry(iter->cur, cos_list_object_content_t, node);
+            iter->cur = iter->cur->next;
+            return iter->status;
+        }
+        if (!iter->prefetching) {
+            // the end of the listing, or the failure of it
+            return iter->status;
+        }
+
+        // wait for the page listed while the page before is iterated
+        rv = cos_wait_part_task_result(iter->thrp, &iter->group, iter->completed_parts, &task_res);
+        if (rv != APR_SUCCESS) {
+            iter->status = cos_status_create(iter->pool);
+            cos_status_set(iter->status, rv, COS_UNKNOWN_ERROR_CODE, NULL);
+            return iter->status;
+        }
+        if (task_res->retrying && 0 == apr_atomic_read32(&iter->failed)) {
+            cos_relaunch_part_task(iter->thrp, &iter->group, list_object_page, &iter->thr_params);
+            continue;
+        }
+        iter->prefetching = COS_FALSE;
+        if (NULL == task_res->s || !cos_status_is_ok(task_res->s)) {
+            iter->status = cos_get_part_task_failure(iter->pool, iter->failed_parts);
+            cos_pool_destroy(iter->thr_params.list_pool);
+            iter->thr_params.list_pool = NULL;
+            return iter->status;
+        }
+
+        // the objects of the page before are no longer valid, the next page is listed at once
+        if (NULL != iter->page_pool) {
+            apr_pool_clear(iter->page_pool);
+            iter->spare_pool = iter->page_pool;
+        }
+        iter->page_pool = iter->thr_params.list_pool;
+        iter->page = iter->thr_params.list_params;
+        iter->thr_params.list_pool = NULL;
+        iter->cur = iter->page->object_list.next;
+        next_marker = cos_clip_list_page(iter->partition, iter->page);
+        if (NULL != next_marker) {
+            cos_prefetch_list_iter_page(iter, next_marker);
+        }
+    }
+}
+
+void cos_list_iter_destroy(cos_list_iter_t *iter)
+{
+    cos_part_task_result_t *task_res = NULL;
+
+    // the page in flight refers to the iterator, abort it and wait until its task exits
+    if (iter->prefetching) {
+        cos_cancel(iter->thr_params.options.cancel_token);
+        while (APR_SUCCESS == cos_wait_part_task_result(iter->thrp, &iter->group, iter->completed_parts, &task_res) && 
+               task_res->retrying) 
+        {
+            cos_relaunch_part_task(iter->thrp, &iter->group, list_object_page, &iter->thr_params);
+        }
+        iter->prefetching = COS_FALSE;
+    }
+
+    if (NULL != iter->thr_params.list_pool) {
+        cos_pool_destroy(iter->thr_params.list_pool);
+    }
+    if (NULL != iter->page_pool) {
+        cos_pool_destroy(iter->page_pool);
+    }
+    if (NULL != iter->spare_pool) {
+        cos_pool_destroy(iter->spare_pool);
+    }
+    cos_task_group_destroy(iter->thrp, &iter->group);
+    cos_destroy_thread_pool(&iter->thr_params, 1);
+    cos_pool_destroy(iter->pool);
+}
+
+int cos_fill_delete_objects_batch(cos_list_iter_t *iter, cos_pool_t *pool, cos_list_t *key_list, 
+                                  cos_status_t **error)
+{
+    cos_status_t *s = NULL;
+    cos_list_object_content_t *content = NULL;
+    cos_object_key_t *object_key = NULL;
+    int count = 0;
+
+    // the listed page is reused by the iterator, the keys are copied to the pool of the batch
+    cos_list_init(key_list);
+    while (count < COS_PER_RET_NUM) {
+        s = cos_list_iter_next(iter, &content);
+        if (!cos_status_is_ok(s)) {
+            *error = s;
+            break;
+        }
+        if (NULL == content) {
+            break;
+        }
+        object_key = cos_create_cos_object_key(pool);
+        cos_str_set(&object_key->key, cos_pstrdup(pool, &content->key));
+        cos_list_add_tail(&object_key->node, key_list);
+        count++;
+    }
+    return count;
+}
+
+void * APR_THREAD_FUNC delete_objects_batch(apr_thread_t *thd, void *data) 
+{
+    cos_status_t *s = NULL;
+    cos_transport_thread_params_t *params = NULL;
+    cos_list_t failed_list;
+    apr_time_t start;
+
+    params = (cos_transport_thread_params_t *)data;
+    if (cos_skip_part_task(params)) {
+        return NULL;
+    }
+
+    // the request is in the pool of the batch, which is cleared when the slot is reused
+    cos_init_part_task_options(params, params->list_pool);
+
+    cos_list_init(&failed_list);
+    params->result->throttled = COS_FALSE;
+    start = apr_time_now();
+    s = cos_do_delete_objects_quiet(&params->options, params->bucket, &params->key_list, NULL, NULL, &failed_list);
+    params->result->elapsed = apr_time_now() - start;
+    if (!cos_status_is_ok(s)) {
+        if (cos_retry_part_task(params, s)) {
+            return s;
+        }
+        cos_fail_part_task(params, s);
+        return s;
+    }
+
+    // the keys failed in the batch are deleted again after a backoff, the others are not resent
+    if (!cos_list_empty(&failed_list)) {
+        cos_list_movelist(&failed_list, &params->key_list);
+        if (params->result->retries < COS_PART_MAX_RETRY && !cos_is_cancelled(params->options.cancel_token)) {
+            params->result->retries++;
+            params->result->retrying = COS_TRUE;
+            params->result->retry_at = apr_time_now() + cos_min(COS_PART_RETRY_BACKOFF << 
+                (params->result->retries - 1), COS_PART_MAX_RETRY_BACKOFF);
+            apr_queue_push(params->completed_parts, params->result);
+            return s;
+        }
+        cos_error_log("Delete objects fail, batch:%d, the first failed key:%s\n", params->part->index + 1, 
+            (cos_list_entry(params->key_list.next, cos_object_key_t, node))->key.data);
+        cos_status_set(s, COSE_SERVICE_ERROR, COS_UNKNOWN_ERROR_CODE, "Delete objects fail");
+        cos_fail_part_task(params, s);
+        return s;
+    }
+
+    params->result->s = s;
+    apr_atomic_inc32(params->completed);
+    apr_queue_push(params->completed_parts, params->result);
+    return NULL;
+}
+
+cos_status_t *cos_parallel_delete_objects_by_prefix(cos_request_options_t *options,
+                                                    const cos_string_t *bucket, 
+                                                    const cos_string_t *prefix,
+                                                    cos_resumable_clt_params_t *clt_params)
+{
+    cos_pool_t *parent_pool = NULL;
+    cos_status_t *s = NULL;
+    cos_status_t *ret = NULL;
+    cos_status_t *error = NULL;
+    cos_status_t *last = NULL;
+    cos_list_object_params_t *list_params = NULL;
+    cos_list_iter_t *iter = NULL;
+    cos_checkpoint_part_t *parts;
+    cos_part_task_result_t *results;
+    cos_part_task_result_t *task_res;
+    cos_transport_thread_params_t *thr_params;
+    cos_thread_pool_t *thrp;
+    cos_task_group_t group;
+    apr_uint32_t launched = 0;
+    apr_uint32_t failed = 0;
+    apr_uint32_t completed = 0;
+    apr_queue_t *failed_parts;
+    apr_queue_t *completed_parts;
+    cos_string_t bucket_name;
+    int *free_slots;
+    int32_t thread_num = 0;
+    int free_num = 0;
+    int running = 0;
+    int batch_num = 0;
+    int last_index = -1;
+    int count = 0;
+    int eof = COS_FALSE;
+    int slot;
+    int i = 0;
+    int rv;
+
+    // prepare, the memory is COS_PER_RET_NUM keys * thread_num whatever the number of objects
+    parent_pool = options->pool;
+    ret = cos_status_create(parent_pool);
+    thread_num = cos_get_thread_num(clt_params);
+
+    thrp = cos_get_thread_pool();
+    if (NULL == thrp) {
+        cos_status_set(ret, COSE_INTERNAL_ERROR, COS_CREATE_THREAD_POOL_ERROR_CODE, NULL); 
+        return ret;
+    }
+
+    rv = apr_queue_create(&failed_parts, thread_num, parent_pool);
+    if (APR_SUCCESS != rv) {
+        cos_status_set(ret, rv, COS_CREATE_QUEUE_ERROR_CODE, NULL); 
+        return ret;
+    }
+
+    rv = apr_queue_create(&completed_parts, thread_num, parent_pool);
+    if (APR_SUCCESS != rv) {
+        cos_status_set(ret, rv, COS_CREATE_QUEUE_ERROR_CODE, NULL); 
+        return ret;
+    }
+
+    // the next page of keys is listed in the background while the batches are deleted
+    list_params = cos_create_list_object_params(parent_pool);
+    if (NULL != prefix->data) {
+        cos_str_set(&list_params->prefix, cos_pstrdup(parent_pool, prefix));
+    }
+    s = cos_list_iter_create(options, bucket, list_params, &iter);
+    if (!cos_status_is_ok(s)) {
+        return s;
+    }
+
+    // one slot per thread, the pool of a slot is cleared and reused by the next batch
+    cos_str_set(&bucket_name, cos_pstrdup(parent_pool, bucket));
+    parts = (cos_checkpoint_part_t *)cos_pcalloc(parent_pool, sizeof(cos_checkpoint_part_t) * thread_num);
+    results = (cos_part_task_result_t *)cos_palloc(parent_pool, sizeof(cos_part_task_result_t) * thread_num);
+    thr_params = (cos_transport_thread_params_t *)cos_palloc(parent_pool, sizeof(cos_transport_thread_params_t) * thread_num);
+    free_slots = (int *)cos_palloc(parent_pool, sizeof(int) * thread_num);
+    cos_build_thread_params(thr_params, thread_num, parent_pool, options, &bucket_name, NULL, NULL, NULL, parts, results);
+    cos_set_task_tracker(thr_params, thread_num, &launched, &failed, &completed, failed_parts, completed_parts);
+    for (i = 0; i < thread_num; i++) {
+        // the batch is deleted on a worker and refilled by the caller, so its pool is not a child of theirs
+        cos_pool_create(&thr_params[i].list_pool, NULL);
+        free_slots[free_num++] = thread_num - 1 - i;
+    }
+
+    // delete batches while the next one is filled from the listing
+    cos_task_group_init(thrp, &group, cos_get_task_priority(clt_params), thread_num, cos_is_auto_tune(clt_params));
+    for (;;) {
+        if (NULL == error && cos_is_cancelled(options->cancel_token)) {
+            cos_status_set(ret, COSE_CANCELLED, COS_CANCELLED_ERROR_CODE, NULL);
+            error = ret;
+        }
+        if (!eof && NULL == error && 0 == apr_atomic_read32(&failed) && 
+            free_num > 0 && running < cos_task_group_limit(thrp, &group)) 
+        {
+            slot = free_slots[--free_num];
+            apr_pool_clear(thr_params[slot].list_pool);
+            s = NULL;
+            count = cos_fill_delete_objects_batch(iter, thr_params[slot].list_pool, &thr_params[slot].key_list, &s);
+            if (count < COS_PER_RET_NUM) {
+                eof = COS_TRUE;
+            }
+            if (NULL != s) {
+                error = cos_status_dup(parent_pool, s);
+                cos_cancel(thr_params[0].options.cancel_token);
+                free_slots[free_num++] = slot;
+                continue;
+            }
+            if (0 == count) {
+                free_slots[free_num++] = slot;
+                continue;
+            }
+
+            results[slot].s = NULL;
+            results[slot].retries = 0;
+            results[slot].retrying = COS_FALSE;
+            parts[slot].index = batch_num;
+            parts[slot].size = count;
+            batch_num++;
+            cos_launch_part_task(thrp, &group, delete_objects_batch, thr_params + slot);
+            running++;
+            continue;
+        }
+
+        if (0 == running) {
+            break;
+        }
+
+        // wait for a batch to free its slot
+        rv = cos_wait_part_task_result(thrp, &group, completed_parts, &task_res);
+        if (rv != APR_SUCCESS) {
+            break;
+        }
+        slot = (int)(task_res - results);
+        if (task_res->retrying && 0 == apr_atomic_read32(&failed)) {
+            // the batch stays in flight, relaunch it after a backoff, the window is halved if it is throttled
+            if (task_res->throttled) {
+                cos_task_group_feedback(thrp, &group, 0, task_res->elapsed, COS_TRUE);
+            }
+            cos_relaunch_part_task(thrp, &group, delete_objects_batch, thr_params + slot);
+            continue;
+        }
+        running--;
+        // the status of the last batch is returned as the delete of one thread does,
+        // it is in the pool of the slot which is cleared when the slot is reused
+        if (NULL != task_res->s && cos_status_is_ok(task_res->s) && parts[slot].index > last_index) {
+            last_index = parts[slot].index;
+            last = cos_status_dup(parent_pool, task_res->s);
+            last->req_id = apr_pstrdup(parent_pool, task_res->s->req_id);
+        }
+        free_slots[free_num++] = slot;
+    }
+    cos_task_group_destroy(thrp, &group);
+    cos_list_iter_destroy(iter);
+    for (i = 0; i < thread_num; i++) {
+        cos_pool_destroy(thr_params[i].list_pool);
+        thr_params[i].list_pool = NULL;
+    }
+
+    if (NULL == error && apr_atomic_read32(&failed) > 0) {
+        error = cos_get_part_task_failure(parent_pool, failed_parts);
+    }
+    cos_destroy_thread_pool(thr_params, thread_num);
+    if (NULL != error) {
+        return error;
+    }
+    if (NULL != last) {
+        return last;
+    }
+
+    // no object has the prefix
+    ret->code = 200;
+    return ret;
+}
@@ -5,11 +5,20 @@
 #include "apr_atomic.h"
 #include "apr_queue.h"
 #include "apr_thread_pool.h"
+#include "cos_thread_pool.h"
 
 COS_CPP_START
 
 #define COS_CP_UPLOAD   1
 #define COS_CP_DOWNLOAD 2
+#define COS_CP_COPY     3
+
+#define COS_CP_JOURNAL_MAGIC      "COSCPJ1\n" // the magic of the checkpoint journal, the old checkpoint is xml
+#define COS_CP_JOURNAL_MAGIC_LEN  8
+#define COS_CP_JOURNAL_ETAG_LEN   64  // the etag longer than it is folded into the journal header
+#define COS_CP_JOURNAL_SYNC_PARTS 16  // the records appended between two syncs of the journal
+#define COS_CP_JOURNAL_HEADER_LEN (COS_CP_JOURNAL_MAGIC_LEN + 16)   // magic, xml length, xml crc64
+#define COS_CP_JOURNAL_RECORD_LEN (8 + COS_CP_JOURNAL_ETAG_LEN + 8) // index, etag length, etag, crc64
 
 typedef struct {
     int32_t index;  // the index of part, start from 0
@@ -39,37 +48,137 @@ typedef struct {
     int  part_num;                 // the total number of parts
     int64_t part_size;             // the part size, byte
     cos_checkpoint_part_t *parts;  // the parts of local or object, from 0
+
+    int unsynced;  // the part records appended to the journal since the last sync
 } cos_checkpoint_t;
 
+/*
+ * the journal is the header followed by one record per completed part,
+ * header: magic, xml length u64, xml crc64 u64, xml of the checkpoint when it is dumped
+ * record: index u32, etag length u32, etag padded with zero, crc64 u64 of the bytes before it
+ * the integers are written little endian, so the journal is read the same on any host
+ */
+typedef struct {
+    int32_t index;     // the index of the completed part
+    int32_t etag_len;  // the length of etag
+    char etag[COS_CP_JOURNAL_ETAG_LEN];
+    uint64_t crc64;    // the crc64 of the encoded fields above, a torn record at the tail is dropped
+} cos_checkpoint_record_t;
+
 typedef struct {
     cos_checkpoint_part_t *part;
     cos_status_t *s;
     cos_string_t etag; 
+    apr_time_t elapsed;  // the time to transfer the part, usec
+    int retries;         // the number of relaunches after the part fails
+    int retrying;        // COS_TRUE if the part fails and is to be relaunched after a backoff
+    apr_time_t retry_at; // the time the retrying part is relaunched by the coordinator
+    int throttled;       // COS_TRUE if the part is throttled, the window is halved for auto_tune
+    int has_crc64;       // COS_TRUE if the crc64 of the part is returned by the server
+    uint64_t crc64;      // the crc64 of the part, combined to verify the completed object
 } cos_part_task_result_t;
 
 typedef struct {
-    cos_request_options_t options;
+    cos_request_options_t options; // the options of the running request, the pool and ctl are set on the worker
+    cos_pool_t *result_pool;       // the status and etag of the part are copied to it, only the workers allocate from it
+    apr_thread_mutex_t *result_mutex; // the lock of result_pool, shared by all parts of the transfer
     cos_string_t *bucket;
     cos_string_t *object; 
     cos_string_t *upload_id;
     cos_string_t *filepath;
+    apr_file_t *file;              // the local file shared by the parts, read or written by positional io
+    int fadvise;                   // COS_TRUE to read the part sequentially and drop it from the page cache after upload
+    int readahead;                 // COS_TRUE to read the next range of the file ahead while the part is sent
+    int direct_io;                 // COS_TRUE if the file is opened with O_DIRECT
+    cos_string_t *copy_source;     // the source object of the parts, for resumable copy
+    const char *copy_source_etag;  // the part fails if the source no longer matches it, for resumable copy
+    const char *object_etag;       // the part fails if the object no longer matches it, for resumable download
     cos_checkpoint_part_t *part;
     cos_part_task_result_t *result;
+    cos_task_group_t *group;       // the task group of the transfer, set when the task is launched
+    cos_list_t retry_node;         // in the delayed list of the group while the part backs off
+    apr_thread_start_t retry_func; // the task the part is relaunched with after the backoff
+    char *buffer;                  // the content of part, for stream upload
+    cos_list_t *buffer_list;       // the content of object, the part is sent from a view of it, for buffer upload
+    cos_list_t content;            // the content of part, for stream download
+    cos_pool_t *list_pool;         // the pool of the listed page, kept until the page is emitted, for parallel list
+    cos_list_object_params_t *list_params; // the page of the partition, for parallel list
+    cos_list_t key_list;           // the keys of the batch, in list_pool, for parallel delete
 
     apr_uint32_t *launched;        // the number of launched part tasks, use atomic
     apr_uint32_t *failed;          // the number of failed part tasks, use atomic
     apr_uint32_t *completed;       // the number of completed part tasks, use atomic
     apr_queue_t  *failed_parts;    // the queue of failed parts tasks, thread safe
-    apr_queue_t  *completed_parts; // the queue of completed parts tasks, thread safe
+    apr_queue_t  *completed_parts; // the queue of finished parts tasks, one result per task, thread safe
+                                   // result->s is NULL for skipped, failure status for failed parts
 } cos_upload_thread_params_t;
 
 typedef cos_upload_thread_params_t cos_transport_thread_params_t;
 
+typedef struct {
+    cos_list_t node;
+    cos_pool_t *pool;              // the pool the page is listed in, destroyed once the page is emitted
+    cos_list_object_params_t *params;
+} cos_list_object_page_t;
+
+typedef struct {
+    cos_list_t node;
+    cos_string_t prefix;           // the keys of the partition
+    cos_string_t marker;           // the partition starts after it
+    cos_string_t end_marker;       // the last key of the partition, empty for the end of prefix
+    cos_list_t object_list;        // the objects listed by the discovery, for sorted listing
+    cos_list_t page_list;          // the pages listed ahead of the emitted one, for sorted listing
+    int pending;                   // the number of pages in page_list
+    int parked;                    // COS_TRUE if the next page waits until the partition is emitted
+    int done;                      // COS_TRUE if the partition is listed to the end
+} cos_list_partition_t;
+
+struct cos_list_iter_s {
+    cos_pool_t *pool;              // the pool of the iterator, a child of the pool of options
+    cos_request_options_t *options;
+    cos_string_t bucket;
+    cos_string_t delimiter;
+    cos_string_t encoding_type;
+    int max_ret;
+    cos_list_partition_t *partition; // the prefix and the start of the listing
+    cos_status_t *status;          // the status of the listing, returned by next
+    cos_thread_pool_t *thrp;
+    cos_task_group_t group;
+    cos_transport_thread_params_t thr_params; // the task listing the next page
+    cos_checkpoint_part_t part;
+    cos_part_task_result_t result;
+    apr_uint32_t launched;
+    apr_uint32_t failed;
+    apr_uint32_t completed;
+    apr_queue_t *failed_parts;
+    apr_queue_t *completed_parts;
+    cos_pool_t *page_pool;         // the pool of the page iterated
+    cos_pool_t *spare_pool;        // the pool of the page before, cleared to be reused by the next page
+    cos_list_object_params_t *page;
+    cos_list_t *cur;               // the next object of the page
+    int prefetching;               // COS_TRUE if the next page is in flight
+};
+
 int32_t cos_get_thread_num(cos_resumable_clt_params_t *clt_params);
 
+int64_t cos_get_resumable_part_size(cos_resumable_clt_params_t *clt_params);
+
+int cos_get_task_priority(cos_resumable_clt_params_t *clt_params);
+
+int cos_is_auto_tune(cos_resumable_clt_params_t *clt_params);
+
+int64_t cos_get_auto_tune_part_size(int64_t file_size, int32_t thread_num);
+
 void cos_get_checkpoint_path(cos_resumable_clt_params_t *clt_params, const cos_string_t *filepath, 
                              cos_pool_t *pool, cos_string_t *checkpoint_path);
 
+void cos_get_copy_checkpoint_path(cos_resumable_clt_params_t *clt_params, const cos_string_t *copy_source, 
+                                  const cos_string_t *bucket, const cos_string_t *object, 
+                                  cos_pool_t *pool, cos_string_t *checkpoint_path);
+
+void cos_get_download_checkpoint_path(cos_resumable_clt_params_t *clt_params, const cos_string_t *filepath, 
+                                      cos_pool_t *pool, cos_string_t *checkpoint_path);
+
 int cos_get_file_info(const cos_string_t *filepath, cos_pool_t *pool, apr_finfo_t *finfo);
 
 int cos_does_file_exist(const cos_string_t *filepath, cos_pool_t *pool); 
@@ -90,23 +199,87 @@ void cos_build_thread_params(cos_transport_thread_params_t *thr_params, int part
 
 void cos_destroy_thread_pool(cos_transport_thread_params_t *thr_params, int part_num);
 
+void cos_set_part_file(cos_transport_thread_params_t *thr_params, int part_num, apr_file_t *file);
+
+int cos_open_part_file_for_read(cos_pool_t *p, cos_string_t *filepath, cos_resumable_clt_params_t *clt_params,
+                                cos_transport_thread_params_t *thr_params, int part_num, apr_file_t **file);
+
+void cos_advise_part_file(cos_transport_thread_params_t *params, int64_t offset, int64_t len, cos_file_advice_e advice);
+
+void cos_preallocate_part_file(cos_resumable_clt_params_t *clt_params, apr_file_t *file, int64_t file_size);
+
+void cos_init_part_task_options(cos_transport_thread_params_t *params, cos_pool_t *pool);
+
+void cos_set_part_task_result(cos_transport_thread_params_t *params, cos_status_t *s, const char *etag);
+
+int cos_skip_part_task(cos_transport_thread_params_t *params);
+
+void cos_fail_part_task(cos_transport_thread_params_t *params, cos_status_t *s);
+
+int cos_should_abort_upload(cos_request_options_t *options);
+
+void cos_abort_resumable_upload(cos_request_options_t *options, cos_string_t *bucket, 
+                                cos_string_t *object, cos_string_t *upload_id);
+
 void cos_set_task_tracker(cos_transport_thread_params_t *thr_params, int part_num, 
                           apr_uint32_t *launched, apr_uint32_t *failed, apr_uint32_t *completed,
                           apr_queue_t *failed_parts, apr_queue_t *completed_parts);
 
+int cos_launch_part_task(cos_thread_pool_t *thrp, cos_task_group_t *group, apr_thread_start_t func, 
+                         cos_transport_thread_params_t *params);
+
+int cos_retry_part_task(cos_transport_thread_params_t *params, cos_status_t *s);
+
+int cos_relaunch_part_task(cos_thread_pool_t *thrp, cos_task_group_t *group, apr_thread_start_t func, 
+                           cos_transport_thread_params_t *params);
+
+cos_status_t *cos_get_part_task_failure(cos_pool_t *pool, apr_queue_t *failed_parts);
+
+int cos_launch_part_tasks(cos_thread_pool_t *thrp, cos_task_group_t *group, apr_thread_start_t func, 
+                          cos_transport_thread_params_t *thr_params, int part_num, int pushed, int finished);
+
+void cos_build_part_buffer(cos_pool_t *pool, cos_list_t *buffer_list, int64_t offset, int64_t size, 
+                           cos_list_t *content);
+
+uint64_t cos_combine_part_crc64(cos_part_task_result_t *results, int part_num, int *has_crc64);
+
+int cos_wait_part_task_result(cos_thread_pool_t *thrp, cos_task_group_t *group, 
+                              apr_queue_t *completed_parts, cos_part_task_result_t **task_res);
+
 int cos_verify_checkpoint_md5(cos_pool_t *pool, const cos_checkpoint_t *checkpoint);
 
 void cos_build_upload_checkpoint(cos_pool_t *pool, cos_checkpoint_t *checkpoint, cos_string_t *file_path, 
                                  apr_finfo_t *finfo, cos_string_t *upload_id, int64_t part_size);
 
+void cos_build_download_checkpoint(cos_pool_t *pool, cos_checkpoint_t *checkpoint, cos_string_t *file_path, 
+                                   const char *object_name, int64_t object_size, const char *object_last_modified,
+                                   const char *object_etag, int64_t part_size);
+
+void cos_build_copy_checkpoint(cos_pool_t *pool, cos_checkpoint_t *checkpoint, cos_string_t *dest_path, 
+                               const char *copy_source, int64_t object_size, const char *object_last_modified,
+                               const char *object_etag, cos_string_t *upload_id, int64_t part_size);
+
 int cos_dump_checkpoint(cos_pool_t *pool, const cos_checkpoint_t *checkpoint);
 
 int cos_load_checkpoint(cos_pool_t *pool, const cos_string_t *filepath, cos_checkpoint_t *checkpoint);
 
+int cos_load_checkpoint_journal(cos_pool_t *pool, const char *body, apr_size_t len, cos_checkpoint_t *checkpoint);
+
 int cos_is_upload_checkpoint_valid(cos_pool_t *pool, cos_checkpoint_t *checkpoint, apr_finfo_t *finfo);
 
+int cos_is_download_checkpoint_valid(cos_pool_t *pool, cos_checkpoint_t *checkpoint, const char *object_name,
+                                     int64_t object_size, const char *object_last_modified, const char *object_etag);
+
+int cos_is_copy_checkpoint_valid(cos_pool_t *pool, cos_checkpoint_t *checkpoint, cos_string_t *dest_path,
+                                 const char *copy_source, int64_t object_size, const char *object_last_modified,
+                                 const char *object_etag);
+
 void cos_update_checkpoint(cos_pool_t *pool, cos_checkpoint_t *checkpoint, int32_t part_index, cos_string_t *etag);
 
+int cos_append_checkpoint(cos_pool_t *pool, cos_checkpoint_t *checkpoint, int32_t part_index, cos_string_t *etag);
+
+int cos_close_checkpoint_file(cos_checkpoint_t *checkpoint);
+
 void cos_get_checkpoint_undo_parts(cos_checkpoint_t *checkpoint, int *part_num, cos_checkpoint_part_t *parts);
 
 void * APR_THREAD_FUNC upload_part(apr_thread_t *thd, void *data);
@@ -124,6 +297,22 @@ cos_status_t *cos_resumable_upload_file_without_cp(cos_request_options_t *option
                                                    cos_table_t **resp_headers,
                                                    cos_list_t *resp_body);
 
+/**
+  * @brief the _ex variants take all options of the transfer from clt_params,
+  *        the ones taking thread_num and part_size are kept for compatibility
+**/
+cos_status_t *cos_resumable_upload_file_without_cp_ex(cos_request_options_t *options,
+                                                      cos_string_t *bucket, 
+                                                      cos_string_t *object, 
+                                                      cos_string_t *filepath,                           
+                                                      cos_table_t *headers,
+                                                      cos_table_t *params,
+                                                      cos_resumable_clt_params_t *clt_params,
+                                                      apr_finfo_t *finfo,
+                                                      cos_progress_callback progress_callback,
+                                                      cos_table_t **resp_headers,
+                                                      cos_list_t *resp_body);
+
 cos_status_t *cos_resumable_upload_file_with_cp(cos_request_options_t *options,
                                                 cos_string_t *bucket, 
                                                 cos_string_t *object, 
@@ -138,6 +327,25 @@ cos_status_t *cos_resumable_upload_file_with_cp(cos_request_options_t *options,
                                                 cos_table_t **resp_headers,
                                                 cos_list_t *resp_body);
 
+cos_status_t *cos_resumable_upload_file_with_cp_ex(cos_request_options_t *options,
+                                                   cos_string_t *bucket, 
+                                                   cos_string_t *object, 
+                                                   cos_string_t *filepath,                           
+                                                   cos_table_t *headers,
+                                                   cos_table_t *params,
+                                                   cos_resumable_clt_params_t *clt_params,
+                                                   cos_string_t *checkpoint_path,
+                                                   apr_finfo_t *finfo,
+                                                   cos_progress_callback progress_callback,
+                                                   cos_table_t **resp_headers,
+                                                   cos_list_t *resp_body);
+
+void * APR_THREAD_FUNC upload_part_from_buffer(apr_thread_t *thd, void *data);
+
+int64_t cos_read_stream_part(cos_read_stream_callback read_callback, void *user_data, char *buffer, int64_t size);
+
+void * APR_THREAD_FUNC upload_part_from_buffer_list(apr_thread_t *thd, void *data);
+
 void * APR_THREAD_FUNC download_part(apr_thread_t *thd, void *data);
 
 int64_t cos_get_safe_size_for_download(int64_t part_size);
@@ -152,7 +360,81 @@ cos_status_t *cos_resumable_download_file_without_cp(cos_request_options_t *opti
                                                    int64_t part_size,
                                                    cos_progress_callback progress_callback);
 
+cos_status_t *cos_resumable_download_file_without_cp_ex(cos_request_options_t *options,
+                                                      cos_string_t *bucket, 
+                                                      cos_string_t *object, 
+                                                      cos_string_t *filepath,                           
+                                                      cos_table_t *headers,
+                                                      cos_table_t *params,
+                                                      cos_resumable_clt_params_t *clt_params,
+                                                      cos_progress_callback progress_callback);
+
+void * APR_THREAD_FUNC download_part_to_buffer(apr_thread_t *thd, void *data);
+
+int cos_write_stream_part(cos_write_stream_callback write_callback, void *user_data, cos_list_t *content);
+
+cos_status_t *cos_resumable_download_file_with_cp(cos_request_options_t *options,
+                                                  cos_string_t *bucket, 
+                                                  cos_string_t *object, 
+                                                  cos_string_t *filepath,                           
+                                                  cos_table_t *headers,
+                                                  cos_table_t *params,
+                                                  cos_resumable_clt_params_t *clt_params,
+                                                  cos_string_t *checkpoint_path,
+                                                  cos_progress_callback progress_callback);
+
+void cos_set_part_copy_source(cos_transport_thread_params_t *thr_params, int part_num, 
+                              cos_string_t *copy_source, const char *copy_source_etag);
+
+cos_status_t *cos_head_copy_source(cos_request_options_t *options, 
+                                   cos_string_t *copy_source,
+                                   int64_t *object_size,
+                                   char **object_etag,
+                                   char **object_last_modified);
+
+int64_t cos_get_copy_part_size(cos_resumable_clt_params_t *clt_params, int64_t object_size);
+
+void * APR_THREAD_FUNC copy_part(apr_thread_t *thd, void *data);
+
+cos_status_t *cos_resumable_copy_object_parts(cos_request_options_t *options,
+                                              cos_string_t *copy_source,
+                                              cos_string_t *dest_bucket, 
+                                              cos_string_t *dest_object, 
+                                              cos_table_t *headers,
+                                              cos_resumable_clt_params_t *clt_params,
+                                              cos_string_t *checkpoint_path,
+                                              int64_t object_size,
+                                              const char *object_etag,
+                                              const char *object_last_modified,
+                                              cos_progress_callback progress_callback,
+                                              cos_table_t **resp_headers,
+                                              cos_list_t *resp_body);
+
+cos_list_partition_t *cos_create_list_partition(cos_pool_t *p, const char *prefix, const char *marker, 
+                                                const char *end_marker);
+
+cos_status_t *cos_discover_list_partitions(cos_request_options_t *options, const cos_string_t *bucket,
+                                           cos_parallel_list_object_params_t *params, 
+                                           cos_list_object_callback callback, void *user_data,
+                                           cos_pool_t *pool, cos_list_t *partition_list);
+
+void cos_prepare_list_page(cos_transport_thread_params_t *params, cos_list_partition_t *partition, 
+                           const char *marker, int max_ret, cos_pool_t *pool);
+
+void * APR_THREAD_FUNC list_object_page(apr_thread_t *thd, void *data);
+
+char *cos_clip_list_page(cos_list_partition_t *partition, cos_list_object_params_t *page);
+
+int cos_emit_list_objects(cos_list_t *object_list, cos_list_object_callback callback, void *user_data);
+
+int cos_emit_list_partition(cos_list_partition_t *partition, cos_list_object_callback callback, void *user_data);
+
+void cos_prefetch_list_iter_page(cos_list_iter_t *iter, const char *marker);
+
+int cos_fill_delete_objects_batch(cos_list_iter_t *iter, cos_pool_t *pool, cos_list_t *key_list, 
+                                  cos_status_t **error);
 
+void * APR_THREAD_FUNC delete_objects_batch(apr_thread_t *thd, void *data);
 
 COS_CPP_END
 
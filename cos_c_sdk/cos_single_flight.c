@@ -0,0 +1,229 @@
+#include "cos_log.h"
+#include "cos_sys_define.h"
+#include "cos_define.h"
+#include "cos_buf.h"
+#include "cos_transport.h"
+#include "cos_single_flight.h"
+#include "apr_hash.h"
+#include "apr_thread_mutex.h"
+#include "apr_thread_cond.h"
+
+#define COS_SINGLE_FLIGHT_HEADER_NUM 5
+
+typedef struct {
+    const char *key;
+    cos_pool_t *pool;               // the response of the flight, destroyed by the last caller
+    apr_thread_cond_t *cond;
+    int refs;                       // the callers not released, guarded by cos_single_flight_mutex
+    int done;
+    cos_status_t *s;
+    cos_table_t *resp_headers;
+    cos_list_t body;
+} cos_flight_t;
+
+static const char *cos_single_flight_headers[COS_SINGLE_FLIGHT_HEADER_NUM] = {
+    COS_RANGE, COS_IF_MATCH, COS_IF_NONE_MATCH, COS_IF_MODIFIED_SINCE, COS_IF_UNMODIFIED_SINCE
+};
+
+static cos_pool_t *cos_single_flight_pool = NULL;
+static apr_thread_mutex_t *cos_single_flight_mutex = NULL;
+static apr_hash_t *cos_single_flights = NULL;
+static int cos_single_flight_enabled = COS_FALSE;
+
+int cos_single_flight_initialize()
+{
+    int s;
+    char buf[256];
+
+    if ((s = cos_pool_create(&cos_single_flight_pool, NULL)) != APR_SUCCESS) {
+        cos_error_log("cos_pool_create failure, code:%d %s.\n", s, apr_strerror(s, buf, sizeof(buf)));
+        return COSE_INTERNAL_ERROR;
+    }
+
+    if ((s = apr_thread_mutex_create(&cos_single_flight_mutex, APR_THREAD_MUTEX_DEFAULT, cos_single_flight_pool)) != APR_SUCCESS) {
+        cos_error_log("apr_thread_mutex_create failure, code:%d %s.\n", s, apr_strerror(s, buf, sizeof(buf)));
+        cos_single_flight_mutex = NULL;
+        return COSE_INTERNAL_ERROR;
+    }
+    cos_single_flights = apr_hash_make(cos_single_flight_pool);
+
+    return COSE_OK;
+}
+
+void cos_single_flight_deinitialize()
+{
+    // the running flights are owned by their callers
+    if (cos_single_flight_mutex != NULL) {
+        apr_thread_mutex_destroy(cos_single_flight_mutex);
+        cos_single_flight_mutex = NULL;
+    }
+    cos_single_flights = NULL;
+
+    if (cos_single_flight_pool != NULL) {
+        cos_pool_destroy(cos_single_flight_pool);
+        cos_single_flight_pool = NULL;
+    }
+}
+
+int cos_set_single_flight(int enable)
+{
+    if (NULL == cos_single_flight_mutex) {
+        return COSE_INTERNAL_ERROR;
+    }
+
+    cos_single_flight_enabled = enable ? COS_TRUE : COS_FALSE;
+    return COSE_OK;
+}
+
+char *cos_single_flight_key(const cos_request_options_t *options, const char *method,
+                            const cos_string_t *bucket, const cos_string_t *object,
+                            cos_table_t *headers, cos_table_t *params)
+{
+    int i;
+    int n = 0;
+    const char *values[COS_SINGLE_FLIGHT_HEADER_NUM];
+
+    if (!cos_single_flight_enabled || NULL == cos_single_flight_mutex) {
+        return NULL;
+    }
+    // a cancelled read must not fail the other callers
+    if (options->cancel_token != NULL || (options->ctl != NULL && options->ctl->cancel_token != NULL)) {
+        return NULL;
+    }
+    if (params != NULL && !apr_is_empty_table(params)) {
+        return NULL;
+    }
+
+    for (i = 0; i < COS_SINGLE_FLIGHT_HEADER_NUM; i++) {
+        values[i] = NULL;
+        if (headers != NULL) {
+            values[i] = apr_table_get(headers, cos_single_flight_headers[i]);
+        }
+        if (values[i] != NULL) {
+            n++;
+        } else {
+            values[i] = "";
+        }
+    }
+    // the other headers may change the response, e.g. the ones of sse-c
+    if (headers != NULL && apr_table_elts(headers)->nelts != n) {
+        return NULL;
+    }
+
+    // a header value has no newline, an object name may contain any character, so it is the last part
+    return apr_psprintf(options->pool, "%s\n%.*s\n%.*s\n%.*s\n%s\n%s\n%s\n%s\n%s\n%.*s", method,
+                        options->config->endpoint.len, options->config->endpoint.data,
+                        options->config->access_key_id.len, options->config->access_key_id.data,
+                        bucket->len, bucket->data, values[0], values[1], values[2], values[3], values[4],
+                        object->len, object->data);
+}
+
+static apr_status_t cos_flight_release(void *data)
+{
+    int last;
+    cos_flight_t *flight = (cos_flight_t *)data;
+
+    apr_thread_mutex_lock(cos_single_flight_mutex);
+    last = (0 == --flight->refs);
+    apr_thread_mutex_unlock(cos_single_flight_mutex);
+
+    if (last) {
+        cos_pool_destroy(flight->pool);
+    }
+    return APR_SUCCESS;
+}
+
+static int cos_flight_copy_header(void *rec, const char *key, const char *value)
+{
+    apr_table_addn((cos_table_t *)rec, key, value);
+    return 1;
+}
+
+// the result refers to the flight pool, which is kept until options->pool is destroyed
+static cos_status_t *cos_flight_result(const cos_request_options_t *options, cos_flight_t *flight,
+                                       cos_list_t *buffer, cos_table_t **resp_headers)
+{
+    cos_status_t *s;
+    cos_buf_t *b;
+    cos_buf_t *content;
+
+    s = cos_status_dup(options->pool, flight->s);
+    s->req_id = flight->s->req_id;
+
+    if (resp_headers != NULL) {
+        *resp_headers = cos_table_make(options->pool, 0);
+        if (flight->resp_headers != NULL) {
+            apr_table_do(cos_flight_copy_header, *resp_headers, flight->resp_headers, NULL);
+        }
+    }
+
+    if (buffer != NULL) {
+        cos_list_for_each_entry(cos_buf_t, b, &flight->body, node) {
+            content = cos_buf_pack(options->pool, b->pos, cos_buf_size(b));
+            cos_list_add_tail(&content->node, buffer);
+        }
+    }
+
+    apr_pool_cleanup_register(options->pool, flight, cos_flight_release, apr_pool_cleanup_null);
+    return s;
+}
+
+cos_status_t *cos_single_flight_do(const cos_request_options_t *options, const char *key,
+                                   cos_flight_call_pt call, void *arg,
+                                   cos_list_t *buffer, cos_table_t **resp_headers)
+{
+    cos_pool_t *pool;
+    cos_flight_t *flight;
+    cos_request_options_t flight_options;
+    cos_http_controller_t *ctl;
+
+    apr_thread_mutex_lock(cos_single_flight_mutex);
+    flight = (cos_flight_t *)apr_hash_get(cos_single_flights, key, APR_HASH_KEY_STRING);
+    if (flight != NULL) {
+        flight->refs++;
+        while (!flight->done) {
+            apr_thread_cond_wait(flight->cond, cos_single_flight_mutex);
+        }
+        apr_thread_mutex_unlock(cos_single_flight_mutex);
+        return cos_flight_result(options, flight, buffer, resp_headers);
+    }
+
+    if (cos_pool_create(&pool, NULL) != APR_SUCCESS) {
+        apr_thread_mutex_unlock(cos_single_flight_mutex);
+        return call(options, arg, buffer, resp_headers);
+    }
+    flight = (cos_flight_t *)cos_pcalloc(pool, sizeof(cos_flight_t));
+    if (apr_thread_cond_create(&flight->cond, pool) != APR_SUCCESS) {
+        apr_thread_mutex_unlock(cos_single_flight_mutex);
+        cos_pool_destroy(pool);
+        return call(options, arg, buffer, resp_headers);
+    }
+    flight->key = apr_pstrdup(pool, key);
+    flight->pool = pool;
+    flight->refs = 1;
+    cos_list_init(&flight->body);
+    apr_hash_set(cos_single_flights, flight->key, APR_HASH_KEY_STRING, flight);
+    apr_thread_mutex_unlock(cos_single_flight_mutex);
+
+    // the response of the flight is allocated in its pool instead of the one of the caller
+    flight_options = *options;
+    flight_options.pool = pool;
+    ctl = (cos_http_controller_t *)cos_pcalloc(pool, sizeof(cos_http_controller_ex_t));
+    memcpy(ctl, options->ctl, sizeof(cos_http_controller_t));
+    ctl->pool = pool;
+    ctl->owner = 0;
+    flight_options.ctl = ctl;
+
+    flight->s = call(&flight_options, arg, &flight->body, &flight->resp_headers);
+    options->ctl->start_time = ctl->start_time;
+    options->ctl->first_byte_time = ctl->first_byte_time;
+    options->ctl->finish_time = ctl->finish_time;
+
+    apr_thread_mutex_lock(cos_single_flight_mutex);
+    flight->done = 1;
+    apr_hash_set(cos_single_flights, flight->key, APR_HASH_KEY_STRING, NULL);
+    apr_thread_cond_broadcast(flight->cond);
+    apr_thread_mutex_unlock(cos_single_flight_mutex);
+
+    return cos_flight_result(options, flight, buffer, resp_headers);
+}
@@ -0,0 +1,51 @@
+#ifndef LIBCOS_SINGLE_FLIGHT_H
+#define LIBCOS_SINGLE_FLIGHT_H
+
+#include "cos_sys_define.h"
+#include "cos_define.h"
+#include "cos_status.h"
+
+
+COS_CPP_START
+
+/**
+  * @brief send the request of a flight with options, the response is allocated in options->pool
+**/
+typedef cos_status_t *(*cos_flight_call_pt)(const cos_request_options_t *options, void *arg,
+                                            cos_list_t *buffer, cos_table_t **resp_headers);
+
+/**
+  * @brief single flight is owned by the sdk, it is disabled until cos_set_single_flight is called,
+  *        the identical reads running at once share one request, a read is identified by
+  *        the method, the endpoint, the access key, the bucket, the object, Range and the
+  *        conditional headers, the reads with other headers or params, a cancel token or a
+  *        progress callback are not shared, the response is kept in a pool referenced by the
+  *        callers, it is freed once the pools of all of them are destroyed, so the body is
+  *        shared without copying
+**/
+int cos_single_flight_initialize();
+void cos_single_flight_deinitialize();
+
+/**
+  * @brief enable or disable single flight of cos_get_object_to_buffer and cos_head_object
+**/
+int cos_set_single_flight(int enable);
+
+/**
+  * @brief the key of a read, NULL if single flight is disabled or the read is not shared
+**/
+char *cos_single_flight_key(const cos_request_options_t *options, const char *method,
+                            const cos_string_t *bucket, const cos_string_t *object,
+                            cos_table_t *headers, cos_table_t *params);
+
+/**
+  * @brief run call, or wait for the running call of key, the response is referenced
+  *        by buffer and resp_headers, which are valid until options->pool is destroyed
+**/
+cos_status_t *cos_single_flight_do(const cos_request_options_t *options, const char *key,
+                                   cos_flight_call_pt call, void *arg,
+                                   cos_list_t *buffer, cos_table_t **resp_headers);
+
+COS_CPP_END
+
+#endif
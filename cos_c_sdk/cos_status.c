@@ -14,6 +14,8 @@ const char COS_INCONSISTENT_ERROR_CODE[] = "InconsistentError";
 const char COS_CREATE_QUEUE_ERROR_CODE[] = "CreateQueueFail";
 const char COS_CREATE_THREAD_POOL_ERROR_CODE[] = "CreateThreadPoolFail";
 const char COS_LACK_OF_CONTENT_LEN_ERROR_CODE[] = "LackOfContentLength";
+const char COS_SLOW_DOWN_ERROR_CODE[] = "SlowDown";
+const char COS_CANCELLED_ERROR_CODE[] = "Cancelled";
 
 
 cos_status_t *cos_status_create(cos_pool_t *p)
@@ -41,12 +43,31 @@ int cos_should_retry(cos_status_t *s) {
         return COS_TRUE;
     }
 
-    if (s->error_code != NULL) {
+    // the error of http io is in code, the error code is HttpIoError
+    if (s->code < 0) {
+        cos_error_code = s->code;
+    } else if (s->error_code != NULL) {
         cos_error_code = atoi(s->error_code);
-        if (cos_error_code == COSE_CONNECTION_FAILED || cos_error_code == COSE_REQUEST_TIMEOUT || 
-            cos_error_code == COSE_FAILED_CONNECT || cos_error_code == COSE_SERVICE_ERROR) {
-            return COS_TRUE;
-        }
+    }
+    if (cos_error_code == COSE_CONNECTION_FAILED || cos_error_code == COSE_REQUEST_TIMEOUT || 
+        cos_error_code == COSE_FAILED_CONNECT || cos_error_code == COSE_SERVICE_ERROR) {
+        return COS_TRUE;
+    }
+
+    return COS_FALSE;
+}
+
+int cos_status_is_throttled(cos_status_t *s) {
+    if (s == NULL) {
+        return COS_FALSE;
+    }
+
+    if (s->code == 503) {
+        return COS_TRUE;
+    }
+
+    if (s->error_code != NULL && 0 == strcmp(s->error_code, COS_SLOW_DOWN_ERROR_CODE)) {
+        return COS_TRUE;
     }
 
     return COS_FALSE;
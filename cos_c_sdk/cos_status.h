@@ -35,6 +35,13 @@ static APR_INLINE int cos_http_is_ok(int st)
  */
 int cos_should_retry(cos_status_t *s);
 
+/**
+ * @brief determine whether the request is rejected by the server for too high request rate
+ * @param[in]   s             the return status of api, such as cos_upload_part_from_file
+ * @return      int           COS_TRUE for 503 or SlowDown, COS_FALSE otherwise
+ */
+int cos_status_is_throttled(cos_status_t *s);
+
 cos_status_t *cos_status_create(cos_pool_t *p);
 
 cos_status_t *cos_status_dup(cos_pool_t *p, cos_status_t *src);
@@ -53,6 +60,8 @@ extern const char COS_INCONSISTENT_ERROR_CODE[];
 extern const char COS_CREATE_QUEUE_ERROR_CODE[];
 extern const char COS_CREATE_THREAD_POOL_ERROR_CODE[];
 extern const char COS_LACK_OF_CONTENT_LEN_ERROR_CODE[];
+extern const char COS_SLOW_DOWN_ERROR_CODE[];
+extern const char COS_CANCELLED_ERROR_CODE[];
 
 COS_CPP_END
 
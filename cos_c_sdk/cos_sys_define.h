@@ -59,6 +59,7 @@ typedef enum {
     COSE_CRC_INCONSISTENT_ERROR = -978,
     COSE_FILE_FLUSH_ERROR = -977,
     COSE_FILE_TRUNC_ERROR = -976,
+    COSE_CANCELLED = -975,
     COSE_UNKNOWN_ERROR = -100
 } cos_error_code_e;
 
@@ -110,8 +111,26 @@ typedef apr_array_header_t cos_array_header_t;
 #define COS_MAX_MEMORY_SIZE 1024*1024*1024L
 #define COS_MAX_PART_SIZE 512*1024*1024L
 #define COS_DEFAULT_PART_SIZE 1024*1024L
+#define COS_MIN_COPY_PART_SIZE 16*1024*1024L  // the part copied by the server is not smaller, the request overhead dominates
+#define COS_MAX_COPY_PART_SIZE 5*1024*1024*1024LL  // the limit of a single copy and of a copied part
 
 #define COS_REQUEST_STACK_SIZE 32
+#define COS_DEFAULT_THREAD_POOL_SIZE 64
+#define COS_MAX_THREAD_POOL_SIZE 1024
+#define COS_AUTO_TUNE_MIN_PART_SIZE 1024*1024L
+#define COS_AUTO_TUNE_MAX_PART_SIZE 64*1024*1024L
+#define COS_AUTO_TUNE_PART_SECONDS 2
+#define COS_AUTO_TUNE_MAX_THROTTLE_RETRY 3
+#define COS_PART_MAX_RETRY 3
+#define COS_PART_RETRY_BACKOFF (200*1000L)     // usec, doubled by every retry of a part
+#define COS_PART_MAX_RETRY_BACKOFF (5*1000*1000L)
+#define COS_PART_RETRY_POLL_INTERVAL (10*1000L)  // usec, the results are polled while a part backs off
+#define COS_DIRECT_IO_ALIGN 4096
+#define COS_DIRECT_IO_BUF_SIZE (1024*1024)  // the aligned buffer the file opened with O_DIRECT is read through
+#define COS_WRITE_BEHIND_BUF_SIZE (1024*1024)  // the buffer of the downloaded data handed to the writer thread
+#define COS_WRITE_BEHIND_MIN_BUFS 2
+#define COS_WRITE_BEHIND_QUEUE_SIZE 1024  // the buffers of all downloads waiting for the writer thread
+#define COS_LIST_MAX_PENDING_PAGES 16  // the pages a partition lists ahead of the emitted one for sorted parallel listing
 
 #define cos_abs(value)       (((value) >= 0) ? (value) : - (value))
 #define cos_max(val1, val2)  (((val1) < (val2)) ? (val2) : (val1))
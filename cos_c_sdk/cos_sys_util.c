@@ -543,6 +543,54 @@ uint64_t cos_atoui64(const char *nptr)
     return cos_strtoull(nptr, NULL, 10);
 }
 
+int64_t cos_atoi64_n(const char *nptr, int len)
+{
+    int64_t value = 0;
+    int i;
+
+    if (len <= 0) {
+        return -1;
+    }
+    for (i = 0; i < len; i++) {
+        if (!isdigit((unsigned char)nptr[i]) || value > (INT64_MAX - 9) / 10) {
+            return -1;
+        }
+        value = value * 10 + (nptr[i] - '0');
+    }
+    return value;
+}
+
+int cos_iso8601_to_epoch(const char *date, int len, int64_t *epoch)
+{
+    int64_t year, mon, day, hour, min, sec;
+    int64_t era, yoe, doy, doe;
+
+    // YYYY-MM-DDTHH:MM:SS, followed by an optional fraction and Z
+    if (len < 19 || '-' != date[4] || '-' != date[7] || 'T' != date[10] || ':' != date[13] || ':' != date[16]) {
+        return COSE_INVALID_ARGUMENT;
+    }
+    year = cos_atoi64_n(date, 4);
+    mon = cos_atoi64_n(date + 5, 2);
+    day = cos_atoi64_n(date + 8, 2);
+    hour = cos_atoi64_n(date + 11, 2);
+    min = cos_atoi64_n(date + 14, 2);
+    sec = cos_atoi64_n(date + 17, 2);
+    if (year < 0 || mon < 1 || mon > 12 || day < 1 || day > 31 || 
+        hour < 0 || hour > 23 || min < 0 || min > 59 || sec < 0 || sec > 60) 
+    {
+        return COSE_INVALID_ARGUMENT;
+    }
+
+    // the days since 1970-01-01 of the proleptic gregorian date, the year starts in march
+    year -= (mon <= 2);
+    era = year / 400;
+    yoe = year - era * 400;
+    doy = (153 * (mon > 2 ? mon - 3 : mon + 9) + 2) / 5 + day - 1;
+    doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    *epoch = (era * 146097 + doe - 719468) * 86400 + hour * 3600 + min * 60 + sec;
+    return COSE_OK;
+}
+
 
 void cos_get_hex_from_digest(unsigned char hexdigest[40], unsigned char digest[20])
 {
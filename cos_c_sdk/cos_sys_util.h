@@ -82,6 +82,19 @@ unsigned long long cos_strtoull(const char *nptr, char **endptr, int base);
 **/
 uint64_t cos_atoui64(const char *nptr);
 
+/*
+ * @brief Convert the decimal digits of a string which is not NUL terminated to int64_t,
+ *        -1 if it is empty or has other characters.
+**/
+int64_t cos_atoi64_n(const char *nptr, int len);
+
+/*
+ * @brief Convert an ISO 8601 time in UTC, such as 2019-01-01T12:00:00.000Z, which is not
+ *        NUL terminated, to seconds since the epoch, the fraction is dropped.
+ * @return COSE_OK, or COSE_INVALID_ARGUMENT if it is not in the format
+**/
+int cos_iso8601_to_epoch(const char *date, int len, int64_t *epoch);
+
 void cos_get_hex_from_digest(unsigned char hexdigest[40], unsigned char digest[20]);
 
 void cos_get_hmac_sha1_hexdigest(unsigned char hexdigest[40], const unsigned char *key, int key_len,
@@ -0,0 +1,442 @@
+#include "cos_log.h"
+#include "cos_sys_define.h"
+#include "cos_define.h"
+#include "cos_thread_pool.h"
+#include <apr_atomic.h>
+
+static cos_pool_t *cos_thread_pool_pool = NULL;
+static apr_thread_mutex_t *cos_thread_pool_mutex = NULL;
+static cos_thread_pool_t *cos_shared_thread_pool = NULL;
+static int cos_thread_pool_size = COS_DEFAULT_THREAD_POOL_SIZE;
+static const char COS_THREAD_WORKER_KEY[] = "cos_thread_worker";
+
+static void * APR_THREAD_FUNC cos_thread_worker_run(apr_thread_t *thd, void *data);
+
+static int cos_task_priority_weight(int priority)
+{
+    switch (priority) {
+        case COS_TASK_PRIORITY_LOW:
+            return 1;
+        case COS_TASK_PRIORITY_HIGH:
+            return 4;
+        default:
+            return 2;
+    }
+}
+
+// called with thrp->mutex locked
+static int cos_thread_pool_spawn(cos_thread_pool_t *thrp, int worker_num)
+{
+    int s;
+    char buf[256];
+    cos_thread_worker_t *worker;
+
+    for (; thrp->spawned_num < worker_num; thrp->spawned_num++) {
+        worker = thrp->workers + thrp->spawned_num;
+        worker->thrp = thrp;
+        worker->index = thrp->spawned_num;
+        cos_list_init(&worker->tasks);
+        s = apr_thread_mutex_create(&worker->mutex, APR_THREAD_MUTEX_DEFAULT, thrp->pool);
+        if (s != APR_SUCCESS) {
+            cos_error_log("apr_thread_mutex_create failure, code:%d %s.\n", s, apr_strerror(s, buf, sizeof(buf)));
+            return COSE_INTERNAL_ERROR;
+        }
+        s = apr_thread_create(&worker->thread, NULL, cos_thread_worker_run, worker, thrp->pool);
+        if (s != APR_SUCCESS) {
+            cos_error_log("apr_thread_create failure, code:%d %s.\n", s, apr_strerror(s, buf, sizeof(buf)));
+            return COSE_INTERNAL_ERROR;
+        }
+    }
+    return COSE_OK;
+}
+
+static cos_thread_pool_t *cos_thread_pool_create(cos_pool_t *p, int worker_num)
+{
+    int s;
+    char buf[256];
+    cos_thread_pool_t *thrp;
+
+    thrp = (cos_thread_pool_t *)cos_pcalloc(p, sizeof(cos_thread_pool_t));
+    thrp->pool = p;
+    thrp->workers = (cos_thread_worker_t *)cos_pcalloc(p, sizeof(cos_thread_worker_t) * COS_MAX_THREAD_POOL_SIZE);
+    thrp->worker_num = worker_num;
+    cos_list_init(&thrp->free_tasks);
+    cos_list_init(&thrp->high_tasks);
+
+    if ((s = apr_thread_mutex_create(&thrp->mutex, APR_THREAD_MUTEX_DEFAULT, p)) != APR_SUCCESS) {
+        cos_error_log("apr_thread_mutex_create failure, code:%d %s.\n", s, apr_strerror(s, buf, sizeof(buf)));
+        return NULL;
+    }
+    if ((s = apr_thread_cond_create(&thrp->cond, p)) != APR_SUCCESS) {
+        cos_error_log("apr_thread_cond_create failure, code:%d %s.\n", s, apr_strerror(s, buf, sizeof(buf)));
+        return NULL;
+    }
+
+    apr_thread_mutex_lock(thrp->mutex);
+    s = cos_thread_pool_spawn(thrp, worker_num);
+    if (s != COSE_OK) {
+        // the tasks are pushed to the spawned workers only
+        thrp->worker_num = thrp->spawned_num;
+    }
+    apr_thread_mutex_unlock(thrp->mutex);
+    if (0 == thrp->worker_num) {
+        return NULL;
+    }
+
+    return thrp;
+}
+
+static void cos_thread_pool_destroy(cos_thread_pool_t *thrp)
+{
+    int i;
+    apr_status_t retval;
+
+    // the queued tasks are finished before the workers exit
+    apr_thread_mutex_lock(thrp->mutex);
+    thrp->stop = COS_TRUE;
+    apr_thread_cond_broadcast(thrp->cond);
+    apr_thread_mutex_unlock(thrp->mutex);
+
+    for (i = 0; i < thrp->spawned_num; i++) {
+        apr_thread_join(&retval, thrp->workers[i].thread);
+    }
+}
+
+static cos_thread_task_t *cos_thread_worker_pop(cos_thread_worker_t *worker, int from_tail)
+{
+    cos_thread_task_t *task = NULL;
+
+    apr_thread_mutex_lock(worker->mutex);
+    if (!cos_list_empty(&worker->tasks)) {
+        if (from_tail) {
+            task = cos_list_entry(worker->tasks.prev, cos_thread_task_t, node);
+        } else {
+            task = cos_list_entry(worker->tasks.next, cos_thread_task_t, node);
+        }
+        cos_list_del(&task->node);
+    }
+    apr_thread_mutex_unlock(worker->mutex);
+
+    if (task != NULL) {
+        apr_atomic_dec32(&worker->thrp->pending);
+    }
+    return task;
+}
+
+static cos_thread_task_t *cos_thread_worker_steal(cos_thread_worker_t *worker, int n)
+{
+    int i;
+    cos_thread_task_t *task = NULL;
+
+    for (i = 1; i < n && NULL == task; i++) {
+        task = cos_thread_worker_pop(worker->thrp->workers + (worker->index + i) % n, COS_TRUE);
+    }
+    return task;
+}
+
+static void * APR_THREAD_FUNC cos_thread_worker_run(apr_thread_t *thd, void *data)
+{
+    cos_thread_worker_t *worker = (cos_thread_worker_t *)data;
+    cos_thread_pool_t *thrp = worker->thrp;
+    cos_thread_task_t *task;
+    int active;
+    int spawned_num;
+
+    // the pool is owned by this thread, so it is created and cleared without locking the parent
+    cos_pool_create(&worker->task_pool, NULL);
+    apr_thread_data_set(worker, COS_THREAD_WORKER_KEY, NULL, thd);
+
+    for (;;) {
+        task = NULL;
+        apr_thread_mutex_lock(thrp->mutex);
+        active = worker->index < thrp->worker_num || thrp->stop;
+        spawned_num = thrp->spawned_num;
+        if (active && !cos_list_empty(&thrp->high_tasks)) {
+            task = cos_list_entry(thrp->high_tasks.next, cos_thread_task_t, node);
+            cos_list_del(&task->node);
+        }
+        apr_thread_mutex_unlock(thrp->mutex);
+
+        if (task != NULL) {
+            apr_atomic_dec32(&thrp->pending);
+        } else if (active) {
+            task = cos_thread_worker_pop(worker, COS_FALSE);
+            if (NULL == task) {
+                task = cos_thread_worker_steal(worker, spawned_num);
+            }
+        }
+
+        if (task != NULL) {
+            task->func(thd, task->param);
+            apr_pool_clear(worker->task_pool);
+            apr_thread_mutex_lock(thrp->mutex);
+            cos_list_add_tail(&task->node, &thrp->free_tasks);
+            apr_thread_mutex_unlock(thrp->mutex);
+            continue;
+        }
+
+        // sleep until a task is pushed, the parked workers beyond the budget keep sleeping
+        apr_thread_mutex_lock(thrp->mutex);
+        while (!thrp->stop && (0 == apr_atomic_read32(&thrp->pending) || worker->index >= thrp->worker_num)) {
+            apr_thread_cond_wait(thrp->cond, thrp->mutex);
+        }
+        if (thrp->stop && 0 == apr_atomic_read32(&thrp->pending)) {
+            apr_thread_mutex_unlock(thrp->mutex);
+            break;
+        }
+        apr_thread_mutex_unlock(thrp->mutex);
+    }
+
+    cos_pool_destroy(worker->task_pool);
+    worker->task_pool = NULL;
+    apr_thread_exit(thd, APR_SUCCESS);
+    return NULL;
+}
+
+cos_pool_t *cos_get_worker_pool(apr_thread_t *thd)
+{
+    void *data = NULL;
+
+    if (NULL == thd || apr_thread_data_get(&data, COS_THREAD_WORKER_KEY, thd) != APR_SUCCESS || NULL == data) {
+        return NULL;
+    }
+    return ((cos_thread_worker_t *)data)->task_pool;
+}
+
+int cos_thread_pool_push(cos_thread_pool_t *thrp, apr_thread_start_t func, void *param, int priority)
+{
+    cos_thread_task_t *task = NULL;
+    cos_thread_worker_t *worker = NULL;
+
+    apr_thread_mutex_lock(thrp->mutex);
+    if (thrp->stop) {
+        apr_thread_mutex_unlock(thrp->mutex);
+        return COSE_INTERNAL_ERROR;
+    }
+    if (!cos_list_empty(&thrp->free_tasks)) {
+        task = cos_list_entry(thrp->free_tasks.next, cos_thread_task_t, node);
+        cos_list_del(&task->node);
+    } else {
+        task = (cos_thread_task_t *)cos_palloc(thrp->pool, sizeof(cos_thread_task_t));
+    }
+    task->func = func;
+    task->param = param;
+    apr_atomic_inc32(&thrp->pending);
+
+    if (COS_TASK_PRIORITY_HIGH == priority) {
+        // every worker checks the high queue first, so no stealer takes a queued task before it
+        cos_list_add_tail(&task->node, &thrp->high_tasks);
+    } else {
+        // spread the tasks over the workers, the idle ones steal the rest
+        worker = thrp->workers + apr_atomic_inc32(&thrp->next) % thrp->worker_num;
+    }
+    apr_thread_mutex_unlock(thrp->mutex);
+
+    if (worker != NULL) {
+        apr_thread_mutex_lock(worker->mutex);
+        cos_list_add_tail(&task->node, &worker->tasks);
+        apr_thread_mutex_unlock(worker->mutex);
+    }
+
+    apr_thread_mutex_lock(thrp->mutex);
+    if (thrp->spawned_num > thrp->worker_num) {
+        apr_thread_cond_broadcast(thrp->cond);
+    } else {
+        apr_thread_cond_signal(thrp->cond);
+    }
+    apr_thread_mutex_unlock(thrp->mutex);
+
+    return COSE_OK;
+}
+
+void cos_task_group_init(cos_thread_pool_t *thrp, cos_task_group_t *group, int priority, 
+                         int max_running, int auto_tune)
+{
+    group->priority = priority;
+    group->weight = cos_task_priority_weight(priority);
+    group->max_running = max_running;
+    group->auto_tune = auto_tune;
+    group->window = cos_max(max_running, 1);
+    group->acked = 0;
+    group->min_cost = 0;
+    cos_list_init(&group->delayed);
+    if (auto_tune) {
+        // the window grows beyond thread_num, the share of the group is the only cap
+        group->max_running = COS_MAX_THREAD_POOL_SIZE;
+    }
+
+    apr_thread_mutex_lock(thrp->mutex);
+    thrp->group_num++;
+    thrp->total_weight += group->weight;
+    apr_thread_mutex_unlock(thrp->mutex);
+}
+
+void cos_task_group_destroy(cos_thread_pool_t *thrp, cos_task_group_t *group)
+{
+    apr_thread_mutex_lock(thrp->mutex);
+    thrp->group_num--;
+    thrp->total_weight -= group->weight;
+    apr_thread_mutex_unlock(thrp->mutex);
+}
+
+int cos_task_group_limit(cos_thread_pool_t *thrp, cos_task_group_t *group)
+{
+    int limit;
+
+    // weighted fair share of the budget, a lone transfer may use all of it
+    apr_thread_mutex_lock(thrp->mutex);
+    limit = thrp->worker_num;
+    if (thrp->total_weight > 0) {
+        limit = thrp->worker_num * group->weight / thrp->total_weight;
+    }
+    apr_thread_mutex_unlock(thrp->mutex);
+
+    limit = cos_min(limit, group->max_running);
+    if (group->auto_tune) {
+        limit = cos_min(limit, group->window);
+    }
+    return cos_max(limit, 1);
+}
+
+void cos_task_group_feedback(cos_thread_pool_t *thrp, cos_task_group_t *group, 
+                             int64_t bytes, apr_time_t elapsed, int throttled)
+{
+    int64_t rate;
+    apr_time_t cost;
+
+    if (throttled) {
+        // multiplicative decrease
+        group->window = cos_max(group->window / 2, 1);
+        group->acked = 0;
+        return;
+    }
+
+    if (bytes <= 0 || elapsed <= 0) {
+        return;
+    }
+
+    rate = bytes * APR_USEC_PER_SEC / elapsed;
+    apr_thread_mutex_lock(thrp->mutex);
+    thrp->stream_rate = (0 == thrp->stream_rate) ? rate : (thrp->stream_rate * 7 + rate) / 8;
+    apr_thread_mutex_unlock(thrp->mutex);
+
+    if (!group->auto_tune) {
+        return;
+    }
+
+    // additive increase while the tasks do not slow down, a task taking twice
+    // the best observed time means the link is saturated and requests are queued
+    cost = elapsed * 1024 * 1024 / bytes;
+    if (0 == group->min_cost || cost < group->min_cost) {
+        group->min_cost = cost;
+    }
+    if (cost > group->min_cost * 2) {
+        group->acked = 0;
+        return;
+    }
+    if (++group->acked >= group->window) {
+        group->window++;
+        group->acked = 0;
+    }
+}
+
+int64_t cos_thread_pool_stream_rate(cos_thread_pool_t *thrp)
+{
+    int64_t rate;
+
+    apr_thread_mutex_lock(thrp->mutex);
+    rate = thrp->stream_rate;
+    apr_thread_mutex_unlock(thrp->mutex);
+
+    return rate;
+}
+
+int cos_thread_pool_initialize()
+{
+    int s;
+    char buf[256];
+
+    if ((s = cos_pool_create(&cos_thread_pool_pool, NULL)) != APR_SUCCESS) {
+        cos_error_log("cos_pool_create failure, code:%d %s.\n", s, apr_strerror(s, buf, sizeof(buf)));
+        return COSE_INTERNAL_ERROR;
+    }
+
+    if ((s = apr_thread_mutex_create(&cos_thread_pool_mutex, APR_THREAD_MUTEX_DEFAULT, cos_thread_pool_pool)) != APR_SUCCESS) {
+        cos_error_log("apr_thread_mutex_create failure, code:%d %s.\n", s, apr_strerror(s, buf, sizeof(buf)));
+        return COSE_INTERNAL_ERROR;
+    }
+    cos_shared_thread_pool = NULL;
+
+    return COSE_OK;
+}
+
+void cos_thread_pool_deinitialize()
+{
+    if (cos_shared_thread_pool != NULL) {
+        cos_thread_pool_destroy(cos_shared_thread_pool);
+        cos_shared_thread_pool = NULL;
+    }
+
+    if (cos_thread_pool_mutex != NULL) {
+        apr_thread_mutex_destroy(cos_thread_pool_mutex);
+        cos_thread_pool_mutex = NULL;
+    }
+
+    if (cos_thread_pool_pool != NULL) {
+        cos_pool_destroy(cos_thread_pool_pool);
+        cos_thread_pool_pool = NULL;
+    }
+}
+
+int cos_set_thread_pool_size(int thread_num)
+{
+    int s = COSE_OK;
+    cos_thread_pool_t *thrp;
+
+    if (thread_num <= 0 || thread_num > COS_MAX_THREAD_POOL_SIZE) {
+        return COSE_INVALID_ARGUMENT;
+    }
+
+    if (cos_thread_pool_mutex != NULL) {
+        apr_thread_mutex_lock(cos_thread_pool_mutex);
+    }
+    cos_thread_pool_size = thread_num;
+    thrp = cos_shared_thread_pool;
+    if (thrp != NULL) {
+        // start the missing workers, or park the ones beyond the new budget
+        apr_thread_mutex_lock(thrp->mutex);
+        s = cos_thread_pool_spawn(thrp, thread_num);
+        thrp->worker_num = cos_min(thread_num, thrp->spawned_num);
+        apr_thread_cond_broadcast(thrp->cond);
+        apr_thread_mutex_unlock(thrp->mutex);
+    }
+    if (cos_thread_pool_mutex != NULL) {
+        apr_thread_mutex_unlock(cos_thread_pool_mutex);
+    }
+
+    return s;
+}
+
+int cos_get_thread_pool_size()
+{
+    return cos_thread_pool_size;
+}
+
+cos_thread_pool_t *cos_get_thread_pool()
+{
+    cos_thread_pool_t *thrp = NULL;
+
+    if (NULL == cos_thread_pool_mutex) {
+        cos_error_log("the shared thread pool is unavailable, call cos_http_io_initialize first.\n");
+        return NULL;
+    }
+
+    apr_thread_mutex_lock(cos_thread_pool_mutex);
+    if (NULL == cos_shared_thread_pool) {
+        cos_shared_thread_pool = cos_thread_pool_create(cos_thread_pool_pool, cos_thread_pool_size);
+    }
+    thrp = cos_shared_thread_pool;
+    apr_thread_mutex_unlock(cos_thread_pool_mutex);
+
+    return thrp;
+}
@@ -0,0 +1,126 @@
+#ifndef LIBCOS_THREAD_POOL_H
+#define LIBCOS_THREAD_POOL_H
+
+#include "cos_sys_define.h"
+#include "cos_list.h"
+#include "apr_thread_proc.h"
+#include "apr_thread_mutex.h"
+#include "apr_thread_cond.h"
+
+
+COS_CPP_START
+
+typedef struct cos_thread_task_s cos_thread_task_t;
+typedef struct cos_thread_worker_s cos_thread_worker_t;
+typedef struct cos_thread_pool_s cos_thread_pool_t;
+
+struct cos_thread_task_s {
+    cos_list_t node;
+    apr_thread_start_t func;
+    void *param;
+};
+
+struct cos_thread_worker_s {
+    cos_thread_pool_t *thrp;
+    apr_thread_t *thread;
+    apr_thread_mutex_t *mutex;
+    cos_list_t tasks;      // the deque of the worker, the owner takes from the head, others steal from the tail
+    cos_pool_t *task_pool; // the pool of the running task, cleared after each task
+    int index;
+};
+
+struct cos_thread_pool_s {
+    cos_pool_t *pool;
+    apr_thread_mutex_t *mutex;
+    apr_thread_cond_t *cond;
+    cos_thread_worker_t *workers;
+    int worker_num;        // the thread budget of all transfers, the workers beyond it are parked, use mutex
+    int spawned_num;       // the number of started workers, use mutex
+    int stop;              // use mutex
+    apr_uint32_t pending;  // the number of queued tasks, use atomic
+    apr_uint32_t next;     // the next worker to push a task to, use atomic
+    cos_list_t free_tasks;
+    cos_list_t high_tasks; // the tasks of high priority, taken by all workers before their deques, use mutex
+    int group_num;         // the number of active task groups
+    int total_weight;      // the sum of the weights of active task groups
+    int64_t stream_rate;   // the moving average of the throughput of one part task, byte per second
+};
+
+/**
+  * @brief a task group is the set of part tasks of one transfer, its running
+  *        tasks are limited to its weighted fair share of the thread budget,
+  *        with auto_tune they are also limited to a window adjusted by AIMD
+**/
+typedef struct {
+    int priority;     // cos_task_priority_e
+    int weight;       // derived from priority
+    int max_running;  // the cap of running tasks, the thread_num of the transfer
+    int auto_tune;    // COS_TRUE to adjust the window by the feedback of finished tasks
+    int window;       // the number of running tasks, grows by one per window of fast tasks, halves when throttled
+    int acked;        // the number of fast tasks since the window grew
+    apr_time_t min_cost;  // the lowest observed time to transfer one MB, usec
+    cos_list_t delayed;   // the tasks relaunched after a backoff, used by the coordinator of the transfer only
+} cos_task_group_t;
+
+/**
+  * @brief the shared transfer thread pool is owned by the sdk, it is created on first use
+  *        and destroyed in cos_http_io_deinitialize, the part tasks of all multi-thread
+  *        transfers are scheduled on it, idle workers steal tasks from busy ones
+**/
+int cos_thread_pool_initialize();
+void cos_thread_pool_deinitialize();
+
+/**
+  * @brief set the max number of threads of the shared transfer thread pool,
+  *        default COS_DEFAULT_THREAD_POOL_SIZE, valid range [1, COS_MAX_THREAD_POOL_SIZE]
+  *        this is the global concurrency of all multi-thread transfers
+**/
+int cos_set_thread_pool_size(int thread_num);
+int cos_get_thread_pool_size();
+
+/**
+  * @brief get the shared transfer thread pool, NULL if cos_http_io_initialize is not called
+**/
+cos_thread_pool_t *cos_get_thread_pool();
+
+/**
+  * @brief get the pool of the task running on the worker thread thd, the pool is cleared
+  *        when the task returns, NULL if thd is not a worker of the shared pool
+**/
+cos_pool_t *cos_get_worker_pool(apr_thread_t *thd);
+
+/**
+  * @brief push a task into the pool, tasks of high priority are kept in a queue of the pool
+  *        that every worker checks before its own deque and the ones it steals from,
+  *        so they are taken before the queued ones
+**/
+int cos_thread_pool_push(cos_thread_pool_t *thrp, apr_thread_start_t func, void *param, int priority);
+
+/**
+  * @brief register a task group before pushing its tasks and unregister it after they finished,
+  *        with auto_tune, max_running is the initial window instead of a cap
+**/
+void cos_task_group_init(cos_thread_pool_t *thrp, cos_task_group_t *group, int priority, 
+                         int max_running, int auto_tune);
+void cos_task_group_destroy(cos_thread_pool_t *thrp, cos_task_group_t *group);
+
+/**
+  * @brief the number of tasks the group may run now, at least one
+**/
+int cos_task_group_limit(cos_thread_pool_t *thrp, cos_task_group_t *group);
+
+/**
+  * @brief report a finished task of the group, bytes transferred in elapsed usec,
+  *        throttled is COS_TRUE if the server rejected the task with 503 or SlowDown
+**/
+void cos_task_group_feedback(cos_thread_pool_t *thrp, cos_task_group_t *group, 
+                             int64_t bytes, apr_time_t elapsed, int throttled);
+
+/**
+  * @brief the observed throughput of one part task of all transfers, byte per second, 0 if unknown
+**/
+int64_t cos_thread_pool_stream_rate(cos_thread_pool_t *thrp);
+
+COS_CPP_END
+
+#endif
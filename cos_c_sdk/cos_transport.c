@@ -17,6 +17,14 @@ static void cos_move_transport_state(cos_curl_http_transport_t *t, cos_transport
 static size_t cos_curl_default_header_callback(char *buffer, size_t size, size_t nitems, void *userdata);
 static size_t cos_curl_default_write_callback(char *ptr, size_t size, size_t nmemb, void *userdata);
 static size_t cos_curl_default_read_callback(char *buffer, size_t size, size_t nitems, void *instream);
+static int cos_curl_transport_cancelled(cos_curl_http_transport_t *t);
+static int cos_curl_transport_write_behind(cos_curl_http_transport_t *t, char *buffer, int len);
+static void cos_curl_transport_finish_write_behind(cos_curl_http_transport_t *t);
+#if LIBCURL_VERSION_NUM >= 0x072000
+static int cos_curl_cancel_callback(void *clientp, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow);
+#else
+static int cos_curl_cancel_callback(void *clientp, double dltotal, double dlnow, double ultotal, double ulnow);
+#endif
 
 static void cos_init_curl_headers(cos_curl_http_transport_t *t)
 {
@@ -239,7 +247,7 @@ size_t cos_curl_default_write_callback(char *ptr, size_t size, size_t nmemb, voi
     
     cos_curl_transport_headers_done(t);
 
-    if (t->controller->error_code != COSE_OK) {
+    if (t->controller->error_code != COSE_OK || cos_curl_transport_cancelled(t)) {
         cos_debug_log("write callback abort");
         return 0;
     }
@@ -261,7 +269,12 @@ size_t cos_curl_default_write_callback(char *ptr, size_t size, size_t nmemb, voi
         return 0;
     }
 
-    if ((bytes = t->resp->write_body(t->resp, ptr, len)) < 0) {
+    if (t->controller->options->write_behind_size > 0 && t->resp->type == BODY_IN_FILE) {
+        bytes = cos_curl_transport_write_behind(t, ptr, len);
+    } else {
+        bytes = t->resp->write_body(t->resp, ptr, len);
+    }
+    if (bytes < 0) {
         cos_debug_log("write body failure, %d.", bytes);
         t->controller->error_code = COSE_WRITE_BODY_ERROR;
         t->controller->reason = "write body failure.";
@@ -294,7 +307,7 @@ size_t cos_curl_default_read_callback(char *buffer, size_t size, size_t nitems,
     t = (cos_curl_http_transport_t *)(instream);
     len = size * nitems;
 
-    if (t->controller->error_code != COSE_OK) {
+    if (t->controller->error_code != COSE_OK || cos_curl_transport_cancelled(t)) {
         cos_debug_log("abort read callback.");
         return CURL_READFUNC_ABORT;
     }
@@ -324,6 +337,77 @@ size_t cos_curl_default_read_callback(char *buffer, size_t size, size_t nitems,
     return bytes;
 }
 
+static int cos_curl_transport_write_behind(cos_curl_http_transport_t *t, char *buffer, int len)
+{
+    int s;
+    int bytes;
+    char buf[256];
+    cos_file_buf_t *fb = t->resp->file_buf;
+
+    if (t->write_behind == NULL) {
+        if (fb == NULL || fb->file == NULL || t->resp->body_len > 0) {
+            // the file is opened by the write body callback, it keeps writing the file
+            return t->resp->write_body(t->resp, buffer, len);
+        }
+        s = cos_write_behind_create(t->pool, fb->file, fb->file_pos, 
+                t->controller->options->write_behind_size, &t->write_behind);
+        if (s != APR_SUCCESS) {
+            cos_error_log("cos_write_behind_create failure, code:%d %s.", s, apr_strerror(s, buf, sizeof(buf)));
+            return COSE_FILE_WRITE_ERROR;
+        }
+    }
+
+    if ((bytes = cos_write_behind_write(t->write_behind, buffer, len)) < 0) {
+        return bytes;
+    }
+    t->resp->body_len += bytes;
+
+    return bytes;
+}
+
+static void cos_curl_transport_finish_write_behind(cos_curl_http_transport_t *t)
+{
+    int s;
+    char buf[256];
+
+    if (t->write_behind == NULL) {
+        return;
+    }
+
+    // the data is on the file when the request returns
+    s = cos_write_behind_finish(t->write_behind);
+    t->write_behind = NULL;
+    if (s != APR_SUCCESS) {
+        cos_error_log("write behind failure, code:%d %s.", s, apr_strerror(s, buf, sizeof(buf)));
+        if (t->controller->error_code == COSE_OK) {
+            t->controller->error_code = COSE_WRITE_BODY_ERROR;
+            t->controller->reason = "write body failure.";
+        }
+    }
+}
+
+static int cos_curl_transport_cancelled(cos_curl_http_transport_t *t)
+{
+    if (!cos_is_cancelled(t->controller->cancel_token)) {
+        return COS_FALSE;
+    }
+    if (t->controller->error_code == COSE_OK) {
+        t->controller->error_code = COSE_CANCELLED;
+        t->controller->reason = "request cancelled.";
+    }
+    return COS_TRUE;
+}
+
+#if LIBCURL_VERSION_NUM >= 0x072000
+int cos_curl_cancel_callback(void *clientp, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow)
+#else
+int cos_curl_cancel_callback(void *clientp, double dltotal, double dlnow, double ultotal, double ulnow)
+#endif
+{
+    // called about once a second even if no data is transferred, non-zero aborts the transfer
+    return cos_curl_transport_cancelled((cos_curl_http_transport_t *)clientp);
+}
+
 int cos_curl_code_to_status(CURLcode code)
 {
     switch (code) {
@@ -349,6 +433,7 @@ int cos_curl_code_to_status(CURLcode code)
 static void cos_curl_transport_finish(cos_curl_http_transport_t *t)
 {
     cos_curl_transport_headers_done(t);
+    cos_curl_transport_finish_write_behind(t);
     
     if (t->cleanup != NULL) {
         cos_fstack_destory(t->cleanup);
@@ -381,7 +466,19 @@ int cos_curl_transport_setup(cos_curl_http_transport_t *t)
 
     curl_easy_setopt_safe(CURLOPT_FILETIME, 1);
     curl_easy_setopt_safe(CURLOPT_NOSIGNAL, 1);
-    curl_easy_setopt_safe(CURLOPT_NOPROGRESS, 1);
+    if (NULL != t->controller->cancel_token) {
+        // the cancel callback aborts a request waiting on the network
+#if LIBCURL_VERSION_NUM >= 0x072000
+        curl_easy_setopt_safe(CURLOPT_XFERINFOFUNCTION, cos_curl_cancel_callback);
+        curl_easy_setopt_safe(CURLOPT_XFERINFODATA, t);
+#else
+        curl_easy_setopt_safe(CURLOPT_PROGRESSFUNCTION, cos_curl_cancel_callback);
+        curl_easy_setopt_safe(CURLOPT_PROGRESSDATA, t);
+#endif
+        curl_easy_setopt_safe(CURLOPT_NOPROGRESS, 0);
+    } else {
+        curl_easy_setopt_safe(CURLOPT_NOPROGRESS, 1);
+    }
     curl_easy_setopt_safe(CURLOPT_TCP_NODELAY, 1);
     curl_easy_setopt_safe(CURLOPT_NETRC, CURL_NETRC_IGNORED);
 
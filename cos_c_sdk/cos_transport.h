@@ -11,6 +11,7 @@ typedef struct cos_http_request_s cos_http_request_t;
 typedef struct cos_http_response_s cos_http_response_t;
 typedef struct cos_http_transport_s cos_http_transport_t;
 typedef struct cos_http_controller_s cos_http_controller_t;
+typedef struct cos_cancel_token_s cos_cancel_token_t;
 
 typedef struct cos_http_request_options_s cos_http_request_options_t;
 typedef struct cos_http_transport_options_s cos_http_transport_options_t;
@@ -21,6 +22,10 @@ typedef int (*cos_write_http_body_pt)(cos_http_response_t *resp, const char *buf
 
 typedef void (*cos_progress_callback)(int64_t consumed_bytes, int64_t total_bytes);
 
+typedef int64_t (*cos_read_stream_callback)(void *user_data, char *buffer, int64_t size);
+
+typedef int64_t (*cos_write_stream_callback)(void *user_data, const char *buffer, int64_t size);
+
 void cos_curl_response_headers_parse(cos_pool_t *p, cos_table_t *headers, char *buffer, int len);
 cos_http_transport_t *cos_curl_http_transport_create(cos_pool_t *p);
 int cos_curl_http_transport_perform(cos_http_transport_t *t);
@@ -34,6 +39,7 @@ struct cos_http_request_options_s {
     int enable_crc;
     char *proxy_host;
     char *proxy_auth;
+    int64_t write_behind_size; // the memory of the buffers the writer thread writes the downloaded file from, default 0 write in the callback
 };
 
 struct cos_http_transport_options_s {
@@ -42,8 +48,15 @@ struct cos_http_transport_options_s {
     uint32_t ssl_verification_disabled:1;
 };
 
+struct cos_cancel_token_s {
+    volatile apr_uint32_t cancelled; // set by cos_cancel, never reset
+    int abort_upload;                // abort the multipart upload of a cancelled resumable upload, default keep it to resume
+    cos_cancel_token_t *parent;      // the token is cancelled with its parent
+};
+
 #define COS_HTTP_BASE_CONTROLLER_DEFINE         \
     cos_http_request_options_t *options;        \
+    cos_cancel_token_t *cancel_token;           \
     cos_pool_t *pool;                           \
     int64_t start_time;                         \
     int64_t first_byte_time;                    \
@@ -93,6 +106,9 @@ struct cos_http_request_s {
     cos_progress_callback progress_callback;
     uint64_t crc64;
     int64_t  consumed_bytes;
+
+    char *meta_cache_key;   // the key of the object changed by the request in the metadata cache
+    char *block_cache_key;  // the key of the object changed by the request in the block cache
 };
 
 struct cos_http_response_s {
@@ -145,6 +161,7 @@ struct cos_curl_http_transport_s {
     curl_read_callback header_callback;
     curl_read_callback read_callback;
     curl_write_callback write_callback;
+    cos_write_behind_t *write_behind;
 };
 
 COS_CPP_END
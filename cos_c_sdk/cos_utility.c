@@ -4,6 +4,8 @@
 #include "cos_status.h"
 #include "cos_auth.h"
 #include "cos_utility.h"
+#include "cos_meta_cache.h"
+#include "cos_block_cache.h"
 
 #ifndef WIN32
 #include<sys/socket.h>
@@ -227,6 +229,60 @@ void cos_get_object_uri(const cos_request_options_t *options,
 
 }
 
+char *cos_gen_copy_source(const cos_request_options_t *options,
+                          const cos_string_t *bucket,
+                          const cos_string_t *object)
+{
+    int32_t proto_len;
+    const char *proto;
+    cos_string_t raw_endpoint;
+
+    proto = starts_with(&options->config->endpoint, COS_HTTP_PREFIX) ? COS_HTTP_PREFIX : "";
+    proto = starts_with(&options->config->endpoint, COS_HTTPS_PREFIX) ? COS_HTTPS_PREFIX : proto;
+    proto_len = strlen(proto);
+    raw_endpoint.len = options->config->endpoint.len - proto_len;
+    raw_endpoint.data = options->config->endpoint.data + proto_len;
+
+    if (options->config->is_cname) {
+        return apr_psprintf(options->pool, "%.*s/%.*s",
+                            raw_endpoint.len, raw_endpoint.data,
+                            object->len, object->data);
+    }
+    return apr_psprintf(options->pool, "%.*s-%.*s.%.*s/%.*s", 
+                        bucket->len, bucket->data,
+                        options->config->appid.len, options->config->appid.data,
+                        raw_endpoint.len, raw_endpoint.data,
+                        object->len, object->data);
+}
+
+int cos_parse_copy_source(const cos_request_options_t *options, const cos_string_t *copy_source, 
+                          cos_string_t *endpoint, cos_string_t *object)
+{
+    int i = 0;
+    const char *proto;
+    cos_string_t source;
+
+    source = *copy_source;
+    if (starts_with(&source, COS_HTTP_PREFIX)) {
+        source.data += strlen(COS_HTTP_PREFIX);
+        source.len -= strlen(COS_HTTP_PREFIX);
+    } else if (starts_with(&source, COS_HTTPS_PREFIX)) {
+        source.data += strlen(COS_HTTPS_PREFIX);
+        source.len -= strlen(COS_HTTPS_PREFIX);
+    }
+
+    for (; i < source.len && source.data[i] != '/'; i++);
+    if (i == 0 || i + 1 >= source.len) {
+        return COSE_INVALID_ARGUMENT;
+    }
+
+    proto = starts_with(&options->config->endpoint, COS_HTTP_PREFIX) ? COS_HTTP_PREFIX : "";
+    proto = starts_with(&options->config->endpoint, COS_HTTPS_PREFIX) ? COS_HTTPS_PREFIX : proto;
+    cos_str_set(endpoint, apr_psprintf(options->pool, "%s%.*s", proto, i, source.data));
+    cos_str_set(object, apr_pstrndup(options->pool, source.data + i + 1, source.len - i - 1));
+    return COSE_OK;
+}
+
 void cos_get_bucket_uri(const cos_request_options_t *options, 
                         const cos_string_t *bucket,
                         cos_http_request_t *req)
@@ -335,19 +391,29 @@ int cos_write_request_body_from_upload_file(cos_pool_t *p,
 {
     int res = COSE_OK;
     cos_file_buf_t *fb = cos_create_file_buf(p);
-    res = cos_open_file_for_range_read(p, upload_file->filename.data, 
-            upload_file->file_pos, upload_file->file_last, fb);
-    if (res != COSE_OK) {
-        cos_error_log("Open read file fail, filename:%s\n", 
-                      upload_file->filename.data);
-        return res;
+
+    if (NULL != upload_file->file) {
+        // the file is shared by the parts, read by positional io without seek
+        cos_share_file_for_range(upload_file->file, upload_file->file_pos, upload_file->file_last, fb);
+        if (upload_file->direct_io) {
+            fb->align_buf = cos_create_aligned_buf(p, COS_DIRECT_IO_BUF_SIZE, COS_DIRECT_IO_ALIGN);
+        }
+        req->read_body = cos_read_http_body_file_at;
+    } else {
+        res = cos_open_file_for_range_read(p, upload_file->filename.data, 
+                upload_file->file_pos, upload_file->file_last, fb);
+        if (res != COSE_OK) {
+            cos_error_log("Open read file fail, filename:%s\n", 
+                          upload_file->filename.data);
+            return res;
+        }
+        req->read_body = cos_read_http_body_file;
     }
 
     req->body_len = fb->file_last - fb->file_pos;
     req->file_path = upload_file->filename.data;
     req->file_buf = fb;
     req->type = BODY_IN_FILE;
-    req->read_body = cos_read_http_body_file;
 
     return res;
 }
@@ -385,14 +451,21 @@ int cos_init_read_response_body_to_file_part(cos_pool_t *p,
 {
     int res = COSE_OK;
     cos_file_buf_t *fb = cos_create_file_buf(p);
-    res = cos_open_file_for_range_write(p, download_file->filename.data, download_file->file_pos, download_file->file_last, fb);
-    if (res != COSE_OK) {
-        cos_error_log("Open write file fail, filename:%s\n", download_file->filename.data);
-        return res;
+
+    if (NULL != download_file->file) {
+        // the file is shared by the parts, written by positional io without seek
+        cos_share_file_for_range(download_file->file, download_file->file_pos, download_file->file_last, fb);
+        resp->write_body = cos_write_http_body_file_at;
+    } else {
+        res = cos_open_file_for_range_write(p, download_file->filename.data, download_file->file_pos, download_file->file_last, fb);
+        if (res != COSE_OK) {
+            cos_error_log("Open write file fail, filename:%s\n", download_file->filename.data);
+            return res;
+        }
+        resp->write_body = cos_write_http_body_file_part;
     }
     resp->file_path = download_file->filename.data;
     resp->file_buf = fb;
-    resp->write_body = cos_write_http_body_file_part;
     resp->type = BODY_IN_FILE;
 
     return res;
@@ -432,8 +505,31 @@ cos_acl_grantee_content_t *cos_create_acl_list_content(cos_pool_t *p)
 
 cos_list_object_content_t *cos_create_list_object_content(cos_pool_t *p)
 {
-    return (cos_list_object_content_t *)cos_create_api_result_content(
+    cos_list_object_content_t *content;
+    content = (cos_list_object_content_t *)cos_create_api_result_content(
             p, sizeof(cos_list_object_content_t));
+    if (NULL != content) {
+        content->object_size = -1;
+        content->last_modified_epoch = -1;
+    }
+    return content;
+}
+
+cos_list_object_content_t *cos_dup_list_object_content(cos_pool_t *p, const cos_list_object_content_t *content)
+{
+    cos_list_object_content_t *copy;
+
+    copy = cos_create_list_object_content(p);
+    *copy = *content;
+    cos_list_init(&copy->node);
+    copy->key.data = cos_pstrdup(p, &content->key);
+    copy->last_modified.data = cos_pstrdup(p, &content->last_modified);
+    copy->etag.data = cos_pstrdup(p, &content->etag);
+    copy->size.data = cos_pstrdup(p, &content->size);
+    copy->owner_id.data = cos_pstrdup(p, &content->owner_id);
+    copy->owner_display_name.data = cos_pstrdup(p, &content->owner_display_name);
+    copy->storage_class.data = cos_pstrdup(p, &content->storage_class);
+    return copy;
 }
 
 cos_list_object_common_prefix_t *cos_create_list_object_common_prefix(cos_pool_t *p)
@@ -500,6 +596,20 @@ cos_list_object_params_t *cos_create_list_object_params(cos_pool_t *p)
     return params;
 }
 
+cos_parallel_list_object_params_t *cos_create_parallel_list_object_params(cos_pool_t *p)
+{
+    cos_parallel_list_object_params_t *params;
+    params = (cos_parallel_list_object_params_t *)cos_pcalloc(
+            p, sizeof(cos_parallel_list_object_params_t));
+    cos_list_init(&params->split_marker_list);
+    cos_str_set(&params->prefix, "");
+    cos_str_set(&params->marker, "");
+    cos_str_set(&params->delimiter, "/");
+    params->max_ret = COS_PER_RET_NUM;
+    params->sorted = COS_FALSE;
+    return params;
+}
+
 cos_list_upload_part_params_t *cos_create_list_upload_part_params(cos_pool_t *p)
 {
     cos_list_upload_part_params_t *params;
@@ -715,6 +825,13 @@ void cos_set_multipart_content_type(cos_table_t *headers)
     apr_table_set(headers, COS_CONTENT_TYPE, content_type);
 }
 
+void cos_set_range_header(cos_table_t *headers, int64_t start, int64_t end)
+{
+    char range_buf[64];
+    apr_snprintf(range_buf, sizeof(range_buf), "bytes=%"APR_INT64_T_FMT"-%"APR_INT64_T_FMT, start, end-1);
+    apr_table_add(headers, COS_RANGE, range_buf);
+}
+
 const char *get_cos_acl_str(cos_acl_e cos_acl)
 {
     switch (cos_acl) {
@@ -774,10 +891,24 @@ void cos_init_object_request(const cos_request_options_t *options,
         (*req)->progress_callback = cb;
         (*req)->crc64 = init_crc;
     }
+    // the parts do not change the object, complete and abort of the upload invalidate it instead
+    if (HTTP_GET != method && HTTP_HEAD != method && 
+        (NULL == params || NULL == apr_table_get(params, COS_UPLOAD_ID))) {
+        cos_init_object_cache_keys(options, bucket, object, *req);
+    }
 
     cos_get_object_uri(options, bucket, object, *req);
 }
 
+void cos_init_object_cache_keys(const cos_request_options_t *options, 
+                                const cos_string_t *bucket,
+                                const cos_string_t *object, 
+                                cos_http_request_t *req)
+{
+    req->meta_cache_key = cos_meta_cache_key(options->pool, options, bucket, object);
+    req->block_cache_key = cos_block_cache_key(options->pool, options, bucket, object);
+}
+
 #if 0
 void cos_init_live_channel_request(const cos_request_options_t *options, 
                                    const cos_string_t *bucket,
@@ -854,13 +985,24 @@ cos_status_t *cos_process_request(const cos_request_options_t *options,
         return s;
     }
 
-    return cos_send_request(options->ctl, req, resp);
+    options->ctl->cancel_token = options->cancel_token;
+    s = cos_send_request(options->ctl, req, resp);
+
+    // after the request, so a head racing with it does not cache the old metadata
+    if (req->meta_cache_key != NULL) {
+        cos_meta_cache_invalidate_key(req->meta_cache_key);
+    }
+    if (req->block_cache_key != NULL) {
+        cos_block_cache_invalidate_key(req->block_cache_key);
+    }
+    return s;
 }
 
 cos_status_t *cos_process_signed_request(const cos_request_options_t *options,
                                          cos_http_request_t *req, 
                                          cos_http_response_t *resp)
 {
+    options->ctl->cancel_token = options->cancel_token;
     return cos_send_request(options->ctl, req, resp);
 }
 
@@ -69,6 +69,12 @@ void cos_init_object_request(const cos_request_options_t *options, const cos_str
         cos_table_t *params, cos_table_t *headers, cos_progress_callback cb, uint64_t initcrc,
         cos_http_response_t **resp);
 
+/**
+  * @brief  invalidate the cached metadata and blocks of the object after the request
+**/
+void cos_init_object_cache_keys(const cos_request_options_t *options, const cos_string_t *bucket,
+        const cos_string_t *object, cos_http_request_t *req);
+
 /**
   * @brief  init cos live channel request
 **/
@@ -110,6 +116,21 @@ void cos_get_object_uri(const cos_request_options_t *options,
                         const cos_string_t *object,
                         cos_http_request_t *req);
 
+/**
+  * @brief  get the copy source of the object in the bucket of the endpoint, bucket-appid.endpoint/object
+**/
+char *cos_gen_copy_source(const cos_request_options_t *options,
+                          const cos_string_t *bucket,
+                          const cos_string_t *object);
+
+/**
+  * @brief  split the copy source bucket-appid.cos.region.myqcloud.com/object into the object and
+  *         the endpoint of its host, with the protocol of the endpoint of options
+  * @return COSE_OK success, COSE_INVALID_ARGUMENT the copy source has no host or object
+**/
+int cos_parse_copy_source(const cos_request_options_t *options, const cos_string_t *copy_source, 
+                          cos_string_t *endpoint, cos_string_t *object);
+
 /**
   * @brief   bucket uri using third-level domain if hostname is cos domain, otherwise second-level domain
 **/
@@ -162,6 +183,7 @@ void cos_fill_read_response_header(cos_http_response_t *resp, cos_table_t **head
 void *cos_create_api_result_content(cos_pool_t *p, size_t size);
 cos_acl_grantee_content_t *cos_create_acl_list_content(cos_pool_t *p);
 cos_list_object_content_t *cos_create_list_object_content(cos_pool_t *p);
+cos_list_object_content_t *cos_dup_list_object_content(cos_pool_t *p, const cos_list_object_content_t *content);
 cos_list_object_common_prefix_t *cos_create_list_object_common_prefix(cos_pool_t *p);
 cos_list_part_content_t *cos_create_list_part_content(cos_pool_t *p);
 cos_list_multipart_upload_content_t *cos_create_list_multipart_upload_content(cos_pool_t *p);
@@ -172,6 +194,12 @@ cos_complete_part_content_t *cos_create_complete_part_content(cos_pool_t *p);
   * @return cos api list parameters
 **/
 cos_list_object_params_t *cos_create_list_object_params(cos_pool_t *p);
+
+/**
+  * @brief  create cos api parallel list parameters
+  * @return cos api parallel list parameters
+**/
+cos_parallel_list_object_params_t *cos_create_parallel_list_object_params(cos_pool_t *p);
 cos_list_upload_part_params_t *cos_create_list_upload_part_params(cos_pool_t *p);
 cos_list_multipart_upload_params_t *cos_create_list_multipart_upload_params(cos_pool_t *p);
 cos_list_live_channel_params_t *cos_create_list_live_channel_params(cos_pool_t *p);
@@ -196,6 +224,11 @@ cos_upload_file_t *cos_create_upload_file(cos_pool_t *p);
 **/
 void cos_set_multipart_content_type(cos_table_t *headers);
 
+/**
+  * @brief  set the Range header of the bytes [start, end) 
+**/
+void cos_set_range_header(cos_table_t *headers, int64_t start, int64_t end);
+
 /**
   * @brief  create lifecycle rule content
   * @return lifecycle rule content
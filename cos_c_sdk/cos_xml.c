@@ -7,6 +7,7 @@
 #include "cos_utility.h"
 #include "cos_auth.h"
 #include "cos_xml.h"
+#include "cos_xml_stream.h"
 #include "cos_define.h"
 
 static int get_truncated_from_xml(cos_pool_t *p, mxml_node_t *xml_node, const char *truncated_xml_path);
@@ -417,33 +418,117 @@ void cos_list_objects_common_prefix_parse(cos_pool_t *p, mxml_node_t *xml_node,
     }
 }
 
-int cos_list_objects_parse_from_body(cos_pool_t *p, cos_list_t *bc,
-    cos_list_t *object_list, cos_list_t *common_prefix_list, cos_string_t *marker, int *truncated)
+typedef struct {
+    cos_pool_t *p;
+    cos_list_t *object_list;
+    cos_list_t *common_prefix_list;
+    cos_string_t *marker;
+    int *truncated;
+    cos_list_object_content_t *content;        // the Contents being parsed
+    cos_list_object_common_prefix_t *common_prefix; // the CommonPrefixes being parsed
+    int in_owner;
+    int zero_copy;                     // COS_TRUE to refer to the values of Contents in the body
+} cos_list_objects_parser_t;
+
+static void cos_list_objects_start_element(void *user_data, int depth, const char *name)
 {
-    int res;
-    mxml_node_t *root;
-    const char next_marker_xml_path[] = "NextMarker";
-    const char truncated_xml_path[] = "IsTruncated";
-    const char buckets_xml_path[] = "Contents";
-    const char common_prefix_xml_path[] = "CommonPrefixes";
-    char* next_marker;
+    cos_list_objects_parser_t *parser = (cos_list_objects_parser_t *)user_data;
 
-    res = get_xmldoc(bc, &root);
-    if (res == COSE_OK) {
-        next_marker = get_xmlnode_value(p, root, next_marker_xml_path);
-        if (next_marker) {
-            cos_str_set(marker, next_marker);
+    if (2 == depth) {
+        if (0 == strcmp(name, "Contents")) {
+            parser->content = cos_create_list_object_content(parser->p);
+        } else if (0 == strcmp(name, "CommonPrefixes")) {
+            parser->common_prefix = cos_create_list_object_common_prefix(parser->p);
         }
+    } else if (3 == depth && NULL != parser->content && 0 == strcmp(name, "Owner")) {
+        parser->in_owner = COS_TRUE;
+    }
+}
 
-        *truncated = get_truncated_from_xml(p, root, truncated_xml_path);
-        
-        cos_list_objects_contents_parse(p, root, buckets_xml_path, object_list);
-        cos_list_objects_common_prefix_parse(p, root, common_prefix_xml_path, common_prefix_list);
+static void cos_list_objects_end_element(void *user_data, int depth, const char *name,
+                                         const char *text, apr_size_t text_len, int in_body)
+{
+    cos_list_objects_parser_t *parser = (cos_list_objects_parser_t *)user_data;
+    cos_string_t *value = NULL;
+    int64_t epoch;
 
-        mxmlDelete(root);
+    if (2 == depth) {
+        if (0 == strcmp(name, "Contents") && NULL != parser->content) {
+            cos_list_add_tail(&parser->content->node, parser->object_list);
+            parser->content = NULL;
+        } else if (0 == strcmp(name, "CommonPrefixes") && NULL != parser->common_prefix) {
+            cos_list_add_tail(&parser->common_prefix->node, parser->common_prefix_list);
+            parser->common_prefix = NULL;
+        } else if (0 == strcmp(name, "NextMarker")) {
+            value = parser->marker;
+        } else if (0 == strcmp(name, "IsTruncated") && text_len > 0) {
+            *parser->truncated = strcasecmp(text, "false") == 0 ? 0 : 1;
+        }
+    } else if (3 == depth && NULL != parser->content) {
+        if (0 == strcmp(name, "Key")) {
+            value = &parser->content->key;
+        } else if (0 == strcmp(name, "LastModified")) {
+            value = &parser->content->last_modified;
+            if (COSE_OK == cos_iso8601_to_epoch(text, (int)text_len, &epoch)) {
+                parser->content->last_modified_epoch = epoch;
+            }
+        } else if (0 == strcmp(name, "ETag")) {
+            value = &parser->content->etag;
+        } else if (0 == strcmp(name, "Size")) {
+            value = &parser->content->size;
+            parser->content->object_size = cos_atoi64_n(text, (int)text_len);
+        } else if (0 == strcmp(name, "StorageClass")) {
+            value = &parser->content->storage_class;
+        } else if (0 == strcmp(name, "Owner")) {
+            parser->in_owner = COS_FALSE;
+        }
+    } else if (3 == depth && NULL != parser->common_prefix) {
+        if (0 == strcmp(name, "Prefix")) {
+            value = &parser->common_prefix->prefix;
+        }
+    } else if (4 == depth && parser->in_owner) {
+        if (0 == strcmp(name, "ID")) {
+            value = &parser->content->owner_id;
+        } else if (0 == strcmp(name, "DisplayName")) {
+            value = &parser->content->owner_display_name;
+        }
     }
-    
-    return res;
+
+    // an empty element leaves the field as it is, the marker and the common prefixes are always copied
+    if (NULL != value && text_len > 0) {
+        if (in_body && parser->zero_copy && NULL != parser->content && depth > 2) {
+            value->data = (char *)text;
+        } else {
+            value->data = apr_pstrmemdup(parser->p, text, text_len);
+        }
+        value->len = (int)text_len;
+    }
+}
+
+int cos_list_objects_parse_from_body(cos_pool_t *p, cos_list_t *bc,
+    cos_list_t *object_list, cos_list_t *common_prefix_list, cos_string_t *marker, int *truncated)
+{
+    return cos_do_list_objects_parse_from_body(p, bc, object_list, common_prefix_list, 
+        marker, truncated, COS_FALSE);
+}
+
+int cos_do_list_objects_parse_from_body(cos_pool_t *p, cos_list_t *bc,
+    cos_list_t *object_list, cos_list_t *common_prefix_list, cos_string_t *marker, int *truncated,
+    int zero_copy)
+{
+    cos_list_objects_parser_t parser;
+
+    // parsed over the chunks of the body, the values are copied to the pool once, without a document tree
+    memset(&parser, 0, sizeof(parser));
+    parser.p = p;
+    parser.object_list = object_list;
+    parser.common_prefix_list = common_prefix_list;
+    parser.marker = marker;
+    parser.truncated = truncated;
+    parser.zero_copy = zero_copy;
+    *truncated = 0;
+
+    return cos_xml_stream_parse(bc, cos_list_objects_start_element, cos_list_objects_end_element, &parser);
 }
 
 int cos_upload_id_parse_from_body(cos_pool_t *p, cos_list_t *bc, cos_string_t *upload_id)
@@ -518,32 +603,69 @@ void cos_list_parts_content_parse(cos_pool_t *p, mxml_node_t *xml_node, cos_list
     }
 }
 
-int cos_list_parts_parse_from_body(cos_pool_t *p, cos_list_t *bc,
-    cos_list_t *part_list, cos_string_t *partnumber_marker, int *truncated)
+typedef struct {
+    cos_pool_t *p;
+    cos_list_t *part_list;
+    cos_string_t *partnumber_marker;
+    int *truncated;
+    cos_list_part_content_t *content;  // the Part being parsed
+} cos_list_parts_parser_t;
+
+static void cos_list_parts_start_element(void *user_data, int depth, const char *name)
 {
-    int res;
-    mxml_node_t *root;
-    const char next_partnumber_marker_xml_path[] = "NextPartNumberMarker";
-    const char truncated_xml_path[] = "IsTruncated";
-    const char parts_xml_path[] = "Part";
-    char *next_partnumber_marker;
+    cos_list_parts_parser_t *parser = (cos_list_parts_parser_t *)user_data;
 
-    res = get_xmldoc(bc, &root);
-    if (res == COSE_OK) {
-        next_partnumber_marker = get_xmlnode_value(p, root,
-                next_partnumber_marker_xml_path);
-        if (next_partnumber_marker) {
-            cos_str_set(partnumber_marker, next_partnumber_marker);
-        }
+    if (2 == depth && 0 == strcmp(name, "Part")) {
+        parser->content = cos_create_list_part_content(parser->p);
+    }
+}
 
-        *truncated = get_truncated_from_xml(p, root, truncated_xml_path);
+static void cos_list_parts_end_element(void *user_data, int depth, const char *name,
+                                       const char *text, apr_size_t text_len, int in_body)
+{
+    cos_list_parts_parser_t *parser = (cos_list_parts_parser_t *)user_data;
+    cos_string_t *value = NULL;
 
-        cos_list_parts_contents_parse(p, root, parts_xml_path, part_list);
+    if (2 == depth) {
+        if (0 == strcmp(name, "Part") && NULL != parser->content) {
+            cos_list_add_tail(&parser->content->node, parser->part_list);
+            parser->content = NULL;
+        } else if (0 == strcmp(name, "NextPartNumberMarker")) {
+            value = parser->partnumber_marker;
+        } else if (0 == strcmp(name, "IsTruncated") && text_len > 0) {
+            *parser->truncated = strcasecmp(text, "false") == 0 ? 0 : 1;
+        }
+    } else if (3 == depth && NULL != parser->content) {
+        if (0 == strcmp(name, "PartNumber")) {
+            value = &parser->content->part_number;
+        } else if (0 == strcmp(name, "LastModified")) {
+            value = &parser->content->last_modified;
+        } else if (0 == strcmp(name, "ETag")) {
+            value = &parser->content->etag;
+        } else if (0 == strcmp(name, "Size")) {
+            value = &parser->content->size;
+        }
+    }
 
-        mxmlDelete(root);
+    if (NULL != value && text_len > 0) {
+        value->data = apr_pstrmemdup(parser->p, text, text_len);
+        value->len = (int)text_len;
     }
+}
 
-    return res;
+int cos_list_parts_parse_from_body(cos_pool_t *p, cos_list_t *bc,
+    cos_list_t *part_list, cos_string_t *partnumber_marker, int *truncated)
+{
+    cos_list_parts_parser_t parser;
+
+    memset(&parser, 0, sizeof(parser));
+    parser.p = p;
+    parser.part_list = part_list;
+    parser.partnumber_marker = partnumber_marker;
+    parser.truncated = truncated;
+    *truncated = 0;
+
+    return cos_xml_stream_parse(bc, cos_list_parts_start_element, cos_list_parts_end_element, &parser);
 }
 
 void cos_list_multipart_uploads_contents_parse(cos_pool_t *p, mxml_node_t *root, const char *xml_path,
@@ -629,290 +751,185 @@ int cos_list_multipart_uploads_parse_from_body(cos_pool_t *p, cos_list_t *bc,
 
 char *build_complete_multipart_upload_xml(cos_pool_t *p, cos_list_t *bc)
 {
-    char *xml_buff;
-    char *complete_part_xml;
-    cos_string_t xml_doc;
-    mxml_node_t *doc;
-    mxml_node_t *root_node;
+    cos_list_t body;
+
+    build_complete_multipart_upload_body(p, bc, &body);
+    return cos_buf_list_content(p, &body);
+}
+
+void build_complete_multipart_upload_body(cos_pool_t *p, cos_list_t *part_list, cos_list_t *body)
+{
+    cos_xml_writer_t writer;
     cos_complete_part_content_t *content;
+    int size = 64;
 
-    doc = mxmlNewXML("1.0");
-    root_node = mxmlNewElement(doc, "CompleteMultipartUpload");
-    cos_list_for_each_entry(cos_complete_part_content_t, content, bc, node) {
-        mxml_node_t *part_node = mxmlNewElement(root_node, "Part");
-        mxml_node_t *part_number_node = mxmlNewElement(part_node, "PartNumber");
-        mxml_node_t *etag_node = mxmlNewElement(part_node, "ETag");
-        mxmlNewText(part_number_node, 0, content->part_number.data);
-        mxmlNewText(etag_node, 0, content->etag.data);
+    // one buffer for the body of thousands of parts, sized by the values and the tags around them
+    cos_list_for_each_entry(cos_complete_part_content_t, content, part_list, node) {
+        size += 64 + content->part_number.len + content->etag.len;
     }
-    
-    xml_buff = new_xml_buff(doc);
-    if (xml_buff == NULL) {
-        mxmlDelete(doc);
-        return NULL;
+    cos_xml_writer_init(&writer, p, body, size);
+    cos_xml_write_start(&writer, "CompleteMultipartUpload");
+    cos_list_for_each_entry(cos_complete_part_content_t, content, part_list, node) {
+        cos_xml_write_start(&writer, "Part");
+        cos_xml_write_element(&writer, "PartNumber", &content->part_number);
+        cos_xml_write_element(&writer, "ETag", &content->etag);
+        cos_xml_write_end(&writer, "Part");
     }
-    cos_str_set(&xml_doc, xml_buff);
-    complete_part_xml = cos_pstrdup(p, &xml_doc);
-
-    free(xml_buff);
-    mxmlDelete(doc);
-
-    return complete_part_xml;
+    cos_xml_write_end(&writer, "CompleteMultipartUpload");
 }
 
-void build_complete_multipart_upload_body(cos_pool_t *p, cos_list_t *part_list, cos_list_t *body)
+char *build_lifecycle_xml(cos_pool_t *p, cos_list_t *lifecycle_rule_list)
 {
-    char *complete_multipart_upload_xml;
-    cos_buf_t *b;
-    
-    complete_multipart_upload_xml = build_complete_multipart_upload_xml(p, part_list);
-    cos_list_init(body);
-    b = cos_buf_pack(p, complete_multipart_upload_xml, strlen(complete_multipart_upload_xml));
-    cos_list_add_tail(&b->node, body);
+    cos_list_t body;
+
+    build_lifecycle_body(p, lifecycle_rule_list, &body);
+    return cos_buf_list_content(p, &body);
 }
 
-char *build_lifecycle_xml(cos_pool_t *p, cos_list_t *lifecycle_rule_list)
+void build_lifecycle_body(cos_pool_t *p, cos_list_t *lifecycle_rule_list, cos_list_t *body)
 {
-    char *lifecycle_xml;
-    char *xml_buff;
-    cos_string_t xml_doc;
-    mxml_node_t *doc;
-    mxml_node_t *root_node;
+    cos_xml_writer_t writer;
     cos_lifecycle_rule_content_t *content;
-    mxml_node_t *transition_node = NULL;
-    mxml_node_t *expire_node = NULL;
-    mxml_node_t *abort_node = NULL;
-    
-    doc = mxmlNewXML("1.0");
-    root_node = mxmlNewElement(doc, "LifecycleConfiguration");
+    int transition;
+
+    cos_xml_writer_init(&writer, p, body, 0);
+    cos_xml_write_start(&writer, "LifecycleConfiguration");
     cos_list_for_each_entry(cos_lifecycle_rule_content_t, content, lifecycle_rule_list, node) {
-        mxml_node_t *rule_node = mxmlNewElement(root_node, "Rule");
-        mxml_node_t *id_node = mxmlNewElement(rule_node, "ID");
-        mxml_node_t *filter_node = mxmlNewElement(rule_node, "Filter");
-        mxml_node_t *prefix_node = mxmlNewElement(filter_node, "Prefix");
-        mxml_node_t *status_node = mxmlNewElement(rule_node, "Status");
-        mxmlNewText(id_node, 0, content->id.data);
-        mxmlNewText(prefix_node, 0, content->prefix.data);
-        mxmlNewText(status_node, 0, content->status.data);
+        cos_xml_write_start(&writer, "Rule");
+        cos_xml_write_element(&writer, "ID", &content->id);
+        cos_xml_write_start(&writer, "Filter");
+        cos_xml_write_element(&writer, "Prefix", &content->prefix);
+        cos_xml_write_end(&writer, "Filter");
+        cos_xml_write_element(&writer, "Status", &content->status);
         if (content->expire.days != INT_MAX) {
-            char value_str[64];
-            expire_node = mxmlNewElement(rule_node, "Expiration");
-            mxml_node_t *days_node = mxmlNewElement(expire_node, "Days");
-            apr_snprintf(value_str, sizeof(value_str), "%d", content->expire.days);
-            mxmlNewText(days_node, 0, value_str);
+            cos_xml_write_start(&writer, "Expiration");
+            cos_xml_write_element_int(&writer, "Days", content->expire.days);
+            cos_xml_write_end(&writer, "Expiration");
         } else if (content->expire.date.len != 0 && strcmp(content->expire.date.data, "") != 0) {
-            mxml_node_t *expire_node = mxmlNewElement(rule_node, "Expiration");
-            mxml_node_t *date_node = mxmlNewElement(expire_node, "Date");
-            mxmlNewText(date_node, 0, content->expire.date.data);
+            cos_xml_write_start(&writer, "Expiration");
+            cos_xml_write_element(&writer, "Date", &content->expire.date);
+            cos_xml_write_end(&writer, "Expiration");
         }
+        transition = COS_TRUE;
         if (content->transition.days != INT_MAX) {
-            char value_str[64];
-            transition_node = mxmlNewElement(rule_node, "Transition");
-            mxml_node_t *days_node = mxmlNewElement(transition_node, "Days");
-            apr_snprintf(value_str, sizeof(value_str), "%d", content->transition.days);
-            mxmlNewText(days_node, 0, value_str);
+            cos_xml_write_start(&writer, "Transition");
+            cos_xml_write_element_int(&writer, "Days", content->transition.days);
         } else if (content->transition.date.len != 0 && strcmp(content->transition.date.data, "") != 0) {
-            transition_node = mxmlNewElement(rule_node, "Transition");
-            mxml_node_t *date_node = mxmlNewElement(transition_node, "Date");
-            mxmlNewText(date_node, 0, content->transition.date.data);
+            cos_xml_write_start(&writer, "Transition");
+            cos_xml_write_element(&writer, "Date", &content->transition.date);
+        } else {
+            transition = COS_FALSE;
         }
-        if (transition_node && content->transition.storage_class.len != 0 && strcmp(content->transition.storage_class.data, "") != 0) {
-            mxml_node_t *date_node = mxmlNewElement(transition_node, "StorageClass");
-            mxmlNewText(date_node, 0, content->transition.storage_class.data);
+        if (transition) {
+            if (content->transition.storage_class.len != 0 && strcmp(content->transition.storage_class.data, "") != 0) {
+                cos_xml_write_element(&writer, "StorageClass", &content->transition.storage_class);
+            }
+            cos_xml_write_end(&writer, "Transition");
         }
         if (content->abort.days != INT_MAX) {
-            char value_str[64];
-            abort_node = mxmlNewElement(rule_node, "AbortIncompleteMultipartUpload");
-            mxml_node_t *days_node = mxmlNewElement(abort_node, "DaysAfterInitiation");
-            apr_snprintf(value_str, sizeof(value_str), "%d", content->abort.days);
-            mxmlNewText(days_node, 0, value_str);
+            cos_xml_write_start(&writer, "AbortIncompleteMultipartUpload");
+            cos_xml_write_element_int(&writer, "DaysAfterInitiation", content->abort.days);
+            cos_xml_write_end(&writer, "AbortIncompleteMultipartUpload");
         }
+        cos_xml_write_end(&writer, "Rule");
     }
-    
-    xml_buff = new_xml_buff(doc);
-    if (xml_buff == NULL) {
-        mxmlDelete(doc);
-        return NULL;
-    }
-    cos_str_set(&xml_doc, xml_buff);
-    lifecycle_xml = cos_pstrdup(p, &xml_doc);
-    
-    free(xml_buff);
-    mxmlDelete(doc);
-
-    return lifecycle_xml;
-}
-
-void build_lifecycle_body(cos_pool_t *p, cos_list_t *lifecycle_rule_list, cos_list_t *body)
-{
-    char *lifecycle_xml;
-    cos_buf_t *b;
-    lifecycle_xml = build_lifecycle_xml(p, lifecycle_rule_list);
-    cos_list_init(body);
-    b = cos_buf_pack(p, lifecycle_xml, strlen(lifecycle_xml));
-    cos_list_add_tail(&b->node, body);
+    cos_xml_write_end(&writer, "LifecycleConfiguration");
 }
 
 void build_versioning_body(cos_pool_t *p, cos_versioning_content_t *versioning, cos_list_t *body)
 {
-    char *versioning_xml;
-    cos_buf_t *b;
-    versioning_xml = build_versioning_xml(p, versioning);
-    cos_list_init(body);
-    b = cos_buf_pack(p, versioning_xml, strlen(versioning_xml));
-    cos_list_add_tail(&b->node, body);
+    cos_xml_writer_t writer;
+
+    cos_xml_writer_init(&writer, p, body, 0);
+    cos_xml_write_start(&writer, "VersioningConfiguration");
+    cos_xml_write_element(&writer, "Status", &versioning->status);
+    cos_xml_write_end(&writer, "VersioningConfiguration");
 }
 
 char *build_versioning_xml(cos_pool_t *p, cos_versioning_content_t *versioning)
 {
-    char *cors_xml;
-    char *xml_buff;
-    cos_string_t xml_doc;
-    mxml_node_t *doc;
-    mxml_node_t *root_node;
-    
-    doc = mxmlNewXML("1.0");
-    root_node = mxmlNewElement(doc, "VersioningConfiguration");
-    mxml_node_t *status_node = mxmlNewElement(root_node, "Status");
-    mxmlNewText(status_node, 0, versioning->status.data);
-    
-    xml_buff = new_xml_buff(doc);
-    if (xml_buff == NULL) {
-        mxmlDelete(doc);
-        return NULL;
-    }
-    cos_str_set(&xml_doc, xml_buff);
-    cors_xml = cos_pstrdup(p, &xml_doc);
-    
-    free(xml_buff);
-    mxmlDelete(doc);
+    cos_list_t body;
 
-    return cors_xml;
+    build_versioning_body(p, versioning, &body);
+    return cos_buf_list_content(p, &body);
 }
 
 char *build_cors_xml(cos_pool_t *p, cos_list_t *cors_rule_list)
 {
-    char *cors_xml;
-    char *xml_buff;
-    cos_string_t xml_doc;
-    mxml_node_t *doc;
-    mxml_node_t *root_node;
+    cos_list_t body;
+
+    build_cors_body(p, cors_rule_list, &body);
+    return cos_buf_list_content(p, &body);
+}
+
+void build_cors_body(cos_pool_t *p, cos_list_t *cors_rule_list, cos_list_t *body)
+{
+    cos_xml_writer_t writer;
     cos_cors_rule_content_t *content;
-    
-    doc = mxmlNewXML("1.0");
-    root_node = mxmlNewElement(doc, "CORSConfiguration");
+
+    cos_xml_writer_init(&writer, p, body, 0);
+    cos_xml_write_start(&writer, "CORSConfiguration");
     cos_list_for_each_entry(cos_cors_rule_content_t, content, cors_rule_list, node) {
-        mxml_node_t *rule_node = mxmlNewElement(root_node, "CORSRule");
+        cos_xml_write_start(&writer, "CORSRule");
         if (content->id.len !=0 && strcmp(content->id.data, "") != 0) {
-            mxml_node_t *id_node = mxmlNewElement(rule_node, "ID");
-            mxmlNewText(id_node, 0, content->id.data);
+            cos_xml_write_element(&writer, "ID", &content->id);
         }
-        mxml_node_t *allowed_origin_node = mxmlNewElement(rule_node, "AllowedOrigin");
-        mxmlNewText(allowed_origin_node, 0, content->allowed_origin.data);
-        mxml_node_t *allowed_method_node = mxmlNewElement(rule_node, "AllowedMethod");
-        mxmlNewText(allowed_method_node, 0, content->allowed_method.data);
+        cos_xml_write_element(&writer, "AllowedOrigin", &content->allowed_origin);
+        cos_xml_write_element(&writer, "AllowedMethod", &content->allowed_method);
         if (content->allowed_header.len !=0 && strcmp(content->allowed_header.data, "") != 0) {
-            mxml_node_t *allowed_header_node = mxmlNewElement(rule_node, "AllowedHeader");
-            mxmlNewText(allowed_header_node, 0, content->allowed_header.data);
+            cos_xml_write_element(&writer, "AllowedHeader", &content->allowed_header);
         }
         if (content->max_age_seconds != INT_MAX) {
-            char value_str[64];
-            mxml_node_t *max_age_node = mxmlNewElement(rule_node, "MaxAgeSeconds");
-            apr_snprintf(value_str, sizeof(value_str), "%d", content->max_age_seconds);
-            mxmlNewText(max_age_node, 0, value_str);
+            cos_xml_write_element_int(&writer, "MaxAgeSeconds", content->max_age_seconds);
         }
         if (content->expose_header.len !=0 && strcmp(content->expose_header.data, "") != 0) {
-            mxml_node_t *expose_header_node = mxmlNewElement(rule_node, "ExposeHeader");
-            mxmlNewText(expose_header_node, 0, content->expose_header.data);
+            cos_xml_write_element(&writer, "ExposeHeader", &content->expose_header);
         }
+        cos_xml_write_end(&writer, "CORSRule");
     }
-    
-    xml_buff = new_xml_buff(doc);
-    if (xml_buff == NULL) {
-        mxmlDelete(doc);
-        return NULL;
-    }
-    cos_str_set(&xml_doc, xml_buff);
-    cors_xml = cos_pstrdup(p, &xml_doc);
-    
-    free(xml_buff);
-    mxmlDelete(doc);
-
-    return cors_xml;
+    cos_xml_write_end(&writer, "CORSConfiguration");
 }
 
-void build_cors_body(cos_pool_t *p, cos_list_t *cors_rule_list, cos_list_t *body)
+char *build_replication_xml(cos_pool_t *p, cos_replication_params_t *replication_param)
 {
-    char *cors_xml;
-    cos_buf_t *b;
-    cors_xml = build_cors_xml(p, cors_rule_list);
-    cos_list_init(body);
-    b = cos_buf_pack(p, cors_xml, strlen(cors_xml));
-    cos_list_add_tail(&b->node, body);
+    cos_list_t body;
+
+    build_replication_body(p, replication_param, &body);
+    return cos_buf_list_content(p, &body);
 }
 
-char *build_replication_xml(cos_pool_t *p, cos_replication_params_t *replication_param)
+void build_replication_body(cos_pool_t *p, cos_replication_params_t *replication_param, cos_list_t *body)
 {
-    char *replication_xml;
-    char *xml_buff;
-    cos_string_t xml_doc;
-    mxml_node_t *doc;
-    mxml_node_t *root_node;
+    cos_xml_writer_t writer;
     cos_replication_rule_content_t *content = NULL;
-    
-    doc = mxmlNewXML("1.0");
-    root_node = mxmlNewElement(doc, "ReplicationConfiguration");
+
+    cos_xml_writer_init(&writer, p, body, 0);
+    cos_xml_write_start(&writer, "ReplicationConfiguration");
     if (replication_param->role.len !=0 && strcmp(replication_param->role.data, "") != 0) {
-        mxml_node_t *role_node = mxmlNewElement(root_node, "Role");
-        mxmlNewText(role_node, 0, replication_param->role.data);
+        cos_xml_write_element(&writer, "Role", &replication_param->role);
     }
     cos_list_for_each_entry(cos_replication_rule_content_t, content, &replication_param->rule_list, node) {
-        mxml_node_t *rule_node = mxmlNewElement(root_node, "Rule");
+        cos_xml_write_start(&writer, "Rule");
         if (content->id.len !=0 && strcmp(content->id.data, "") != 0) {
-            mxml_node_t *id_node = mxmlNewElement(rule_node, "ID");
-            mxmlNewText(id_node, 0, content->id.data);
+            cos_xml_write_element(&writer, "ID", &content->id);
         }
         if (content->status.len !=0 && strcmp(content->status.data, "") != 0) {
-            mxml_node_t *status_node = mxmlNewElement(rule_node, "Status");
-            mxmlNewText(status_node, 0, content->status.data);
+            cos_xml_write_element(&writer, "Status", &content->status);
         }
         if (content->prefix.len !=0 && strcmp(content->prefix.data, "") != 0) {
-            mxml_node_t *prefix_node = mxmlNewElement(rule_node, "Prefix");
-            mxmlNewText(prefix_node, 0, content->prefix.data);
+            cos_xml_write_element(&writer, "Prefix", &content->prefix);
         }
-        mxml_node_t *dst_node = mxmlNewElement(rule_node, "Destination");
+        cos_xml_write_start(&writer, "Destination");
         if (content->dst_bucket.len !=0 && strcmp(content->dst_bucket.data, "") != 0) {
-            mxml_node_t *bucket_node = mxmlNewElement(dst_node, "Bucket");
-            mxmlNewText(bucket_node, 0, content->dst_bucket.data);
+            cos_xml_write_element(&writer, "Bucket", &content->dst_bucket);
         }
         if (content->storage_class.len !=0 && strcmp(content->storage_class.data, "") != 0) {
-            mxml_node_t *bucket_node = mxmlNewElement(dst_node, "StorageClass");
-            mxmlNewText(bucket_node, 0, content->storage_class.data);
+            cos_xml_write_element(&writer, "StorageClass", &content->storage_class);
         }
+        cos_xml_write_end(&writer, "Destination");
+        cos_xml_write_end(&writer, "Rule");
     }
-    
-    xml_buff = new_xml_buff(doc);
-    if (xml_buff == NULL) {
-        mxmlDelete(doc);
-        return NULL;
-    }
-    cos_str_set(&xml_doc, xml_buff);
-    replication_xml = cos_pstrdup(p, &xml_doc);
-    
-    free(xml_buff);
-    mxmlDelete(doc);
-
-    return replication_xml;
-}
-
-void build_replication_body(cos_pool_t *p, cos_replication_params_t *replication_param, cos_list_t *body)
-{
-    char *cors_xml;
-    cos_buf_t *b;
-    cors_xml = build_replication_xml(p, replication_param);
-    cos_list_init(body);
-    b = cos_buf_pack(p, cors_xml, strlen(cors_xml));
-    cos_list_add_tail(&b->node, body);
+    cos_xml_write_end(&writer, "ReplicationConfiguration");
 }
 
 #if 0
@@ -1254,6 +1271,21 @@ int cos_delete_objects_parse_from_body(cos_pool_t *p, cos_list_t *bc, cos_list_t
     return res;
 }
 
+int cos_delete_objects_failed_parse_from_body(cos_pool_t *p, cos_list_t *bc, cos_list_t *object_list)
+{
+    int res;
+    mxml_node_t *root = NULL;
+    const char error_xml_path[] = "Error";
+
+    res = get_xmldoc(bc, &root);
+    if (res == COSE_OK) {
+        cos_delete_objects_contents_parse(p, root, error_xml_path, object_list);
+        mxmlDelete(root);
+    }
+
+    return res;
+}
+
 #if 0
 void cos_publish_url_parse(cos_pool_t *p, mxml_node_t *node, cos_live_channel_publish_url_t *content)
 {   
@@ -1791,47 +1823,32 @@ int cos_live_channel_history_parse_from_body(cos_pool_t *p, cos_list_t *bc, cos_
 
 char *build_objects_xml(cos_pool_t *p, cos_list_t *object_list, const char *quiet)
 {
-    char *object_xml;
-    char *xml_buff;
-    cos_string_t xml_doc;
-    mxml_node_t *doc;
-    mxml_node_t *root_node;
-    cos_object_key_t *content;
-    mxml_node_t *quiet_node;
+    cos_list_t body;
 
-    doc = mxmlNewXML("1.0");
-    root_node = mxmlNewElement(doc, "Delete");
-    quiet_node = mxmlNewElement(root_node, "Quiet");
-    mxmlNewText(quiet_node, 0, quiet);
-    cos_list_for_each_entry(cos_object_key_t, content, object_list, node) {
-        mxml_node_t *object_node = mxmlNewElement(root_node, "Object");
-        mxml_node_t *key_node = mxmlNewElement(object_node, "Key");
-        mxmlNewText(key_node, 0, content->key.data);
-    }
-
-    xml_buff = new_xml_buff(doc);
-    if (xml_buff == NULL) {
-        return NULL;
-    }
-    cos_str_set(&xml_doc, xml_buff);
-    object_xml = cos_pstrdup(p, &xml_doc);
-
-    free(xml_buff);
-    mxmlDelete(doc);
-
-    return object_xml;
+    build_delete_objects_body(p, object_list, 0 == strcmp(quiet, "true"), &body);
+    return cos_buf_list_content(p, &body);
 }
 
 void build_delete_objects_body(cos_pool_t *p, cos_list_t *object_list, int is_quiet, cos_list_t *body)
 {
-    char *objects_xml;
-    cos_buf_t *b;
-    char *quiet;
-    quiet = is_quiet > 0 ? "true": "false";
-    objects_xml = build_objects_xml(p, object_list, quiet);
-    cos_list_init(body);
-    b = cos_buf_pack(p, objects_xml, strlen(objects_xml));
-    cos_list_add_tail(&b->node, body);
+    cos_xml_writer_t writer;
+    cos_object_key_t *content;
+    int size = 64;
+
+    cos_list_for_each_entry(cos_object_key_t, content, object_list, node) {
+        size += 32 + content->key.len;
+    }
+    cos_xml_writer_init(&writer, p, body, size);
+    cos_xml_write_start(&writer, "Delete");
+    cos_xml_write_start(&writer, "Quiet");
+    cos_xml_write_raw(&writer, is_quiet > 0 ? "true" : "false", is_quiet > 0 ? 4 : 5);
+    cos_xml_write_end(&writer, "Quiet");
+    cos_list_for_each_entry(cos_object_key_t, content, object_list, node) {
+        cos_xml_write_start(&writer, "Object");
+        cos_xml_write_element(&writer, "Key", &content->key);
+        cos_xml_write_end(&writer, "Object");
+    }
+    cos_xml_write_end(&writer, "Delete");
 }
 
 mxml_node_t	*set_xmlnode_value_str(mxml_node_t *parent, const char *name, const cos_string_t *value)
@@ -140,6 +140,8 @@ void cos_list_objects_common_prefix_parse(cos_pool_t *p, mxml_node_t *root, cons
             cos_list_t *common_prefix_list);
 int cos_list_objects_parse_from_body(cos_pool_t *p, cos_list_t *bc, cos_list_t *object_list,
             cos_list_t *common_prefix_list, cos_string_t *marker, int *truncated);
+int cos_do_list_objects_parse_from_body(cos_pool_t *p, cos_list_t *bc, cos_list_t *object_list,
+            cos_list_t *common_prefix_list, cos_string_t *marker, int *truncated, int zero_copy);
 
 /**
   * @brief parse parts from xml body for list upload part
@@ -202,6 +204,7 @@ void cos_delete_objects_contents_parse(cos_pool_t *p, mxml_node_t *root, const c
     cos_list_t *object_list);
 void cos_object_key_parse(cos_pool_t *p, mxml_node_t * xml_node, cos_object_key_t *content);
 int cos_delete_objects_parse_from_body(cos_pool_t *p, cos_list_t *bc, cos_list_t *object_list);
+int cos_delete_objects_failed_parse_from_body(cos_pool_t *p, cos_list_t *bc, cos_list_t *object_list);
 
 /**
   * @brief  build body for create live channel
@@ -0,0 +1,452 @@
+#include "cos_log.h"
+#include "cos_sys_define.h"
+#include "cos_buf.h"
+#include "cos_xml_stream.h"
+
+#define COS_XML_MARKUP_DONE      0
+#define COS_XML_MARKUP_CONTINUE  1
+#define COS_XML_WRITER_MIN_SIZE  1024
+
+static int cos_xml_scratch_append(cos_xml_scratch_t *scratch, const char *data, apr_size_t len)
+{
+    char *buf;
+    apr_size_t cap;
+
+    // the scratch holds one tag or one text, it grows to the longest of them and is reused
+    if (scratch->len + len + 1 > scratch->cap) {
+        cap = cos_max(scratch->cap * 2, scratch->len + len + 1);
+        cap = cos_max(cap, 256);
+        buf = (char *)realloc(scratch->data, cap);
+        if (NULL == buf) {
+            return COSE_OUT_MEMORY;
+        }
+        scratch->data = buf;
+        scratch->cap = cap;
+    }
+    memcpy(scratch->data + scratch->len, data, len);
+    scratch->len += len;
+    scratch->data[scratch->len] = '\0';
+    return COSE_OK;
+}
+
+static apr_size_t cos_xml_utf8_encode(unsigned long code, char *out)
+{
+    if (code < 0x80) {
+        out[0] = (char)code;
+        return 1;
+    }
+    if (code < 0x800) {
+        out[0] = (char)(0xC0 | (code >> 6));
+        out[1] = (char)(0x80 | (code & 0x3F));
+        return 2;
+    }
+    if (code < 0x10000) {
+        out[0] = (char)(0xE0 | (code >> 12));
+        out[1] = (char)(0x80 | ((code >> 6) & 0x3F));
+        out[2] = (char)(0x80 | (code & 0x3F));
+        return 3;
+    }
+    out[0] = (char)(0xF0 | (code >> 18));
+    out[1] = (char)(0x80 | ((code >> 12) & 0x3F));
+    out[2] = (char)(0x80 | ((code >> 6) & 0x3F));
+    out[3] = (char)(0x80 | (code & 0x3F));
+    return 4;
+}
+
+static apr_size_t cos_xml_unescape(char *text, apr_size_t len)
+{
+    char *src = text;
+    char *dst = text;
+    char *end = text + len;
+    char *semi;
+    char *stop;
+    char *name;
+    apr_size_t name_len;
+    unsigned long code;
+
+    // in place, an entity is never shorter than the character it stands for
+    while (src < end) {
+        if ('&' != *src || NULL == (semi = (char *)memchr(src, ';', end - src))) {
+            *dst++ = *src++;
+            continue;
+        }
+        name = src + 1;
+        name_len = semi - name;
+        if (2 == name_len && 0 == strncmp(name, "lt", 2)) {
+            *dst++ = '<';
+        } else if (2 == name_len && 0 == strncmp(name, "gt", 2)) {
+            *dst++ = '>';
+        } else if (3 == name_len && 0 == strncmp(name, "amp", 3)) {
+            *dst++ = '&';
+        } else if (4 == name_len && 0 == strncmp(name, "quot", 4)) {
+            *dst++ = '"';
+        } else if (4 == name_len && 0 == strncmp(name, "apos", 4)) {
+            *dst++ = '\'';
+        } else if (name_len > 1 && '#' == name[0]) {
+            if ('x' == name[1] || 'X' == name[1]) {
+                code = strtoul(name + 2, &stop, 16);
+            } else {
+                code = strtoul(name + 1, &stop, 10);
+            }
+            if (stop != semi || 0 == code || code > 0x10FFFF) {
+                *dst++ = *src++;
+                continue;
+            }
+            dst += cos_xml_utf8_encode(code, dst);
+        } else {
+            // unknown entity, kept as it is
+            *dst++ = *src++;
+            continue;
+        }
+        src = semi + 1;
+    }
+    *dst = '\0';
+    return dst - text;
+}
+
+static int cos_xml_is_space(char c)
+{
+    return ' ' == c || '\t' == c || '\r' == c || '\n' == c;
+}
+
+static int cos_xml_stream_end_element(cos_xml_stream_t *stream, const char *name)
+{
+    if (stream->depth <= 0) {
+        return COSE_XML_PARSE_ERROR;
+    }
+    if (NULL != stream->end_element) {
+        if (stream->leaf && NULL != stream->view) {
+            stream->end_element(stream->user_data, stream->depth, name, stream->view, stream->view_len, COS_TRUE);
+        } else if (stream->leaf && stream->text.len > 0) {
+            stream->end_element(stream->user_data, stream->depth, name, stream->text.data, stream->text.len, COS_FALSE);
+        } else {
+            stream->end_element(stream->user_data, stream->depth, name, "", 0, COS_FALSE);
+        }
+    }
+    stream->depth--;
+    stream->leaf = COS_FALSE;
+    stream->text.len = 0;
+    stream->text_run = 0;
+    stream->view = NULL;
+    if (0 == stream->depth) {
+        stream->root_closed = COS_TRUE;
+    }
+    return COSE_OK;
+}
+
+static int cos_xml_stream_flush_view(cos_xml_stream_t *stream)
+{
+    int res = COSE_OK;
+
+    // more text follows the view, it is copied to be joined with it
+    if (NULL != stream->view) {
+        res = cos_xml_scratch_append(&stream->text, stream->view, stream->view_len);
+        stream->text_run = stream->text.len;
+        stream->view = NULL;
+    }
+    return res;
+}
+
+static int cos_xml_stream_markup(cos_xml_stream_t *stream)
+{
+    char *tag = stream->tag.data;
+    apr_size_t len = stream->tag.len;
+    apr_size_t i;
+    int self_closing;
+
+    if (0 == len) {
+        return COSE_XML_PARSE_ERROR;
+    }
+
+    // comments, cdata and processing instructions may contain '>', they end with their own terminator
+    if (len >= 3 && 0 == strncmp(tag, "!--", 3)) {
+        return (len >= 5 && 0 == strncmp(tag + len - 2, "--", 2)) ?
+            COS_XML_MARKUP_DONE : COS_XML_MARKUP_CONTINUE;
+    }
+    if (len >= 8 && 0 == strncmp(tag, "![CDATA[", 8)) {
+        if (len < 10 || 0 != strncmp(tag + len - 2, "]]", 2)) {
+            return COS_XML_MARKUP_CONTINUE;
+        }
+        // the content of cdata is not unescaped
+        if (stream->depth > 0 && stream->leaf) {
+            if (COSE_OK != cos_xml_stream_flush_view(stream) || 
+                COSE_OK != cos_xml_scratch_append(&stream->text, tag + 8, len - 10)) 
+            {
+                return COSE_OUT_MEMORY;
+            }
+            stream->text_run = stream->text.len;
+        }
+        return COS_XML_MARKUP_DONE;
+    }
+    if ('?' == tag[0]) {
+        return ('?' == tag[len - 1]) ? COS_XML_MARKUP_DONE : COS_XML_MARKUP_CONTINUE;
+    }
+    if ('!' == tag[0]) {
+        // doctype
+        return COS_XML_MARKUP_DONE;
+    }
+
+    if ('/' == tag[0]) {
+        for (i = len; i > 1 && cos_xml_is_space(tag[i - 1]); i--);
+        tag[i] = '\0';
+        return cos_xml_stream_end_element(stream, tag + 1);
+    }
+
+    self_closing = ('/' == tag[len - 1]);
+    for (i = 0; i < len && !cos_xml_is_space(tag[i]) && '/' != tag[i]; i++);
+    tag[i] = '\0';
+    if (0 == i || stream->root_closed) {
+        return COSE_XML_PARSE_ERROR;
+    }
+    stream->depth++;
+    stream->leaf = COS_TRUE;
+    stream->text.len = 0;
+    stream->text_run = 0;
+    stream->view = NULL;
+    if (NULL != stream->start_element) {
+        stream->start_element(stream->user_data, stream->depth, tag);
+    }
+    if (self_closing) {
+        return cos_xml_stream_end_element(stream, tag);
+    }
+    return COS_XML_MARKUP_DONE;
+}
+
+void cos_xml_stream_init(cos_xml_stream_t *stream, cos_xml_start_element_pt start_element,
+                         cos_xml_end_element_pt end_element, void *user_data)
+{
+    memset(stream, 0, sizeof(cos_xml_stream_t));
+    stream->start_element = start_element;
+    stream->end_element = end_element;
+    stream->user_data = user_data;
+    stream->error = COSE_OK;
+}
+
+int cos_xml_stream_feed(cos_xml_stream_t *stream, const char *data, apr_size_t len)
+{
+    const char *pos = data;
+    const char *end = data + len;
+    const char *lt;
+    const char *q;
+    apr_size_t run_len;
+    char first;
+    int res;
+
+    while (COSE_OK == stream->error && pos < end) {
+        if (!stream->in_tag) {
+            // the text outside of a leaf element, such as the indent between elements, is dropped
+            lt = (const char *)memchr(pos, '<', end - pos);
+            run_len = (NULL == lt ? end : lt) - pos;
+            if (stream->depth > 0 && stream->leaf && run_len > 0) {
+                // the text in one chunk without entities is referred to in place instead of copied
+                if (NULL == stream->view && 0 == stream->text.len && NULL != lt && 
+                    NULL == memchr(pos, '&', run_len)) 
+                {
+                    stream->view = pos;
+                    stream->view_len = run_len;
+                    res = COSE_OK;
+                } else {
+                    res = cos_xml_stream_flush_view(stream);
+                    if (COSE_OK == res) {
+                        res = cos_xml_scratch_append(&stream->text, pos, run_len);
+                    }
+                }
+                if (COSE_OK != res) {
+                    stream->error = res;
+                    break;
+                }
+            }
+            if (NULL == lt) {
+                break;
+            }
+            if (stream->text.len > stream->text_run) {
+                stream->text.len = stream->text_run +
+                    cos_xml_unescape(stream->text.data + stream->text_run, stream->text.len - stream->text_run);
+                stream->text_run = stream->text.len;
+            }
+            stream->in_tag = COS_TRUE;
+            stream->quote = 0;
+            stream->tag.len = 0;
+            pos = lt + 1;
+            continue;
+        }
+
+        // the '>' in a quoted attribute value does not end a start tag
+        first = (stream->tag.len > 0) ? stream->tag.data[0] : *pos;
+        for (q = pos; q < end; q++) {
+            if (0 != stream->quote) {
+                if (*q == stream->quote) {
+                    stream->quote = 0;
+                }
+            } else if ('>' == *q) {
+                break;
+            } else if (('"' == *q || '\'' == *q) && '!' != first && '?' != first && '/' != first) {
+                stream->quote = *q;
+            }
+        }
+        res = cos_xml_scratch_append(&stream->tag, pos, q - pos);
+        if (COSE_OK != res) {
+            stream->error = res;
+            break;
+        }
+        if (q == end) {
+            break;
+        }
+        pos = q + 1;
+
+        res = cos_xml_stream_markup(stream);
+        if (COS_XML_MARKUP_CONTINUE == res) {
+            res = cos_xml_scratch_append(&stream->tag, ">", 1);
+            if (COSE_OK != res) {
+                stream->error = res;
+            }
+            continue;
+        }
+        if (COS_XML_MARKUP_DONE != res) {
+            stream->error = res;
+            break;
+        }
+        stream->in_tag = COS_FALSE;
+    }
+
+    if (COSE_OK != stream->error) {
+        cos_error_log("Xml format invalid, stream parse fail, code:%d.\n", stream->error);
+    }
+    return stream->error;
+}
+
+int cos_xml_stream_finish(cos_xml_stream_t *stream)
+{
+    if (COSE_OK == stream->error && (stream->in_tag || !stream->root_closed)) {
+        cos_error_log("Xml format invalid, the root element is not closed.\n");
+        stream->error = COSE_XML_PARSE_ERROR;
+    }
+    return stream->error;
+}
+
+void cos_xml_stream_destroy(cos_xml_stream_t *stream)
+{
+    free(stream->tag.data);
+    free(stream->text.data);
+    memset(&stream->tag, 0, sizeof(cos_xml_scratch_t));
+    memset(&stream->text, 0, sizeof(cos_xml_scratch_t));
+}
+
+int cos_xml_stream_parse(cos_list_t *bc, cos_xml_start_element_pt start_element,
+                         cos_xml_end_element_pt end_element, void *user_data)
+{
+    int res = COSE_OK;
+    cos_buf_t *b;
+    cos_xml_stream_t stream;
+
+    if (cos_list_empty(bc)) {
+        return COSE_XML_PARSE_ERROR;
+    }
+
+    cos_xml_stream_init(&stream, start_element, end_element, user_data);
+    cos_list_for_each_entry(cos_buf_t, b, bc, node) {
+        res = cos_xml_stream_feed(&stream, (const char *)b->pos, (apr_size_t)cos_buf_size(b));
+        if (res != COSE_OK) {
+            break;
+        }
+    }
+    if (res == COSE_OK) {
+        res = cos_xml_stream_finish(&stream);
+    }
+    cos_xml_stream_destroy(&stream);
+
+    return res;
+}
+
+void cos_xml_writer_init(cos_xml_writer_t *writer, cos_pool_t *p, cos_list_t *body, int size)
+{
+    writer->pool = p;
+    writer->body = body;
+    writer->buf = NULL;
+    writer->buf_size = cos_max(size, COS_XML_WRITER_MIN_SIZE);
+    cos_list_init(body);
+    cos_xml_write_raw(writer, "<?xml version=\"1.0\"?>", 21);
+}
+
+void cos_xml_write_raw(cos_xml_writer_t *writer, const char *data, int len)
+{
+    int n;
+
+    while (len > 0) {
+        if (NULL == writer->buf || writer->buf->last == writer->buf->end) {
+            // the estimate is short, the next buffer is as large as the written ones together
+            writer->buf = cos_create_buf(writer->pool, cos_max(writer->buf_size, len));
+            cos_list_add_tail(&writer->buf->node, writer->body);
+            writer->buf_size *= 2;
+        }
+        n = cos_min(len, (int)(writer->buf->end - writer->buf->last));
+        memcpy(writer->buf->last, data, n);
+        writer->buf->last += n;
+        data += n;
+        len -= n;
+    }
+}
+
+void cos_xml_write_text(cos_xml_writer_t *writer, const char *text, int len)
+{
+    const char *run = text;
+    const char *end = text + len;
+    const char *entity;
+
+    for (; text < end; text++) {
+        switch (*text) {
+            case '&':
+                entity = "&amp;";
+                break;
+            case '<':
+                entity = "&lt;";
+                break;
+            case '>':
+                entity = "&gt;";
+                break;
+            case '"':
+                entity = "&quot;";
+                break;
+            default:
+                continue;
+        }
+        cos_xml_write_raw(writer, run, (int)(text - run));
+        cos_xml_write_raw(writer, entity, (int)strlen(entity));
+        run = text + 1;
+    }
+    cos_xml_write_raw(writer, run, (int)(end - run));
+}
+
+void cos_xml_write_start(cos_xml_writer_t *writer, const char *name)
+{
+    cos_xml_write_raw(writer, "<", 1);
+    cos_xml_write_raw(writer, name, (int)strlen(name));
+    cos_xml_write_raw(writer, ">", 1);
+}
+
+void cos_xml_write_end(cos_xml_writer_t *writer, const char *name)
+{
+    cos_xml_write_raw(writer, "</", 2);
+    cos_xml_write_raw(writer, name, (int)strlen(name));
+    cos_xml_write_raw(writer, ">", 1);
+}
+
+void cos_xml_write_element(cos_xml_writer_t *writer, const char *name, const cos_string_t *value)
+{
+    cos_xml_write_start(writer, name);
+    if (NULL != value->data) {
+        cos_xml_write_text(writer, value->data, value->len);
+    }
+    cos_xml_write_end(writer, name);
+}
+
+void cos_xml_write_element_int(cos_xml_writer_t *writer, const char *name, int64_t value)
+{
+    char value_str[COS_MAX_INT64_STRING_LEN];
+    int len;
+
+    len = apr_snprintf(value_str, sizeof(value_str), "%" APR_INT64_T_FMT, value);
+    cos_xml_write_start(writer, name);
+    cos_xml_write_raw(writer, value_str, len);
+    cos_xml_write_end(writer, name);
+}
@@ -0,0 +1,110 @@
+#ifndef LIBCOS_XML_STREAM_H
+#define LIBCOS_XML_STREAM_H
+
+#include "cos_sys_define.h"
+#include "cos_list.h"
+#include "cos_buf.h"
+#include "cos_string.h"
+
+
+COS_CPP_START
+
+/**
+  * @brief called when an element starts, depth of the root element is 1,
+  *        name is valid during the call only
+**/
+typedef void (*cos_xml_start_element_pt)(void *user_data, int depth, const char *name);
+
+/**
+  * @brief called when an element ends, text is the unescaped text of an element without
+  *        child elements, empty for others, name and text are valid during the call only,
+  *        unless in_body is COS_TRUE, then text points into the data fed, which is kept
+  *        by the caller, it is not NUL terminated
+**/
+typedef void (*cos_xml_end_element_pt)(void *user_data, int depth, const char *name,
+                                       const char *text, apr_size_t text_len, int in_body);
+
+typedef struct {
+    char *data;
+    apr_size_t len;
+    apr_size_t cap;
+} cos_xml_scratch_t;
+
+/**
+  * @brief an incremental xml parser without a document tree, the body is fed
+  *        chunk by chunk in order, a tag or text may span chunks
+**/
+typedef struct {
+    cos_xml_start_element_pt start_element;
+    cos_xml_end_element_pt end_element;
+    void *user_data;
+    int in_tag;                 // COS_TRUE if the bytes are in a markup, from '<' to '>'
+    char quote;                 // the quote of the attribute value being read, 0 for none
+    int depth;                  // the number of open elements
+    int leaf;                   // COS_TRUE if the open element has no child element yet
+    int root_closed;            // COS_TRUE once the root element ends
+    int error;
+    cos_xml_scratch_t tag;      // the markup read so far, without '<' and '>'
+    cos_xml_scratch_t text;     // the text of the open element read so far
+    apr_size_t text_run;        // the offset of the text not unescaped yet, it ends at the next '<'
+    const char *view;           // the text in the data fed, if it is in one chunk without entities
+    apr_size_t view_len;
+} cos_xml_stream_t;
+
+void cos_xml_stream_init(cos_xml_stream_t *stream, cos_xml_start_element_pt start_element,
+                         cos_xml_end_element_pt end_element, void *user_data);
+
+/**
+  * @brief parse the next chunk of the body
+  * @return COSE_OK, or COSE_XML_PARSE_ERROR if the body is malformed
+**/
+int cos_xml_stream_feed(cos_xml_stream_t *stream, const char *data, apr_size_t len);
+
+/**
+  * @brief end of the body
+  * @return COSE_OK, or COSE_XML_PARSE_ERROR if the root element is not closed
+**/
+int cos_xml_stream_finish(cos_xml_stream_t *stream);
+
+void cos_xml_stream_destroy(cos_xml_stream_t *stream);
+
+/**
+  * @brief parse the chain of cos_buf_t in place, without copying it to one buffer
+**/
+int cos_xml_stream_parse(cos_list_t *bc, cos_xml_start_element_pt start_element,
+                         cos_xml_end_element_pt end_element, void *user_data);
+
+/**
+  * @brief an xml writer appending to a list of cos_buf_t without a document tree,
+  *        the text is escaped as it is copied, a buffer is added when the last one is full
+**/
+typedef struct {
+    cos_pool_t *pool;
+    cos_list_t *body;
+    cos_buf_t *buf;             // the buffer being filled, the last one of body
+    int buf_size;               // the size of the next buffer
+} cos_xml_writer_t;
+
+/**
+  * @brief init body and the writer, size is the estimated length of the body
+**/
+void cos_xml_writer_init(cos_xml_writer_t *writer, cos_pool_t *p, cos_list_t *body, int size);
+
+void cos_xml_write_raw(cos_xml_writer_t *writer, const char *data, int len);
+
+void cos_xml_write_text(cos_xml_writer_t *writer, const char *text, int len);
+
+void cos_xml_write_start(cos_xml_writer_t *writer, const char *name);
+
+void cos_xml_write_end(cos_xml_writer_t *writer, const char *name);
+
+/**
+  * @brief write <name>value</name>, the value is escaped
+**/
+void cos_xml_write_element(cos_xml_writer_t *writer, const char *name, const cos_string_t *value);
+
+void cos_xml_write_element_int(cos_xml_writer_t *writer, const char *name, int64_t value);
+
+COS_CPP_END
+
+#endif
@@ -586,6 +586,33 @@ void test_resumable()
     
 }
 
+void test_resumable_download_with_checkpoint()
+{
+    cos_pool_t *p = NULL;
+    int is_cname = 0;
+    cos_status_t *s = NULL;
+    cos_request_options_t *options = NULL;
+    cos_string_t bucket;
+    cos_string_t object;
+    cos_string_t filepath;
+    cos_resumable_clt_params_t *clt_params;
+    
+    cos_pool_create(&p, NULL);
+    options = cos_request_options_create(p);
+    init_test_request_options(options, is_cname);
+    cos_str_set(&bucket, TEST_BUCKET_NAME);
+    cos_str_set(&object, TEST_MULTIPART_OBJECT3);
+    cos_str_set(&filepath, TEST_DOWNLOAD_NAME4);
+
+    // the completed parts are saved to TEST_DOWNLOAD_NAME4.dcp, run again to resume
+    clt_params = cos_create_resumable_clt_params_content(p, 5*1024*1024, 3, COS_TRUE, NULL);
+    s = cos_resumable_download_file(options, &bucket, &object, &filepath, NULL, NULL, 
+        clt_params, NULL);
+    log_status(s);
+
+    cos_pool_destroy(p);
+}
+
 void test_resumable_upload_with_multi_threads()
 {
     cos_pool_t *p = NULL;
@@ -621,6 +648,41 @@ void test_resumable_upload_with_multi_threads()
     cos_pool_destroy(p);
 }
 
+int64_t read_from_stdin(void *user_data, char *buffer, int64_t size)
+{
+    size_t bytes = fread(buffer, 1, (size_t)size, stdin);
+    if (0 == bytes && ferror(stdin)) {
+        return -1;
+    }
+    return (int64_t)bytes;
+}
+
+void test_resumable_upload_stream()
+{
+    cos_pool_t *p = NULL;
+    cos_string_t bucket;
+    cos_string_t object;
+    cos_status_t *s = NULL;
+    int is_cname = 0;
+    cos_table_t *resp_headers = NULL;
+    cos_request_options_t *options = NULL;
+    cos_resumable_clt_params_t *clt_params;
+
+    cos_pool_create(&p, NULL);
+    options = cos_request_options_create(p);
+    init_test_request_options(options, is_cname);
+    cos_str_set(&bucket, TEST_BUCKET_NAME);
+    cos_str_set(&object, TEST_MULTIPART_OBJECT4);
+
+    // upload stdin, such as cat file | cos_demo, at most 4 parts of 8MB in memory
+    clt_params = cos_create_resumable_clt_params_content(p, 8 * 1024 * 1024, 4, COS_FALSE, NULL);
+    s = cos_resumable_upload_stream(options, &bucket, &object, NULL, clt_params, 
+        read_from_stdin, NULL, NULL, &resp_headers, NULL);
+    log_status(s);
+
+    cos_pool_destroy(p);
+}
+
 void test_delete_objects()
 {
     cos_pool_t *p = NULL;
@@ -982,6 +1044,8 @@ int main(int argc, char *argv[])
     //abort_multipart_upload();
     //list_multipart();
     //test_resumable();
+    //test_resumable_download_with_checkpoint();
+    //test_resumable_upload_stream();
     //test_resumable_upload_with_multi_threads();test_bucket();
     //test_acl();
     //test_copy();
@@ -362,6 +362,155 @@ void test_list_object_with_delimiter(CuTest *tc)
     printf("test_list_object_with_delimiter ok\n");
 }
 
+typedef struct {
+    cos_pool_t *pool;
+    char *keys;
+    int count;
+    int stop_at;
+} test_list_object_result_t;
+
+int test_list_object_callback(void *user_data, cos_list_object_content_t *content)
+{
+    test_list_object_result_t *result = (test_list_object_result_t *)user_data;
+
+    result->keys = apr_psprintf(result->pool, "%s%s%.*s", result->keys, 
+        result->count > 0 ? "," : "", content->key.len, content->key.data);
+    result->count++;
+    return result->count == result->stop_at;
+}
+
+void test_parallel_list_object(CuTest *tc)
+{
+    cos_pool_t *p = NULL;
+    cos_string_t bucket;
+    cos_request_options_t *options = NULL;
+    int is_cname = 0;
+    cos_status_t *s = NULL;
+    cos_parallel_list_object_params_t *params = NULL;
+    cos_resumable_clt_params_t *clt_params = NULL;
+    cos_object_key_t *split_marker = NULL;
+    test_list_object_result_t result;
+    char *keys = "cos_test_object1,cos_test_object2,cos_tmp1/,cos_tmp2/,cos_tmp3";
+
+    cos_pool_create(&p, NULL);
+    options = cos_request_options_create(p);
+    init_test_request_options(options, is_cname);
+    cos_str_set(&bucket, TEST_BUCKET_NAME);
+    clt_params = cos_create_resumable_clt_params_content(p, 0, 3, COS_FALSE, NULL);
+
+    // partitioned by the common prefixes of "/", the objects beside them are kept in order
+    params = cos_create_parallel_list_object_params(p);
+    cos_str_set(&params->prefix, "cos_");
+    params->max_ret = 1;
+    params->sorted = COS_TRUE;
+    memset(&result, 0, sizeof(result));
+    result.pool = p;
+    result.keys = "";
+    s = cos_parallel_list_object(options, &bucket, params, clt_params, test_list_object_callback, &result);
+    CuAssertIntEquals(tc, 200, s->code);
+    CuAssertIntEquals(tc, 5, result.count);
+    CuAssertStrEquals(tc, keys, result.keys);
+
+    // partitioned by split markers, a partition ends at its marker
+    params = cos_create_parallel_list_object_params(p);
+    cos_str_set(&params->prefix, "cos_");
+    params->max_ret = 1;
+    params->sorted = COS_TRUE;
+    split_marker = cos_create_cos_object_key(p);
+    cos_str_set(&split_marker->key, "cos_test_object1");
+    cos_list_add_tail(&split_marker->node, &params->split_marker_list);
+    split_marker = cos_create_cos_object_key(p);
+    cos_str_set(&split_marker->key, "cos_tmp2/");
+    cos_list_add_tail(&split_marker->node, &params->split_marker_list);
+    memset(&result, 0, sizeof(result));
+    result.pool = p;
+    result.keys = "";
+    s = cos_parallel_list_object(options, &bucket, params, clt_params, test_list_object_callback, &result);
+    CuAssertIntEquals(tc, 200, s->code);
+    CuAssertStrEquals(tc, keys, result.keys);
+
+    // unsorted, every object is emitted once
+    params->sorted = COS_FALSE;
+    memset(&result, 0, sizeof(result));
+    result.pool = p;
+    result.keys = "";
+    s = cos_parallel_list_object(options, &bucket, params, clt_params, test_list_object_callback, &result);
+    CuAssertIntEquals(tc, 200, s->code);
+    CuAssertIntEquals(tc, 5, result.count);
+
+    // stopped by the callback
+    memset(&result, 0, sizeof(result));
+    result.pool = p;
+    result.keys = "";
+    result.stop_at = 2;
+    s = cos_parallel_list_object(options, &bucket, params, clt_params, test_list_object_callback, &result);
+    CuAssertIntEquals(tc, COSE_CANCELLED, s->code);
+    CuAssertIntEquals(tc, 2, result.count);
+
+    cos_pool_destroy(p);
+
+    printf("test_parallel_list_object ok\n");
+}
+
+void test_list_iter(CuTest *tc)
+{
+    cos_pool_t *p = NULL;
+    cos_string_t bucket;
+    cos_request_options_t *options = NULL;
+    int is_cname = 0;
+    cos_status_t *s = NULL;
+    cos_list_object_params_t *params = NULL;
+    cos_list_object_content_t *content = NULL;
+    cos_list_iter_t *iter = NULL;
+    char *keys = "";
+    int size = 0;
+
+    cos_pool_create(&p, NULL);
+    options = cos_request_options_create(p);
+    init_test_request_options(options, is_cname);
+    cos_str_set(&bucket, TEST_BUCKET_NAME);
+
+    // pages of 2 objects, the last page is listed while the first is iterated
+    params = cos_create_list_object_params(p);
+    params->max_ret = 2;
+    cos_str_set(&params->prefix, "cos_");
+    s = cos_list_iter_create(options, &bucket, params, &iter);
+    CuAssertIntEquals(tc, 200, s->code);
+    for (;;) {
+        s = cos_list_iter_next(iter, &content);
+        CuAssertIntEquals(tc, 200, s->code);
+        if (NULL == content) {
+            break;
+        }
+        keys = apr_psprintf(p, "%s%s%.*s", keys, size > 0 ? "," : "", content->key.len, content->key.data);
+        ++size;
+    }
+    cos_list_iter_destroy(iter);
+    CuAssertIntEquals(tc, 5, size);
+    CuAssertStrEquals(tc, "cos_test_object1,cos_test_object2,cos_tmp1/,cos_tmp2/,cos_tmp3", keys);
+
+    // destroyed before the end
+    s = cos_list_iter_create(options, &bucket, params, &iter);
+    CuAssertIntEquals(tc, 200, s->code);
+    s = cos_list_iter_next(iter, &content);
+    CuAssertIntEquals(tc, 200, s->code);
+    CuAssertStrEquals(tc, "cos_test_object1", content->key.data);
+    cos_list_iter_destroy(iter);
+
+    // the failure of listing is returned by next
+    cos_str_set(&bucket, "c-sdk-no-such-bucket");
+    s = cos_list_iter_create(options, &bucket, params, &iter);
+    CuAssertIntEquals(tc, 200, s->code);
+    s = cos_list_iter_next(iter, &content);
+    CuAssertTrue(tc, !cos_status_is_ok(s));
+    CuAssertPtrEquals(tc, NULL, content);
+    cos_list_iter_destroy(iter);
+
+    cos_pool_destroy(p);
+
+    printf("test_list_iter ok\n");
+}
+
 void test_lifecycle(CuTest *tc)
 {
     cos_pool_t *p = NULL;
@@ -582,6 +731,51 @@ void test_delete_objects_by_prefix(CuTest *tc)
     printf("test_delete_object_by_prefix ok\n");
 }
 
+void test_parallel_delete_objects_by_prefix(CuTest *tc)
+{
+    cos_pool_t *p = NULL;
+    cos_request_options_t *options = NULL;
+    int is_cname = 0;
+    cos_string_t bucket;
+    cos_status_t *s = NULL;
+    cos_string_t prefix;
+    cos_table_t *headers = NULL;
+    cos_list_object_params_t *params = NULL;
+    cos_resumable_clt_params_t *clt_params = NULL;
+    char *prefix_str = "cos_tmp4/";
+    char *object_name = NULL;
+    int i = 0;
+
+    cos_pool_create(&p, NULL);
+    options = cos_request_options_create(p);
+    init_test_request_options(options, is_cname);
+    cos_str_set(&bucket, TEST_BUCKET_NAME);
+    cos_str_set(&prefix, prefix_str);
+    for (i = 0; i < 5; i++) {
+        headers = cos_table_make(p, 0);
+        object_name = apr_psprintf(p, "%s%d", prefix_str, i);
+        s = create_test_object(options, TEST_BUCKET_NAME, object_name, "test", headers);
+        CuAssertIntEquals(tc, 200, s->code);
+    }
+
+    clt_params = cos_create_resumable_clt_params_content(p, 0, 3, COS_FALSE, NULL);
+    s = cos_parallel_delete_objects_by_prefix(options, &bucket, &prefix, clt_params);
+    CuAssertIntEquals(tc, 200, s->code);
+
+    params = cos_create_list_object_params(p);
+    cos_str_set(&params->prefix, prefix_str);
+    s = cos_list_object(options, &bucket, params, NULL);
+    CuAssertIntEquals(tc, 200, s->code);
+    CuAssertIntEquals(tc, 1, cos_list_empty(&params->object_list));
+
+    // nothing left to delete
+    s = cos_parallel_delete_objects_by_prefix(options, &bucket, &prefix, clt_params);
+    CuAssertIntEquals(tc, 200, s->code);
+    cos_pool_destroy(p);
+
+    printf("test_parallel_delete_objects_by_prefix ok\n");
+}
+
 CuSuite *test_cos_bucket()
 {
     CuSuite* suite = CuSuiteNew();
@@ -593,11 +787,14 @@ CuSuite *test_cos_bucket()
     SUITE_ADD_TEST(suite, test_delete_objects_by_prefix);
     SUITE_ADD_TEST(suite, test_list_object);
     SUITE_ADD_TEST(suite, test_list_object_with_delimiter);
+    SUITE_ADD_TEST(suite, test_parallel_list_object);
+    SUITE_ADD_TEST(suite, test_list_iter);
     SUITE_ADD_TEST(suite, test_lifecycle);
     SUITE_ADD_TEST(suite, test_bucket_acl);
     SUITE_ADD_TEST(suite, test_bucket_cors);
     SUITE_ADD_TEST(suite, test_delete_objects_quiet);
     SUITE_ADD_TEST(suite, test_delete_objects_not_quiet);
+    SUITE_ADD_TEST(suite, test_parallel_delete_objects_by_prefix);
     SUITE_ADD_TEST(suite, test_delete_bucket);
     SUITE_ADD_TEST(suite, test_bucket_cleanup);
 
@@ -349,7 +349,6 @@ void test_multipart_upload_from_file(CuTest *tc)
     printf("test_multipart_upload_from_file ok\n");
 }
 
-#if 0
 void test_upload_part_copy(CuTest *tc)
 {
     cos_pool_t *p = NULL;
@@ -478,7 +477,6 @@ void test_upload_part_copy(CuTest *tc)
 
     printf("test_upload_part_copy ok\n");
 }
-#endif
 
 void test_upload_file_failed_without_uploadid(CuTest *tc) 
 {
@@ -803,6 +801,7 @@ CuSuite *test_cos_multipart()
     SUITE_ADD_TEST(suite, test_upload_file_failed_without_uploadid);
     SUITE_ADD_TEST(suite, test_upload_file_from_recover);
     SUITE_ADD_TEST(suite, test_upload_file_from_recover_failed);
+    SUITE_ADD_TEST(suite, test_upload_part_copy);
     SUITE_ADD_TEST(suite, test_list_upload_part_with_empty);
     SUITE_ADD_TEST(suite, test_cos_get_sorted_uploaded_part);
     SUITE_ADD_TEST(suite, test_cos_get_sorted_uploaded_part_with_empty);
@@ -7,6 +7,9 @@
 #include "cos_utility.h"
 #include "cos_xml.h"
 #include "cos_api.h"
+#include "cos_meta_cache.h"
+#include "cos_block_cache.h"
+#include "cos_single_flight.h"
 #include "cos_config.h"
 #include "cos_test_util.h"
 
@@ -521,6 +524,294 @@ void test_head_object_with_not_exist(CuTest *tc)
     printf("test_head_object ok\n");
 }
 
+void test_head_object_with_meta_cache(CuTest *tc)
+{
+    cos_pool_t *p = NULL;
+    cos_string_t bucket;
+    cos_string_t object;
+    char *object_name = "cos_test_head_object_with_meta_cache";
+    int is_cname = 0;
+    cos_request_options_t *options = NULL;
+    cos_request_options_t *other_options = NULL;
+    cos_table_t *resp_headers = NULL;
+    cos_status_t *s = NULL;
+
+    cos_pool_create(&p, NULL);
+    options = cos_request_options_create(p);
+    init_test_request_options(options, is_cname);
+    other_options = cos_request_options_create(p);
+    init_test_request_options(other_options, is_cname);
+    cos_str_set(&other_options->config->access_key_id, "invalid_access_key_id");
+    cos_str_set(&bucket, TEST_BUCKET_NAME);
+    cos_str_set(&object, object_name);
+    CuAssertIntEquals(tc, COSE_OK, cos_set_meta_cache(100, 60, 60));
+
+    s = create_test_object(options, TEST_BUCKET_NAME, object_name, "meta cache", NULL);
+    CuAssertIntEquals(tc, 200, s->code);
+
+    /* the second head is served by the cache */
+    s = cos_head_object(options, &bucket, &object, NULL, &resp_headers);
+    CuAssertIntEquals(tc, 200, s->code);
+    CuAssertTrue(tc, 0 != strlen(s->req_id));
+    s = cos_head_object(options, &bucket, &object, NULL, &resp_headers);
+    CuAssertIntEquals(tc, 200, s->code);
+    CuAssertTrue(tc, NULL == s->req_id || 0 == strlen(s->req_id));
+    CuAssertStrEquals(tc, "10", apr_table_get(resp_headers, COS_CONTENT_LENGTH));
+    CuAssertPtrNotNull(tc, apr_table_get(resp_headers, COS_ETAG));
+
+    /* the entry is not served to other credentials */
+    s = cos_head_object(other_options, &bucket, &object, NULL, &resp_headers);
+    CuAssertIntEquals(tc, 403, s->code);
+
+    /* the entry is dropped by the delete of this client, the missing object is cached too */
+    s = delete_test_object(options, TEST_BUCKET_NAME, object_name);
+    CuAssertIntEquals(tc, 204, s->code);
+    s = cos_head_object(options, &bucket, &object, NULL, &resp_headers);
+    CuAssertIntEquals(tc, 404, s->code);
+    CuAssertTrue(tc, 0 != strlen(s->req_id));
+    s = cos_head_object(options, &bucket, &object, NULL, &resp_headers);
+    CuAssertIntEquals(tc, 404, s->code);
+    CuAssertStrEquals(tc, "UnknownError", s->error_code);
+    CuAssertTrue(tc, NULL == s->req_id || 0 == strlen(s->req_id));
+
+    s = create_test_object(options, TEST_BUCKET_NAME, object_name, "meta", NULL);
+    CuAssertIntEquals(tc, 200, s->code);
+    s = cos_head_object(options, &bucket, &object, NULL, &resp_headers);
+    CuAssertIntEquals(tc, 200, s->code);
+    CuAssertStrEquals(tc, "4", apr_table_get(resp_headers, COS_CONTENT_LENGTH));
+
+    delete_test_object(options, TEST_BUCKET_NAME, object_name);
+    cos_set_meta_cache(0, 0, 0);
+    cos_pool_destroy(p);
+
+    printf("test_head_object_with_meta_cache ok\n");
+}
+
+void test_get_object_to_buffer_with_block_cache(CuTest *tc)
+{
+    cos_pool_t *p = NULL;
+    cos_string_t bucket;
+    cos_string_t object;
+    char *object_name = "cos_test_get_object_with_block_cache";
+    int is_cname = 0;
+    cos_request_options_t *options = NULL;
+    cos_request_options_t *other_options = NULL;
+    cos_table_t *headers = NULL;
+    cos_table_t *resp_headers = NULL;
+    cos_status_t *s = NULL;
+    cos_list_t buffer;
+
+    cos_pool_create(&p, NULL);
+    options = cos_request_options_create(p);
+    init_test_request_options(options, is_cname);
+    other_options = cos_request_options_create(p);
+    init_test_request_options(other_options, is_cname);
+    cos_str_set(&other_options->config->access_key_id, "invalid_access_key_id");
+    cos_str_set(&bucket, TEST_BUCKET_NAME);
+    cos_str_set(&object, object_name);
+    CuAssertIntEquals(tc, COSE_OK, cos_set_block_cache(1024 * 1024, 8, 60, NULL, 0));
+
+    s = create_test_object(options, TEST_BUCKET_NAME, object_name, "0123456789abcdefghij", NULL);
+    CuAssertIntEquals(tc, 200, s->code);
+
+    /* the blocks around the range are fetched, the nearby range is served by the cache */
+    headers = cos_table_make(p, 1);
+    apr_table_set(headers, "Range", "bytes=3-5");
+    cos_list_init(&buffer);
+    s = cos_get_object_to_buffer(options, &bucket, &object, headers, NULL, &buffer, &resp_headers);
+    CuAssertIntEquals(tc, 206, s->code);
+    CuAssertTrue(tc, 0 != strlen(s->req_id));
+    CuAssertStrEquals(tc, "345", cos_buf_list_content(p, &buffer));
+    CuAssertStrEquals(tc, "bytes 3-5/20", apr_table_get(resp_headers, "Content-Range"));
+
+    apr_table_set(headers, "Range", "bytes=6-7");
+    cos_list_init(&buffer);
+    s = cos_get_object_to_buffer(options, &bucket, &object, headers, NULL, &buffer, &resp_headers);
+    CuAssertIntEquals(tc, 206, s->code);
+    CuAssertTrue(tc, NULL == s->req_id || 0 == strlen(s->req_id));
+    CuAssertStrEquals(tc, "67", cos_buf_list_content(p, &buffer));
+    CuAssertStrEquals(tc, "2", apr_table_get(resp_headers, COS_CONTENT_LENGTH));
+
+    /* the rest of the object is fetched once */
+    cos_list_init(&buffer);
+    s = cos_get_object_to_buffer(options, &bucket, &object, NULL, NULL, &buffer, &resp_headers);
+    CuAssertIntEquals(tc, 200, s->code);
+    CuAssertStrEquals(tc, "0123456789abcdefghij", cos_buf_list_content(p, &buffer));
+    cos_list_init(&buffer);
+    s = cos_get_object_to_buffer(options, &bucket, &object, NULL, NULL, &buffer, &resp_headers);
+    CuAssertIntEquals(tc, 200, s->code);
+    CuAssertTrue(tc, NULL == s->req_id || 0 == strlen(s->req_id));
+    CuAssertStrEquals(tc, "0123456789abcdefghij", cos_buf_list_content(p, &buffer));
+
+    /* the blocks are not served to other credentials */
+    cos_list_init(&buffer);
+    s = cos_get_object_to_buffer(other_options, &bucket, &object, NULL, NULL, &buffer, &resp_headers);
+    CuAssertIntEquals(tc, 403, s->code);
+
+    /* the blocks are dropped by the put of this client */
+    s = create_test_object(options, TEST_BUCKET_NAME, object_name, "abc", NULL);
+    CuAssertIntEquals(tc, 200, s->code);
+    cos_list_init(&buffer);
+    s = cos_get_object_to_buffer(options, &bucket, &object, NULL, NULL, &buffer, &resp_headers);
+    CuAssertIntEquals(tc, 200, s->code);
+    CuAssertStrEquals(tc, "abc", cos_buf_list_content(p, &buffer));
+
+    delete_test_object(options, TEST_BUCKET_NAME, object_name);
+    cos_pool_destroy(p);
+    cos_set_block_cache(0, COS_BLOCK_CACHE_DEFAULT_BLOCK_SIZE, 0, NULL, 0);
+
+    printf("test_get_object_to_buffer_with_block_cache ok\n");
+}
+
+void test_get_object_to_buffer_with_single_flight(CuTest *tc)
+{
+    cos_pool_t *p = NULL;
+    cos_pool_t *sub_pool = NULL;
+    cos_string_t bucket;
+    cos_string_t object;
+    char *object_name = "cos_test_get_object_with_single_flight";
+    int is_cname = 0;
+    cos_request_options_t *options = NULL;
+    cos_request_options_t *sub_options = NULL;
+    cos_table_t *headers = NULL;
+    cos_table_t *resp_headers = NULL;
+    cos_status_t *s = NULL;
+    cos_list_t buffer;
+
+    cos_pool_create(&p, NULL);
+    options = cos_request_options_create(p);
+    init_test_request_options(options, is_cname);
+    cos_str_set(&bucket, TEST_BUCKET_NAME);
+    cos_str_set(&object, object_name);
+    CuAssertIntEquals(tc, COSE_OK, cos_set_single_flight(COS_TRUE));
+
+    s = create_test_object(options, TEST_BUCKET_NAME, object_name, "0123456789", NULL);
+    CuAssertIntEquals(tc, 200, s->code);
+
+    /* the response of a shared read is kept until the pool of the caller is destroyed */
+    cos_pool_create(&sub_pool, p);
+    sub_options = cos_request_options_create(sub_pool);
+    init_test_request_options(sub_options, is_cname);
+    headers = cos_table_make(sub_pool, 1);
+    apr_table_set(headers, "Range", "bytes=2-4");
+    cos_list_init(&buffer);
+    s = cos_get_object_to_buffer(sub_options, &bucket, &object, headers, NULL, &buffer, &resp_headers);
+    CuAssertIntEquals(tc, 206, s->code);
+    CuAssertTrue(tc, 0 != strlen(s->req_id));
+    CuAssertStrEquals(tc, "234", cos_buf_list_content(sub_pool, &buffer));
+    CuAssertStrEquals(tc, "3", apr_table_get(resp_headers, COS_CONTENT_LENGTH));
+    cos_pool_destroy(sub_pool);
+
+    cos_list_init(&buffer);
+    s = cos_get_object_to_buffer(options, &bucket, &object, NULL, NULL, &buffer, &resp_headers);
+    CuAssertIntEquals(tc, 200, s->code);
+    CuAssertStrEquals(tc, "0123456789", cos_buf_list_content(p, &buffer));
+
+    s = cos_head_object(options, &bucket, &object, NULL, &resp_headers);
+    CuAssertIntEquals(tc, 200, s->code);
+    CuAssertStrEquals(tc, "10", apr_table_get(resp_headers, COS_CONTENT_LENGTH));
+
+    delete_test_object(options, TEST_BUCKET_NAME, object_name);
+    s = cos_head_object(options, &bucket, &object, NULL, &resp_headers);
+    CuAssertIntEquals(tc, 404, s->code);
+
+    cos_pool_destroy(p);
+    cos_set_single_flight(COS_FALSE);
+
+    printf("test_get_object_to_buffer_with_single_flight ok\n");
+}
+
+typedef struct {
+    cos_pool_t *pool;
+    cos_request_options_t *options;
+    apr_thread_mutex_t *start;      // held by the test until all readers are created
+    cos_status_t *s;
+    char *body;
+} flight_reader_t;
+
+void * APR_THREAD_FUNC get_object_in_flight(apr_thread_t *thd, void *data)
+{
+    flight_reader_t *reader = (flight_reader_t *)data;
+    cos_string_t bucket;
+    cos_string_t object;
+    cos_table_t *resp_headers = NULL;
+    cos_list_t buffer;
+
+    cos_str_set(&bucket, TEST_BUCKET_NAME);
+    cos_str_set(&object, "cos_test_get_object_with_concurrent_single_flight");
+    apr_thread_mutex_lock(reader->start);
+    apr_thread_mutex_unlock(reader->start);
+
+    cos_list_init(&buffer);
+    reader->s = cos_get_object_to_buffer(reader->options, &bucket, &object, NULL, NULL, &buffer, &resp_headers);
+    reader->body = cos_buf_list_content(reader->pool, &buffer);
+    apr_thread_exit(thd, APR_SUCCESS);
+    return NULL;
+}
+
+void test_get_object_to_buffer_with_concurrent_single_flight(CuTest *tc)
+{
+    cos_pool_t *p = NULL;
+    char *object_name = "cos_test_get_object_with_concurrent_single_flight";
+    int is_cname = 0;
+    cos_request_options_t *options = NULL;
+    cos_status_t *s = NULL;
+    apr_thread_mutex_t *start = NULL;
+    apr_thread_t *threads[8];
+    flight_reader_t readers[8];
+    apr_status_t rv;
+    char *data;
+    int size = 4 * 1024 * 1024;
+    int i;
+
+    cos_pool_create(&p, NULL);
+    options = cos_request_options_create(p);
+    init_test_request_options(options, is_cname);
+    CuAssertIntEquals(tc, COSE_OK, cos_set_single_flight(COS_TRUE));
+
+    /* large enough that the readers join the flight while it is downloading */
+    data = (char *)cos_palloc(p, size + 1);
+    for (i = 0; i < size; i++) {
+        data[i] = 'a' + i % 26;
+    }
+    data[size] = '\0';
+    s = create_test_object(options, TEST_BUCKET_NAME, object_name, data, NULL);
+    CuAssertIntEquals(tc, 200, s->code);
+
+    CuAssertIntEquals(tc, APR_SUCCESS, apr_thread_mutex_create(&start, APR_THREAD_MUTEX_DEFAULT, p));
+    apr_thread_mutex_lock(start);
+    for (i = 0; i < 8; i++) {
+        cos_pool_create(&readers[i].pool, NULL);
+        readers[i].options = cos_request_options_create(readers[i].pool);
+        init_test_request_options(readers[i].options, is_cname);
+        readers[i].start = start;
+        readers[i].s = NULL;
+        readers[i].body = NULL;
+        CuAssertIntEquals(tc, APR_SUCCESS, apr_thread_create(&threads[i], NULL, get_object_in_flight, &readers[i], p));
+    }
+    apr_thread_mutex_unlock(start);
+    for (i = 0; i < 8; i++) {
+        apr_thread_join(&rv, threads[i]);
+    }
+
+    /* the readers share the response of a single request */
+    for (i = 0; i < 8; i++) {
+        CuAssertIntEquals(tc, 200, readers[i].s->code);
+        CuAssertTrue(tc, 0 != strlen(readers[i].s->req_id));
+        CuAssertStrEquals(tc, readers[0].s->req_id, readers[i].s->req_id);
+        CuAssertTrue(tc, 0 == strcmp(data, readers[i].body));
+    }
+    for (i = 0; i < 8; i++) {
+        cos_pool_destroy(readers[i].pool);
+    }
+
+    delete_test_object(options, TEST_BUCKET_NAME, object_name);
+    cos_pool_destroy(p);
+    cos_set_single_flight(COS_FALSE);
+
+    printf("test_get_object_to_buffer_with_concurrent_single_flight ok\n");
+}
+
 void test_delete_object(CuTest *tc)
 {
     cos_pool_t *p = NULL;
@@ -749,6 +1040,10 @@ CuSuite *test_cos_object()
     SUITE_ADD_TEST(suite, test_get_object_to_file);
     SUITE_ADD_TEST(suite, test_head_object);
     SUITE_ADD_TEST(suite, test_head_object_with_not_exist);
+    SUITE_ADD_TEST(suite, test_head_object_with_meta_cache);
+    SUITE_ADD_TEST(suite, test_get_object_to_buffer_with_block_cache);
+    SUITE_ADD_TEST(suite, test_get_object_to_buffer_with_single_flight);
+    SUITE_ADD_TEST(suite, test_get_object_to_buffer_with_concurrent_single_flight);
     SUITE_ADD_TEST(suite, test_object_acl);
     SUITE_ADD_TEST(suite, test_object_copy);
     SUITE_ADD_TEST(suite, test_delete_object);
@@ -100,6 +100,10 @@ void test_resumable_cos_get_checkpoint_path(CuTest *tc)
     cos_resumable_clt_params_t *clt_params;
     cos_string_t file_path = cos_null_string;
     cos_string_t checkpoint_path = cos_null_string;
+    cos_string_t other_path = cos_null_string;
+    cos_string_t copy_source;
+    cos_string_t bucket;
+    cos_string_t object;
 
     cos_pool_create(&p, NULL);
 
@@ -136,6 +140,22 @@ void test_resumable_cos_get_checkpoint_path(CuTest *tc)
     cos_get_checkpoint_path(clt_params, &file_path, p, &checkpoint_path);
     CuAssertStrEquals(tc, "/home/tim/work/cos/BingWallpaper-2017-01-19.jpg.cp", checkpoint_path.data);
 
+    // copy, the default path is in the temp dir and depends on the source and the destination
+    cos_str_set(&copy_source, "bucket-1250000000.cos.ap-guangzhou.myqcloud.com/dir/a.jpg");
+    cos_str_set(&bucket, "bucket-1250000000");
+    cos_str_set(&object, "dir/sub/b.jpg");
+    clt_params = cos_create_resumable_clt_params_content(p, 1024 * 100, 1024, COS_TRUE, NULL);
+    cos_get_copy_checkpoint_path(clt_params, &copy_source, &bucket, &object, p, &checkpoint_path);
+    CuAssertTrue(tc, NULL == strstr(checkpoint_path.data, "dir/sub"));
+    CuAssertTrue(tc, NULL != strstr(checkpoint_path.data, ".ccp"));
+    cos_str_set(&copy_source, "bucket-1250000000.cos.ap-guangzhou.myqcloud.com/dir/c.jpg");
+    cos_get_copy_checkpoint_path(clt_params, &copy_source, &bucket, &object, p, &other_path);
+    CuAssertTrue(tc, strcmp(checkpoint_path.data, other_path.data) != 0);
+
+    clt_params = cos_create_resumable_clt_params_content(p, 1024 * 100, 1024, COS_TRUE, "b.jpg.ccp");
+    cos_get_copy_checkpoint_path(clt_params, &copy_source, &bucket, &object, p, &checkpoint_path);
+    CuAssertStrEquals(tc, "b.jpg.ccp", checkpoint_path.data);
+
     cos_pool_destroy(p);
 
     printf("test_resumable_cos_get_checkpoint_path ok\n");
@@ -325,6 +345,112 @@ void test_resumable_cos_load_checkpoint(CuTest *tc)
     printf("test_resumable_cos_load_checkpoint ok\n");
 }
 
+void test_resumable_cos_append_checkpoint(CuTest *tc)
+{
+    cos_pool_t *p = NULL;
+    cos_string_t file_path = cos_null_string;
+    char *cp_file = "test_resumable_cos_append_checkpoint.ucp";
+    cos_checkpoint_t *cp;
+    cos_checkpoint_t *cp_l;
+    apr_finfo_t finfo;
+    cos_string_t upload_id;
+    cos_string_t etag;
+    char *xml_body;
+    apr_size_t len;
+    apr_file_t *thefile;
+    unsigned char journal[8192];
+    unsigned char *record;
+    int xml_len;
+    int64_t part_size;
+    int i;
+    int rv;
+
+    cos_pool_create(&p, NULL);
+
+    // build checkpoint
+    finfo.size = 510598;
+    finfo.mtime = 1459922563;  
+    cos_str_set(&file_path, "D:\\work\\cos\\BingWallpaper-2017-01-19.jpg");
+    cos_str_set(&upload_id, "0004B9894A22E5B1888A1E29F8236E2D");
+    part_size = 1024 * 100;
+
+    cp = cos_create_checkpoint_content(p);
+    cos_build_upload_checkpoint(p, cp, &file_path, &finfo, &upload_id, part_size);
+
+    cos_str_set(&file_path, cp_file);
+    rv = cos_open_checkpoint_file(p, &file_path, cp); 
+    CuAssertIntEquals(tc, APR_SUCCESS, rv);
+    rv = cos_dump_checkpoint(p, cp);
+    CuAssertIntEquals(tc, COSE_OK, rv);
+
+    // append the completed parts, the etag too long for a record compacts the journal
+    cos_str_set(&etag, "\"4D3F1E2B4E5A34D7C6F31A7AC8D0A6C2\"");
+    rv = cos_append_checkpoint(p, cp, 0, &etag);
+    CuAssertIntEquals(tc, COSE_OK, rv);
+    cos_str_set(&etag, "\"4D3F1E2B4E5A34D7C6F31A7AC8D0A6C2-4D3F1E2B4E5A34D7C6F31A7AC8D0A6C2\"");
+    rv = cos_append_checkpoint(p, cp, 2, &etag);
+    CuAssertIntEquals(tc, COSE_OK, rv);
+    cos_str_set(&etag, "\"5E4F2F3C5F6B45E8D7F42B8BD9E1B7D3\"");
+    rv = cos_append_checkpoint(p, cp, 4, &etag);
+    CuAssertIntEquals(tc, COSE_OK, rv);
+
+    // a torn record at the tail
+    len = 10;
+    rv = apr_file_write_full(cp->thefile, "0123456789", len, &len);
+    CuAssertIntEquals(tc, APR_SUCCESS, rv);
+    rv = cos_close_checkpoint_file(cp);
+    CuAssertIntEquals(tc, APR_SUCCESS, rv);
+
+    // the integers of the journal are little endian, the record of part 4 follows the compacted xml
+    rv = apr_file_open(&thefile, cp_file, APR_READ, APR_UREAD | APR_GREAD, p);
+    CuAssertIntEquals(tc, APR_SUCCESS, rv);
+    rv = apr_file_read_full(thefile, journal, sizeof(journal), &len);
+    apr_file_close(thefile);
+    CuAssertIntEquals(tc, APR_EOF, rv);
+    xml_len = journal[COS_CP_JOURNAL_MAGIC_LEN] | (journal[COS_CP_JOURNAL_MAGIC_LEN + 1] << 8) | 
+              (journal[COS_CP_JOURNAL_MAGIC_LEN + 2] << 16);
+    CuAssertIntEquals(tc, COS_CP_JOURNAL_HEADER_LEN + xml_len + COS_CP_JOURNAL_RECORD_LEN + 10, (int)len);
+    record = journal + COS_CP_JOURNAL_HEADER_LEN + xml_len;
+    CuAssertIntEquals(tc, 4, record[0]);
+    CuAssertIntEquals(tc, 0, record[1] | record[2] | record[3]);
+    CuAssertIntEquals(tc, etag.len, record[4]);
+    CuAssertIntEquals(tc, 0, record[5] | record[6] | record[7]);
+    CuAssertIntEquals(tc, 0, memcmp(record + 8, etag.data, etag.len));
+
+    // load
+    cp_l = cos_create_checkpoint_content(p);
+    rv = cos_load_checkpoint(p, &file_path, cp_l);
+    CuAssertIntEquals(tc, COSE_OK, rv);
+    CuAssertStrEquals(tc, cp->upload_id.data, cp_l->upload_id.data);
+    CuAssertIntEquals(tc, cp->part_num, cp_l->part_num);
+    for (i = 0; i < cp->part_num; i++) {
+        CuAssertIntEquals(tc, cp->parts[i].completed, cp_l->parts[i].completed);
+        CuAssertStrEquals(tc, cp->parts[i].etag.data, cp_l->parts[i].etag.data);
+    }
+    CuAssertIntEquals(tc, COS_FALSE, cp_l->parts[1].completed);
+
+    // the checkpoint of old version
+    apr_file_remove(cp_file, p);
+    rv = apr_file_open(&cp->thefile, cp_file, APR_CREATE | APR_WRITE, APR_UREAD | APR_UWRITE | APR_GREAD, p);
+    CuAssertIntEquals(tc, APR_SUCCESS, rv);
+    xml_body = cos_build_checkpoint_xml(p, cp);
+    rv = apr_file_write_full(cp->thefile, xml_body, strlen(xml_body), &len);
+    CuAssertIntEquals(tc, APR_SUCCESS, rv);
+    apr_file_close(cp->thefile);
+
+    cp_l = cos_create_checkpoint_content(p);
+    rv = cos_load_checkpoint(p, &file_path, cp_l);
+    CuAssertIntEquals(tc, COSE_OK, rv);
+    CuAssertIntEquals(tc, COS_TRUE, cp_l->parts[4].completed);
+    CuAssertStrEquals(tc, cp->parts[4].etag.data, cp_l->parts[4].etag.data);
+
+    apr_file_remove(cp_file, p);
+
+    cos_pool_destroy(p);
+
+    printf("test_resumable_cos_append_checkpoint ok\n");
+}
+
 void test_resumable_cos_is_upload_checkpoint_valid(CuTest *tc)
 {
     cos_pool_t *p = NULL;
@@ -363,6 +489,74 @@ void test_resumable_cos_is_upload_checkpoint_valid(CuTest *tc)
     printf("test_resumable_cos_is_upload_checkpoint_valid ok\n");
 }
 
+void test_resumable_cos_is_download_checkpoint_valid(CuTest *tc)
+{
+    cos_pool_t *p = NULL;
+    cos_string_t file_path = cos_null_string;
+    cos_string_t checkpoint_path = cos_null_string;
+    cos_resumable_clt_params_t *clt_params;
+    cos_checkpoint_t *cp;
+    cos_checkpoint_t *cp_l;
+    char *object_name = "test_3M.dat";
+    char *last_modified = "Thu, 19 Jan 2017 02:20:44 GMT";
+    char *etag = "\"f5f5c4a9b2b7e4dd9b2c8fb1f2d9a30e\"";
+    int64_t object_size = 3 * 1024 * 1024 + 1;
+    int rv;
+
+    cos_pool_create(&p, NULL);
+
+    // checkpoint path
+    cos_str_set(&file_path, "/home/tim/work/cos/download.dat");
+    clt_params = cos_create_resumable_clt_params_content(p, 1024 * 1024, 3, COS_TRUE, NULL);
+    cos_get_download_checkpoint_path(clt_params, &file_path, p, &checkpoint_path);
+    CuAssertStrEquals(tc, "/home/tim/work/cos/download.dat.dcp", checkpoint_path.data);
+
+    // build checkpoint
+    cp = cos_create_checkpoint_content(p);
+    cos_build_download_checkpoint(p, cp, &file_path, object_name, object_size, last_modified, etag, 1024 * 1024);
+    CuAssertIntEquals(tc, COS_CP_DOWNLOAD, cp->cp_type);
+    CuAssertIntEquals(tc, 4, cp->part_num);
+    CuAssertTrue(tc, 1 == cp->parts[3].size);
+    CuAssertTrue(tc, 3 * 1024 * 1024 == cp->parts[3].offset);
+
+    rv = cos_is_download_checkpoint_valid(p, cp, object_name, object_size, last_modified, etag);
+    CuAssertTrue(tc, rv);
+
+    // object changed
+    rv = cos_is_download_checkpoint_valid(p, cp, object_name, object_size - 1, last_modified, etag);
+    CuAssertTrue(tc, !rv);
+
+    rv = cos_is_download_checkpoint_valid(p, cp, object_name, object_size, last_modified, "\"0\"");
+    CuAssertTrue(tc, !rv);
+
+    rv = cos_is_download_checkpoint_valid(p, cp, object_name, object_size, "Fri, 20 Jan 2017 02:20:44 GMT", etag);
+    CuAssertTrue(tc, !rv);
+
+    rv = cos_is_download_checkpoint_valid(p, cp, "test_3M_other.dat", object_size, last_modified, etag);
+    CuAssertTrue(tc, !rv);
+
+    // the object without etag and last modified, the empty values are loaded as NULL
+    cp = cos_create_checkpoint_content(p);
+    cos_build_download_checkpoint(p, cp, &file_path, object_name, object_size, "", "", 1024 * 1024);
+    cp_l = cos_create_checkpoint_content(p);
+    rv = cos_checkpoint_parse_from_body(p, cos_build_checkpoint_xml(p, cp), cp_l);
+    CuAssertIntEquals(tc, COSE_OK, rv);
+    rv = cos_is_download_checkpoint_valid(p, cp_l, object_name, object_size, "", "");
+    CuAssertTrue(tc, rv);
+
+    rv = cos_is_download_checkpoint_valid(p, cp_l, object_name, object_size, "", etag);
+    CuAssertTrue(tc, !rv);
+
+    // upload checkpoint
+    cp->cp_type = COS_CP_UPLOAD;
+    rv = cos_is_download_checkpoint_valid(p, cp, object_name, object_size, last_modified, etag);
+    CuAssertTrue(tc, !rv);
+
+    cos_pool_destroy(p);
+
+    printf("test_resumable_cos_is_download_checkpoint_valid ok\n");
+}
+
 void test_resumable_checkpoint_xml(CuTest *tc)
 {
     cos_pool_t *p = NULL;
@@ -1165,6 +1359,230 @@ void test_resumable_upload_progress_with_checkpoint(CuTest *tc)
     printf("test_resumable_upload_progress_with_checkpoint ok\n");
 }
 
+int64_t read_stream_from_file(void *user_data, char *buffer, int64_t size)
+{
+    FILE *fd = (FILE *)user_data;
+    size_t bytes;
+
+    // a pipe returns short reads, so does this
+    bytes = fread(buffer, 1, (size_t)cos_min(size, 64 * 1024), fd);
+    if (0 == bytes && ferror(fd)) {
+        return -1;
+    }
+    return (int64_t)bytes;
+}
+
+int64_t read_stream_failed(void *user_data, char *buffer, int64_t size)
+{
+    return -1;
+}
+
+void test_resumable_upload_stream(CuTest *tc)
+{
+    cos_pool_t *p = NULL;
+    char *object_name = "test_resumable_upload_stream.jpg";
+    cos_string_t bucket;
+    cos_string_t object;
+    cos_status_t *s = NULL;
+    int is_cname = 0;
+    cos_table_t *headers = NULL;
+    cos_table_t *resp_headers = NULL;
+    cos_list_t resp_body;
+    cos_request_options_t *options = NULL;
+    cos_resumable_clt_params_t *clt_params;
+    int64_t content_length = 0;
+    FILE *fd = NULL;
+
+    cos_pool_create(&p, NULL);
+    options = cos_request_options_create(p);
+    init_test_request_options(options, is_cname);
+    headers = cos_table_make(p, 0);
+    cos_str_set(&bucket, TEST_BUCKET_NAME);
+    cos_str_set(&object, object_name);
+    cos_list_init(&resp_body);
+
+    // upload object from stream, part size 1MB, 3 part buffers
+    fd = fopen(test_local_file, "rb");
+    CuAssertTrue(tc, fd != NULL);
+    clt_params = cos_create_resumable_clt_params_content(p, 1024 * 1024, 3, COS_FALSE, NULL);
+    s = cos_resumable_upload_stream(options, &bucket, &object, headers, clt_params, 
+        read_stream_from_file, fd, percentage, &resp_headers, &resp_body);
+    CuAssertIntEquals(tc, 200, s->code);
+    fclose(fd);
+
+    cos_pool_destroy(p);
+
+    // head object
+    cos_pool_create(&p, NULL);
+    options = cos_request_options_create(p);
+    init_test_request_options(options, is_cname);
+    s = cos_head_object(options, &bucket, &object, NULL, &resp_headers);
+    CuAssertIntEquals(tc, 200, s->code);
+
+    content_length = atol((char*)apr_table_get(resp_headers, COS_CONTENT_LENGTH));
+    CuAssertTrue(tc, content_length == get_file_size(test_local_file));
+
+    cos_pool_destroy(p);
+
+    // the upload is aborted when the stream fails
+    cos_pool_create(&p, NULL);
+    options = cos_request_options_create(p);
+    init_test_request_options(options, is_cname);
+    cos_list_init(&resp_body);
+    clt_params = cos_create_resumable_clt_params_content(p, 1024 * 1024, 3, COS_FALSE, NULL);
+    s = cos_resumable_upload_stream(options, &bucket, &object, NULL, clt_params, 
+        read_stream_failed, NULL, NULL, &resp_headers, &resp_body);
+    CuAssertIntEquals(tc, COSE_READ_BODY_ERROR, s->code);
+
+    cos_pool_destroy(p);
+
+    printf("test_resumable_upload_stream ok\n");
+}
+
+void test_resumable_upload_buffer(CuTest *tc)
+{
+    cos_pool_t *p = NULL;
+    char *object_name = "test_resumable_upload_buffer.dat";
+    cos_string_t bucket;
+    cos_string_t object;
+    cos_status_t *s = NULL;
+    int is_cname = 0;
+    cos_table_t *resp_headers = NULL;
+    cos_list_t resp_body;
+    cos_list_t buffer;
+    cos_list_t content;
+    cos_buf_t *b = NULL;
+    cos_request_options_t *options = NULL;
+    cos_resumable_clt_params_t *clt_params;
+    int64_t sizes[] = {300 * 1024, 1024 * 1024 + 17, 7, 2 * 1024 * 1024, 512 * 1024 - 1};
+    int64_t content_length = 0;
+    uint64_t crc64 = 0;
+    char *data = NULL;
+    int i = 0;
+
+    cos_pool_create(&p, NULL);
+    options = cos_request_options_create(p);
+    init_test_request_options(options, is_cname);
+    cos_str_set(&bucket, TEST_BUCKET_NAME);
+    cos_str_set(&object, object_name);
+    cos_list_init(&resp_body);
+
+    // the parts of 1MB cross the bounds of the buffers
+    cos_list_init(&buffer);
+    for (i = 0; i < (int)(sizeof(sizes) / sizeof(sizes[0])); i++) {
+        data = (char *)cos_palloc(p, (apr_size_t)sizes[i]);
+        memset(data, 'a' + i, (size_t)sizes[i]);
+        crc64 = cos_crc64(crc64, data, (size_t)sizes[i]);
+        b = cos_buf_pack(p, data, (int)sizes[i]);
+        cos_list_add_tail(&b->node, &buffer);
+        content_length += sizes[i];
+    }
+
+    cos_build_part_buffer(p, &buffer, 1024 * 1024, 1024 * 1024, &content);
+    CuAssertTrue(tc, cos_buf_list_len(&content) == 1024 * 1024);
+    b = cos_list_entry(content.next, cos_buf_t, node);
+    CuAssertIntEquals(tc, 'b', *b->pos);
+
+    clt_params = cos_create_resumable_clt_params_content(p, 1024 * 1024, 3, COS_FALSE, NULL);
+    s = cos_resumable_upload_buffer(options, &bucket, &object, &buffer, NULL, clt_params, 
+        percentage, &resp_headers, &resp_body);
+    CuAssertIntEquals(tc, 200, s->code);
+
+    // the buffer is not consumed by the upload
+    CuAssertTrue(tc, cos_buf_list_len(&buffer) == content_length);
+
+    cos_pool_destroy(p);
+
+    // head object
+    cos_pool_create(&p, NULL);
+    options = cos_request_options_create(p);
+    init_test_request_options(options, is_cname);
+    s = cos_head_object(options, &bucket, &object, NULL, &resp_headers);
+    CuAssertIntEquals(tc, 200, s->code);
+
+    CuAssertTrue(tc, content_length == atol((char*)apr_table_get(resp_headers, COS_CONTENT_LENGTH)));
+    CuAssertTrue(tc, crc64 == cos_atoui64((char*)apr_table_get(resp_headers, COS_HASH_CRC64_ECMA)));
+
+    cos_pool_destroy(p);
+
+    // an empty buffer is uploaded as one empty part
+    cos_pool_create(&p, NULL);
+    options = cos_request_options_create(p);
+    init_test_request_options(options, is_cname);
+    cos_list_init(&buffer);
+    cos_list_init(&resp_body);
+    clt_params = cos_create_resumable_clt_params_content(p, 1024 * 1024, 3, COS_FALSE, NULL);
+    s = cos_resumable_upload_buffer(options, &bucket, &object, &buffer, NULL, clt_params, 
+        NULL, &resp_headers, &resp_body);
+    CuAssertIntEquals(tc, 200, s->code);
+
+    cos_pool_destroy(p);
+
+    printf("test_resumable_upload_buffer ok\n");
+}
+
+int64_t read_stream_and_cancel(void *user_data, char *buffer, int64_t size)
+{
+    // the stream is cancelled once the first part is read
+    memset(buffer, 'c', (size_t)size);
+    cos_cancel((cos_cancel_token_t *)user_data);
+    return size;
+}
+
+void test_resumable_upload_cancelled(CuTest *tc)
+{
+    cos_pool_t *p = NULL;
+    char *object_name = "test_resumable_upload_cancelled.jpg";
+    char *cp_file = "test_resumable_upload_cancelled.ucp";
+    cos_string_t bucket;
+    cos_string_t object;
+    cos_string_t filename;
+    cos_status_t *s = NULL;
+    int is_cname = 0;
+    cos_table_t *resp_headers = NULL;
+    cos_list_t resp_body;
+    cos_request_options_t *options = NULL;
+    cos_resumable_clt_params_t *clt_params;
+    cos_cancel_token_t *parent;
+
+    cos_pool_create(&p, NULL);
+    options = cos_request_options_create(p);
+    init_test_request_options(options, is_cname);
+    cos_str_set(&bucket, TEST_BUCKET_NAME);
+    cos_str_set(&object, object_name);
+    cos_str_set(&filename, test_local_file);
+    cos_list_init(&resp_body);
+
+    // the token is cancelled with its parent
+    parent = cos_cancel_token_create(p, NULL);
+    options->cancel_token = cos_cancel_token_create(p, parent);
+    CuAssertIntEquals(tc, COS_FALSE, cos_is_cancelled(options->cancel_token));
+    cos_cancel(parent);
+    CuAssertIntEquals(tc, COS_TRUE, cos_is_cancelled(options->cancel_token));
+
+    // cancelled before the upload starts
+    clt_params = cos_create_resumable_clt_params_content(p, 1024 * 1024, 3, COS_TRUE, cp_file);
+    s = cos_resumable_upload_file(options, &bucket, &object, &filename, NULL, NULL, 
+        clt_params, NULL, &resp_headers, &resp_body);
+    CuAssertIntEquals(tc, COSE_CANCELLED, s->code);
+
+    // cancelled in the middle of the stream, the upload is aborted
+    options->cancel_token = cos_cancel_token_create(p, NULL);
+    options->cancel_token->abort_upload = COS_TRUE;
+    clt_params = cos_create_resumable_clt_params_content(p, 1024 * 1024, 3, COS_FALSE, NULL);
+    s = cos_resumable_upload_stream(options, &bucket, &object, NULL, clt_params, 
+        read_stream_and_cancel, options->cancel_token, NULL, &resp_headers, &resp_body);
+    CuAssertIntEquals(tc, COSE_CANCELLED, s->code);
+
+    options->cancel_token = NULL;
+    s = cos_head_object(options, &bucket, &object, NULL, &resp_headers);
+    CuAssertIntEquals(tc, 404, s->code);
+
+    cos_pool_destroy(p);
+
+    printf("test_resumable_upload_cancelled ok\n");
+}
+
 void test_resumable_download(CuTest *tc)
 {
     cos_pool_t *p = NULL;
@@ -1190,6 +1608,194 @@ void test_resumable_download(CuTest *tc)
     
 }
 
+void test_resumable_download_ex(CuTest *tc)
+{
+    cos_pool_t *p = NULL;
+    int is_cname = 0;
+    cos_status_t *s = NULL;
+    cos_request_options_t *options = NULL;
+    cos_string_t bucket;
+    cos_string_t object;
+    cos_string_t filepath;
+    cos_resumable_clt_params_t *clt_params;
+    
+    cos_pool_create(&p, NULL);
+    options = cos_request_options_create(p);
+    init_test_request_options(options, is_cname);
+    cos_str_set(&bucket, TEST_BUCKET_NAME);
+    cos_str_set(&object, "test_3M.dat");
+    cos_str_set(&filepath, "download.dat");
+
+    clt_params = cos_create_resumable_clt_params_content(p, 5*1024*1024, 3, COS_FALSE, NULL);
+    s = cos_resumable_download_file_without_cp_ex(options, &bucket, &object, &filepath, NULL, NULL, clt_params, NULL);
+    CuAssertIntEquals(tc, 0, s->code);
+
+    cos_pool_destroy(p);
+}
+
+int64_t compare_stream_with_file(void *user_data, const char *buffer, int64_t size)
+{
+    FILE *fd = (FILE *)user_data;
+    char *expected;
+    size_t bytes;
+
+    // the bytes must arrive in order
+    expected = (char *)malloc((size_t)size);
+    bytes = fread(expected, 1, (size_t)size, fd);
+    if (bytes != (size_t)size || memcmp(expected, buffer, bytes) != 0) {
+        size = -1;
+    }
+    free(expected);
+    return size;
+}
+
+void test_resumable_download_stream(CuTest *tc)
+{
+    cos_pool_t *p = NULL;
+    int is_cname = 0;
+    cos_status_t *s = NULL;
+    cos_request_options_t *options = NULL;
+    cos_string_t bucket;
+    cos_string_t object;
+    cos_resumable_clt_params_t *clt_params;
+    FILE *fd = NULL;
+    
+    cos_pool_create(&p, NULL);
+    options = cos_request_options_create(p);
+    init_test_request_options(options, is_cname);
+    cos_str_set(&bucket, TEST_BUCKET_NAME);
+    cos_str_set(&object, "test_resumable_upload_stream.jpg");
+
+    // 3 threads, but only 2 parts of 4MB are buffered ahead of the writer
+    fd = fopen(test_local_file, "rb");
+    CuAssertTrue(tc, fd != NULL);
+    clt_params = cos_create_resumable_clt_params_content(p, 4*1024*1024, 3, COS_FALSE, NULL);
+    clt_params->buffer_size = 8*1024*1024;
+    s = cos_resumable_download_stream(options, &bucket, &object, clt_params, 
+        compare_stream_with_file, fd, percentage);
+    CuAssertIntEquals(tc, 200, s->code);
+    CuAssertTrue(tc, (unsigned long)ftell(fd) == get_file_size(test_local_file));
+    fclose(fd);
+
+    // the download is aborted when the writer fails
+    fd = fopen(__FILE__, "rb");
+    CuAssertTrue(tc, fd != NULL);
+    s = cos_resumable_download_stream(options, &bucket, &object, clt_params, 
+        compare_stream_with_file, fd, NULL);
+    CuAssertIntEquals(tc, COSE_WRITE_BODY_ERROR, s->code);
+    fclose(fd);
+
+    cos_pool_destroy(p);
+
+    printf("test_resumable_download_stream ok\n");
+}
+
+void test_resumable_download_with_checkpoint(CuTest *tc)
+{
+    cos_pool_t *p = NULL;
+    int is_cname = 0;
+    cos_status_t *s = NULL;
+    cos_request_options_t *options = NULL;
+    cos_resumable_clt_params_t *clt_params;
+    cos_string_t bucket;
+    cos_string_t object;
+    cos_string_t filepath;
+    cos_string_t checkpoint_path;
+    
+    cos_pool_create(&p, NULL);
+    options = cos_request_options_create(p);
+    init_test_request_options(options, is_cname);
+    cos_str_set(&bucket, TEST_BUCKET_NAME);
+    cos_str_set(&object, "test_3M.dat");
+    cos_str_set(&filepath, "download_with_checkpoint.dat");
+
+    clt_params = cos_create_resumable_clt_params_content(p, 5*1024*1024, 3, COS_TRUE, NULL);
+    s = cos_resumable_download_file(options, &bucket, &object, &filepath, NULL, NULL, clt_params, NULL);
+    CuAssertIntEquals(tc, 200, s->code);
+
+    // checkpoint file is removed after success
+    cos_get_download_checkpoint_path(clt_params, &filepath, p, &checkpoint_path);
+    CuAssertTrue(tc, !cos_does_file_exist(&checkpoint_path, p));
+    CuAssertTrue(tc, cos_does_file_exist(&filepath, p));
+
+    apr_file_remove(filepath.data, p);
+    cos_pool_destroy(p);
+
+    printf("test_resumable_download_with_checkpoint ok\n");
+}
+
+void test_resumable_copy_object(CuTest *tc)
+{
+    cos_pool_t *p = NULL;
+    int is_cname = 0;
+    cos_status_t *s = NULL;
+    cos_request_options_t *options = NULL;
+    cos_resumable_clt_params_t *clt_params;
+    cos_string_t bucket;
+    cos_string_t object;
+    cos_string_t dest_object;
+    cos_string_t filepath;
+    cos_string_t copy_source;
+    cos_string_t checkpoint_path;
+    cos_string_t data;
+    cos_table_t *resp_headers = NULL;
+    int64_t content_length = 0;
+    char *local_filename = "test_resumable_copy_object.dat";
+    FILE *fd = NULL;
+    
+    cos_pool_create(&p, NULL);
+    options = cos_request_options_create(p);
+    init_test_request_options(options, is_cname);
+    cos_str_set(&bucket, TEST_BUCKET_NAME);
+    cos_str_set(&object, "test_resumable_copy_object_source.dat");
+    cos_str_set(&dest_object, "test_resumable_copy_object_dest.dat");
+
+    // the source of 3 parts of 16MB
+    make_rand_string(p, 40 * 1024 * 1024, &data);
+    fd = fopen(local_filename, "wb");
+    CuAssertTrue(tc, fd != NULL);
+    fwrite(data.data, sizeof(data.data[0]), data.len, fd);
+    fclose(fd);
+    cos_str_set(&filepath, local_filename);
+    clt_params = cos_create_resumable_clt_params_content(p, 4*1024*1024, 8, COS_FALSE, NULL);
+    s = cos_resumable_upload_file(options, &bucket, &object, &filepath, NULL, NULL, clt_params, NULL, NULL, NULL);
+    CuAssertIntEquals(tc, 200, s->code);
+
+    cos_str_set(&copy_source, cos_gen_copy_source(options, &bucket, &object));
+    clt_params = cos_create_resumable_clt_params_content(p, 16*1024*1024, 3, COS_TRUE, NULL);
+    s = cos_resumable_copy_object(options, &copy_source, &bucket, &dest_object, NULL, NULL, clt_params, 
+        percentage, NULL, NULL);
+    CuAssertIntEquals(tc, 200, s->code);
+
+    // checkpoint file is removed after success
+    cos_get_copy_checkpoint_path(clt_params, &copy_source, &bucket, &dest_object, p, &checkpoint_path);
+    CuAssertTrue(tc, !cos_does_file_exist(&checkpoint_path, p));
+
+    s = cos_head_object(options, &bucket, &dest_object, NULL, &resp_headers);
+    CuAssertIntEquals(tc, 200, s->code);
+    content_length = atol((char*)apr_table_get(resp_headers, COS_CONTENT_LENGTH));
+    CuAssertTrue(tc, content_length == get_file_size(local_filename));
+
+    // the object of one part is copied by a single request
+    cos_str_set(&copy_source, cos_gen_copy_source(options, &bucket, &dest_object));
+    cos_str_set(&dest_object, "test_resumable_copy_object_small.dat");
+    clt_params = cos_create_resumable_clt_params_content(p, 64*1024*1024, 3, COS_FALSE, NULL);
+    s = cos_resumable_copy_object(options, &copy_source, &bucket, &dest_object, NULL, NULL, clt_params, 
+        NULL, NULL, NULL);
+    CuAssertIntEquals(tc, 200, s->code);
+
+    // the copy source without object
+    cos_str_set(&copy_source, "invalid-copy-source");
+    s = cos_resumable_copy_object(options, &copy_source, &bucket, &dest_object, NULL, NULL, clt_params, 
+        NULL, NULL, NULL);
+    CuAssertIntEquals(tc, COSE_INVALID_ARGUMENT, s->code);
+
+    remove(local_filename);
+    cos_pool_destroy(p);
+
+    printf("test_resumable_copy_object ok\n");
+}
+
 
 CuSuite *test_cos_resumable()
 {
@@ -1202,7 +1808,9 @@ CuSuite *test_cos_resumable()
     SUITE_ADD_TEST(suite, test_resumable_cos_does_file_exist);
     SUITE_ADD_TEST(suite, test_resumable_cos_dump_checkpoint);
     SUITE_ADD_TEST(suite, test_resumable_cos_load_checkpoint);
+    SUITE_ADD_TEST(suite, test_resumable_cos_append_checkpoint);
     SUITE_ADD_TEST(suite, test_resumable_cos_is_upload_checkpoint_valid);
+    SUITE_ADD_TEST(suite, test_resumable_cos_is_download_checkpoint_valid);
     SUITE_ADD_TEST(suite, test_resumable_checkpoint_xml);
     SUITE_ADD_TEST(suite, test_resumable_upload_without_checkpoint);
     SUITE_ADD_TEST(suite, test_resumable_upload_with_checkpoint);
@@ -1216,7 +1824,14 @@ CuSuite *test_cos_resumable()
     SUITE_ADD_TEST(suite, test_resumable_upload_with_file_path_invalid);
     SUITE_ADD_TEST(suite, test_resumable_upload_progress_without_checkpoint);
     SUITE_ADD_TEST(suite, test_resumable_upload_progress_with_checkpoint);
+    SUITE_ADD_TEST(suite, test_resumable_upload_stream);
+    SUITE_ADD_TEST(suite, test_resumable_upload_buffer);
+    SUITE_ADD_TEST(suite, test_resumable_upload_cancelled);
     SUITE_ADD_TEST(suite, test_resumable_download);
+    SUITE_ADD_TEST(suite, test_resumable_download_ex);
+    SUITE_ADD_TEST(suite, test_resumable_download_with_checkpoint);
+    SUITE_ADD_TEST(suite, test_resumable_download_stream);
+    SUITE_ADD_TEST(suite, test_resumable_copy_object);
     SUITE_ADD_TEST(suite, test_resumable_cleanup);
      
     return suite;
@@ -9,6 +9,9 @@
 #include "cos_xml.h"
 #include "cos_utility.h"
 #include "cos_transport.h"
+#include "cos_thread_pool.h"
+#include "cos_resumable.h"
+#include "cos_buf.h"
 
 extern int starts_with(const cos_string_t *str, const char *prefix);
 extern int cos_curl_code_to_status(CURLcode code);
@@ -30,6 +33,126 @@ void test_get_xml_doc_with_empty_cos_list(CuTest *tc)
     printf("test_get_xml_doc_with_empty_cos_list ok\n");
 }
 
+void test_cos_list_objects_parse_from_body(CuTest *tc)
+{
+    int ret;
+    int i;
+    int len;
+    int truncated = 1;
+    cos_pool_t *p = NULL;
+    cos_buf_t *b = NULL;
+    cos_list_t bc;
+    cos_list_t object_list;
+    cos_list_t common_prefix_list;
+    cos_string_t marker;
+    cos_list_object_content_t *content = NULL;
+    cos_list_object_common_prefix_t *common_prefix = NULL;
+    const char *xml = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+        "<ListBucketResult>\n"
+        "  <Prefix>a</Prefix>\n"
+        "  <NextMarker>a&amp;b/2</NextMarker>\n"
+        "  <IsTruncated>false</IsTruncated>\n"
+        "  <Contents>\n"
+        "    <Key>a&amp;b/1&#x4e2d;</Key>\n"
+        "    <LastModified>2026-01-02T03:04:05.000Z</LastModified>\n"
+        "    <ETag>&quot;0123&quot;</ETag>\n"
+        "    <Size>10</Size>\n"
+        "    <Owner><ID>1250000000</ID><DisplayName/></Owner>\n"
+        "    <StorageClass>STANDARD</StorageClass>\n"
+        "  </Contents>\n"
+        "  <CommonPrefixes><Prefix>a/c/</Prefix></CommonPrefixes>\n"
+        "</ListBucketResult>\n";
+
+    // the body is split into small chunks, a tag or an entity spans chunks
+    cos_pool_create(&p, NULL);
+    cos_list_init(&bc);
+    len = strlen(xml);
+    for (i = 0; i < len; i += 7) {
+        b = cos_buf_pack(p, xml + i, cos_min(7, len - i));
+        cos_list_add_tail(&b->node, &bc);
+    }
+    cos_list_init(&object_list);
+    cos_list_init(&common_prefix_list);
+    cos_str_null(&marker);
+
+    ret = cos_list_objects_parse_from_body(p, &bc, &object_list, &common_prefix_list, &marker, &truncated);
+    CuAssertIntEquals(tc, COSE_OK, ret);
+    CuAssertIntEquals(tc, 0, truncated);
+    CuAssertStrEquals(tc, "a&b/2", marker.data);
+    CuAssertTrue(tc, !cos_list_empty(&object_list));
+    content = cos_list_entry(object_list.next, cos_list_object_content_t, node);
+    CuAssertStrEquals(tc, "a&b/1\xe4\xb8\xad", content->key.data);
+    CuAssertIntEquals(tc, 8, content->key.len);
+    CuAssertStrEquals(tc, "\"0123\"", content->etag.data);
+    CuAssertStrEquals(tc, "10", content->size.data);
+    CuAssertTrue(tc, 10 == content->object_size);
+    CuAssertTrue(tc, 1767323045 == content->last_modified_epoch);
+    CuAssertStrEquals(tc, "1250000000", content->owner_id.data);
+    CuAssertStrEquals(tc, "STANDARD", content->storage_class.data);
+    CuAssertTrue(tc, content->node.next == &object_list);
+    common_prefix = cos_list_entry(common_prefix_list.next, cos_list_object_common_prefix_t, node);
+    CuAssertStrEquals(tc, "a/c/", common_prefix->prefix.data);
+
+    // a truncated body fails
+    cos_list_init(&bc);
+    b = cos_buf_pack(p, xml, len - 30);
+    cos_list_add_tail(&b->node, &bc);
+    cos_list_init(&object_list);
+    cos_list_init(&common_prefix_list);
+    ret = cos_list_objects_parse_from_body(p, &bc, &object_list, &common_prefix_list, &marker, &truncated);
+    CuAssertIntEquals(tc, COSE_XML_PARSE_ERROR, ret);
+
+    // with zero_copy the plain values point into the body, the escaped ones are copied
+    cos_list_init(&bc);
+    b = cos_buf_pack(p, xml, len);
+    cos_list_add_tail(&b->node, &bc);
+    cos_list_init(&object_list);
+    cos_list_init(&common_prefix_list);
+    ret = cos_do_list_objects_parse_from_body(p, &bc, &object_list, &common_prefix_list, &marker, &truncated, COS_TRUE);
+    CuAssertIntEquals(tc, COSE_OK, ret);
+    content = cos_list_entry(object_list.next, cos_list_object_content_t, node);
+    CuAssertTrue(tc, content->storage_class.data > xml && content->storage_class.data < xml + len);
+    CuAssertIntEquals(tc, 0, strncmp("STANDARD", content->storage_class.data, content->storage_class.len));
+    CuAssertTrue(tc, content->key.data < xml || content->key.data >= xml + len);
+    CuAssertStrEquals(tc, "a&b/1\xe4\xb8\xad", content->key.data);
+    CuAssertTrue(tc, 10 == content->object_size);
+    CuAssertTrue(tc, 1767323045 == content->last_modified_epoch);
+
+    cos_pool_destroy(p);
+
+    printf("test_cos_list_objects_parse_from_body ok\n");
+}
+
+void test_build_complete_multipart_upload_body(CuTest *tc)
+{
+    int i;
+    cos_pool_t *p = NULL;
+    cos_list_t part_list;
+    cos_list_t body;
+    cos_complete_part_content_t *content = NULL;
+    char *xml = NULL;
+
+    cos_pool_create(&p, NULL);
+    cos_list_init(&part_list);
+    for (i = 1; i <= 2; i++) {
+        content = cos_create_complete_part_content(p);
+        cos_str_set(&content->part_number, apr_psprintf(p, "%d", i));
+        cos_str_set(&content->etag, apr_psprintf(p, "\"etag%d\"", i));
+        cos_list_add_tail(&content->node, &part_list);
+    }
+
+    build_complete_multipart_upload_body(p, &part_list, &body);
+    xml = cos_buf_list_content(p, &body);
+    CuAssertStrEquals(tc, "<?xml version=\"1.0\"?><CompleteMultipartUpload>"
+        "<Part><PartNumber>1</PartNumber><ETag>&quot;etag1&quot;</ETag></Part>"
+        "<Part><PartNumber>2</PartNumber><ETag>&quot;etag2&quot;</ETag></Part>"
+        "</CompleteMultipartUpload>", xml);
+
+    cos_pool_destroy(p);
+
+    printf("test_build_complete_multipart_upload_body ok\n");
+}
+
 /*
  * cos_list.h
  */
@@ -389,9 +512,34 @@ void test_cos_should_retry(CuTest *tc) {
     cos_status_set(&s, 200, NULL, NULL);
     CuAssertIntEquals(tc, 0, cos_should_retry(&s));
 
+    cos_status_set(&s, COSE_CONNECTION_FAILED, "HttpIoError", NULL);
+    CuAssertIntEquals(tc, 1, cos_should_retry(&s));
+
+    cos_status_set(&s, COSE_CANCELLED, "HttpIoError", NULL);
+    CuAssertIntEquals(tc, 0, cos_should_retry(&s));
+
     printf("test_cos_should_retry ok\n");
 }
 
+void test_cos_status_is_throttled(CuTest *tc) {
+    cos_status_t s;
+    cos_status_set(&s, 503, "SlowDown", "");
+    CuAssertIntEquals(tc, 1, cos_status_is_throttled(&s));
+
+    cos_status_set(&s, 503, NULL, NULL);
+    CuAssertIntEquals(tc, 1, cos_status_is_throttled(&s));
+
+    cos_status_set(&s, 500, "InternalError", "");
+    CuAssertIntEquals(tc, 0, cos_status_is_throttled(&s));
+
+    cos_status_set(&s, 200, NULL, NULL);
+    CuAssertIntEquals(tc, 0, cos_status_is_throttled(&s));
+
+    CuAssertIntEquals(tc, 0, cos_status_is_throttled(NULL));
+
+    printf("test_cos_status_is_throttled ok\n");
+}
+
 void test_cos_strtoll(CuTest *tc)
 {
     int64_t val = 0;
@@ -448,11 +596,429 @@ void test_cos_strtoull(CuTest *tc)
     CuAssertTrue(tc, val == UINT64_MAX);
 }
 
+/*
+ * cos_thread_pool.c
+ */
+void test_cos_thread_pool_size(CuTest *tc)
+{
+    cos_thread_pool_t *thrp = NULL;
+    cos_task_group_t normal_group;
+    cos_task_group_t high_group;
+    int size = cos_get_thread_pool_size();
+
+    CuAssertIntEquals(tc, COSE_INVALID_ARGUMENT, cos_set_thread_pool_size(0));
+    CuAssertIntEquals(tc, COSE_INVALID_ARGUMENT, cos_set_thread_pool_size(COS_MAX_THREAD_POOL_SIZE + 1));
+    CuAssertIntEquals(tc, size, cos_get_thread_pool_size());
+
+    // the pool is shared by all transfers
+    thrp = cos_get_thread_pool();
+    CuAssertTrue(tc, thrp != NULL);
+    CuAssertTrue(tc, thrp == cos_get_thread_pool());
+
+    // resize the existing pool
+    CuAssertIntEquals(tc, COSE_OK, cos_set_thread_pool_size(8));
+    CuAssertIntEquals(tc, 8, cos_get_thread_pool_size());
+    CuAssertTrue(tc, thrp == cos_get_thread_pool());
+
+    // a lone transfer is limited by its own thread_num
+    cos_task_group_init(thrp, &normal_group, COS_TASK_PRIORITY_NORMAL, 6, COS_FALSE);
+    CuAssertIntEquals(tc, 6, cos_task_group_limit(thrp, &normal_group));
+
+    // concurrent transfers share the threads by the weight of their priority
+    cos_task_group_init(thrp, &high_group, COS_TASK_PRIORITY_HIGH, 16, COS_FALSE);
+    CuAssertIntEquals(tc, 2, cos_task_group_limit(thrp, &normal_group));
+    CuAssertIntEquals(tc, 5, cos_task_group_limit(thrp, &high_group));
+
+    cos_task_group_destroy(thrp, &high_group);
+    CuAssertIntEquals(tc, 6, cos_task_group_limit(thrp, &normal_group));
+    cos_task_group_destroy(thrp, &normal_group);
+
+    CuAssertIntEquals(tc, COSE_OK, cos_set_thread_pool_size(size));
+}
+
+void * APR_THREAD_FUNC report_worker_pool(apr_thread_t *thd, void *data)
+{
+    cos_pool_t *pool = cos_get_worker_pool(thd);
+    // the task allocates from the pool of its worker, it is cleared after the task
+    if (NULL != pool) {
+        cos_palloc(pool, 1024);
+    }
+    apr_queue_push((apr_queue_t *)data, pool);
+    return NULL;
+}
+
+void test_cos_worker_pool(CuTest *tc)
+{
+    cos_pool_t *p = NULL;
+    cos_thread_pool_t *thrp = NULL;
+    apr_queue_t *queue = NULL;
+    void *pool = NULL;
+
+    cos_pool_create(&p, NULL);
+    CuAssertTrue(tc, NULL == cos_get_worker_pool(NULL));
+
+    thrp = cos_get_thread_pool();
+    CuAssertTrue(tc, thrp != NULL);
+    CuAssertIntEquals(tc, APR_SUCCESS, apr_queue_create(&queue, 1, p));
+    CuAssertIntEquals(tc, COSE_OK, cos_thread_pool_push(thrp, report_worker_pool, queue, COS_TASK_PRIORITY_NORMAL));
+    CuAssertIntEquals(tc, APR_SUCCESS, apr_queue_pop(queue, &pool));
+    CuAssertTrue(tc, pool != NULL);
+
+    cos_pool_destroy(p);
+}
+
+typedef struct {
+    apr_queue_t *gate;
+    apr_queue_t *order;
+    int priority;
+} priority_task_t;
+
+void * APR_THREAD_FUNC block_worker(apr_thread_t *thd, void *data)
+{
+    void *ignored = NULL;
+    apr_queue_pop((apr_queue_t *)data, &ignored);
+    return NULL;
+}
+
+void * APR_THREAD_FUNC report_task_priority(apr_thread_t *thd, void *data)
+{
+    priority_task_t *task = (priority_task_t *)data;
+    apr_queue_push(task->order, &task->priority);
+    return NULL;
+}
+
+void test_cos_thread_pool_priority(CuTest *tc)
+{
+    cos_pool_t *p = NULL;
+    cos_thread_pool_t *thrp = NULL;
+    apr_queue_t *gate = NULL;
+    apr_queue_t *order = NULL;
+    priority_task_t tasks[3];
+    void *priority = NULL;
+    int size = cos_get_thread_pool_size();
+    int i;
+
+    cos_pool_create(&p, NULL);
+    thrp = cos_get_thread_pool();
+    CuAssertTrue(tc, thrp != NULL);
+    CuAssertIntEquals(tc, APR_SUCCESS, apr_queue_create(&gate, 1, p));
+    CuAssertIntEquals(tc, APR_SUCCESS, apr_queue_create(&order, 3, p));
+
+    // both running workers are busy, so the tasks below are queued
+    CuAssertIntEquals(tc, COSE_OK, cos_set_thread_pool_size(2));
+    for (i = 0; i < 2; i++) {
+        CuAssertIntEquals(tc, COSE_OK, cos_thread_pool_push(thrp, block_worker, gate, COS_TASK_PRIORITY_NORMAL));
+    }
+    for (i = 0; i < 3; i++) {
+        tasks[i].gate = gate;
+        tasks[i].order = order;
+        tasks[i].priority = (2 == i) ? COS_TASK_PRIORITY_HIGH : COS_TASK_PRIORITY_NORMAL;
+        CuAssertIntEquals(tc, COSE_OK, cos_thread_pool_push(thrp, report_task_priority, &tasks[i], tasks[i].priority));
+    }
+
+    // the task of high priority is taken before the queued ones, whichever worker is freed
+    CuAssertIntEquals(tc, APR_SUCCESS, apr_queue_push(gate, NULL));
+    CuAssertIntEquals(tc, APR_SUCCESS, apr_queue_pop(order, &priority));
+    CuAssertIntEquals(tc, COS_TASK_PRIORITY_HIGH, *(int *)priority);
+    CuAssertIntEquals(tc, APR_SUCCESS, apr_queue_push(gate, NULL));
+    for (i = 0; i < 2; i++) {
+        CuAssertIntEquals(tc, APR_SUCCESS, apr_queue_pop(order, &priority));
+        CuAssertIntEquals(tc, COS_TASK_PRIORITY_NORMAL, *(int *)priority);
+    }
+
+    CuAssertIntEquals(tc, COSE_OK, cos_set_thread_pool_size(size));
+    cos_pool_destroy(p);
+}
+
+void test_cos_task_group_auto_tune(CuTest *tc)
+{
+    cos_thread_pool_t *thrp = NULL;
+    cos_task_group_t group;
+
+    thrp = cos_get_thread_pool();
+    CuAssertTrue(tc, thrp != NULL);
+
+    // the window starts at thread_num
+    cos_task_group_init(thrp, &group, COS_TASK_PRIORITY_NORMAL, 2, COS_TRUE);
+    CuAssertIntEquals(tc, 2, cos_task_group_limit(thrp, &group));
+
+    // grows by one after a window of fast parts
+    cos_task_group_feedback(thrp, &group, 1024 * 1024, 100000, COS_FALSE);
+    CuAssertIntEquals(tc, 2, cos_task_group_limit(thrp, &group));
+    cos_task_group_feedback(thrp, &group, 1024 * 1024, 100000, COS_FALSE);
+    CuAssertIntEquals(tc, 3, cos_task_group_limit(thrp, &group));
+    CuAssertTrue(tc, cos_thread_pool_stream_rate(thrp) > 0);
+
+    // holds when the parts slow down
+    cos_task_group_feedback(thrp, &group, 1024 * 1024, 1000000, COS_FALSE);
+    cos_task_group_feedback(thrp, &group, 1024 * 1024, 1000000, COS_FALSE);
+    cos_task_group_feedback(thrp, &group, 1024 * 1024, 1000000, COS_FALSE);
+    CuAssertIntEquals(tc, 3, cos_task_group_limit(thrp, &group));
+
+    // halves when throttled, never below one
+    cos_task_group_feedback(thrp, &group, 1024 * 1024, 0, COS_TRUE);
+    CuAssertIntEquals(tc, 1, cos_task_group_limit(thrp, &group));
+    cos_task_group_feedback(thrp, &group, 1024 * 1024, 0, COS_TRUE);
+    CuAssertIntEquals(tc, 1, cos_task_group_limit(thrp, &group));
+
+    cos_task_group_destroy(thrp, &group);
+
+    // the part size follows the observed throughput within the bounds
+    CuAssertTrue(tc, cos_get_auto_tune_part_size(1024 * 1024 * 1024L, 1) >= COS_AUTO_TUNE_MIN_PART_SIZE);
+    CuAssertTrue(tc, cos_get_auto_tune_part_size(1024 * 1024 * 1024L, 1) <= COS_AUTO_TUNE_MAX_PART_SIZE);
+    CuAssertIntEquals(tc, COS_AUTO_TUNE_MIN_PART_SIZE, cos_get_auto_tune_part_size(1024, 4));
+}
+
+void test_cos_get_part_task_failure(CuTest *tc)
+{
+    cos_pool_t *p = NULL;
+    apr_queue_t *failed_parts = NULL;
+    cos_checkpoint_part_t parts[3];
+    cos_part_task_result_t results[3];
+    cos_status_t *s = NULL;
+    int i;
+
+    cos_pool_create(&p, NULL);
+    apr_queue_create(&failed_parts, 3, p);
+
+    // the first failure is reported, the parts aborted by it are not listed
+    for (i = 0; i < 3; i++) {
+        parts[i].index = i * 2 + 1;
+        results[i].part = parts + i;
+        results[i].s = cos_status_create(p);
+    }
+    cos_status_set(results[0].s, 500, "InternalError", "We encountered an internal error.");
+    cos_status_set(results[1].s, COSE_CANCELLED, "HttpIoError", "request cancelled.");
+    cos_status_set(results[2].s, COSE_CONNECTION_FAILED, "HttpIoError", NULL);
+    for (i = 0; i < 3; i++) {
+        apr_queue_push(failed_parts, results + i);
+    }
+    s = cos_get_part_task_failure(p, failed_parts);
+    CuAssertIntEquals(tc, 500, s->code);
+    CuAssertStrEquals(tc, "InternalError", s->error_code);
+    CuAssertStrEquals(tc, "We encountered an internal error., failed parts:2,6", s->error_msg);
+
+    // cancelled by the caller
+    apr_queue_push(failed_parts, results + 1);
+    s = cos_get_part_task_failure(p, failed_parts);
+    CuAssertIntEquals(tc, COSE_CANCELLED, s->code);
+    CuAssertStrEquals(tc, "request cancelled.", s->error_msg);
+
+    cos_pool_destroy(p);
+
+    printf("test_cos_get_part_task_failure ok\n");
+}
+
+void * APR_THREAD_FUNC report_part_result(apr_thread_t *thd, void *data)
+{
+    cos_transport_thread_params_t *params = (cos_transport_thread_params_t *)data;
+    apr_queue_push(params->completed_parts, params->result);
+    return NULL;
+}
+
+void test_cos_wait_part_task_result_with_backoff(CuTest *tc)
+{
+    cos_pool_t *p = NULL;
+    cos_request_options_t *options = NULL;
+    cos_thread_pool_t *thrp = NULL;
+    cos_task_group_t group;
+    cos_checkpoint_part_t parts[2];
+    cos_part_task_result_t results[2];
+    cos_transport_thread_params_t thr_params[2];
+    cos_part_task_result_t *task_res = NULL;
+    apr_uint32_t launched = 0;
+    apr_uint32_t failed = 0;
+    apr_uint32_t completed = 0;
+    apr_queue_t *failed_parts = NULL;
+    apr_queue_t *completed_parts = NULL;
+    apr_time_t start;
+
+    cos_pool_create(&p, NULL);
+    options = cos_request_options_create(p);
+    thrp = cos_get_thread_pool();
+    CuAssertTrue(tc, thrp != NULL);
+    apr_queue_create(&failed_parts, 2, p);
+    apr_queue_create(&completed_parts, 2, p);
+    cos_build_parts(2, 1, parts);
+    cos_build_thread_params(thr_params, 2, p, options, NULL, NULL, NULL, NULL, parts, results);
+    cos_set_task_tracker(thr_params, 2, &launched, &failed, &completed, failed_parts, completed_parts);
+    cos_task_group_init(thrp, &group, COS_TASK_PRIORITY_NORMAL, 2, COS_FALSE);
+
+    // the part backing off does not hold the results of the others
+    start = apr_time_now();
+    results[0].retrying = COS_TRUE;
+    results[0].retry_at = start + 200 * 1000;
+    cos_relaunch_part_task(thrp, &group, report_part_result, thr_params);
+    cos_launch_part_task(thrp, &group, report_part_result, thr_params + 1);
+    CuAssertIntEquals(tc, APR_SUCCESS, cos_wait_part_task_result(thrp, &group, completed_parts, &task_res));
+    CuAssertTrue(tc, task_res == results + 1);
+    CuAssertTrue(tc, apr_time_now() < results[0].retry_at);
+
+    // it is relaunched when it is due
+    CuAssertIntEquals(tc, APR_SUCCESS, cos_wait_part_task_result(thrp, &group, completed_parts, &task_res));
+    CuAssertTrue(tc, task_res == results);
+    CuAssertIntEquals(tc, COS_FALSE, results[0].retrying);
+    CuAssertTrue(tc, apr_time_now() >= results[0].retry_at);
+    CuAssertTrue(tc, cos_list_empty(&group.delayed));
+
+    cos_task_group_destroy(thrp, &group);
+    cos_destroy_thread_pool(thr_params, 2);
+    cos_pool_destroy(p);
+
+    printf("test_cos_wait_part_task_result_with_backoff ok\n");
+}
+
+void test_cos_file_read_write_at(CuTest *tc)
+{
+    cos_pool_t *p = NULL;
+    apr_file_t *file = NULL;
+    char *filename = "cos_file_read_write_at.txt";
+    char buf[16];
+    apr_size_t len;
+    int rv;
+
+    cos_pool_create(&p, NULL);
+    rv = apr_file_open(&file, filename, APR_CREATE | APR_READ | APR_WRITE | APR_TRUNCATE,
+        APR_UREAD | APR_UWRITE | APR_GREAD, p);
+    CuAssertIntEquals(tc, APR_SUCCESS, rv);
+
+    // the parts are written out of order, the file offset is not used
+    len = 5;
+    rv = cos_file_write_at(file, 6, "world", &len);
+    CuAssertIntEquals(tc, APR_SUCCESS, rv);
+    CuAssertIntEquals(tc, 5, (int)len);
+    len = 6;
+    rv = cos_file_write_at(file, 0, "hello ", &len);
+    CuAssertIntEquals(tc, APR_SUCCESS, rv);
+
+    len = 5;
+    rv = cos_file_read_at(file, 6, buf, &len);
+    CuAssertIntEquals(tc, APR_SUCCESS, rv);
+    CuAssertIntEquals(tc, 5, (int)len);
+    CuAssertTrue(tc, 0 == memcmp(buf, "world", 5));
+
+    len = sizeof(buf);
+    rv = cos_file_read_at(file, 0, buf, &len);
+    CuAssertIntEquals(tc, APR_SUCCESS, rv);
+    CuAssertIntEquals(tc, 11, (int)len);
+    CuAssertTrue(tc, 0 == memcmp(buf, "hello world", 11));
+
+    len = sizeof(buf);
+    rv = cos_file_read_at(file, 11, buf, &len);
+    CuAssertIntEquals(tc, APR_EOF, rv);
+
+    apr_file_close(file);
+    apr_file_remove(filename, p);
+    cos_pool_destroy(p);
+
+    printf("test_cos_file_read_write_at ok\n");
+}
+
+void test_cos_file_read_direct(CuTest *tc)
+{
+    cos_pool_t *p = NULL;
+    apr_file_t *file = NULL;
+    cos_file_buf_t *fb = NULL;
+    char *filename = "cos_file_read_direct.txt";
+    char buf[16];
+    apr_size_t len;
+    int rv;
+
+    cos_pool_create(&p, NULL);
+    rv = apr_file_open(&file, filename, APR_CREATE | APR_READ | APR_WRITE | APR_TRUNCATE,
+        APR_UREAD | APR_UWRITE | APR_GREAD, p);
+    CuAssertIntEquals(tc, APR_SUCCESS, rv);
+    len = 11;
+    rv = cos_file_write_at(file, 0, "hello world", &len);
+    CuAssertIntEquals(tc, APR_SUCCESS, rv);
+
+    // the range starts at an unaligned offset, it is served from the aligned buffer
+    fb = cos_create_file_buf(p);
+    cos_share_file_for_range(file, 6, 11, fb);
+    fb->align_buf = cos_create_aligned_buf(p, COS_DIRECT_IO_ALIGN, COS_DIRECT_IO_ALIGN);
+    CuAssertIntEquals(tc, 0, (int)((uintptr_t)fb->align_buf->start % COS_DIRECT_IO_ALIGN));
+
+    len = 3;
+    rv = cos_file_read_direct(fb, buf, &len);
+    CuAssertIntEquals(tc, APR_SUCCESS, rv);
+    CuAssertIntEquals(tc, 3, (int)len);
+    CuAssertTrue(tc, 0 == memcmp(buf, "wor", 3));
+
+    len = sizeof(buf);
+    rv = cos_file_read_direct(fb, buf, &len);
+    CuAssertIntEquals(tc, APR_SUCCESS, rv);
+    CuAssertIntEquals(tc, 2, (int)len);
+    CuAssertTrue(tc, 0 == memcmp(buf, "ld", 2));
+    CuAssertTrue(tc, 11 == fb->file_pos);
+
+    len = sizeof(buf);
+    rv = cos_file_read_direct(fb, buf, &len);
+    CuAssertIntEquals(tc, APR_EOF, rv);
+
+    apr_file_close(file);
+    apr_file_remove(filename, p);
+    cos_pool_destroy(p);
+
+    printf("test_cos_file_read_direct ok\n");
+}
+
+void test_cos_write_behind(CuTest *tc)
+{
+    cos_pool_t *p = NULL;
+    apr_file_t *file = NULL;
+    cos_write_behind_t *wb = NULL;
+    char *filename = "cos_write_behind.txt";
+    char *chunk = NULL;
+    char *data = NULL;
+    int chunk_size = 64 * 1024;
+    int chunk_num = 40;
+    int64_t file_pos = 100;
+    apr_size_t len;
+    int i;
+    int rv;
+
+    cos_pool_create(&p, NULL);
+    rv = apr_file_open(&file, filename, APR_CREATE | APR_READ | APR_WRITE | APR_TRUNCATE,
+        APR_UREAD | APR_UWRITE | APR_GREAD, p);
+    CuAssertIntEquals(tc, APR_SUCCESS, rv);
+
+    // more data than the buffers, the writer has to return them while the data is received
+    rv = cos_write_behind_create(p, file, file_pos, 0, &wb);
+    CuAssertIntEquals(tc, APR_SUCCESS, rv);
+    chunk = (char *)cos_palloc(p, chunk_size);
+    for (i = 0; i < chunk_num; i++) {
+        memset(chunk, 'a' + i % 26, chunk_size);
+        CuAssertIntEquals(tc, chunk_size, cos_write_behind_write(wb, chunk, chunk_size));
+    }
+    CuAssertIntEquals(tc, 5, cos_write_behind_write(wb, "hello", 5));
+    rv = cos_write_behind_finish(wb);
+    CuAssertIntEquals(tc, APR_SUCCESS, rv);
+
+    len = chunk_size * chunk_num + 5;
+    data = (char *)cos_palloc(p, len);
+    rv = cos_file_read_at(file, file_pos, data, &len);
+    CuAssertIntEquals(tc, APR_SUCCESS, rv);
+    CuAssertIntEquals(tc, chunk_size * chunk_num + 5, (int)len);
+    for (i = 0; i < chunk_num; i++) {
+        CuAssertTrue(tc, data[i * chunk_size] == 'a' + i % 26);
+        CuAssertTrue(tc, data[(i + 1) * chunk_size - 1] == 'a' + i % 26);
+    }
+    CuAssertTrue(tc, 0 == memcmp(data + chunk_size * chunk_num, "hello", 5));
+
+    apr_file_close(file);
+    apr_file_remove(filename, p);
+    cos_pool_destroy(p);
+
+    printf("test_cos_write_behind ok\n");
+}
+
 CuSuite *test_cos_sys()
 {
     CuSuite* suite = CuSuiteNew();   
 
     SUITE_ADD_TEST(suite, test_get_xml_doc_with_empty_cos_list);
+    SUITE_ADD_TEST(suite, test_cos_list_objects_parse_from_body);
+    SUITE_ADD_TEST(suite, test_build_complete_multipart_upload_body);
     SUITE_ADD_TEST(suite, test_cos_list_movelist_with_empty_list);
     SUITE_ADD_TEST(suite, test_starts_with_failed);
     SUITE_ADD_TEST(suite, test_is_valid_ip);
@@ -473,8 +1039,18 @@ CuSuite *test_cos_sys()
     SUITE_ADD_TEST(suite, test_cos_url_decode_with_add);
     SUITE_ADD_TEST(suite, test_cos_url_decode_failed);
     SUITE_ADD_TEST(suite, test_cos_should_retry);
+    SUITE_ADD_TEST(suite, test_cos_status_is_throttled);
     SUITE_ADD_TEST(suite, test_cos_strtoll);
     SUITE_ADD_TEST(suite, test_cos_strtoull);
+    SUITE_ADD_TEST(suite, test_cos_thread_pool_size);
+    SUITE_ADD_TEST(suite, test_cos_task_group_auto_tune);
+    SUITE_ADD_TEST(suite, test_cos_worker_pool);
+    SUITE_ADD_TEST(suite, test_cos_thread_pool_priority);
+    SUITE_ADD_TEST(suite, test_cos_get_part_task_failure);
+    SUITE_ADD_TEST(suite, test_cos_wait_part_task_result_with_backoff);
+    SUITE_ADD_TEST(suite, test_cos_file_read_write_at);
+    SUITE_ADD_TEST(suite, test_cos_file_read_direct);
+    SUITE_ADD_TEST(suite, test_cos_write_behind);
 
     return suite;
 }